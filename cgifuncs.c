@@ -75,6 +75,209 @@ FindCGIParameter(const char *pcToFind, char *pcParam[], int32_t iNumParams)
     return(-1);
 }
 
+//*****************************************************************************
+//
+// The value of each character as a hexadecimal digit, 0xFF if it is not one.
+//
+//*****************************************************************************
+static const uint8_t g_pui8HexValue[256] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+//*****************************************************************************
+//
+// Word at a time scanning.  CGI_SWAR_ZERO is nonzero if any byte of the
+// 32-bit word is zero, CGI_SWAR_MATCH if any byte equals the character c.
+// Only the lowest byte they flag is certain, the scans use them to decide
+// whether a word is clean.  CGI_SWAR_EQUAL is exact: it has the top bit set
+// in each byte equal to c and nothing else.
+//
+//*****************************************************************************
+#define CGI_SWAR_ONES           0x01010101
+#define CGI_SWAR_LOWS           0x7F7F7F7F
+#define CGI_SWAR_HIGHS          0x80808080
+#define CGI_SWAR_ZERO(w)        (((w) - CGI_SWAR_ONES) & ~(w) & CGI_SWAR_HIGHS)
+#define CGI_SWAR_MATCH(w, c)                                                  \
+        CGI_SWAR_ZERO((w) ^ (CGI_SWAR_ONES * (uint8_t)(c)))
+#define CGI_SWAR_EQUAL(w, c)    CGI_SWAR_EQUAL_ZERO((w) ^                    \
+                                    (CGI_SWAR_ONES * (uint8_t)(c)))
+#define CGI_SWAR_EQUAL_ZERO(x)                                                \
+        (~((((x) & CGI_SWAR_LOWS) + CGI_SWAR_LOWS) | (x) | CGI_SWAR_LOWS))
+
+//*****************************************************************************
+//
+// The word scans read the whole aligned word holding the terminator, up to
+// three bytes past the end of the string.  On the Cortex-M4 this is safe: an
+// aligned word never crosses the boundary of a memory region or an MPU
+// region, the bytes past the terminator are only compared, never used, and
+// neither SRAM nor flash faults on a read of an existing address.
+// AddressSanitizer in a host build flags those bytes all the same, so the
+// two scanners are left uninstrumented there.
+//
+//*****************************************************************************
+#if defined(__SANITIZE_ADDRESS__)
+#define CGI_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CGI_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+#endif
+#ifndef CGI_NO_SANITIZE_ADDRESS
+#define CGI_NO_SANITIZE_ADDRESS
+#endif
+
+//*****************************************************************************
+//
+// Returns the length of the run at the start of pcString holding neither
+// the terminator nor the character c.
+//
+// Words are only read once the pointer is aligned, so a word never spans
+// beyond the one holding the terminator.
+//
+//*****************************************************************************
+static uint32_t CGI_NO_SANITIZE_ADDRESS
+CGIScanRun(const char *pcString, char c)
+{
+    const char *pcScan;
+    uint32_t ui32Word;
+
+    for(pcScan = pcString; (uintptr_t)pcScan & 3; pcScan++)
+    {
+        if(!*pcScan || (*pcScan == c))
+        {
+            return((uint32_t)(pcScan - pcString));
+        }
+    }
+
+    for(;;)
+    {
+        //
+        // memcpy keeps the compiler honest about aliasing, it is a single
+        // aligned load.
+        //
+        memcpy(&ui32Word, pcScan, sizeof(ui32Word));
+        if(CGI_SWAR_ZERO(ui32Word) | CGI_SWAR_MATCH(ui32Word, c))
+        {
+            break;
+        }
+        pcScan += sizeof(ui32Word);
+    }
+
+    while(*pcScan && (*pcScan != c))
+    {
+        pcScan++;
+    }
+
+    return((uint32_t)(pcScan - pcString));
+}
+
+//*****************************************************************************
+//
+// Decodes pcEncoded into at most ui32Space characters at pcDecoded, which
+// may be pcEncoded itself, and terminates it.  Aligned words of the input
+// are decoded in one go where they can be, the rest a byte at a time.
+//
+//*****************************************************************************
+static uint32_t CGI_NO_SANITIZE_ADDRESS
+CGIDecode(const char *pcEncoded, char *pcDecoded, uint32_t ui32Space)
+{
+    uint32_t ui32Count, ui32Word;
+    uint8_t ui8High, ui8Low;
+
+    ui32Count = 0;
+
+    while(ui32Count < ui32Space)
+    {
+        //
+        // A word without a terminator or escape is stored with its ``+''
+        // characters turned into spaces.  The output never gets ahead of
+        // the input, so this holds in the in place case too.
+        //
+        if(!((uintptr_t)pcEncoded & 3) && ((ui32Space - ui32Count) >= 4))
+        {
+            memcpy(&ui32Word, pcEncoded, sizeof(ui32Word));
+            if(!(CGI_SWAR_ZERO(ui32Word) | CGI_SWAR_MATCH(ui32Word, '%')))
+            {
+                ui32Word ^= (CGI_SWAR_EQUAL(ui32Word, '+') >> 7) * ('+' ^ ' ');
+                memcpy(&pcDecoded[ui32Count], &ui32Word, sizeof(ui32Word));
+                ui32Count += sizeof(ui32Word);
+                pcEncoded += sizeof(ui32Word);
+                continue;
+            }
+        }
+
+        if(!*pcEncoded)
+        {
+            break;
+        }
+        else if(*pcEncoded == '+')
+        {
+            pcDecoded[ui32Count++] = ' ';
+            pcEncoded++;
+        }
+        else if(*pcEncoded == '%')
+        {
+            //
+            // An escape cut short by the end of the string ends the string.
+            //
+            if(!pcEncoded[1] || !pcEncoded[2])
+            {
+                break;
+            }
+
+            //
+            // An invalid escape is skipped without output.
+            //
+            ui8High = g_pui8HexValue[(uint8_t)pcEncoded[1]];
+            ui8Low = g_pui8HexValue[(uint8_t)pcEncoded[2]];
+            if(!((ui8High | ui8Low) & 0xF0))
+            {
+                pcDecoded[ui32Count++] = (char)((ui8High << 4) | ui8Low);
+            }
+            pcEncoded += 3;
+        }
+        else
+        {
+            pcDecoded[ui32Count++] = *pcEncoded++;
+        }
+    }
+
+    pcDecoded[ui32Count] = '\0';
+    return(ui32Count);
+}
+
 //*****************************************************************************
 //
 // Determines whether a given character is a valid hexadecimal digit.
@@ -91,16 +294,7 @@ FindCGIParameter(const char *pcToFind, char *pcParam[], int32_t iNumParams)
 bool
 IsValidHexDigit(const char cDigit)
 {
-    if(((cDigit >= '0') && (cDigit <= '9')) ||
-       ((cDigit >= 'a') && (cDigit <= 'f')) ||
-       ((cDigit >= 'A') && (cDigit <= 'F')))
-    {
-        return(true);
-    }
-    else
-    {
-        return(false);
-    }
+    return(g_pui8HexValue[(uint8_t)cDigit] != 0xFF);
 }
 
 //*****************************************************************************
@@ -120,29 +314,7 @@ IsValidHexDigit(const char cDigit)
 unsigned char
 HexDigit(const char cDigit)
 {
-    if((cDigit >= '0') && (cDigit <= '9'))
-    {
-        return(cDigit - '0');
-    }
-    else
-    {
-        if((cDigit >= 'a') && (cDigit <= 'f'))
-        {
-            return((cDigit - 'a') + 10);
-        }
-        else
-        {
-            if((cDigit >= 'A') && (cDigit <= 'F'))
-            {
-                return((cDigit - 'A') + 10);
-            }
-        }
-    }
-
-    //
-    // If we get here, we were passed an invalid hex digit so return 0xFF.
-    //
-    return(0xFF);
+    return(g_pui8HexValue[(uint8_t)cDigit]);
 }
 
 //*****************************************************************************
@@ -166,17 +338,25 @@ HexDigit(const char cDigit)
 bool
 DecodeHexEscape(const char *pcEncoded, char *pcDecoded)
 {
-    if((pcEncoded[0] != '%') || !IsValidHexDigit(pcEncoded[1]) ||
-       !IsValidHexDigit(pcEncoded[2]))
+    uint8_t ui8High, ui8Low;
+
+    if(pcEncoded[0] != '%')
     {
         return(false);
     }
-    else
+
+    //
+    // Both digits are below 16 only if neither lookup failed.
+    //
+    ui8High = g_pui8HexValue[(uint8_t)pcEncoded[1]];
+    ui8Low = g_pui8HexValue[(uint8_t)pcEncoded[2]];
+    if((ui8High | ui8Low) & 0xF0)
     {
-        *pcDecoded = ((HexDigit(pcEncoded[1]) * 16) +
-                      HexDigit(pcEncoded[2]));
-        return(true);
+        return(false);
     }
+
+    *pcDecoded = (char)((ui8High << 4) | ui8Low);
+    return(true);
 }
 
 //*****************************************************************************
@@ -200,7 +380,7 @@ uint32_t
 EncodeFormString(const char *pcDecoded, char *pcEncoded,
                  uint32_t ui32Len)
 {
-    uint32_t ui32Loop;
+    uint32_t ui32Run;
     uint32_t ui32Count;
 
     //
@@ -217,30 +397,28 @@ EncodeFormString(const char *pcDecoded, char *pcEncoded,
     ui32Count = 0;
 
     //
-    // Step through each character of the input until we run out of data or
-    // space to put our output in.
+    // Copy the runs between the characters needing an escape until we run
+    // out of data or space to put our output in.
     //
-    for(ui32Loop = 0; pcDecoded[ui32Loop] && (ui32Count < (ui32Len - 1));
-        ui32Loop++)
+    while(ui32Count < (ui32Len - 1))
     {
-        switch(pcDecoded[ui32Loop])
+        ui32Run = CGIScanRun(pcDecoded, '\'');
+        if(ui32Run > (ui32Len - 1 - ui32Count))
         {
-            //
-            // Pass most characters without modification.
-            //
-            default:
-            {
-                pcEncoded[ui32Count++] = pcDecoded[ui32Loop];
-                break;
-            }
+            ui32Run = ui32Len - 1 - ui32Count;
+        }
+        memcpy(&pcEncoded[ui32Count], pcDecoded, ui32Run);
+        ui32Count += ui32Run;
+        pcDecoded += ui32Run;
 
-            case '\'':
-            {
-                ui32Count += usnprintf(&pcEncoded[ui32Count],
-                                       (ui32Len - ui32Count), "&#39;");
-                break;
-            }
+        if(!*pcDecoded || (ui32Count == (ui32Len - 1)))
+        {
+            break;
         }
+
+        ui32Count += usnprintf(&pcEncoded[ui32Count], (ui32Len - ui32Count),
+                               "&#39;");
+        pcDecoded++;
     }
 
     return(ui32Count);
@@ -268,87 +446,197 @@ uint32_t
 DecodeFormString(const  char *pcEncoded, char *pcDecoded,
                  uint32_t ui32Len)
 {
-    uint32_t ui32Loop;
-    uint32_t ui32Count;
-    bool bValid;
+    return(CGIDecode(pcEncoded, pcDecoded, ui32Len - 1));
+}
 
-    ui32Count = 0;
-    ui32Loop = 0;
+//*****************************************************************************
+//
+// Characters allowed around a number, and the characters ending a value: the
+// terminator, or the ``&'' starting the next pair of a raw query string.
+//
+//*****************************************************************************
+#define CGI_IS_BLANK(c)         (((c) == ' ') || ((c) == '\t'))
+#define CGI_IS_VALUE_END(c)     (((c) == '\0') || ((c) == '&'))
+
+//*****************************************************************************
+//
+// Appends a digit to the magnitude *pui32Accum, unless the result would go
+// beyond the limit given as ui32Cutoff (the limit divided by ten) and
+// ui32Cutlim (the remainder).  Returns false on overflow.
+//
+//*****************************************************************************
+static bool
+CGIAccumulate(uint32_t *pui32Accum, uint32_t ui32Digit, uint32_t ui32Cutoff,
+              uint32_t ui32Cutlim)
+{
+    if((*pui32Accum > ui32Cutoff) ||
+       ((*pui32Accum == ui32Cutoff) && (ui32Digit > ui32Cutlim)))
+    {
+        return(false);
+    }
+
+    *pui32Accum = (*pui32Accum * 10) + ui32Digit;
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Reads a fixed point decimal number.
+//
+// \param pcValue points to the ASCII representation of the number.  It ends
+// at a terminator or at a ``&'', so a value may be read where it stands in a
+// raw query string.
+// \param ui32Decimals is the number of decimal places kept, 0 to 9.
+// \param i32Min is the smallest value accepted, in units of the last decimal
+// place.
+// \param i32Max is the largest value accepted, in the same units.
+// \param pi32Value points to storage which will receive the number scaled by
+// 10 to the power of \e ui32Decimals.
+//
+// The number is an optional sign, at least one digit, and, if \e ui32Decimals
+// is not 0, an optional decimal point followed by at least one digit.  Blanks
+// may surround it.  Digits beyond \e ui32Decimals places have to be zeros;
+// nothing is rounded.  The string is read once and no intermediate result
+// can overflow.  With 2 decimal places, ``-12.5'' reads as -1250.
+//
+// \return Returns \b true if the string is a number of that form within the
+// range, \b false if not, in which case \e *pi32Value is not written.
+//
+//*****************************************************************************
+bool
+ParseFixedParam(const char *pcValue, uint32_t ui32Decimals, int32_t i32Min,
+                int32_t i32Max, int32_t *pi32Value)
+{
+    uint32_t ui32Accum, ui32Cutoff, ui32Cutlim, ui32Digit, ui32Places;
+    int32_t i32Value;
+    bool bNeg, bDigits;
+
+    if(ui32Decimals > 9)
+    {
+        return(false);
+    }
+
+    while(CGI_IS_BLANK(*pcValue))
+    {
+        pcValue++;
+    }
+
+    bNeg = (*pcValue == '-') ? true : false;
+    if(bNeg || (*pcValue == '+'))
+    {
+        pcValue++;
+    }
+
+    //
+    // The magnitude may reach 2^31 only for a negative number.
+    //
+    ui32Cutoff = bNeg ? 0x80000000 : 0x7FFFFFFF;
+    ui32Cutlim = ui32Cutoff % 10;
+    ui32Cutoff /= 10;
+
+    ui32Accum = 0;
+    ui32Places = 0;
+    bDigits = false;
 
     //
-    // Keep going until we run out of input or fill the output buffer.
+    // A character below '0' wraps around to a large digit value, so one
+    // comparison checks for a digit.
     //
-    while(pcEncoded[ui32Loop] && (ui32Count < (ui32Len - 1)))
+    while((ui32Digit = (uint32_t)(*pcValue - '0')) <= 9)
     {
-        switch(pcEncoded[ui32Loop])
+        if(!CGIAccumulate(&ui32Accum, ui32Digit, ui32Cutoff, ui32Cutlim))
         {
-            //
-            // '+' in the encoded data is decoded as a space.
-            //
-            case '+':
-            {
-                pcDecoded[ui32Count++] = ' ';
-                ui32Loop++;
-                break;
-            }
+            return(false);
+        }
+        bDigits = true;
+        pcValue++;
+    }
 
-            //
-            // '%' in the encoded data indicates that the following 2
-            // characters indicate the hex ASCII code of the decoded character.
-            //
-            case '%':
+    if((*pcValue == '.') && ui32Decimals)
+    {
+        pcValue++;
+        if((uint32_t)(*pcValue - '0') > 9)
+        {
+            return(false);
+        }
+
+        while((ui32Digit = (uint32_t)(*pcValue - '0')) <= 9)
+        {
+            if(ui32Places < ui32Decimals)
             {
-                if(pcEncoded[ui32Loop + 1] && pcEncoded[ui32Loop + 2])
+                if(!CGIAccumulate(&ui32Accum, ui32Digit, ui32Cutoff,
+                                  ui32Cutlim))
                 {
-                    //
-                    // Decode the escape sequence.
-                    //
-                    bValid = DecodeHexEscape(&pcEncoded[ui32Loop],
-                                             &pcDecoded[ui32Count]);
-
-                    //
-                    // If the escape sequence was valid, move to the next
-                    // output character.
-                    //
-                    if(bValid)
-                    {
-                        ui32Count++;
-                    }
-
-                    //
-                    // Skip past the escape sequence in the encoded string.
-                    //
-                    ui32Loop += 3;
-                }
-                else
-                {
-                    //
-                    // We reached the end of the string partway through an
-                    // escape sequence so just ignore it and return the number
-                    // of decoded characters found so far.
-                    //
-                    pcDecoded[ui32Count] = '\0';
-                    return(ui32Count);
+                    return(false);
                 }
-                break;
+                ui32Places++;
             }
-
-            //
-            // For all other characters, just copy the input to the output.
-            //
-            default:
+            else if(ui32Digit)
             {
-                pcDecoded[ui32Count++] = pcEncoded[ui32Loop++];
-                break;
+                return(false);
             }
+            pcValue++;
         }
+        bDigits = true;
+    }
+
+    if(!bDigits)
+    {
+        return(false);
     }
 
     //
-    // Terminate the string and return the number of characters we decoded.
+    // Scale up for the decimal places not given.
     //
-    pcDecoded[ui32Count] = '\0';
-    return(ui32Count);
+    for(; ui32Places < ui32Decimals; ui32Places++)
+    {
+        if(!CGIAccumulate(&ui32Accum, 0, ui32Cutoff, ui32Cutlim))
+        {
+            return(false);
+        }
+    }
+
+    while(CGI_IS_BLANK(*pcValue))
+    {
+        pcValue++;
+    }
+    if(!CGI_IS_VALUE_END(*pcValue))
+    {
+        return(false);
+    }
+
+    i32Value = bNeg ? (int32_t)(0 - ui32Accum) : (int32_t)ui32Accum;
+    if((i32Value < i32Min) || (i32Value > i32Max))
+    {
+        return(false);
+    }
+
+    *pi32Value = i32Value;
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Reads a decimal integer.
+//
+// \param pcValue points to the ASCII representation of the number, ending at
+// a terminator or at a ``&''.
+// \param i32Min is the smallest value accepted.
+// \param i32Max is the largest value accepted.
+// \param pi32Value points to storage which will receive the number.
+//
+// This function is ParseFixedParam without decimal places: an optional sign
+// and at least one digit, blanks around them allowed.
+//
+// \return Returns \b true if the string is a number within the range or \b
+// false if not, in which case \e *pi32Value is not written.
+//
+//*****************************************************************************
+bool
+ParseDecimalParam(const char *pcValue, int32_t i32Min, int32_t i32Max,
+                  int32_t *pi32Value)
+{
+    return(ParseFixedParam(pcValue, 0, i32Min, i32Max, pi32Value));
 }
 
 //*****************************************************************************
@@ -363,126 +651,72 @@ DecodeFormString(const  char *pcEncoded, char *pcDecoded,
 //
 // This function determines whether or not a given string represents a valid
 // decimal number and, if it does, converts the string into a decimal number
-// which is returned to the caller.
+// which is returned to the caller.  Any value of an int32_t is accepted, see
+// ParseDecimalParam.
 //
 // \return Returns \b true if the string is a valid representation of a
 // decimal number or \b false if not.
-
+//
 //*****************************************************************************
 bool
 CheckDecimalParam(const char *pcValue, int32_t *pi32Value)
 {
-    uint32_t ui32Loop;
-    bool bStarted;
-    bool bFinished;
-    bool bNeg;
-    int32_t i32Accum;
+    return(ParseDecimalParam(pcValue, INT32_MIN, INT32_MAX, pi32Value));
+}
 
-    //
-    // Check that the string is a valid decimal number.
-    //
-    bStarted = false;
-    bFinished = false;
-    bNeg = false;
-    ui32Loop = 0;
-    i32Accum = 0;
+//*****************************************************************************
+//
+// Finds the value of a parameter in a raw query string.
+//
+// \param pcQuery points to the name=value pairs, separated by ``&'', with
+// or without the ``?'' in front of them.
+// \param pcName is the name of the parameter.
+//
+// Unlike a substring search, this only matches a whole name at the start of
+// a pair.  The value is not decoded; it ends at the next ``&'', which
+// ParseDecimalParam and ParseFixedParam accept as its end.
+//
+// \return Returns a pointer to the value, to an empty one for a name without
+// ``='', or NULL if the parameter is not present.
+//
+//*****************************************************************************
+const char *
+FindQueryValue(const char *pcQuery, const char *pcName)
+{
+    const char *pcPair, *pcMatch;
 
-    while(pcValue[ui32Loop])
+    if(*pcQuery == '?')
     {
-        //
-        // Ignore whitespace before the string.
-        //
-        if(!bStarted)
-        {
-            if((pcValue[ui32Loop] == ' ') || (pcValue[ui32Loop] == '\t'))
-            {
-                ui32Loop++;
-                continue;
-            }
+        pcQuery++;
+    }
 
-            //
-            // Ignore a + or - character as long as we have not started.
-            //
-            if((pcValue[ui32Loop] == '+') || (pcValue[ui32Loop] == '-'))
-            {
-                //
-                // If the string starts with a '-', remember to negate the
-                // result.
-                //
-                bNeg = (pcValue[ui32Loop] == '-') ? true : false;
-                bStarted = true;
-                ui32Loop++;
-            }
-            else
-            {
-                //
-                // We found something other than whitespace or a sign character
-                // so we start looking for numerals now.
-                //
-                bStarted = true;
-            }
+    for(pcPair = pcQuery; pcPair; )
+    {
+        for(pcMatch = pcName; *pcMatch && (*pcPair == *pcMatch); pcMatch++)
+        {
+            pcPair++;
         }
 
-        if(bStarted)
+        if(!*pcMatch)
         {
-            if(!bFinished)
+            if(*pcPair == '=')
             {
-                //
-                // We expect to see nothing other than valid digit characters
-                // here.
-                //
-                if((pcValue[ui32Loop] >= '0') && (pcValue[ui32Loop] <= '9'))
-                {
-                    i32Accum = (i32Accum * 10) + (pcValue[ui32Loop] - '0');
-                }
-                else
-                {
-                    //
-                    // Have we hit whitespace?  If so, check for no more
-                    // characters until the end of the string.
-                    //
-                    if((pcValue[ui32Loop] == ' ') || (pcValue[ui32Loop] == '\t'))
-                    {
-                        bFinished = true;
-                    }
-                    else
-                    {
-                        //
-                        // We got something other than a digit or whitespace so
-                        // this makes the string invalid as a decimal number.
-                        //
-                        return(false);
-                    }
-                }
+                return(pcPair + 1);
             }
-            else
+            if(CGI_IS_VALUE_END(*pcPair))
             {
-                //
-                // We are scanning for whitespace until the end of the string.
-                //
-                if((pcValue[ui32Loop] != ' ') && (pcValue[ui32Loop] != '\t'))
-                {
-                    //
-                    // We found something other than whitespace so the string
-                    // is not valid.
-                    //
-                    return(false);
-                }
+                return(pcPair);
             }
+        }
 
-            //
-            // Move on to the next character in the string.
-            //
-            ui32Loop++;
+        pcPair = strchr(pcPair, '&');
+        if(pcPair)
+        {
+            pcPair++;
         }
     }
 
-    //
-    // If we drop out of the loop, the string must be valid.  All we need to do
-    // now is negate the accumulated value if the string started with a '-'.
-    //
-    *pi32Value =  bNeg ? -i32Accum : i32Accum;
-    return(true);
+    return(NULL);
 }
 
 //*****************************************************************************
@@ -549,3 +783,359 @@ GetCGIParam(const char *pcName, char *pcParams[], char *pcValue[],
     *pbError = true;
     return(0);
 }
+
+//*****************************************************************************
+//
+// Parameter names are hashed with 32-bit FNV-1a.
+//
+//*****************************************************************************
+#define CGI_HASH_BASIS          2166136261u
+#define CGI_HASH_STEP(h, c)     (((h) ^ (uint8_t)(c)) * 16777619u)
+
+static uint32_t
+CGIQueryHash(const char *pcName)
+{
+    uint32_t ui32Hash;
+
+    ui32Hash = CGI_HASH_BASIS;
+    while(*pcName)
+    {
+        ui32Hash = CGI_HASH_STEP(ui32Hash, *pcName++);
+    }
+
+    return(ui32Hash);
+}
+
+//*****************************************************************************
+//
+// Adds the name/value pair at index i32Index of a query, its name hashing to
+// ui32Hash, to the hash table.  A name that is already present keeps its
+// first occurrence, as FindCGIParameter does.
+//
+//*****************************************************************************
+static void
+CGIQueryInsert(tCGIQuery *psQuery, int32_t i32Index, uint32_t ui32Hash)
+{
+    uint32_t ui32Slot;
+    uint8_t ui8Entry;
+
+    psQuery->pui32Hash[i32Index] = ui32Hash;
+
+    //
+    // Open addressing with linear probing.  The table has more than twice
+    // as many slots as there are parameters so there is always a free one.
+    //
+    for(ui32Slot = ui32Hash & (CGI_QUERY_HASH_SIZE - 1); ;
+        ui32Slot = (ui32Slot + 1) & (CGI_QUERY_HASH_SIZE - 1))
+    {
+        ui8Entry = psQuery->pui8Slot[ui32Slot];
+        if(ui8Entry == 0)
+        {
+            psQuery->pui8Slot[ui32Slot] = (uint8_t)(i32Index + 1);
+            return;
+        }
+        if((psQuery->pui32Hash[ui8Entry - 1] == ui32Hash) &&
+           (strcmp(psQuery->ppcName[ui8Entry - 1],
+                   psQuery->ppcName[i32Index]) == 0))
+        {
+            return;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Sets the number of parameters of a query whose names and values are in
+// place and, if there are more than CGI_QUERY_LINEAR_MAX, hashes the names
+// into the table.
+//
+//*****************************************************************************
+static void
+CGIQueryIndex(tCGIQuery *psQuery, int32_t i32NumParams)
+{
+    int32_t i32Index;
+
+    psQuery->i32NumParams = i32NumParams;
+    if(i32NumParams <= CGI_QUERY_LINEAR_MAX)
+    {
+        return;
+    }
+
+    memset(psQuery->pui8Slot, 0, sizeof(psQuery->pui8Slot));
+    for(i32Index = 0; i32Index < i32NumParams; i32Index++)
+    {
+        CGIQueryInsert(psQuery, i32Index,
+                       CGIQueryHash(psQuery->ppcName[i32Index]));
+    }
+}
+
+//*****************************************************************************
+//
+// Decodes a string encoded as part of an HTTP URI in place.
+//
+// \param pcString is a pointer to a null terminated string encoded as per
+// RFC1738, section 2.2.  It is overwritten with the decoded string.
+//
+// This function decodes the string the way DecodeFormString does.  The
+// decoded string is never longer than the encoded one, so no second buffer
+// is needed.
+//
+// \return Returns the length of the decoded string.
+//
+//*****************************************************************************
+uint32_t
+DecodeFormStringInPlace(char *pcString)
+{
+    return(CGIDecode(pcString, pcString, 0xFFFFFFFF));
+}
+
+//*****************************************************************************
+//
+// Returns true if a character of a query ends the part it is in: the end of
+// the query, the ``&'' after a pair or, in a name, the ``='' before its
+// value.
+//
+//*****************************************************************************
+static bool
+CGIQueryIsEnd(char cChar, const char *pcValue)
+{
+    return((cChar == '\0') || (cChar == '&') || ((cChar == '=') && !pcValue));
+}
+
+//*****************************************************************************
+//
+// Parses a CGI query string in a single pass.
+//
+// \param pcQuery is a pointer to the query string, the part of the URI after
+// the ``?'', as name=value pairs separated by ``&''.  It is modified: the
+// names and values are decoded in place, each followed by a terminator.
+// \param psQuery is a pointer to the structure receiving the parameters.
+//
+// The string is read once: the pairs are split and decoded as they are
+// found.  Only a query of more than CGI_QUERY_LINEAR_MAX parameters gets
+// its names hashed, a short one is looked up by a scan of the names the way
+// FindCGIParameter does, which is cheaper for the few parameters the
+// firmware's pages send.  Pairs beyond CGI_QUERY_MAX_PARAMS are ignored.  A
+// name without ``='' has an empty value.
+//
+// \return Returns the number of parameters found.
+//
+//*****************************************************************************
+int32_t
+ParseCGIQuery(char *pcQuery, tCGIQuery *psQuery)
+{
+    char *pcIn, *pcOut, *pcName, *pcValue;
+    int32_t i32Count;
+    bool bValid;
+    char cSep;
+
+    i32Count = 0;
+
+    //
+    // The decoded text is never longer than the encoded one, so it is written
+    // over the input behind the read position.
+    //
+    pcIn = pcOut = pcName = pcQuery;
+    pcValue = NULL;
+    while(i32Count < CGI_QUERY_MAX_PARAMS)
+    {
+        if((*pcIn == '&') || (*pcIn == '\0'))
+        {
+            //
+            // End of a pair.  Empty pairs, as in "a=1&&b=2", are skipped.
+            // The terminator may overwrite the separator itself.
+            //
+            cSep = *pcIn;
+            if(pcOut != pcName)
+            {
+                *pcOut++ = '\0';
+                psQuery->ppcName[i32Count] = pcName;
+                psQuery->ppcValue[i32Count] = pcValue ? pcValue : (pcOut - 1);
+                i32Count++;
+            }
+            if(cSep == '\0')
+            {
+                break;
+            }
+            pcIn++;
+            pcName = pcOut;
+            pcValue = NULL;
+            continue;
+        }
+        else if((*pcIn == '=') && !pcValue)
+        {
+            *pcOut++ = '\0';
+            pcValue = pcOut;
+            pcIn++;
+            continue;
+        }
+        else if(*pcIn == '+')
+        {
+            *pcOut = ' ';
+            pcIn++;
+        }
+        else if(*pcIn == '%')
+        {
+            //
+            // As in DecodeFormString an invalid escape is dropped and one cut
+            // short ends the string, here the name or value it is in: its
+            // digits are skipped up to the separator, which ends the part as
+            // usual.
+            //
+            if(CGIQueryIsEnd(pcIn[1], pcValue) ||
+               CGIQueryIsEnd(pcIn[2], pcValue))
+            {
+                pcIn++;
+                while(!CGIQueryIsEnd(*pcIn, pcValue))
+                {
+                    pcIn++;
+                }
+                continue;
+            }
+            bValid = DecodeHexEscape(pcIn, pcOut);
+            pcIn += 3;
+            if(!bValid)
+            {
+                continue;
+            }
+        }
+        else
+        {
+            *pcOut = *pcIn++;
+        }
+        pcOut++;
+    }
+
+    CGIQueryIndex(psQuery, i32Count);
+    return(i32Count);
+}
+
+//*****************************************************************************
+//
+// Builds the hashed index over the parameter arrays the HTTP server passes
+// to a CGI handler.
+//
+// \param psQuery is a pointer to the structure receiving the index.
+// \param pcParam is an array of character pointers, each containing the name
+// of a single parameter.
+// \param pcValue is an array of the values of the parameters.
+// \param i32NumParams is the number of elements in the arrays.
+//
+// The values are decoded in place, the names are used as they are.
+// Parameters beyond CGI_QUERY_MAX_PARAMS are ignored.
+//
+// \return Returns the number of parameters indexed.
+//
+//*****************************************************************************
+int32_t
+IndexCGIParams(tCGIQuery *psQuery, char *pcParam[], char *pcValue[],
+               int32_t i32NumParams)
+{
+    int32_t i32Index;
+
+    if(i32NumParams > CGI_QUERY_MAX_PARAMS)
+    {
+        i32NumParams = CGI_QUERY_MAX_PARAMS;
+    }
+
+    for(i32Index = 0; i32Index < i32NumParams; i32Index++)
+    {
+        DecodeFormStringInPlace(pcValue[i32Index]);
+        psQuery->ppcName[i32Index] = pcParam[i32Index];
+        psQuery->ppcValue[i32Index] = pcValue[i32Index];
+    }
+
+    CGIQueryIndex(psQuery, i32NumParams);
+    return(i32NumParams);
+}
+
+//*****************************************************************************
+//
+// Looks a parameter up in a parsed query.
+//
+// \param psQuery is a pointer to a query parsed by ParseCGIQuery or indexed
+// by IndexCGIParams.
+// \param pcName is a pointer to the name of the parameter.
+//
+// \return Returns the index of the parameter in the query or -1 if it is not
+// present.
+//
+//*****************************************************************************
+int32_t
+FindCGIQueryParam(const tCGIQuery *psQuery, const char *pcName)
+{
+    uint32_t ui32Hash, ui32Slot;
+    uint8_t ui8Entry;
+    int32_t i32Index;
+
+    //
+    // A short query was not hashed, its names are scanned.
+    //
+    if(psQuery->i32NumParams <= CGI_QUERY_LINEAR_MAX)
+    {
+        for(i32Index = 0; i32Index < psQuery->i32NumParams; i32Index++)
+        {
+            if(strcmp(psQuery->ppcName[i32Index], pcName) == 0)
+            {
+                return(i32Index);
+            }
+        }
+
+        return(-1);
+    }
+
+    ui32Hash = CGIQueryHash(pcName);
+    for(ui32Slot = ui32Hash & (CGI_QUERY_HASH_SIZE - 1);
+        (ui8Entry = psQuery->pui8Slot[ui32Slot]) != 0;
+        ui32Slot = (ui32Slot + 1) & (CGI_QUERY_HASH_SIZE - 1))
+    {
+        if((psQuery->pui32Hash[ui8Entry - 1] == ui32Hash) &&
+           (strcmp(psQuery->ppcName[ui8Entry - 1], pcName) == 0))
+        {
+            return(ui8Entry - 1);
+        }
+    }
+
+    return(-1);
+}
+
+//*****************************************************************************
+//
+// Returns the value of a parameter of a parsed query, or NULL if the
+// parameter is not present.
+//
+//*****************************************************************************
+const char *
+GetCGIQueryValue(const tCGIQuery *psQuery, const char *pcName)
+{
+    int32_t i32Index;
+
+    i32Index = FindCGIQueryParam(psQuery, pcName);
+
+    return((i32Index == -1) ? NULL : psQuery->ppcValue[i32Index]);
+}
+
+//*****************************************************************************
+//
+// Reads a parameter of a parsed query as a decimal number between i32Min and
+// i32Max.  Works like GetCGIParam: on any error, the value out of range
+// included, *pbError is set to true and 0 is returned, otherwise *pbError is
+// left alone.
+//
+//*****************************************************************************
+int32_t
+GetCGIQueryDecimal(const tCGIQuery *psQuery, const char *pcName,
+                   int32_t i32Min, int32_t i32Max, bool *pbError)
+{
+    const char *pcValue;
+    int32_t i32Value;
+
+    pcValue = GetCGIQueryValue(psQuery, pcName);
+    if(pcValue && ParseDecimalParam(pcValue, i32Min, i32Max, &i32Value))
+    {
+        return(i32Value);
+    }
+
+    *pbError = true;
+    return(0);
+}
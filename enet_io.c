@@ -59,10 +59,19 @@
 #include "utils/uartstdio.h"
 #include "utils/ustdlib.h"
 
+/* lwIP state the timer deadline looks at */
+#include "lwip/netif.h"
+#include "netif/etharp.h"
+#include "lwip/tcp_impl.h"
+#include "lwip/dhcp.h"
+#include "lwip/autoip.h"
+
 /* misc */
 #include "httpserver_raw/httpd.h"
 #include "io.h"
 #include "cgifuncs.h"
+#include "weather_station/ws_route.h"
+#include "weather_station/ws_http.h"
 
 /* sensor libraries */
 /* I2C driver lib */
@@ -85,14 +94,42 @@
 #include "sensorlib/hw_isl29023.h"
 
 #include "weather_station/weather_station.h"
+#include "weather_station/ws_netstats.h"
 
 //*****************************************************************************
 //
-// Defines for setting up the system clock.
+// Deadlines of the SysTick handler.  SysTick is no longer periodic, it is
+// programmed for the earliest deadline only (see weather_station/ws_tick.h).
+//
+// lwIPTimer runs each lwIP timer whose interval passed since it last ran.  A
+// copy of that bookkeeping gives the next timer that has work to do: TCP only
+// while there are active or TIME_WAIT PCBs, AutoIP only while it probes,
+// announces or defends, the DHCP fine timer only while a request waits for
+// its answer.  The host timer (ws_netstats, SNTP, multicast, MQTT, CoAP) and
+// ARP always have work.  Those modules count their time in calls of
+// lwIPHostTimerHandler, so lwIP still wakes up every HOST_TMR_INTERVAL; the
+// 100 ms steps mostly fall on a refresh deadline and share its wakeup.
 //
 //*****************************************************************************
-#define SYSTICKHZ               100
-#define SYSTICKMS               (1000 / SYSTICKHZ)
+typedef enum
+{
+    LWIP_TIMER_HOST,
+    LWIP_TIMER_ARP,
+    LWIP_TIMER_TCP,
+    LWIP_TIMER_AUTOIP,
+    LWIP_TIMER_DHCP_FINE,
+    LWIP_TIMER_DHCP_COARSE,
+    NUM_LWIP_TIMERS
+}
+tLwIPTimer;
+
+static const uint32_t g_pui32LwIPTimerMs[NUM_LWIP_TIMERS] =
+{
+    HOST_TMR_INTERVAL, ARP_TMR_INTERVAL, TCP_TMR_INTERVAL,
+    AUTOIP_TMR_INTERVAL, DHCP_FINE_TIMER_MSECS, DHCP_COARSE_TIMER_MSECS
+};
+
+static uint32_t g_pui32LwIPTimerLastMs[NUM_LWIP_TIMERS];
 
 //*****************************************************************************
 //
@@ -103,6 +140,8 @@
 #define SYSTICK_INT_PRIORITY    0x80		/* Systick INT priority is the highest */
 #define ETHERNET_INT_PRIORITY   0xC0		/* ETH priority */
 #define GPIOH_INT_PRIORITY		0xE0		/* Light threshold INT priority is the lowest */
+/* Shortest refreshing period of sensor data. The filters and the 1 s rollups
+ * are built on at most one set per 50 ms, a slower sensor set stretches it. */
 #define WS_REFRESH_PERIOD_MS	50			/* Refreshing period of sensor data */
 
 //*****************************************************************************
@@ -121,87 +160,15 @@ static volatile bool ipSetupRdy;
 // External Application references.
 //
 //*****************************************************************************
-extern void httpd_init(void);
-
-//*****************************************************************************
-//
-// SSI tag indices for each entry in the g_pcSSITags array.
-//
-//*****************************************************************************
-#define SSI_INDEX_LEDSTATE  0
-#define SSI_INDEX_FORMVARS  1
-#define SSI_INDEX_SPEED     2
-
-//*****************************************************************************
-//
-// This array holds all the strings that are to be recognized as SSI tag
-// names by the HTTPD server.  The server will call SSIHandler to request a
-// replacement string whenever the pattern <!--#tagname--> (where tagname
-// appears in the following array) is found in ".ssi", ".shtml" or ".shtm"
-// files that it serves.
-//
-//*****************************************************************************
-static const char *g_pcConfigSSITags[] =
-{
-    "LEDtxt",        // SSI_INDEX_LEDSTATE
-    "FormVars",      // SSI_INDEX_FORMVARS
-    "speed"          // SSI_INDEX_SPEED
-};
-
-//*****************************************************************************
-//
-// The number of individual SSI tags that the HTTPD server can expect to
-// find in our configuration pages.
-//
-//*****************************************************************************
-#define NUM_CONFIG_SSI_TAGS     (sizeof(g_pcConfigSSITags) / sizeof (char *))
 
 //*****************************************************************************
 //
 // Prototypes for the various CGI handler functions.
 //
 //*****************************************************************************
-static char *ControlCGIHandler(int32_t iIndex, int32_t i32NumParams,
-                               char *pcParam[], char *pcValue[]);
-static char *SetTextCGIHandler(int32_t iIndex, int32_t i32NumParams,
-                               char *pcParam[], char *pcValue[]);
-
-//*****************************************************************************
-//
-// Prototype for the main handler used to process server-side-includes for the
-// application's web-based configuration screens.
-//
-//*****************************************************************************
-static int32_t SSIHandler(int32_t iIndex, char *pcInsert, int32_t iInsertLen);
-
-//*****************************************************************************
-//
-// CGI URI indices for each entry in the g_psConfigCGIURIs array.
-//
-//*****************************************************************************
-#define CGI_INDEX_CONTROL       0
-#define CGI_INDEX_TEXT          1
-
-//*****************************************************************************
-//
-// This array is passed to the HTTPD server to inform it of special URIs
-// that are treated as common gateway interface (CGI) scripts.  Each URI name
-// is defined along with a pointer to the function which is to be called to
-// process it.
-//
-//*****************************************************************************
-static const tCGI g_psConfigCGIURIs[] =
-{
-    { "/iocontrol.cgi", (tCGIHandler)ControlCGIHandler }, // CGI_INDEX_CONTROL
-    { "/settxt.cgi", (tCGIHandler)SetTextCGIHandler }     // CGI_INDEX_TEXT
-};
-
-//*****************************************************************************
-//
-// The number of individual CGI URIs that are configured for this system.
-//
-//*****************************************************************************
-#define NUM_CONFIG_CGI_URIS     (sizeof(g_psConfigCGIURIs) / sizeof(tCGI))
+static const char *ControlCGIHandler(const tCGIQuery *psQuery);
+static const char *SetTextCGIHandler(const tCGIQuery *psQuery);
+static const char *SetSpeedCGIHandler(const tCGIQuery *psQuery);
 
 //*****************************************************************************
 //
@@ -245,13 +212,15 @@ float HumidityMeas;
 float PressureMeas;
 float LightMeas;
 uint8_t LightMask;
-int SystickCounter = 0;
+WS_SampleTime_t PublishedTime;		/* Acquisition times of the published values */
+static volatile bool SampleProcessed;	/* processSample ran for the current set */
+static volatile uint64_t RefreshUs;		/* Deadline of the last refresh */
 
-/* Extern IO variables */
-int32_t tempInteger, tempFraction;
-int32_t humidityInteger, humidityFraction;
-int32_t pressureInteger, pressureFraction;
-int32_t lightInteger, lightFraction;
+/* The measurements, in deadband channel order */
+static float * const PublishMeas[WS_DEADBAND_CHANNELS] =
+{
+	&TempAmbientMeas, &HumidityMeas, &PressureMeas, &LightMeas
+};
 
 //*****************************************************************************
 //
@@ -284,11 +253,11 @@ __error__(char *pcFilename, uint32_t ui32Line)
 //*****************************************************************************
 //
 // This CGI handler is called whenever the web browser requests iocontrol.cgi.
+// The server parsed the query with ParseCGIQuery.
 //
 //*****************************************************************************
-static char *
-ControlCGIHandler(int32_t iIndex, int32_t i32NumParams, char *pcParam[],
-                  char *pcValue[])
+static const char *
+ControlCGIHandler(const tCGIQuery *psQuery)
 {
     int32_t i32LEDState, i32Speed;
     bool bParamError;
@@ -301,14 +270,15 @@ ControlCGIHandler(int32_t iIndex, int32_t i32NumParams, char *pcParam[],
     //
     // Get each of the expected parameters.
     //
-    i32LEDState = FindCGIParameter("LEDOn", pcParam, i32NumParams);
-    i32Speed = GetCGIParam("speed_percent", pcParam, pcValue, i32NumParams,
-            &bParamError);
+    i32LEDState = FindCGIQueryParam(psQuery, "LEDOn");
+    i32Speed = GetCGIQueryDecimal(psQuery, "speed_percent", 0, 100,
+                                  &bParamError);
 
     //
-    // Was there any error reported by the parameter parser?
+    // Was there any error reported by the parameter parser?  A speed out of
+    // range is one.
     //
-    if(bParamError || (i32Speed < 0) || (i32Speed > 100))
+    if(bParamError)
     {
         return(PARAM_ERROR_RESPONSE);
     }
@@ -331,36 +301,29 @@ ControlCGIHandler(int32_t iIndex, int32_t i32NumParams, char *pcParam[],
 // This CGI handler is called whenever the web browser requests settxt.cgi.
 //
 //*****************************************************************************
-static char *
-SetTextCGIHandler(int32_t i32Index, int32_t i32NumParams, char *pcParam[],
-                  char *pcValue[])
+static const char *
+SetTextCGIHandler(const tCGIQuery *psQuery)
 {
-    long lStringParam;
-    char pcDecodedString[48];
+    const char *pcText;
 
     //
-    // Find the parameter that has the string we need to display.
+    // Find the parameter that has the string we need to display, already
+    // decoded.
     //
-    lStringParam = FindCGIParameter("DispText", pcParam, i32NumParams);
+    pcText = GetCGIQueryValue(psQuery, "DispText");
 
     //
     // If the parameter was not found, show the error page.
     //
-    if(lStringParam == -1)
+    if(pcText == NULL)
     {
         return(PARAM_ERROR_RESPONSE);
     }
 
     //
-    // The parameter is present. We need to decode the text for display.
+    // Print the string over the UART.  It is user input, not a format.
     //
-    DecodeFormString(pcValue[lStringParam], pcDecodedString, 48);
-
-    //
-    // Print sting over the UART
-    //
-    UARTprintf(pcDecodedString);
-    UARTprintf("\n");
+    UARTprintf("%s\n", pcText);
 
     //
     // Tell the HTTPD server which file to send back to the client.
@@ -370,48 +333,129 @@ SetTextCGIHandler(int32_t i32Index, int32_t i32NumParams, char *pcParam[],
 
 //*****************************************************************************
 //
-// This function is called by the HTTP server whenever it encounters an SSI
-// tag in a web page.  The iIndex parameter provides the index of the tag in
-// the g_pcConfigSSITags array. This function writes the substitution text
-// into the pcInsert array, writing no more than iInsertLen characters.
+// This CGI handler is called whenever the web browser requests
+// /cgi-bin/set_speed?percent=<0-100>.  The response is the speed in effect,
+// which is the old one if the parameter was missing or invalid.
 //
 //*****************************************************************************
-static int32_t
-SSIHandler(int32_t iIndex, char *pcInsert, int32_t iInsertLen)
+static const char *
+SetSpeedCGIHandler(const tCGIQuery *psQuery)
 {
-    //
-    // Which SSI tag have we been passed?
-    //
-    switch(iIndex)
+    int32_t i32Speed;
+    bool bParamError;
+
+    bParamError = false;
+    i32Speed = GetCGIQueryDecimal(psQuery, "percent", 0, 100, &bParamError);
+    if(!bParamError)
     {
-        case SSI_INDEX_LEDSTATE:
-            io_get_ledstate(pcInsert, iInsertLen);
-            break;
-
-        case SSI_INDEX_FORMVARS:
-            usnprintf(pcInsert, iInsertLen,
-                    "%sls=%d;\nsp=%d;\n%s",
-                    JAVASCRIPT_HEADER,
-                    io_is_led_on(),
-                    io_get_animation_speed(),
-                    JAVASCRIPT_FOOTER);
-            break;
-
-        case SSI_INDEX_SPEED:
-            io_get_animation_speed_string(pcInsert, iInsertLen);
-            break;
-
-        default:
-            usnprintf(pcInsert, iInsertLen, "??");
-            break;
+        io_set_animation_speed(i32Speed);
     }
 
-    //
-    // Tell the server how many characters our insert string contains.
-    //
+    return("/get_speed");
+}
+
+//*****************************************************************************
+//
+// The SSI tags, registered with the router in main.  The server calls the
+// function of a tag whenever the pattern <!--#tagname--> is found in
+// ".ssi", ".shtml" or ".shtm" files that it serves.  Each one writes the
+// substitution text into the pcInsert array, writing no more than
+// i32InsertLen characters, and returns its length.  They only show the LED
+// and the animation speed, so the router keeps their text until io.c
+// reports a change of either.
+//
+//*****************************************************************************
+static int32_t
+SSILedState(char *pcInsert, int32_t i32InsertLen)
+{
+    io_get_ledstate(pcInsert, i32InsertLen);
+
+    return(strlen(pcInsert));
+}
+
+static int32_t
+SSIFormVars(char *pcInsert, int32_t i32InsertLen)
+{
+    usnprintf(pcInsert, i32InsertLen,
+            "%sls=%d;\nsp=%d;\n%s",
+            JAVASCRIPT_HEADER,
+            io_is_led_on(),
+            io_get_animation_speed(),
+            JAVASCRIPT_FOOTER);
+
     return(strlen(pcInsert));
 }
 
+static int32_t
+SSISpeed(char *pcInsert, int32_t i32InsertLen)
+{
+    io_get_animation_speed_string(pcInsert, i32InsertLen);
+
+    return(strlen(pcInsert));
+}
+
+//*****************************************************************************
+//
+// Bring the copy of lwIPTimer's bookkeeping to ui32NowMs and return the ms
+// until the next lwIP timer that has work to do.
+//
+//*****************************************************************************
+static uint32_t
+LwIPTimerDelay(uint32_t ui32NowMs)
+{
+    struct netif *psNetIF = netif_default;
+    uint32_t ui32Timer, ui32Left, ui32Delay = HOST_TMR_INTERVAL;
+    bool bNeeded;
+
+    for(ui32Timer = 0; ui32Timer < NUM_LWIP_TIMERS; ui32Timer++)
+    {
+        if((ui32NowMs - g_pui32LwIPTimerLastMs[ui32Timer]) >=
+           g_pui32LwIPTimerMs[ui32Timer])
+        {
+            g_pui32LwIPTimerLastMs[ui32Timer] = ui32NowMs;
+        }
+
+        switch(ui32Timer)
+        {
+            case LWIP_TIMER_TCP:
+                bNeeded = (tcp_active_pcbs != NULL) || (tcp_tw_pcbs != NULL);
+                break;
+#if LWIP_AUTOIP
+            case LWIP_TIMER_AUTOIP:
+                bNeeded = psNetIF && psNetIF->autoip &&
+                          ((psNetIF->autoip->state == AUTOIP_STATE_PROBING) ||
+                           (psNetIF->autoip->state == AUTOIP_STATE_ANNOUNCING) ||
+                           psNetIF->autoip->lastconflict);
+                break;
+#endif
+#if LWIP_DHCP
+            case LWIP_TIMER_DHCP_FINE:
+                bNeeded = psNetIF && psNetIF->dhcp && psNetIF->dhcp->request_timeout;
+                break;
+            case LWIP_TIMER_DHCP_COARSE:
+                bNeeded = psNetIF && psNetIF->dhcp;
+                break;
+#endif
+            case LWIP_TIMER_HOST:
+            case LWIP_TIMER_ARP:
+                bNeeded = true;
+                break;
+            default:
+                bNeeded = false;
+                break;
+        }
+
+        ui32Left = g_pui32LwIPTimerMs[ui32Timer] -
+                   (ui32NowMs - g_pui32LwIPTimerLastMs[ui32Timer]);
+        if(bNeeded && (ui32Left < ui32Delay))
+        {
+            ui32Delay = ui32Left;
+        }
+    }
+
+    return(ui32Delay);
+}
+
 //*****************************************************************************
 //
 // The interrupt handler for the SysTick interrupt.
@@ -420,40 +464,110 @@ SSIHandler(int32_t iIndex, char *pcInsert, int32_t iInsertLen)
 void
 SysTickIntHandler(void)
 {
+    static uint32_t ui32LwIPMs;
+    uint32_t ui32Probe = probeStart();
+    uint32_t ui32Due, ui32NowMs, ui32Ch, ui32Published;
+    uint64_t ui64NowUs;
+    int32_t pi32Values[WS_DEADBAND_CHANNELS];
+    char ppcHeld[WS_DEADBAND_CHANNELS][16];
+
+    stackSampleNesting();
+
+    ui32Due = tickExpired();
+
     //
-    // Call the lwIP timer handler.
+    // Call the lwIP timer handler with the time that really passed.
     //
-    lwIPTimer(SYSTICKMS);
-    if(ipSetupRdy)
+    if(ui32Due & (1 << WS_TickLwIP))
     {
-		/* Increment counter for sensors */
-		if( !(SystickCounter % ((SYSTICKHZ * WS_REFRESH_PERIOD_MS)/1000) ) )
-		{
-		tempInteger = IntegerPart(TempAmbientMeas);
-		tempFraction = FractionPart(TempAmbientMeas);
-
-		humidityInteger = IntegerPart(HumidityMeas);
-		humidityFraction = FractionPart(HumidityMeas);
-
-		pressureInteger = IntegerPart(PressureMeas);
-		pressureFraction = FractionPart(PressureMeas);
-
-		lightInteger = IntegerPart(LightMeas);
-		lightFraction = FractionPart(LightMeas);
-
-		UARTprintf("Temperature: %d.%d,  Humidity: %d.%d,  Pressure: %d.%d, Light: %d.%d\n ", tempInteger, tempFraction,
-	    																					  humidityInteger, humidityFraction,
-	    																					  pressureInteger, pressureFraction,
-	    																					  lightInteger, lightFraction);
-			/* Clear data ready flags */
-			TempDataFlag = false;
-			HumidityDataFlag = false;
-			PressureDataFlag = false;
-			LightDataFlag = false;
-			SystickCounter = 0;
-		}
-		SystickCounter++;
+        ui64NowUs = tickNowUs();
+        ui32NowMs = (uint32_t)(ui64NowUs / 1000);
+        lwIPTimer(ui32NowMs - ui32LwIPMs);
+        ui32LwIPMs = ui32NowMs;
+
+        tickDeadlineSet(WS_TickLwIP, ui64NowUs - (ui64NowUs % 1000) +
+                                     (uint64_t)LwIPTimerDelay(ui32NowMs) * 1000);
     }
+
+    //
+    // The refresh publishes a complete set and starts the next one.  The
+    // main loop sets its deadline when the set is processed, one period
+    // after the last refresh at the earliest, so it runs at the sampling
+    // rate.  Until the network is up the set is held and polled.
+    //
+    if(ui32Due & (1 << WS_TickRefresh))
+    {
+        if(!ipSetupRdy)
+        {
+            RefreshUs = tickNextPeriod(RefreshUs, WS_REFRESH_PERIOD_MS * 1000);
+            tickDeadlineSet(WS_TickRefresh, RefreshUs);
+        }
+        else
+        {
+            /* Only the measurements that moved past their deadband, or whose
+             * heartbeat expired, are published and logged */
+            for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+            {
+                pi32Values[ui32Ch] = filterToMilli(*PublishMeas[ui32Ch]);
+            }
+            ui32Published = deadbandUpdate(&PublishDeadband, &PublishDeadbandConfig, tickNowMs(),
+                                           pi32Values);
+
+            for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+            {
+                if(ui32Published & (1u << ui32Ch))
+                {
+                    PublishedTime.pui64SensorUs[ui32Ch] = SampleTime.pui64SensorUs[ui32Ch];
+                    if(PublishedTime.pui64SensorUs[ui32Ch] > PublishedTime.ui64Us)
+                    {
+                        PublishedTime.ui64Us = PublishedTime.pui64SensorUs[ui32Ch];
+                    }
+                }
+            }
+
+            if(ui32Published)
+            {
+                /* The held values, in the thousandths io_send_data reports */
+                for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+                {
+                    FormatMilli(ppcHeld[ui32Ch], sizeof(ppcHeld[ui32Ch]),
+                                PublishDeadband.pi32Held[ui32Ch]);
+                }
+                UARTprintf("[%u.%06u] ", (uint32_t)(PublishedTime.ui64Us / 1000000u),
+                           (uint32_t)(PublishedTime.ui64Us % 1000000u));
+                UARTprintf("Temperature: %s,  Humidity: %s,  Pressure: %s, Light: %s\n",
+                           ppcHeld[0], ppcHeld[1], ppcHeld[2], ppcHeld[3]);
+            }
+
+            /* Clear data ready flags */
+            TempDataFlag = false;
+            HumidityDataFlag = false;
+            PressureDataFlag = false;
+            LightDataFlag = false;
+            SampleProcessed = false;
+        }
+    }
+
+    //
+    // The sensor bus deadlines only wake up measureSensors.
+    //
+    tickArm();
+
+    probeEnd(WS_ProbeSysTick, ui32Probe);
+}
+
+//*****************************************************************************
+//
+// The interrupt handler for the Ethernet controller.  All TCP/IP and HTTP
+// work runs from here, so this is where the stack gets deepest.
+//
+//*****************************************************************************
+void
+EthernetIntHandler(void)
+{
+    stackSampleNesting();
+
+    lwIPEthernetIntHandler();
 }
 
 //*****************************************************************************
@@ -464,6 +578,8 @@ SysTickIntHandler(void)
 void
 AnimTimerIntHandler(void)
 {
+    stackSampleNesting();
+
     //
     // Clear the timer interrupt.
     //
@@ -505,8 +621,48 @@ DisplayIPAddress(uint32_t ui32Addr)
 void
 lwIPHostTimerHandler(void)
 {
+    static uint32_t ui32StackUsed, ui32StackNesting;
+    WS_StackReport_t sStack;
     uint32_t ui32NewIPAddress;
 
+    //
+    // Dump the lwIP memory statistics on the UART now and then.
+    //
+    netStatsTick(HOST_TMR_INTERVAL);
+
+    //
+    // Keep the wall clock synchronized.
+    //
+    timeTick(HOST_TMR_INTERVAL);
+
+    //
+    // Send the samples queued for the multicast group.
+    //
+    mcastTick();
+
+    //
+    // Publish to the MQTT broker, connecting first if need be.
+    //
+    mqttTick();
+
+    //
+    // Notify the CoAP observers of changed values.
+    //
+    coapTick();
+
+    //
+    // Report when the stack high-water mark or the nesting depth grows.
+    //
+    stackReport(&sStack);
+    if((sStack.ui32Used > ui32StackUsed) ||
+       (sStack.ui32MaxNesting > ui32StackNesting))
+    {
+        ui32StackUsed = sStack.ui32Used;
+        ui32StackNesting = sStack.ui32MaxNesting;
+        UARTprintf("Stack high-water: %u of %u bytes, nesting %u\n",
+                   sStack.ui32Used, sStack.ui32Size, sStack.ui32MaxNesting);
+    }
+
     //
     // Get the current IP address.
     //
@@ -578,6 +734,11 @@ main(void)
     uint32_t ui32User0, ui32User1;
     uint8_t pui8MACArray[8];
 
+    //
+    // Fill the free stack with a pattern for the high-water measurement.
+    //
+    stackInit();
+
     //
     // Make sure the main oscillator is enabled because this is required by
     // the PHY.  The system must have a 25MHz crystal attached to the OSC
@@ -609,19 +770,6 @@ main(void)
     //
     UARTprintf("Weather station serial test application\n");
 
-    /* Enable the I2C7 peripheral before use. */
-    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
-    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_I2C7);
-
-    /* Configure the pin muxing for I2C7 functions on port D0 and D1. */
-    ROM_GPIOPinConfigure(GPIO_PD0_I2C7SCL);
-    ROM_GPIOPinConfigure(GPIO_PD1_I2C7SDA);
-
-    /* Select the I2C function for these pins.  This function will also configure the GPIO pins pins for I2C operation, setting them to
-     * open-drain operation with weak pull-ups. */
-    GPIOPinTypeI2CSCL(GPIO_PORTD_BASE, GPIO_PIN_0);
-    ROM_GPIOPinTypeI2C(GPIO_PORTD_BASE, GPIO_PIN_1);
-
     /* Configure and Enable the GPIO interrupt. Used for DRDY from the TMP006 and for INT signal from the ISL29023*/
     ROM_GPIOPinTypeGPIOInput(GPIO_PORTH_BASE, GPIO_PIN_2);
     ROM_GPIOPinTypeGPIOInput(GPIO_PORTE_BASE, GPIO_PIN_5);
@@ -635,7 +783,7 @@ main(void)
     /* Enable interrupts to the processor. */
     ROM_IntMasterEnable();
 
-    /* Initialize I2C peripheral. */
+    /* Initialize the I2C buses the sensors are attached to. */
     initI2C();
 
     /* Initialize the TMP006 */
@@ -650,13 +798,18 @@ main(void)
     /* Initialize ISL29023 */
     lightSensorInit();
 
+    /* Find the end of the sample log in flash */
+    if(flashLogMount(&FlashLog, &FlashLogInternal))
+    {
+        UARTprintf("Sample log unavailable\n");
+    }
+
     //
-    // Configure SysTick for a periodic interrupt.
+    // Start the clock and the deadlines of the SysTick interrupt.
     //
     ipSetupRdy = false;
-    MAP_SysTickPeriodSet(g_ui32SysClock / SYSTICKHZ);
-    MAP_SysTickEnable();
-    MAP_SysTickIntEnable();
+    tickInit();
+    tickDeadlineSet(WS_TickLwIP, (uint64_t)LwIPTimerDelay(0) * 1000);
 
     //
     // Configure the hardware MAC address for Ethernet Controller filtering of
@@ -705,11 +858,6 @@ main(void)
     LocatorMACAddrSet(pui8MACArray);
     LocatorAppTitleSet("EK-TM4C1294XL enet_io");
 
-    //
-    // Initialize a sample httpd server.
-    //
-    httpd_init();
-
     //
     // Set the interrupt priorities.  We set the SysTick interrupt to a higher
     // priority than the Ethernet interrupt to ensure that the file system
@@ -721,15 +869,17 @@ main(void)
     MAP_IntPrioritySet(FAULT_SYSTICK, SYSTICK_INT_PRIORITY);
 
     //
-    // Pass our tag information to the HTTP server.
-    //
-    http_set_ssi_handler((tSSIHandler)SSIHandler, g_pcConfigSSITags,
-            NUM_CONFIG_SSI_TAGS);
-
-    //
-    // Pass our CGI handlers to the HTTP server.
+    // Register the files, CGIs and SSI tags with the router, then start the
+    // HTTP server on them.
     //
-    http_set_cgi_handlers(g_psConfigCGIURIs, NUM_CONFIG_CGI_URIS);
+    io_fs_init();
+    routeAddCGI("/iocontrol.cgi", ControlCGIHandler);
+    routeAddCGI("/settxt.cgi", SetTextCGIHandler);
+    routeAddCGI("/cgi-bin/set_speed", SetSpeedCGIHandler);
+    routeAddSSI("LEDtxt", WS_ROUTE_SSI_CACHE, SSILedState);
+    routeAddSSI("FormVars", WS_ROUTE_SSI_CACHE, SSIFormVars);
+    routeAddSSI("speed", WS_ROUTE_SSI_CACHE, SSISpeed);
+    httpInit();
 
     //
     // Initialize IO controls
@@ -746,17 +896,17 @@ main(void)
         if( (TempDataFlag == 0) || (HumidityDataFlag == 0) ||
             		(PressureDataFlag == 0) || (LightDataFlag == 0) )
         {
-        	/* TMP006 sensor */
-        	measureTemp();
-
-        	/* SHT21 sensor */
-        	measureHumidity();
-
-          	/* BMP180 sensor */
-          	measurePressure();
-
-            /*ISL29023 sensor */
-            measureLight();
+        	/* TMP006, SHT21, BMP180 and ISL29023 sensors, buses in parallel */
+        	measureSensors();
+        }
+        else if(!SampleProcessed)
+        {
+        	/* Derived quantities of the complete set, the refresh publishes
+        	 * it */
+        	processSample();
+        	SampleProcessed = true;
+        	RefreshUs = tickNextPeriod(RefreshUs, WS_REFRESH_PERIOD_MS * 1000);
+        	tickDeadlineSet(WS_TickRefresh, RefreshUs);
         }
         else
         {
@@ -44,7 +44,9 @@
 MEMORY
 {
     /* Application stored in and executes from internal flash */
-    FLASH (RX) : origin = APP_BASE, length = 0x00100000
+    FLASH (RX) : origin = APP_BASE, length = 0x000C0000
+    /* Top 256 KB reserved for the sample log, see ws_flashlog_flash.c */
+    FLASHLOG (R) : origin = 0x000C0000, length = 0x00040000
     /* Application uses internal RAM for data */
     SRAM (RWX) : origin = 0x20000000, length = 0x00040000
 }
@@ -0,0 +1,273 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "weather_station/weather_station.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Check of the measurement on two I2C buses.
+ *
+ *  The simulated board has every sensor on both I2C7 and I2C8, the
+ *  firmware's SensorConfig picks which one it talks to. The bench runs the
+ *  firmware twice, each time in a child process: once with every sensor on
+ *  I2C7, once with the sensors split over both buses (-s, a bus per sensor in
+ *  temperature, humidity, pressure, light order). The buses take the time
+ *  the transfers need at the -c clock (WS_SIM_I2C_HZ, see sim_i2cm.c).
+ *
+ *      ./build/busbench -d 20 -o result.json
+ *      ./build/busbench -c 10000 -s 7878
+ *
+ *  A round is measured from the refresh that clears the data flags to the
+ *  moment every sensor has its data again. The buses run in parallel if the
+ *  split rounds are no slower than the single bus ones while the second bus
+ *  carries its share of the transfers; otherwise the exit status is 1. The
+ *  results are printed as one JSON object.
+ *
+ *  -d duration of each run in s, -c bus clock in Hz, -s the split, -o output
+ *  file (stdout by default), -v keeps the firmware's UART output. */
+//*****************************************************************************
+
+typedef struct {
+	uint32_t ui32Rounds;
+	uint64_t ui64LatencyUs;			/* Sum over the rounds */
+	uint64_t ui64MaxLatencyUs;
+	uint64_t ui64DurationUs;
+	uint32_t pui32Transfers[WS_NUM_I2C_BUSES];
+	uint64_t pui64BusyUs[WS_NUM_I2C_BUSES];
+}BusBenchResult_t;
+
+/* The data flags, enet_io.c */
+extern bool TempDataFlag, HumidityDataFlag, PressureDataFlag, LightDataFlag;
+
+extern int firmwareMain(void);
+
+static uint32_t BusBenchDurationMs = 10000;
+static bool BusBenchVerbose;
+
+/* State of the run in the child */
+static int BusBenchPipe;
+static uint64_t BusBenchStartUs;
+static uint64_t BusBenchRoundUs;
+static bool BusBenchInRound;
+static BusBenchResult_t BusBenchResult;
+
+//*****************************************************************************
+//
+// Child: the firmware with one assignment, measured between interrupts.
+//
+//*****************************************************************************
+static void busBenchIdle(void)
+{
+	uint64_t ui64Now = simMicros(), ui64Latency;
+	uint32_t ui32Bus;
+	bool bNone = !TempDataFlag && !HumidityDataFlag && !PressureDataFlag && !LightDataFlag;
+	bool bAll = TempDataFlag && HumidityDataFlag && PressureDataFlag && LightDataFlag;
+
+	if(!BusBenchStartUs)
+	{
+		/* The firmware is up and sleeping */
+		BusBenchStartUs = ui64Now;
+	}
+
+	if(!BusBenchInRound && bNone)
+	{
+		BusBenchInRound = true;
+		BusBenchRoundUs = ui64Now;
+	}
+	else if(BusBenchInRound && bAll)
+	{
+		BusBenchInRound = false;
+		ui64Latency = ui64Now - BusBenchRoundUs;
+		BusBenchResult.ui32Rounds++;
+		BusBenchResult.ui64LatencyUs += ui64Latency;
+		if(ui64Latency > BusBenchResult.ui64MaxLatencyUs)
+		{
+			BusBenchResult.ui64MaxLatencyUs = ui64Latency;
+		}
+	}
+
+	if(ui64Now - BusBenchStartUs < (uint64_t)BusBenchDurationMs * 1000u)
+	{
+		return;
+	}
+
+	BusBenchResult.ui64DurationUs = ui64Now - BusBenchStartUs;
+	for(ui32Bus = 0; ui32Bus < WS_NUM_I2C_BUSES; ui32Bus++)
+	{
+		simI2CStats(ui32Bus, &BusBenchResult.pui32Transfers[ui32Bus],
+					&BusBenchResult.pui64BusyUs[ui32Bus]);
+	}
+	_exit((write(BusBenchPipe, &BusBenchResult, sizeof(BusBenchResult)) ==
+		   sizeof(BusBenchResult)) ? 0 : 1);
+}
+
+/* "7788": the bus of each sensor */
+static bool busBenchAssign(const char *pcBuses)
+{
+	uint32_t ui32Sensor;
+
+	if(strlen(pcBuses) != WS_NUM_SENSORS)
+	{
+		return(false);
+	}
+	for(ui32Sensor = 0; ui32Sensor < WS_NUM_SENSORS; ui32Sensor++)
+	{
+		if((pcBuses[ui32Sensor] != '7') && (pcBuses[ui32Sensor] != '8'))
+		{
+			return(false);
+		}
+		SensorConfig[ui32Sensor].eBus = (pcBuses[ui32Sensor] == '7') ? WS_I2CBus7 : WS_I2CBus8;
+	}
+
+	return(true);
+}
+
+//*****************************************************************************
+//
+// Parent: a run per assignment.
+//
+//*****************************************************************************
+static bool busBenchRun(const char *pcBuses, BusBenchResult_t *psResult)
+{
+	int piPipe[2], iStatus;
+	pid_t iPid;
+	ssize_t iLen;
+
+	if(pipe(piPipe))
+	{
+		perror("pipe");
+		return(false);
+	}
+
+	iPid = fork();
+	if(iPid < 0)
+	{
+		perror("fork");
+		return(false);
+	}
+	if(!iPid)
+	{
+		close(piPipe[0]);
+		BusBenchPipe = piPipe[1];
+		busBenchAssign(pcBuses);
+
+		simInit();
+		simUARTQuiet(!BusBenchVerbose);
+		simIdleHookSet(busBenchIdle);
+		_exit(firmwareMain());
+	}
+
+	close(piPipe[1]);
+	iLen = read(piPipe[0], psResult, sizeof(*psResult));
+	close(piPipe[0]);
+	waitpid(iPid, &iStatus, 0);
+
+	if((iLen != sizeof(*psResult)) || !WIFEXITED(iStatus) || WEXITSTATUS(iStatus))
+	{
+		fprintf(stderr, "%s: the run failed\n", pcBuses);
+		return(false);
+	}
+
+	return(true);
+}
+
+static double busBenchMeanMs(const BusBenchResult_t *psResult)
+{
+	return(psResult->ui32Rounds ? (double)psResult->ui64LatencyUs / psResult->ui32Rounds / 1000.0 : 0.0);
+}
+
+static void busBenchPrint(FILE *psOut, const char *pcBuses, const BusBenchResult_t *psResult)
+{
+	uint32_t ui32Bus;
+
+	fprintf(psOut, "{\"buses\":\"%s\",\"rounds\":%u,\"roundsPerSec\":%.2f,"
+			"\"latencyMs\":{\"mean\":%.2f,\"max\":%.2f}", pcBuses, psResult->ui32Rounds,
+			psResult->ui32Rounds * 1e6 / (double)psResult->ui64DurationUs,
+			busBenchMeanMs(psResult), psResult->ui64MaxLatencyUs / 1000.0);
+	for(ui32Bus = 0; ui32Bus < WS_NUM_I2C_BUSES; ui32Bus++)
+	{
+		fprintf(psOut, ",\"i2c%u\":{\"transfers\":%u,\"busyPct\":%.1f}", 7 + ui32Bus,
+				psResult->pui32Transfers[ui32Bus],
+				100.0 * (double)psResult->pui64BusyUs[ui32Bus] / (double)psResult->ui64DurationUs);
+	}
+	fprintf(psOut, "}");
+}
+
+int main(int argc, char **argv)
+{
+	static const char pcSingle[] = "7777";
+	const char *pcSplit = "7788";
+	BusBenchResult_t sSingle, sSplit;
+	const char *pcHz = "100000";
+	FILE *psOut = stdout;
+	bool bPass;
+	int iOpt;
+
+	while((iOpt = getopt(argc, argv, "d:c:s:o:v")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 'd':
+				BusBenchDurationMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'c':
+				pcHz = optarg;
+				break;
+			case 's':
+				pcSplit = optarg;
+				break;
+			case 'o':
+				psOut = fopen(optarg, "w");
+				if(!psOut)
+				{
+					perror(optarg);
+					return(1);
+				}
+				break;
+			case 'v':
+				BusBenchVerbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-d seconds] [-c bus_hz] [-s t,h,p,l buses as 7788] "
+						"[-o file] [-v]\n", argv[0]);
+				return(1);
+		}
+	}
+	if(!busBenchAssign(pcSplit) || !strchr(pcSplit, '8'))
+	{
+		fprintf(stderr, "the split is a bus per sensor, 7 or 8, at least one on 8\n");
+		return(1);
+	}
+	if(!BusBenchDurationMs || !strtoul(pcHz, NULL, 0))
+	{
+		fprintf(stderr, "a duration and a bus clock\n");
+		return(1);
+	}
+	setenv("WS_SIM_I2C_HZ", pcHz, 1);
+
+	if(!busBenchRun(pcSingle, &sSingle) || !busBenchRun(pcSplit, &sSplit))
+	{
+		return(1);
+	}
+
+	/* Parallel buses: no slower rounds, and the second bus did its part */
+	bPass = sSingle.ui32Rounds && sSplit.ui32Rounds && sSplit.pui32Transfers[WS_I2CBus8] &&
+			(busBenchMeanMs(&sSplit) <= busBenchMeanMs(&sSingle));
+
+	fprintf(psOut, "{\"busHz\":%s,\"single\":", pcHz);
+	busBenchPrint(psOut, pcSingle, &sSingle);
+	fprintf(psOut, ",\"split\":");
+	busBenchPrint(psOut, pcSplit, &sSplit);
+	fprintf(psOut, ",\"latencyRatio\":%.3f,\"pass\":%s}\n",
+			busBenchMeanMs(&sSingle) ? (busBenchMeanMs(&sSplit) / busBenchMeanMs(&sSingle)) : 0.0,
+			bPass ? "true" : "false");
+	fflush(psOut);
+
+	return(bPass ? 0 : 1);
+}
@@ -0,0 +1,837 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils/ustdlib.h"
+
+#include "cgifuncs.h"
+
+//*****************************************************************************
+/*  Benchmark of the CGI query parsing, the list scan of FindCGIParameter and
+ *  DecodeFormString against IndexCGIParams and the single pass
+ *  ParseCGIQuery, which ws_http runs for the handlers.
+ *
+ *  First random queries over separators, escapes and a few names are fuzzed:
+ *  ParseCGIQuery has to split and decode them like httpd's split followed by
+ *  the old byte at a time decoder, IndexCGIParams has to give that decoder's
+ *  values, and the lookups have to find the first parameter of a name.
+ *
+ *  Then random queries of 2, 4, 8, 12 and 16 parameters with escaped values
+ *  are parsed and every parameter plus one missing name is looked up. The
+ *  old path splits the query the way httpd does before it calls a CGI
+ *  handler, scans the list per lookup and decodes each value found into a
+ *  buffer. The indexed path splits the same way and indexes the arrays, the
+ *  parsed one runs ParseCGIQuery. Up to CGI_QUERY_LINEAR_MAX parameters both look the
+ *  names up by a scan like the old path, above it by hash. Built with
+ *  CFLAGS="-O2 -DCGI_QUERY_LINEAR_MAX=0", or =16, every size is hashed, or
+ *  scanned (see cgifuncs.h). All paths sum the indexes and decoded lengths
+ *  they find, the sums have to agree.
+ *
+ *  The second table times the word at a time DecodeFormString and
+ *  EncodeFormString against the byte at a time loops they replaced, kept
+ *  here as reference, over short control values, set_text posts and text
+ *  with the odd apostrophe. Every input, and a set of cut off escapes and
+ *  short buffers, is first run through both, the output bytes and counts
+ *  have to agree.
+ *
+ *  The third table times ParseDecimalParam and ParseFixedParam against the
+ *  unchecked CheckDecimalParam loop they replaced. Before that, both parsers
+ *  are checked against a 64 bit reference: every integer of +-100000 in
+ *  several spellings and at 0 to 3 decimal places, the int32_t limits and
+ *  their neighbours, and random strings over digits, signs, points, blanks
+ *  and separators. Any disagreement is printed and the benchmark exits
+ *  non-zero.
+ *
+ *      ./build/cgibench [iterations] */
+//*****************************************************************************
+
+#define BENCH_QUERIES			256
+#define BENCH_QUERY_LEN			512
+#define BENCH_VALUE_LEN			64
+
+static char BenchQueries[BENCH_QUERIES][BENCH_QUERY_LEN];
+static char BenchNames[CGI_QUERY_MAX_PARAMS + 1][16];
+
+static uint64_t benchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+/* name=value pairs, values with '+' and %xx escapes */
+static void benchMakeQuery(char *pcQuery, uint32_t ui32Params)
+{
+	static const char pcPlain[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+	uint32_t ui32Param, ui32Char, ui32Len;
+	int iLen = 0;
+
+	for(ui32Param = 0; ui32Param < ui32Params; ui32Param++)
+	{
+		iLen += sprintf(pcQuery + iLen, "%s%s=", ui32Param ? "&" : "", BenchNames[ui32Param]);
+		ui32Len = 1 + rand() % 24;
+		for(ui32Char = 0; ui32Char < ui32Len; ui32Char++)
+		{
+			switch(rand() % 8)
+			{
+				case 0:
+					pcQuery[iLen++] = '+';
+					break;
+				case 1:
+					iLen += sprintf(pcQuery + iLen, "%%%02X", 0x21 + rand() % 0x5e);
+					break;
+				default:
+					pcQuery[iLen++] = pcPlain[rand() % (sizeof(pcPlain) - 1)];
+					break;
+			}
+		}
+	}
+	pcQuery[iLen] = 0;
+}
+
+/* What httpd does before calling a CGI handler */
+static int32_t benchSplit(char *pcQuery, char *ppcParam[], char *ppcValue[])
+{
+	int32_t i32Count = 0;
+	char *pcPair = pcQuery, *pcEquals;
+
+	while(pcPair && (i32Count < CGI_QUERY_MAX_PARAMS))
+	{
+		ppcParam[i32Count] = pcPair;
+		pcPair = strchr(pcPair, '&');
+		if(pcPair)
+		{
+			*pcPair++ = 0;
+		}
+		pcEquals = strchr(ppcParam[i32Count], '=');
+		if(pcEquals)
+		{
+			*pcEquals++ = 0;
+			ppcValue[i32Count] = pcEquals;
+		}
+		else
+		{
+			ppcValue[i32Count] = ppcParam[i32Count] + strlen(ppcParam[i32Count]);
+		}
+		i32Count++;
+	}
+
+	return(i32Count);
+}
+
+/* The byte at a time decoder cgifuncs.c had before the word scan */
+static unsigned char benchHexDigit(char cDigit)
+{
+	if((cDigit >= '0') && (cDigit <= '9'))
+	{
+		return(cDigit - '0');
+	}
+	if((cDigit >= 'a') && (cDigit <= 'f'))
+	{
+		return((cDigit - 'a') + 10);
+	}
+	if((cDigit >= 'A') && (cDigit <= 'F'))
+	{
+		return((cDigit - 'A') + 10);
+	}
+	return(0xFF);
+}
+
+static uint32_t benchDecodeBytewise(const char *pcEncoded, char *pcDecoded, uint32_t ui32Len)
+{
+	uint32_t ui32Loop = 0, ui32Count = 0;
+	unsigned char ucHigh, ucLow;
+
+	while(pcEncoded[ui32Loop] && (ui32Count < (ui32Len - 1)))
+	{
+		switch(pcEncoded[ui32Loop])
+		{
+			case '+':
+				pcDecoded[ui32Count++] = ' ';
+				ui32Loop++;
+				break;
+
+			case '%':
+				if(!pcEncoded[ui32Loop + 1] || !pcEncoded[ui32Loop + 2])
+				{
+					pcDecoded[ui32Count] = 0;
+					return(ui32Count);
+				}
+				ucHigh = benchHexDigit(pcEncoded[ui32Loop + 1]);
+				ucLow = benchHexDigit(pcEncoded[ui32Loop + 2]);
+				if((ucHigh != 0xFF) && (ucLow != 0xFF))
+				{
+					pcDecoded[ui32Count++] = (char)(ucHigh * 16 + ucLow);
+				}
+				ui32Loop += 3;
+				break;
+
+			default:
+				pcDecoded[ui32Count++] = pcEncoded[ui32Loop++];
+				break;
+		}
+	}
+
+	pcDecoded[ui32Count] = 0;
+	return(ui32Count);
+}
+
+/* And the encoder */
+static uint32_t benchEncodeBytewise(const char *pcDecoded, char *pcEncoded, uint32_t ui32Len)
+{
+	uint32_t ui32Loop, ui32Count = 0;
+
+	if(ui32Len <= 1)
+	{
+		return(0);
+	}
+
+	for(ui32Loop = 0; pcDecoded[ui32Loop] && (ui32Count < (ui32Len - 1)); ui32Loop++)
+	{
+		if(pcDecoded[ui32Loop] == '\'')
+		{
+			ui32Count += usnprintf(&pcEncoded[ui32Count], (ui32Len - ui32Count), "&#39;");
+		}
+		else
+		{
+			pcEncoded[ui32Count++] = pcDecoded[ui32Loop];
+		}
+	}
+
+	return(ui32Count);
+}
+
+/* Form values as the pages send them: a short control value, a set_text
+ * post of words and punctuation, or plain text for the encoder */
+static void benchMakeText(char *pcText, uint32_t ui32Kind)
+{
+	static const char *ppcShort[] = { "on", "off", "50", "100", "0x1F", "3" };
+	static const char *ppcWords[] = { "Temperature", "is", "rising", "it's", "22.5",
+									  "degrees", "humidity", "at", "60%", "wind", "NE",
+									  "don't", "forget", "the", "umbrella", "hPa" };
+	uint32_t ui32Words, ui32Word;
+	const char *pcWord;
+	int iLen = 0;
+
+	if(ui32Kind == 0)
+	{
+		strcpy(pcText, ppcShort[rand() % 6]);
+		return;
+	}
+
+	ui32Words = 8 + rand() % 40;
+	for(ui32Word = 0; ui32Word < ui32Words; ui32Word++)
+	{
+		pcWord = ppcWords[rand() % 16];
+		if(ui32Word)
+		{
+			pcText[iLen++] = (ui32Kind == 1) ? '+' : ' ';
+		}
+		for(; *pcWord; pcWord++)
+		{
+			/* Form encoding escapes the punctuation */
+			if((ui32Kind == 1) && ((*pcWord == '\'') || (*pcWord == '%') || (*pcWord == '.')))
+			{
+				iLen += sprintf(pcText + iLen, "%%%02X", (uint8_t)*pcWord);
+			}
+			else
+			{
+				pcText[iLen++] = *pcWord;
+			}
+		}
+	}
+	pcText[iLen] = 0;
+}
+
+/* Both codecs on one input and output size, false if they disagree */
+static bool benchSame(const char *pcIn, uint32_t ui32Len)
+{
+	char pcOld[BENCH_QUERY_LEN + 8], pcNew[BENCH_QUERY_LEN + 8];
+	uint32_t ui32Old, ui32New;
+
+	memset(pcOld, 0x55, sizeof(pcOld));
+	memset(pcNew, 0x55, sizeof(pcNew));
+	ui32Old = benchDecodeBytewise(pcIn, pcOld, ui32Len);
+	ui32New = DecodeFormString(pcIn, pcNew, ui32Len);
+	if((ui32Old != ui32New) || memcmp(pcOld, pcNew, sizeof(pcOld)))
+	{
+		return(false);
+	}
+
+	memset(pcOld, 0x55, sizeof(pcOld));
+	memset(pcNew, 0x55, sizeof(pcNew));
+	ui32Old = benchEncodeBytewise(pcIn, pcOld, ui32Len);
+	ui32New = EncodeFormString(pcIn, pcNew, ui32Len);
+	if((ui32Old != ui32New) || memcmp(pcOld, pcNew, sizeof(pcOld)))
+	{
+		return(false);
+	}
+
+	/* In place, from every alignment */
+	strcpy(pcNew + (ui32Len & 3), pcIn);
+	ui32Old = benchDecodeBytewise(pcIn, pcOld, sizeof(pcOld));
+	ui32New = DecodeFormStringInPlace(pcNew + (ui32Len & 3));
+	return((ui32Old == ui32New) && !strcmp(pcOld, pcNew + (ui32Len & 3)));
+}
+
+static bool benchEquivalent(void)
+{
+	static const char *ppcEdges[] = { "", "%", "%4", "%41", "%4g", "%g4", "+%", "abc%", "abc%4",
+									  "a%41b%zzc", "%%%41", "'", "", "abc'def'",
+									  "%2B+%2b", "%C3%A9t%C3%A9", "%00abc", "abcdefgh%" };
+	uint32_t ui32Idx, ui32Len;
+	char pcText[BENCH_QUERY_LEN];
+
+	for(ui32Idx = 0; ui32Idx < sizeof(ppcEdges) / sizeof(ppcEdges[0]); ui32Idx++)
+	{
+		for(ui32Len = 1; ui32Len < 24; ui32Len++)
+		{
+			if(!benchSame(ppcEdges[ui32Idx], ui32Len))
+			{
+				printf("differs on \"%s\", %u bytes\n", ppcEdges[ui32Idx], ui32Len);
+				return(false);
+			}
+		}
+	}
+
+	for(ui32Idx = 0; ui32Idx < 3000; ui32Idx++)
+	{
+		benchMakeText(pcText, ui32Idx % 3);
+		ui32Len = 1 + rand() % BENCH_QUERY_LEN;
+		if(!benchSame(pcText, ui32Len) || !benchSame(pcText, BENCH_QUERY_LEN))
+		{
+			printf("differs on \"%s\", %u bytes\n", pcText, ui32Len);
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/* The pairs of a query the way httpd splits them, on the raw '&' and the
+ * first raw '=', each part decoded on its own. A pair without '=' whose name
+ * decodes to no bytes is skipped, as ParseCGIQuery does. */
+static int32_t benchParseReference(const char *pcQuery, char ppcName[][BENCH_QUERY_LEN],
+								   char ppcValue[][BENCH_QUERY_LEN])
+{
+	char pcPair[BENCH_QUERY_LEN], *pcEquals;
+	const char *pcEnd;
+	int32_t i32Count = 0;
+	uint32_t ui32Len;
+
+	while(i32Count < CGI_QUERY_MAX_PARAMS)
+	{
+		pcEnd = strchr(pcQuery, '&');
+		if(!pcEnd)
+		{
+			pcEnd = pcQuery + strlen(pcQuery);
+		}
+		memcpy(pcPair, pcQuery, pcEnd - pcQuery);
+		pcPair[pcEnd - pcQuery] = 0;
+
+		pcEquals = strchr(pcPair, '=');
+		if(pcEquals)
+		{
+			*pcEquals++ = 0;
+		}
+		ui32Len = benchDecodeBytewise(pcPair, ppcName[i32Count], BENCH_QUERY_LEN);
+		benchDecodeBytewise(pcEquals ? pcEquals : "", ppcValue[i32Count], BENCH_QUERY_LEN);
+		if(pcEquals || ui32Len)
+		{
+			i32Count++;
+		}
+
+		if(!*pcEnd)
+		{
+			break;
+		}
+		pcQuery = pcEnd + 1;
+	}
+
+	return(i32Count);
+}
+
+/* Random queries over separators, escapes and a few names. ParseCGIQuery
+ * has to give the reference's pairs, IndexCGIParams the values the old
+ * decoder gives, and both the first parameter of a name, hashed or not. */
+static bool benchQueryFuzz(uint32_t ui32Queries)
+{
+	static const char pcAlphabet[] = "ab&&=%%+04Fgx";
+	static char ppcName[CGI_QUERY_MAX_PARAMS][BENCH_QUERY_LEN];
+	static char ppcValue[CGI_QUERY_MAX_PARAMS][BENCH_QUERY_LEN];
+	char pcQuery[BENCH_QUERY_LEN], pcWork[BENCH_QUERY_LEN], pcDecoded[BENCH_QUERY_LEN];
+	char *ppcParam[CGI_QUERY_MAX_PARAMS], *ppcRaw[CGI_QUERY_MAX_PARAMS];
+	char ppcRawValue[CGI_QUERY_MAX_PARAMS][BENCH_QUERY_LEN];
+	uint32_t ui32Query, ui32Len;
+	int32_t i32Count, i32Idx, i32First;
+	tCGIQuery sQuery;
+
+	for(ui32Query = 0; ui32Query < ui32Queries; ui32Query++)
+	{
+		for(ui32Len = rand() % 120, pcQuery[ui32Len] = 0; ui32Len--; )
+		{
+			pcQuery[ui32Len] = pcAlphabet[rand() % (sizeof(pcAlphabet) - 1)];
+		}
+
+		i32Count = benchParseReference(pcQuery, ppcName, ppcValue);
+		strcpy(pcWork, pcQuery);
+		if(ParseCGIQuery(pcWork, &sQuery) != i32Count)
+		{
+			printf("\"%s\": %d parameters, the reference has %d\n", pcQuery, sQuery.i32NumParams,
+				   i32Count);
+			return(false);
+		}
+		for(i32Idx = 0; i32Idx < i32Count; i32Idx++)
+		{
+			for(i32First = 0; strcmp(ppcName[i32First], ppcName[i32Idx]); i32First++)
+			{
+			}
+			if(strcmp(sQuery.ppcName[i32Idx], ppcName[i32Idx]) ||
+			   strcmp(sQuery.ppcValue[i32Idx], ppcValue[i32Idx]) ||
+			   (FindCGIQueryParam(&sQuery, ppcName[i32Idx]) != i32First))
+			{
+				printf("\"%s\": parameter %d is \"%s\"=\"%s\", the reference has \"%s\"=\"%s\"\n",
+					   pcQuery, i32Idx, sQuery.ppcName[i32Idx], sQuery.ppcValue[i32Idx],
+					   ppcName[i32Idx], ppcValue[i32Idx]);
+				return(false);
+			}
+		}
+		if(FindCGIQueryParam(&sQuery, "missing") != -1)
+		{
+			printf("\"%s\": finds a missing parameter\n", pcQuery);
+			return(false);
+		}
+
+		/* The handlers' path, over the arrays httpd splits */
+		strcpy(pcWork, pcQuery);
+		i32Count = benchSplit(pcWork, ppcParam, ppcRaw);
+		for(i32Idx = 0; i32Idx < i32Count; i32Idx++)
+		{
+			strcpy(ppcRawValue[i32Idx], ppcRaw[i32Idx]);
+		}
+		IndexCGIParams(&sQuery, ppcParam, ppcRaw, i32Count);
+		for(i32Idx = 0; i32Idx < i32Count; i32Idx++)
+		{
+			benchDecodeBytewise(ppcRawValue[i32Idx], pcDecoded, sizeof(pcDecoded));
+			if(strcmp(sQuery.ppcValue[i32Idx], pcDecoded) ||
+			   (FindCGIQueryParam(&sQuery, ppcParam[i32Idx]) !=
+				FindCGIParameter(ppcParam[i32Idx], ppcParam, i32Count)))
+			{
+				printf("\"%s\": indexed parameter %d differs\n", pcQuery, i32Idx);
+				return(false);
+			}
+		}
+	}
+
+	return(true);
+}
+
+/* ns per call of the old and the new codec over BenchQueries */
+static void benchCodec(const char *pcName, bool bDecode, uint32_t ui32Iterations)
+{
+	char pcOut[BENCH_QUERY_LEN];
+	uint32_t ui32Iter;
+	uint64_t ui64Start, ui64OldNs, ui64NewNs, ui64OldSum = 0, ui64NewSum = 0;
+	const char *pcIn;
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		pcIn = BenchQueries[ui32Iter % BENCH_QUERIES];
+		ui64OldSum += bDecode ? benchDecodeBytewise(pcIn, pcOut, sizeof(pcOut)) :
+								benchEncodeBytewise(pcIn, pcOut, sizeof(pcOut));
+	}
+	ui64OldNs = benchNs() - ui64Start;
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		pcIn = BenchQueries[ui32Iter % BENCH_QUERIES];
+		ui64NewSum += bDecode ? DecodeFormString(pcIn, pcOut, sizeof(pcOut)) :
+								EncodeFormString(pcIn, pcOut, sizeof(pcOut));
+	}
+	ui64NewNs = benchNs() - ui64Start;
+
+	printf("%-14s  %12.1f  %12.1f  %6.2fx%s\n", pcName,
+		   (double)ui64OldNs / ui32Iterations, (double)ui64NewNs / ui32Iterations,
+		   (double)ui64OldNs / (double)ui64NewNs,
+		   (ui64OldSum == ui64NewSum) ? "" : "  (results differ)");
+}
+
+/* CheckDecimalParam before the range checked parser: no overflow check,
+ * an empty string or a bare sign reads as 0 */
+static bool benchCheckDecimalOld(const char *pcValue, int32_t *pi32Value)
+{
+	bool bStarted = false, bFinished = false, bNeg = false;
+	int32_t i32Accum = 0;
+
+	for(; *pcValue; pcValue++)
+	{
+		if(!bStarted)
+		{
+			if((*pcValue == ' ') || (*pcValue == '\t'))
+			{
+				continue;
+			}
+			bStarted = true;
+			if((*pcValue == '+') || (*pcValue == '-'))
+			{
+				bNeg = (*pcValue == '-');
+				continue;
+			}
+		}
+		if(!bFinished && (*pcValue >= '0') && (*pcValue <= '9'))
+		{
+			i32Accum = (i32Accum * 10) + (*pcValue - '0');
+		}
+		else if((*pcValue == ' ') || (*pcValue == '\t'))
+		{
+			bFinished = true;
+		}
+		else
+		{
+			return(false);
+		}
+	}
+
+	*pi32Value = bNeg ? -i32Accum : i32Accum;
+	return(true);
+}
+
+/* The number grammar of ParseFixedParam over a saturating 64 bit magnitude */
+static bool benchFixedReference(const char *pcValue, uint32_t ui32Decimals, int32_t i32Min,
+								int32_t i32Max, int32_t *pi32Value)
+{
+	int64_t i64Mag = 0, i64Value;
+	int iFrac = -1, iDigits = 0;
+	bool bNeg = false;
+
+	while((*pcValue == ' ') || (*pcValue == '\t'))
+	{
+		pcValue++;
+	}
+	if((*pcValue == '-') || (*pcValue == '+'))
+	{
+		bNeg = (*pcValue++ == '-');
+	}
+	for(;; pcValue++)
+	{
+		if((*pcValue >= '0') && (*pcValue <= '9'))
+		{
+			iDigits++;
+			if(iFrac >= (int)ui32Decimals)
+			{
+				if(*pcValue != '0')
+				{
+					return(false);
+				}
+				continue;
+			}
+			if(iFrac >= 0)
+			{
+				iFrac++;
+			}
+			i64Mag = i64Mag * 10 + (*pcValue - '0');
+			if(i64Mag > 100000000000LL)
+			{
+				i64Mag = 100000000000LL;
+			}
+		}
+		else if((*pcValue == '.') && (iFrac < 0) && ui32Decimals)
+		{
+			if((pcValue[1] < '0') || (pcValue[1] > '9'))
+			{
+				return(false);
+			}
+			iFrac = 0;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if(!iDigits)
+	{
+		return(false);
+	}
+	for(iFrac = (iFrac < 0) ? 0 : iFrac; iFrac < (int)ui32Decimals; iFrac++)
+	{
+		i64Mag = (i64Mag > 100000000000LL) ? i64Mag : i64Mag * 10;
+	}
+	while((*pcValue == ' ') || (*pcValue == '\t'))
+	{
+		pcValue++;
+	}
+	if(*pcValue && (*pcValue != '&'))
+	{
+		return(false);
+	}
+
+	i64Value = bNeg ? -i64Mag : i64Mag;
+	if((i64Value < INT32_MIN) || (i64Value > INT32_MAX) || (i64Value < i32Min) ||
+	   (i64Value > i32Max))
+	{
+		return(false);
+	}
+	*pi32Value = (int32_t)i64Value;
+	return(true);
+}
+
+static bool benchNumberSame(const char *pcValue, uint32_t ui32Decimals, int32_t i32Min,
+							int32_t i32Max)
+{
+	int32_t i32Ref = 0x5A5A5A5A, i32New = 0x5A5A5A5A;
+	bool bRef, bNew;
+
+	bRef = benchFixedReference(pcValue, ui32Decimals, i32Min, i32Max, &i32Ref);
+	bNew = ParseFixedParam(pcValue, ui32Decimals, i32Min, i32Max, &i32New);
+	if((bRef != bNew) || (i32Ref != i32New))
+	{
+		printf("differs on \"%s\" at %u places: %d %d, %d %d\n", pcValue, ui32Decimals,
+			   bRef, i32Ref, bNew, i32New);
+		return(false);
+	}
+
+	return(true);
+}
+
+static bool benchNumbersValid(void)
+{
+	static const char *ppcForms[] = { "%s", " %s", "%s\t", "+%s", "%s&x=1", " %s  &" };
+	static const char *ppcLimits[] = { "2147483647", "2147483648", "-2147483648", "-2147483649",
+									   "4294967296", "99999999999", "214748364.7", "-214748364.8",
+									   "21474836.48", "0.000000001", "-0", "00000000000000000001" };
+	static const char pcAlphabet[] = "0123456789+-. \t&x";
+	char pcNumber[32], pcValue[48];
+	uint32_t ui32Decimals, ui32Form, ui32Idx, ui32Len;
+	int32_t i32Value, i32Scale;
+
+	for(ui32Decimals = 0; ui32Decimals <= 3; ui32Decimals++)
+	{
+		for(i32Scale = 1, ui32Idx = 0; ui32Idx < ui32Decimals; ui32Idx++)
+		{
+			i32Scale *= 10;
+		}
+		for(i32Value = -100000; i32Value <= 100000; i32Value++)
+		{
+			if(ui32Decimals)
+			{
+				sprintf(pcNumber, "%s%d.%0*d", (i32Value < 0) ? "-" : "", abs(i32Value) / i32Scale,
+						(int)ui32Decimals, abs(i32Value) % i32Scale);
+			}
+			else
+			{
+				sprintf(pcNumber, "%d", i32Value);
+			}
+			for(ui32Form = 0; ui32Form < sizeof(ppcForms) / sizeof(ppcForms[0]); ui32Form++)
+			{
+				if((ui32Form == 3) && (i32Value < 0))
+				{
+					continue;
+				}
+				sprintf(pcValue, ppcForms[ui32Form], pcNumber);
+				if(!benchNumberSame(pcValue, ui32Decimals, INT32_MIN, INT32_MAX) ||
+				   !benchNumberSame(pcValue, ui32Decimals, -5000, 5000))
+				{
+					return(false);
+				}
+			}
+		}
+	}
+
+	for(ui32Idx = 0; ui32Idx < sizeof(ppcLimits) / sizeof(ppcLimits[0]); ui32Idx++)
+	{
+		for(ui32Decimals = 0; ui32Decimals <= 9; ui32Decimals++)
+		{
+			if(!benchNumberSame(ppcLimits[ui32Idx], ui32Decimals, INT32_MIN, INT32_MAX))
+			{
+				return(false);
+			}
+		}
+	}
+
+	for(ui32Idx = 0; ui32Idx < 2000000; ui32Idx++)
+	{
+		for(ui32Len = rand() % 14, pcValue[ui32Len] = 0; ui32Len--; )
+		{
+			pcValue[ui32Len] = pcAlphabet[rand() % (sizeof(pcAlphabet) - 1)];
+		}
+		if(!benchNumberSame(pcValue, rand() % 4, INT32_MIN, INT32_MAX))
+		{
+			return(false);
+		}
+	}
+
+	return(FindQueryValue("?res=60&from=7", "from") &&
+		   !strcmp(FindQueryValue("?res=60&from=7", "from"), "7") &&
+		   !FindQueryValue("xres=1&resx=2", "res") &&
+		   !strcmp(FindQueryValue("a&res&b=1", "res"), "&b=1"));
+}
+
+/* ns per value of the old and new integer parsers and of ParseFixedParam */
+static void benchNumbers(uint32_t ui32Iterations)
+{
+	static const char *ppcValues[] = { "50", "100", "0", "-1234", " 75 ", "2147483647", "7",
+									   "-40", "1013", "65535", "22", "+3" };
+	static const char *ppcFixed[] = { "22.5", "-4.25", "1013.25", "0.5", "100", "-40.0" };
+	uint64_t ui64Start, ui64OldNs, ui64NewNs, ui64FixedNs, ui64OldSum = 0, ui64NewSum = 0;
+	uint32_t ui32Iter;
+	int32_t i32Value;
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		benchCheckDecimalOld(ppcValues[ui32Iter % 12], &i32Value);
+		ui64OldSum += i32Value;
+	}
+	ui64OldNs = benchNs() - ui64Start;
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		ParseDecimalParam(ppcValues[ui32Iter % 12], INT32_MIN, INT32_MAX, &i32Value);
+		ui64NewSum += i32Value;
+	}
+	ui64NewNs = benchNs() - ui64Start;
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		ParseFixedParam(ppcFixed[ui32Iter % 6], 2, INT32_MIN, INT32_MAX, &i32Value);
+		ui64NewSum += i32Value;
+	}
+	ui64FixedNs = benchNs() - ui64Start;
+
+	printf("\nnumbers         old ns/value  new ns/value  speedup  fixed ns/value\n");
+	printf("%-14s  %12.1f  %12.1f  %6.2fx  %14.1f\n", "decimal",
+		   (double)ui64OldNs / ui32Iterations, (double)ui64NewNs / ui32Iterations,
+		   (double)ui64OldNs / (double)ui64NewNs, (double)ui64FixedNs / ui32Iterations);
+	(void)ui64OldSum;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32Iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20000;
+	char pcWork[BENCH_QUERY_LEN], pcDecoded[BENCH_VALUE_LEN];
+	char *ppcParam[CGI_QUERY_MAX_PARAMS], *ppcValue[CGI_QUERY_MAX_PARAMS];
+	uint32_t ui32Params, ui32Iter, ui32Query, ui32Name;
+	uint64_t ui64Start, ui64OldNs, ui64IndexNs, ui64NewNs, ui64OldSum, ui64IndexSum, ui64NewSum;
+	int32_t i32Count, i32Index;
+	tCGIQuery sQuery;
+	static const char *ppcKinds[] = { "decode short", "decode text", "encode text" };
+	uint32_t ui32Kind;
+
+	for(ui32Name = 0; ui32Name <= CGI_QUERY_MAX_PARAMS; ui32Name++)
+	{
+		sprintf(BenchNames[ui32Name], "param_%u", ui32Name);
+	}
+
+	srand(1);
+	if(!benchQueryFuzz(200000))
+	{
+		return(1);
+	}
+
+	printf("params  old ns/query  indexed ns/query  speedup  parsed ns/query  speedup\n");
+	for(ui32Params = 2; ui32Params <= CGI_QUERY_MAX_PARAMS;
+		ui32Params += (ui32Params < 8) ? ui32Params : 4)
+	{
+		srand(ui32Params);
+		for(ui32Query = 0; ui32Query < BENCH_QUERIES; ui32Query++)
+		{
+			benchMakeQuery(BenchQueries[ui32Query], ui32Params);
+		}
+
+		ui64OldSum = 0;
+		ui64Start = benchNs();
+		for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+		{
+			strcpy(pcWork, BenchQueries[ui32Iter % BENCH_QUERIES]);
+			i32Count = benchSplit(pcWork, ppcParam, ppcValue);
+			for(ui32Name = 0; ui32Name <= ui32Params; ui32Name++)
+			{
+				i32Index = FindCGIParameter(BenchNames[ui32Name], ppcParam, i32Count);
+				if(i32Index != -1)
+				{
+					ui64OldSum += i32Index + DecodeFormString(ppcValue[i32Index], pcDecoded,
+															  sizeof(pcDecoded));
+				}
+			}
+		}
+		ui64OldNs = benchNs() - ui64Start;
+
+		ui64IndexSum = 0;
+		ui64Start = benchNs();
+		for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+		{
+			strcpy(pcWork, BenchQueries[ui32Iter % BENCH_QUERIES]);
+			i32Count = benchSplit(pcWork, ppcParam, ppcValue);
+			IndexCGIParams(&sQuery, ppcParam, ppcValue, i32Count);
+			for(ui32Name = 0; ui32Name <= ui32Params; ui32Name++)
+			{
+				i32Index = FindCGIQueryParam(&sQuery, BenchNames[ui32Name]);
+				if(i32Index != -1)
+				{
+					ui64IndexSum += i32Index + strlen(sQuery.ppcValue[i32Index]);
+				}
+			}
+		}
+		ui64IndexNs = benchNs() - ui64Start;
+
+		ui64NewSum = 0;
+		ui64Start = benchNs();
+		for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+		{
+			strcpy(pcWork, BenchQueries[ui32Iter % BENCH_QUERIES]);
+			ParseCGIQuery(pcWork, &sQuery);
+			for(ui32Name = 0; ui32Name <= ui32Params; ui32Name++)
+			{
+				i32Index = FindCGIQueryParam(&sQuery, BenchNames[ui32Name]);
+				if(i32Index != -1)
+				{
+					ui64NewSum += i32Index + strlen(sQuery.ppcValue[i32Index]);
+				}
+			}
+		}
+		ui64NewNs = benchNs() - ui64Start;
+
+		printf("%6u  %12.1f  %16.1f  %6.2fx  %15.1f  %6.2fx\n", ui32Params,
+			   (double)ui64OldNs / ui32Iterations, (double)ui64IndexNs / ui32Iterations,
+			   (double)ui64OldNs / (double)ui64IndexNs, (double)ui64NewNs / ui32Iterations,
+			   (double)ui64OldNs / (double)ui64NewNs);
+		if((ui64IndexSum != ui64OldSum) || (ui64NewSum != ui64OldSum))
+		{
+			printf("results differ\n");
+			return(1);
+		}
+	}
+
+	srand(1);
+	if(!benchEquivalent())
+	{
+		return(1);
+	}
+
+	printf("\ncodec           old ns/call   new ns/call  speedup\n");
+	for(ui32Kind = 0; ui32Kind < 3; ui32Kind++)
+	{
+		for(ui32Query = 0; ui32Query < BENCH_QUERIES; ui32Query++)
+		{
+			benchMakeText(BenchQueries[ui32Query], ui32Kind);
+		}
+		benchCodec(ppcKinds[ui32Kind], ui32Kind < 2, ui32Iterations);
+	}
+
+	if(!benchNumbersValid())
+	{
+		return(1);
+	}
+	benchNumbers(ui32Iterations * 10);
+
+	return(0);
+}
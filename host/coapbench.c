@@ -0,0 +1,737 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils/lwiplib.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/ip.h"
+
+#include "weather_station/ws_coap.h"
+#include "weather_station/ws_coap_msg.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Traffic of the CoAP server against the JSON poll, on the host build.
+ *
+ *  Two kinds of clients run inside the firmware process on lwIP's raw API,
+ *  both against the station's own address:
+ *
+ *  - CoAP observers, -c of them, each observing /temperature, /humidity,
+ *    /pressure and /light in text (-f text) or CBOR (-f cbor). They
+ *    acknowledge the CON notifications and decode every value. A
+ *    registration that meets no server yet, or 5.03 before the first
+ *    sample, is repeated every second.
+ *  - One dashboard polling /cgi-bin/send_data every -p ms, as index.html
+ *    does, on a connection per poll or, with -k, on one HTTP/1.1
+ *    connection.
+ *
+ *  A tap on the simulated link counts the IP packets and bytes of each
+ *  protocol in both directions: requests, responses, acknowledgements and,
+ *  for HTTP, the handshakes and the closes. The report divides them by the
+ *  updates each side got, and by the updates that carried a changed value
+ *  (the poll returns the four sensor values whether they changed or not):
+ *
+ *      ./build/coapbench -d 60 -o result.json
+ *      ./build/coapbench -d 60 -f cbor -k
+ *
+ *  -c observers (at most WS_COAP_OBSERVERS / 4), -d duration in s, -f
+ *  format of the notifications, -p poll period in ms, -k keep-alive, -o
+ *  output file (stdout by default), -v keeps the firmware's UART output. */
+//*****************************************************************************
+
+#define COAPBENCH_MAX_CLIENTS	(WS_COAP_OBSERVERS / WS_COAP_RESOURCES)
+#define COAPBENCH_HTTP_PORT		80
+
+/* Address of the station on the simulated link */
+#define COAPBENCH_SERVER(a)		IP4_ADDR((a), 10, 0, 0, 2)
+
+/* Registrations not answered are repeated that often */
+#define COAPBENCH_RETRY_MS		1000
+
+/* Response of the poll kept to be parsed */
+#define COAPBENCH_RESPONSE_LEN	1024
+
+/* Body of a response without a Content-Length, ends with the connection */
+#define COAPBENCH_UNTIL_CLOSE	UINT32_MAX
+
+/* IPv4 header fields the tap reads */
+#define COAPBENCH_IP_PROTO		9
+
+typedef struct {
+	struct udp_pcb *psPcb;
+	uint16_t ui16NextId;
+	bool pbObserving[WS_COAP_RESOURCES];
+	bool pbRefused[WS_COAP_RESOURCES];
+	bool pbHave[WS_COAP_RESOURCES];
+	int32_t pi32Last[WS_COAP_RESOURCES];
+}CoapBenchClient_t;
+
+typedef struct {
+	uint32_t ui32Packets;
+	uint64_t ui64Bytes;
+}CoapBenchLink_t;
+
+static const char * const CoapBenchPaths[WS_COAP_RESOURCES] =
+{
+	"temperature", "humidity", "pressure", "light"
+};
+
+static uint32_t CoapBenchDurationMs = 10000;
+static uint32_t CoapBenchNumClients = 1;
+static uint32_t CoapBenchPollMs = 1000;
+static bool CoapBenchCbor;
+static bool CoapBenchKeepAlive;
+static FILE *CoapBenchOut;
+
+static CoapBenchClient_t CoapBenchClients[COAPBENCH_MAX_CLIENTS];
+
+/* The dashboard, one request at a time */
+static struct tcp_pcb *CoapBenchHttpPCB;
+static bool CoapBenchHttpBusy;
+static char CoapBenchResponse[COAPBENCH_RESPONSE_LEN];
+static uint32_t CoapBenchResponseLen;
+static uint32_t CoapBenchBodyStart;		/* 0 while the header is incomplete */
+static uint32_t CoapBenchBodyLeft;
+static bool CoapBenchHttpHave;
+static int32_t CoapBenchHttpLast[WS_COAP_RESOURCES];
+
+/* Run */
+static uint64_t CoapBenchRunStart;
+static uint64_t CoapBenchNextPoll;
+static uint64_t CoapBenchNextRetry;
+static WS_CoapStats_t CoapBenchStart;
+
+/* What the clients saw */
+static CoapBenchLink_t CoapBenchCoapLink;
+static CoapBenchLink_t CoapBenchHttpLink;
+static uint32_t CoapBenchRegistrations;
+static uint32_t CoapBenchNotifications;
+static uint32_t CoapBenchCoapChanges;
+static uint32_t CoapBenchCoapInvalid;
+static uint32_t CoapBenchAcks;
+static uint32_t CoapBenchPolls;
+static uint32_t CoapBenchPollsSkipped;
+static uint32_t CoapBenchPollsFailed;
+static uint32_t CoapBenchHttpValues;
+static uint32_t CoapBenchHttpChanges;
+static uint32_t CoapBenchConnects;
+
+extern int firmwareMain(void);
+
+//*****************************************************************************
+//
+// Link tap.
+//
+//*****************************************************************************
+static void coapBenchTap(const struct pbuf *p)
+{
+	uint8_t pui8Head[64];
+	uint32_t ui32IPLen;
+	uint16_t ui16Src, ui16Dest;
+	CoapBenchLink_t *psLink = NULL;
+
+	if(!CoapBenchRunStart || (p->tot_len < 28))
+	{
+		return;
+	}
+	pbuf_copy_partial((struct pbuf *)p, pui8Head, (p->tot_len < sizeof(pui8Head)) ?
+					  p->tot_len : sizeof(pui8Head), 0);
+	ui32IPLen = (pui8Head[0] & 0x0F) * 4;
+	if((ui32IPLen + 4) > sizeof(pui8Head))
+	{
+		return;
+	}
+	ui16Src = (pui8Head[ui32IPLen] << 8) | pui8Head[ui32IPLen + 1];
+	ui16Dest = (pui8Head[ui32IPLen + 2] << 8) | pui8Head[ui32IPLen + 3];
+
+	if((pui8Head[COAPBENCH_IP_PROTO] == IP_PROTO_UDP) &&
+	   ((ui16Src == WS_COAP_PORT) || (ui16Dest == WS_COAP_PORT)))
+	{
+		psLink = &CoapBenchCoapLink;
+	}
+	else if((pui8Head[COAPBENCH_IP_PROTO] == IP_PROTO_TCP) &&
+			((ui16Src == COAPBENCH_HTTP_PORT) || (ui16Dest == COAPBENCH_HTTP_PORT)))
+	{
+		psLink = &CoapBenchHttpLink;
+	}
+
+	if(psLink)
+	{
+		psLink->ui32Packets++;
+		psLink->ui64Bytes += p->tot_len;
+	}
+}
+
+//*****************************************************************************
+//
+// CoAP observers.
+//
+//*****************************************************************************
+static void coapBenchSend(CoapBenchClient_t *psClient, const WS_CoapMsg_t *psMsg)
+{
+	uint8_t pui8Buf[WS_COAP_MSG_LEN];
+	uint32_t ui32Len = coapEncode(pui8Buf, sizeof(pui8Buf), psMsg);
+	ip_addr_t sServer;
+	struct pbuf *p;
+
+	if(!ui32Len || !(p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)ui32Len, PBUF_RAM)))
+	{
+		return;
+	}
+	pbuf_take(p, pui8Buf, (u16_t)ui32Len);
+	COAPBENCH_SERVER(&sServer);
+	udp_sendto(psClient->psPcb, p, &sServer, WS_COAP_PORT);
+	pbuf_free(p);
+}
+
+/* GET with Observe: 0, the token is the resource */
+static void coapBenchRegister(CoapBenchClient_t *psClient, uint32_t ui32Resource)
+{
+	WS_CoapMsg_t sMsg;
+
+	coapMsgInit(&sMsg, WS_COAP_CON, WS_COAP_GET, psClient->ui16NextId++);
+	sMsg.ui8TokenLen = 1;
+	sMsg.pui8Token[0] = (uint8_t)ui32Resource;
+	sMsg.ui32Observe = 0;
+	if(CoapBenchCbor)
+	{
+		sMsg.ui32Accept = WS_COAP_FORMAT_CBOR;
+	}
+	strcpy(sMsg.pcPath, CoapBenchPaths[ui32Resource]);
+
+	CoapBenchRegistrations++;
+	coapBenchSend(psClient, &sMsg);
+}
+
+/* The value of a 2.05, false if it is not one in the format asked for */
+static bool coapBenchValue(const WS_CoapMsg_t *psMsg, int32_t *pi32Milli)
+{
+	char pcText[16], *pcEnd;
+	double dValue;
+
+	if(CoapBenchCbor)
+	{
+		return((psMsg->ui32Format == WS_COAP_FORMAT_CBOR) &&
+			   coapCborGetMilli(psMsg->pui8Payload, psMsg->ui32PayloadLen, pi32Milli));
+	}
+
+	if(((psMsg->ui32Format != WS_COAP_FORMAT_TEXT) && (psMsg->ui32Format != WS_COAP_NONE)) ||
+	   !psMsg->ui32PayloadLen || (psMsg->ui32PayloadLen >= sizeof(pcText)))
+	{
+		return(false);
+	}
+	memcpy(pcText, psMsg->pui8Payload, psMsg->ui32PayloadLen);
+	pcText[psMsg->ui32PayloadLen] = 0;
+	dValue = strtod(pcText, &pcEnd);
+	*pi32Milli = (int32_t)(dValue * 1000.0 + ((dValue < 0) ? -0.5 : 0.5));
+
+	return(*pcEnd == 0);
+}
+
+static void coapBenchRecv(void *pvArg, struct udp_pcb *psPcb, struct pbuf *p, ip_addr_t *psAddr,
+						  u16_t ui16Port)
+{
+	CoapBenchClient_t *psClient = pvArg;
+	uint8_t pui8Buf[WS_COAP_MSG_LEN];
+	uint32_t ui32Len = p->tot_len, ui32Resource;
+	WS_CoapMsg_t sMsg, sAck;
+	int32_t i32Value;
+
+	if(ui32Len > sizeof(pui8Buf))
+	{
+		ui32Len = 0;
+	}
+	pbuf_copy_partial(p, pui8Buf, (u16_t)ui32Len, 0);
+	pbuf_free(p);
+	if(!ui32Len || !coapDecode(pui8Buf, ui32Len, &sMsg) || (sMsg.ui8TokenLen != 1) ||
+	   (sMsg.pui8Token[0] >= WS_COAP_RESOURCES))
+	{
+		CoapBenchCoapInvalid++;
+		return;
+	}
+	ui32Resource = sMsg.pui8Token[0];
+
+	if(sMsg.ui8Type == WS_COAP_CON)
+	{
+		coapMsgInit(&sAck, WS_COAP_ACK, WS_COAP_EMPTY, sMsg.ui16Id);
+		CoapBenchAcks++;
+		coapBenchSend(psClient, &sAck);
+	}
+
+	if(sMsg.ui8Code != WS_COAP_CONTENT)
+	{
+		/* 5.03 until the first sample, the registration is repeated */
+		CoapBenchCoapInvalid += (sMsg.ui8Code != WS_COAP_UNAVAILABLE);
+		return;
+	}
+	if(sMsg.ui32Observe == WS_COAP_NONE)
+	{
+		/* The plain response, the observer table is full */
+		psClient->pbRefused[ui32Resource] = true;
+		return;
+	}
+	psClient->pbObserving[ui32Resource] = true;
+
+	if(!coapBenchValue(&sMsg, &i32Value))
+	{
+		CoapBenchCoapInvalid++;
+		return;
+	}
+	CoapBenchNotifications++;
+	if(!psClient->pbHave[ui32Resource] || (psClient->pi32Last[ui32Resource] != i32Value))
+	{
+		CoapBenchCoapChanges++;
+	}
+	psClient->pbHave[ui32Resource] = true;
+	psClient->pi32Last[ui32Resource] = i32Value;
+}
+
+static void coapBenchClientsStart(void)
+{
+	CoapBenchClient_t *psClient;
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < CoapBenchNumClients; ui32Idx++)
+	{
+		psClient = &CoapBenchClients[ui32Idx];
+		psClient->psPcb = udp_new();
+		if(!psClient->psPcb || (udp_bind(psClient->psPcb, IP_ADDR_ANY, 0) != ERR_OK))
+		{
+			fprintf(stderr, "coapbench: no UDP PCB\n");
+			exit(1);
+		}
+		psClient->ui16NextId = (uint16_t)(ui32Idx << 12);
+		udp_recv(psClient->psPcb, coapBenchRecv, psClient);
+	}
+}
+
+/* Register what is neither observed nor refused yet */
+static void coapBenchClientsRetry(void)
+{
+	CoapBenchClient_t *psClient;
+	uint32_t ui32Idx, ui32Resource;
+
+	for(ui32Idx = 0; ui32Idx < CoapBenchNumClients; ui32Idx++)
+	{
+		psClient = &CoapBenchClients[ui32Idx];
+		for(ui32Resource = 0; ui32Resource < WS_COAP_RESOURCES; ui32Resource++)
+		{
+			if(!psClient->pbObserving[ui32Resource] && !psClient->pbRefused[ui32Resource])
+			{
+				coapBenchRegister(psClient, ui32Resource);
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// JSON poll.
+//
+//*****************************************************************************
+static err_t coapBenchHttpClose(bool bAbort)
+{
+	struct tcp_pcb *psPCB = CoapBenchHttpPCB;
+
+	CoapBenchHttpPCB = NULL;
+	if(!psPCB)
+	{
+		return(ERR_OK);
+	}
+
+	tcp_arg(psPCB, NULL);
+	tcp_recv(psPCB, NULL);
+	tcp_err(psPCB, NULL);
+	if(bAbort || (tcp_close(psPCB) != ERR_OK))
+	{
+		tcp_abort(psPCB);
+		return(ERR_ABRT);
+	}
+
+	return(ERR_OK);
+}
+
+/* A whole response is in, count its sensor values and the changed ones */
+static void coapBenchPolled(void)
+{
+	char *pcValue;
+	uint32_t ui32Idx;
+	int32_t i32Value;
+	char pcKey[20];
+
+	CoapBenchHttpBusy = false;
+	CoapBenchResponse[CoapBenchResponseLen] = 0;
+	if(memcmp(CoapBenchResponse, "HTTP/1.", 7) || memcmp(CoapBenchResponse + 8, " 200", 4))
+	{
+		CoapBenchPollsFailed++;
+		return;
+	}
+
+	for(ui32Idx = 0; ui32Idx < WS_COAP_RESOURCES; ui32Idx++)
+	{
+		snprintf(pcKey, sizeof(pcKey), "\"%s\":", CoapBenchPaths[ui32Idx]);
+		pcValue = strstr(CoapBenchResponse + CoapBenchBodyStart, pcKey);
+		if(!pcValue)
+		{
+			CoapBenchPollsFailed++;
+			return;
+		}
+		i32Value = (int32_t)(strtod(pcValue + strlen(pcKey), NULL) * 1000.0 + 0.5);
+		CoapBenchHttpValues++;
+		if(!CoapBenchHttpHave || (CoapBenchHttpLast[ui32Idx] != i32Value))
+		{
+			CoapBenchHttpChanges++;
+		}
+		CoapBenchHttpLast[ui32Idx] = i32Value;
+	}
+	CoapBenchHttpHave = true;
+}
+
+/* The header is in, where the body starts and how long it is */
+static void coapBenchHttpHeader(uint32_t ui32End)
+{
+	const char *pcLength;
+
+	CoapBenchResponse[ui32End] = 0;
+	pcLength = strstr(CoapBenchResponse, "Content-Length:");
+	CoapBenchBodyStart = ui32End;
+	CoapBenchBodyLeft = pcLength ? strtoul(pcLength + 15, NULL, 10) : COAPBENCH_UNTIL_CLOSE;
+}
+
+static err_t coapBenchHttpReceive(void *pvArg, struct tcp_pcb *psPCB, struct pbuf *p, err_t eErr)
+{
+	uint32_t ui32Copy, ui32Offset = 0;
+	char *pcEnd;
+
+	if(!p)
+	{
+		/* End of a response without a length, or of the kept connection */
+		if(CoapBenchHttpBusy)
+		{
+			if(CoapBenchBodyStart && (CoapBenchBodyLeft == COAPBENCH_UNTIL_CLOSE))
+			{
+				coapBenchPolled();
+			}
+			else
+			{
+				CoapBenchHttpBusy = false;
+				CoapBenchPollsFailed++;
+			}
+		}
+		return(coapBenchHttpClose(false));
+	}
+
+	tcp_recved(psPCB, p->tot_len);
+	while(CoapBenchHttpBusy && (ui32Offset < p->tot_len))
+	{
+		ui32Copy = p->tot_len - ui32Offset;
+		if(CoapBenchBodyStart && (ui32Copy > CoapBenchBodyLeft))
+		{
+			ui32Copy = CoapBenchBodyLeft;
+		}
+		if(ui32Copy > (COAPBENCH_RESPONSE_LEN - 1 - CoapBenchResponseLen))
+		{
+			ui32Copy = COAPBENCH_RESPONSE_LEN - 1 - CoapBenchResponseLen;
+		}
+		if(!ui32Copy)
+		{
+			/* Longer than any answer of send_data */
+			CoapBenchHttpBusy = false;
+			CoapBenchPollsFailed++;
+			pbuf_free(p);
+			return(coapBenchHttpClose(true));
+		}
+		pbuf_copy_partial(p, CoapBenchResponse + CoapBenchResponseLen, (u16_t)ui32Copy,
+						  (u16_t)ui32Offset);
+		ui32Offset += ui32Copy;
+
+		if(CoapBenchBodyStart)
+		{
+			CoapBenchResponseLen += ui32Copy;
+			if(CoapBenchBodyLeft != COAPBENCH_UNTIL_CLOSE)
+			{
+				CoapBenchBodyLeft -= ui32Copy;
+			}
+		}
+		else
+		{
+			/* What follows the header goes round again as body */
+			CoapBenchResponse[CoapBenchResponseLen + ui32Copy] = 0;
+			pcEnd = strstr(CoapBenchResponse, "\r\n\r\n");
+			if(pcEnd)
+			{
+				ui32Copy = CoapBenchResponseLen + ui32Copy - (uint32_t)(pcEnd + 4 - CoapBenchResponse);
+				CoapBenchResponseLen = (uint32_t)(pcEnd + 4 - CoapBenchResponse);
+				ui32Offset -= ui32Copy;
+				coapBenchHttpHeader(CoapBenchResponseLen);
+			}
+			else
+			{
+				CoapBenchResponseLen += ui32Copy;
+			}
+		}
+
+		if(CoapBenchBodyStart && !CoapBenchBodyLeft)
+		{
+			coapBenchPolled();
+		}
+	}
+	pbuf_free(p);
+
+	return(ERR_OK);
+}
+
+static void coapBenchHttpError(void *pvArg, err_t eErr)
+{
+	/* The PCB is already freed */
+	CoapBenchHttpPCB = NULL;
+	if(CoapBenchHttpBusy)
+	{
+		CoapBenchHttpBusy = false;
+		CoapBenchPollsFailed++;
+	}
+}
+
+static bool coapBenchHttpSend(void)
+{
+	char pcRequest[128];
+	int iLen;
+
+	/* The script appends a random query against caching */
+	iLen = snprintf(pcRequest, sizeof(pcRequest), "GET /cgi-bin/send_data?id%u%s\r\n\r\n",
+					CoapBenchPolls, CoapBenchKeepAlive ? " HTTP/1.1\r\nHost: 10.0.0.2" : " HTTP/1.0");
+	if(tcp_write(CoapBenchHttpPCB, pcRequest, (u16_t)iLen, TCP_WRITE_FLAG_COPY) != ERR_OK)
+	{
+		return(false);
+	}
+	tcp_output(CoapBenchHttpPCB);
+
+	return(true);
+}
+
+static err_t coapBenchHttpConnected(void *pvArg, struct tcp_pcb *psPCB, err_t eErr)
+{
+	if(!coapBenchHttpSend())
+	{
+		CoapBenchHttpBusy = false;
+		CoapBenchPollsFailed++;
+		return(coapBenchHttpClose(true));
+	}
+
+	return(ERR_OK);
+}
+
+static void coapBenchPoll(void)
+{
+	ip_addr_t sServer;
+
+	if(CoapBenchHttpBusy)
+	{
+		CoapBenchPollsSkipped++;
+		return;
+	}
+
+	CoapBenchPolls++;
+	CoapBenchHttpBusy = true;
+	CoapBenchResponseLen = 0;
+	CoapBenchBodyStart = 0;
+
+	/* A kept connection takes the request right away */
+	if(CoapBenchHttpPCB)
+	{
+		if(!coapBenchHttpSend())
+		{
+			CoapBenchHttpBusy = false;
+			CoapBenchPollsFailed++;
+			coapBenchHttpClose(true);
+		}
+		return;
+	}
+
+	CoapBenchHttpPCB = tcp_new();
+	if(!CoapBenchHttpPCB)
+	{
+		CoapBenchHttpBusy = false;
+		CoapBenchPollsFailed++;
+		return;
+	}
+	tcp_recv(CoapBenchHttpPCB, coapBenchHttpReceive);
+	tcp_err(CoapBenchHttpPCB, coapBenchHttpError);
+
+	CoapBenchConnects++;
+	COAPBENCH_SERVER(&sServer);
+	if(tcp_connect(CoapBenchHttpPCB, &sServer, COAPBENCH_HTTP_PORT, coapBenchHttpConnected) != ERR_OK)
+	{
+		CoapBenchHttpBusy = false;
+		CoapBenchPollsFailed++;
+		coapBenchHttpClose(true);
+	}
+}
+
+//*****************************************************************************
+//
+// Report.
+//
+//*****************************************************************************
+static double coapBenchPer(uint64_t ui64Bytes, uint32_t ui32Count)
+{
+	return(ui32Count ? ((double)ui64Bytes / ui32Count) : 0.0);
+}
+
+static void coapBenchReport(uint64_t ui64Now)
+{
+	double dSeconds = (double)(ui64Now - CoapBenchRunStart) / 1e6;
+	uint32_t ui32Idx, ui32Resource, ui32Observing = 0, ui32Polled;
+
+	for(ui32Idx = 0; ui32Idx < CoapBenchNumClients; ui32Idx++)
+	{
+		for(ui32Resource = 0; ui32Resource < WS_COAP_RESOURCES; ui32Resource++)
+		{
+			ui32Observing += CoapBenchClients[ui32Idx].pbObserving[ui32Resource];
+		}
+	}
+	ui32Polled = CoapBenchPolls - CoapBenchPollsFailed - CoapBenchHttpBusy;
+
+	fprintf(CoapBenchOut, "{\"durationMs\":%u,\"clients\":%u,\"format\":\"%s\",\"pollMs\":%u,"
+			"\"keepAlive\":%s,", CoapBenchDurationMs, CoapBenchNumClients,
+			CoapBenchCbor ? "cbor" : "text", CoapBenchPollMs, CoapBenchKeepAlive ? "true" : "false");
+
+	/* Every value a CoAP notification, four per poll */
+	fprintf(CoapBenchOut, "\"coap\":{\"observing\":%u,\"registrations\":%u,\"notifications\":%u,"
+			"\"notificationsPerSec\":%.2f,\"changes\":%u,\"acks\":%u,\"invalid\":%u,",
+			ui32Observing, CoapBenchRegistrations, CoapBenchNotifications,
+			CoapBenchNotifications / dSeconds, CoapBenchCoapChanges, CoapBenchAcks,
+			CoapBenchCoapInvalid);
+	fprintf(CoapBenchOut, "\"packets\":%u,\"ipBytes\":%llu,\"bytesPerSec\":%.0f,"
+			"\"bytesPerValue\":%.1f,\"bytesPerChange\":%.1f},", CoapBenchCoapLink.ui32Packets,
+			(unsigned long long)CoapBenchCoapLink.ui64Bytes, CoapBenchCoapLink.ui64Bytes / dSeconds,
+			coapBenchPer(CoapBenchCoapLink.ui64Bytes, CoapBenchNotifications),
+			coapBenchPer(CoapBenchCoapLink.ui64Bytes, CoapBenchCoapChanges));
+	fprintf(CoapBenchOut, "\"http\":{\"polls\":%u,\"skipped\":%u,\"failed\":%u,\"connects\":%u,"
+			"\"values\":%u,\"changes\":%u,\"packets\":%u,\"ipBytes\":%llu,\"bytesPerSec\":%.0f,",
+			CoapBenchPolls, CoapBenchPollsSkipped, CoapBenchPollsFailed, CoapBenchConnects,
+			CoapBenchHttpValues, CoapBenchHttpChanges, CoapBenchHttpLink.ui32Packets,
+			(unsigned long long)CoapBenchHttpLink.ui64Bytes, CoapBenchHttpLink.ui64Bytes / dSeconds);
+	fprintf(CoapBenchOut, "\"bytesPerPoll\":%.1f,\"bytesPerValue\":%.1f,\"bytesPerChange\":%.1f},",
+			coapBenchPer(CoapBenchHttpLink.ui64Bytes, ui32Polled),
+			coapBenchPer(CoapBenchHttpLink.ui64Bytes, CoapBenchHttpValues),
+			coapBenchPer(CoapBenchHttpLink.ui64Bytes, CoapBenchHttpChanges));
+
+	/* The station's side */
+	fprintf(CoapBenchOut, "\"station\":{\"requests\":%u,\"notifications\":%u,\"sentBytes\":%u,"
+			"\"observers\":%u,\"refused\":%u,\"timeouts\":%u,\"resets\":%u,\"errors\":%u}}\n",
+			CoapStats.ui32Requests - CoapBenchStart.ui32Requests,
+			CoapStats.ui32Notifications - CoapBenchStart.ui32Notifications,
+			CoapStats.ui32TxBytes - CoapBenchStart.ui32TxBytes, CoapStats.ui32Observers,
+			CoapStats.ui32Refused - CoapBenchStart.ui32Refused,
+			CoapStats.ui32Timeouts - CoapBenchStart.ui32Timeouts,
+			CoapStats.ui32Resets - CoapBenchStart.ui32Resets,
+			CoapStats.ui32Errors - CoapBenchStart.ui32Errors);
+	fflush(CoapBenchOut);
+}
+
+//*****************************************************************************
+//
+// Run, on the firmware thread between interrupts.
+//
+//*****************************************************************************
+static void coapBenchIdle(void)
+{
+	uint64_t ui64Now = simMicros();
+
+	if(!CoapBenchRunStart)
+	{
+		/* The firmware is up and sleeping */
+		CoapBenchRunStart = ui64Now;
+		CoapBenchNextPoll = ui64Now;
+		CoapBenchNextRetry = ui64Now;
+		CoapBenchStart = CoapStats;
+		coapBenchClientsStart();
+	}
+
+	if(ui64Now - CoapBenchRunStart >= (uint64_t)CoapBenchDurationMs * 1000u)
+	{
+		coapBenchReport(ui64Now);
+		exit(0);
+	}
+
+	if(ui64Now >= CoapBenchNextRetry)
+	{
+		CoapBenchNextRetry = ui64Now + COAPBENCH_RETRY_MS * 1000ull;
+		coapBenchClientsRetry();
+	}
+
+	if(ui64Now >= CoapBenchNextPoll)
+	{
+		CoapBenchNextPoll += CoapBenchPollMs * 1000ull;
+		coapBenchPoll();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool bVerbose = false;
+	int iOpt;
+
+	CoapBenchOut = stdout;
+	while((iOpt = getopt(argc, argv, "c:d:f:p:ko:v")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 'c':
+				CoapBenchNumClients = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				CoapBenchDurationMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'f':
+				CoapBenchCbor = !strcmp(optarg, "cbor");
+				if(!CoapBenchCbor && strcmp(optarg, "text"))
+				{
+					fprintf(stderr, "format text or cbor\n");
+					return(1);
+				}
+				break;
+			case 'p':
+				CoapBenchPollMs = strtoul(optarg, NULL, 0);
+				break;
+			case 'k':
+				CoapBenchKeepAlive = true;
+				break;
+			case 'o':
+				CoapBenchOut = fopen(optarg, "w");
+				if(!CoapBenchOut)
+				{
+					perror(optarg);
+					return(1);
+				}
+				break;
+			case 'v':
+				bVerbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-c clients] [-d seconds] [-f text|cbor] [-p poll_ms] "
+						"[-k] [-o file] [-v]\n", argv[0]);
+				return(1);
+		}
+	}
+	if(!CoapBenchDurationMs || !CoapBenchPollMs || !CoapBenchNumClients ||
+	   (CoapBenchNumClients > COAPBENCH_MAX_CLIENTS))
+	{
+		fprintf(stderr, "a duration of at least 1 s, a poll period and 1 to %u clients\n",
+				COAPBENCH_MAX_CLIENTS);
+		return(1);
+	}
+
+	simInit();
+	simUARTQuiet(!bVerbose);
+	simLinkTapSet(coapBenchTap);
+	simIdleHookSet(coapBenchIdle);
+
+	return(firmwareMain());
+}
@@ -0,0 +1,294 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "weather_station/ws_deadband.h"
+#include "weather_station/ws_filter.h"
+#include "weather_station/ws_tick.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Check of the deadband publishing on the host build.
+ *
+ *  The firmware runs as usual, on the simulated sensors or, with
+ *  WS_SIM_TRACE, on a sensor trace captured on the board, so thresholds can
+ *  be tuned against real noise:
+ *
+ *      WS_SIM_TRACE=sensors.trace WS_SIM_SPEED=10 ./build/deadbandbench
+ *      ./build/deadbandbench -d 120 -t 50,250,5000,1000 -H 30000
+ *
+ *  Between interrupts it checks what the station publishes: the held value
+ *  of a sensor may not be further than its threshold from the value last
+ *  offered, nor older than the heartbeat plus a refresh period. The held
+ *  values of the multicast and MQTT streams, StreamDeadband, may not be
+ *  further than the threshold from their input either. It also
+ *  measures how far the held values trail the measurements, the error a
+ *  consumer of the published values sees.
+ *
+ *  The results are printed as one JSON object when the run ends, after -d
+ *  seconds or when the trace was replayed: per sensor the refreshes
+ *  offered, published, sent as heartbeats and suppressed, the tracking
+ *  error and the violations, and what the streams sent and suppressed. The
+ *  exit status is 1 if there were any violations.
+ *
+ *  -t thresholds in thousandths (temperature,humidity,pressure,light), -H
+ *  heartbeat in ms, -d duration in s (0, the default, runs to the end of the
+ *  trace), -o output file (stdout by default), -v keeps the firmware's UART
+ *  output. */
+//*****************************************************************************
+
+/* Refresh period of the published values, enet_io.c */
+#define DEADBANDBENCH_REFRESH_MS	50
+
+typedef struct {
+	uint32_t ui32Checks;
+	uint32_t ui32Violations;		/* Held value too far from the input */
+	uint32_t ui32Stale;				/* Held value older than the heartbeat */
+	uint32_t ui32MaxAgeMs;
+	uint64_t ui64ErrorSum;			/* |measurement - held|, thousandths */
+	uint32_t ui32MaxError;
+	uint32_t ui32StreamViolations;	/* Same for StreamDeadband */
+}DeadbandBenchChannel_t;
+
+static const char * const DeadbandBenchNames[WS_DEADBAND_CHANNELS] =
+{
+	"temperature", "humidity", "pressure", "light"
+};
+
+/* The measurements, enet_io.c */
+extern float TempAmbientMeas, HumidityMeas, PressureMeas, LightMeas;
+static float * const DeadbandBenchMeas[WS_DEADBAND_CHANNELS] =
+{
+	&TempAmbientMeas, &HumidityMeas, &PressureMeas, &LightMeas
+};
+
+static uint32_t DeadbandBenchDurationMs;
+static FILE *DeadbandBenchOut;
+
+static uint64_t DeadbandBenchRunStart;
+static uint64_t DeadbandBenchRunEnd;
+static DeadbandBenchChannel_t DeadbandBenchChannels[WS_DEADBAND_CHANNELS];
+
+extern int firmwareMain(void);
+
+//*****************************************************************************
+//
+// Checks, on the firmware thread between interrupts.
+//
+//*****************************************************************************
+static uint32_t deadbandBenchDiff(int32_t i32A, int32_t i32B)
+{
+	int64_t i64Diff = (int64_t)i32A - i32B;
+
+	return((uint32_t)((i64Diff < 0) ? -i64Diff : i64Diff));
+}
+
+static void deadbandBenchCheck(void)
+{
+	DeadbandBenchChannel_t *psChannel;
+	uint32_t ui32Ch, ui32Error, ui32AgeMs, ui32NowMs = tickNowMs();
+
+	if(!PublishDeadband.bPrimed)
+	{
+		return;
+	}
+
+	for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+	{
+		psChannel = &DeadbandBenchChannels[ui32Ch];
+		psChannel->ui32Checks++;
+
+		if(deadbandBenchDiff(PublishDeadband.pi32Input[ui32Ch], PublishDeadband.pi32Held[ui32Ch]) >
+		   (uint32_t)PublishDeadbandConfig.pi32Threshold[ui32Ch])
+		{
+			psChannel->ui32Violations++;
+		}
+
+		ui32AgeMs = ui32NowMs - PublishDeadband.pui32HeldMs[ui32Ch];
+		if(ui32AgeMs > psChannel->ui32MaxAgeMs)
+		{
+			psChannel->ui32MaxAgeMs = ui32AgeMs;
+		}
+		if(PublishDeadbandConfig.ui32HeartbeatMs &&
+		   (ui32AgeMs > (PublishDeadbandConfig.ui32HeartbeatMs + DEADBANDBENCH_REFRESH_MS)))
+		{
+			psChannel->ui32Stale++;
+		}
+
+		if(StreamDeadband.bPrimed &&
+		   (deadbandBenchDiff(StreamDeadband.pi32Input[ui32Ch], StreamDeadband.pi32Held[ui32Ch]) >
+			(uint32_t)PublishDeadbandConfig.pi32Threshold[ui32Ch]))
+		{
+			psChannel->ui32StreamViolations++;
+		}
+
+		ui32Error = deadbandBenchDiff(filterToMilli(*DeadbandBenchMeas[ui32Ch]),
+									  PublishDeadband.pi32Held[ui32Ch]);
+		psChannel->ui64ErrorSum += ui32Error;
+		if(ui32Error > psChannel->ui32MaxError)
+		{
+			psChannel->ui32MaxError = ui32Error;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// Report, when the duration is over or the trace ends.
+//
+//*****************************************************************************
+static void deadbandBenchReport(void)
+{
+	const DeadbandBenchChannel_t *psChannel;
+	const WS_DeadbandStats_t *psStats, *psStream;
+	double dSeconds;
+	uint32_t ui32Ch, ui32Offered, ui32Sent, ui32Failures = 0;
+
+	if(!DeadbandBenchRunStart)
+	{
+		return;
+	}
+	if(!DeadbandBenchRunEnd)
+	{
+		DeadbandBenchRunEnd = simMicros();
+	}
+	dSeconds = (double)(DeadbandBenchRunEnd - DeadbandBenchRunStart) / 1e6;
+
+	fprintf(DeadbandBenchOut, "{\"durationMs\":%.0f,\"heartbeatMs\":%u,\"sensors\":{",
+			dSeconds * 1000.0, PublishDeadbandConfig.ui32HeartbeatMs);
+	for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+	{
+		psChannel = &DeadbandBenchChannels[ui32Ch];
+		psStats = &PublishDeadband.psStats[ui32Ch];
+		psStream = &StreamDeadband.psStats[ui32Ch];
+		ui32Sent = psStats->ui32Published + psStats->ui32Heartbeats;
+		ui32Offered = ui32Sent + psStats->ui32Suppressed;
+		ui32Failures += psChannel->ui32Violations + psChannel->ui32Stale +
+						psChannel->ui32StreamViolations;
+
+		fprintf(DeadbandBenchOut, "%s\"%s\":{\"threshold\":%d,\"offered\":%u,\"published\":%u,"
+				"\"heartbeats\":%u,\"suppressed\":%u,\"suppressedPct\":%.1f,\"publishedPerSec\":%.3f,",
+				ui32Ch ? "," : "", DeadbandBenchNames[ui32Ch],
+				PublishDeadbandConfig.pi32Threshold[ui32Ch], ui32Offered, psStats->ui32Published,
+				psStats->ui32Heartbeats, psStats->ui32Suppressed,
+				ui32Offered ? (100.0 * psStats->ui32Suppressed / ui32Offered) : 0.0,
+				ui32Sent / dSeconds);
+		fprintf(DeadbandBenchOut, "\"error\":{\"mean\":%.1f,\"max\":%u},\"maxAgeMs\":%u,"
+				"\"checks\":%u,\"violations\":%u,\"stale\":%u,",
+				psChannel->ui32Checks ? ((double)psChannel->ui64ErrorSum / psChannel->ui32Checks) : 0.0,
+				psChannel->ui32MaxError, psChannel->ui32MaxAgeMs, psChannel->ui32Checks,
+				psChannel->ui32Violations, psChannel->ui32Stale);
+		fprintf(DeadbandBenchOut, "\"stream\":{\"published\":%u,\"heartbeats\":%u,"
+				"\"suppressed\":%u,\"violations\":%u}}",
+				psStream->ui32Published, psStream->ui32Heartbeats, psStream->ui32Suppressed,
+				psChannel->ui32StreamViolations);
+	}
+	fprintf(DeadbandBenchOut, "}}\n");
+	fflush(DeadbandBenchOut);
+
+	/* The exit status of the run */
+	if(ui32Failures)
+	{
+		_exit(1);
+	}
+}
+
+static void deadbandBenchIdle(void)
+{
+	uint64_t ui64Now = simMicros();
+
+	if(!DeadbandBenchRunStart)
+	{
+		/* The firmware is up and sleeping */
+		DeadbandBenchRunStart = ui64Now;
+	}
+
+	deadbandBenchCheck();
+
+	if(DeadbandBenchDurationMs &&
+	   (ui64Now - DeadbandBenchRunStart >= (uint64_t)DeadbandBenchDurationMs * 1000u))
+	{
+		DeadbandBenchRunEnd = ui64Now;
+		exit(0);
+	}
+}
+
+/* "t,h,p,l" in thousandths */
+static bool deadbandBenchThresholds(const char *pcArg)
+{
+	uint32_t ui32Ch;
+	char *pcEnd;
+
+	for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+	{
+		PublishDeadbandConfig.pi32Threshold[ui32Ch] = (int32_t)strtol(pcArg, &pcEnd, 0);
+		if((pcEnd == pcArg) || (PublishDeadbandConfig.pi32Threshold[ui32Ch] < 0) ||
+		   (*pcEnd != ((ui32Ch == (WS_DEADBAND_CHANNELS - 1)) ? 0 : ',')))
+		{
+			return(false);
+		}
+		pcArg = pcEnd + 1;
+	}
+
+	return(true);
+}
+
+int main(int argc, char **argv)
+{
+	bool bVerbose = false;
+	int iOpt;
+
+	DeadbandBenchOut = stdout;
+	while((iOpt = getopt(argc, argv, "t:H:d:o:v")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 't':
+				if(!deadbandBenchThresholds(optarg))
+				{
+					fprintf(stderr, "thresholds as temperature,humidity,pressure,light\n");
+					return(1);
+				}
+				break;
+			case 'H':
+				PublishDeadbandConfig.ui32HeartbeatMs = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				DeadbandBenchDurationMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'o':
+				DeadbandBenchOut = fopen(optarg, "w");
+				if(!DeadbandBenchOut)
+				{
+					perror(optarg);
+					return(1);
+				}
+				break;
+			case 'v':
+				bVerbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-t t,h,p,l] [-H heartbeat_ms] [-d seconds] [-o file] "
+						"[-v]\n", argv[0]);
+				return(1);
+		}
+	}
+	if(!DeadbandBenchDurationMs && !getenv("WS_SIM_TRACE"))
+	{
+		fprintf(stderr, "a duration, or a trace to replay in WS_SIM_TRACE\n");
+		return(1);
+	}
+
+	/* The replay exits when the trace ends */
+	atexit(deadbandBenchReport);
+
+	simInit();
+	simUARTQuiet(!bVerbose);
+	simIdleHookSet(deadbandBenchIdle);
+
+	return(firmwareMain());
+}
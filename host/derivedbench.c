@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "weather_station/ws_derived.h"
+
+//*****************************************************************************
+/*  Accuracy and cost of the derived quantities (weather_station/ws_derived.h).
+ *
+ *  derivedCompute is run over a grid of the sensor ranges the header names
+ *  and every result is compared with the same formula in double precision
+ *  with the libm functions: dew point and heat index over -40..85 degC and
+ *  1..100 %RH, altitude over 300..1100 hPa, the sea-level pressure over
+ *  station altitudes of -500..4000 m. The largest error of each is printed
+ *  next to the bound the header promises; one over its bound makes the exit
+ *  status 1. Then a full set is timed.
+ *
+ *      ./build/derivedbench [iterations] */
+//*****************************************************************************
+
+#define BENCH_TEMP_STEPS		251		/* -40..85 degC by 0.5 */
+#define BENCH_HUMIDITY_STEPS	199		/* 1..100 %RH by 0.5 */
+#define BENCH_PRESSURE_STEPS	8001	/* 300..1100 hPa by 0.1 */
+#define BENCH_ALTITUDE_STEPS	451		/* -500..4000 m by 10 */
+
+typedef struct {
+	const char *pcName;
+	const char *pcUnit;
+	double dBound;				/* From ws_derived.h */
+	double dMaxError;
+	double dWorstInput;
+}BenchQuantity_t;
+
+static BenchQuantity_t BenchQuantities[] =
+{
+	{ "dew point",			"degC",	0.01 },
+	{ "heat index",			"degC",	0.01 },
+	{ "altitude",			"m",	0.1 },
+	{ "sea-level pressure",	"Pa",	1.0 }
+};
+
+static uint64_t benchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+static void benchError(BenchQuantity_t *psQuantity, double dValue, double dReference, double dInput)
+{
+	double dError = fabs(dValue - dReference);
+
+	if(dError > psQuantity->dMaxError)
+	{
+		psQuantity->dMaxError = dError;
+		psQuantity->dWorstInput = dInput;
+	}
+}
+
+//*****************************************************************************
+//
+// Double precision references, the formulas of ws_derived.c.
+//
+//*****************************************************************************
+static double benchDewPoint(double dTemp, double dHumidity)
+{
+	double dGamma = log(dHumidity / 100.0) + (17.62 * dTemp) / (243.12 + dTemp);
+
+	return((243.12 * dGamma) / (17.62 - dGamma));
+}
+
+static double benchHeatIndex(double dTemp, double dHumidity)
+{
+	double dT = dTemp * 1.8 + 32.0;
+	double dHI = 0.5 * (dT + 61.0 + (dT - 68.0) * 1.2 + dHumidity * 0.094);
+
+	if((dHI + dT) / 2.0 >= 80.0)
+	{
+		dHI = -42.379 + 2.04901523 * dT + 10.14333127 * dHumidity
+			  - 0.22475541 * dT * dHumidity - 0.00683783 * dT * dT
+			  - 0.05481717 * dHumidity * dHumidity
+			  + 0.00122874 * dT * dT * dHumidity
+			  + 0.00085282 * dT * dHumidity * dHumidity
+			  - 0.00000199 * dT * dT * dHumidity * dHumidity;
+
+		if((dHumidity < 13.0) && (dT >= 80.0) && (dT <= 112.0))
+		{
+			dHI -= ((13.0 - dHumidity) / 4.0) * sqrt((17.0 - fabs(dT - 95.0)) / 17.0);
+		}
+		else if((dHumidity > 85.0) && (dT >= 80.0) && (dT <= 87.0))
+		{
+			dHI += ((dHumidity - 85.0) / 10.0) * ((87.0 - dT) / 5.0);
+		}
+	}
+
+	return((dHI - 32.0) / 1.8);
+}
+
+static double benchAltitude(double dPressure)
+{
+	return(44330.0 * (1.0 - pow(dPressure / 101325.0, 1.0 / 5.255)));
+}
+
+static double benchSeaLevel(double dPressure, double dAltitude)
+{
+	return(dPressure / pow(1.0 - dAltitude / 44330.0, 5.255));
+}
+
+//*****************************************************************************
+//
+// The sweeps.
+//
+//*****************************************************************************
+static void benchSweep(void)
+{
+	WS_Derived_t sDerived;
+	uint32_t ui32T, ui32H, ui32P, ui32A;
+	double dTemp, dHumidity, dPressure, dAltitude;
+
+	derivedSetStationAltitude(0.0f);
+	for(ui32T = 0; ui32T < BENCH_TEMP_STEPS; ui32T++)
+	{
+		dTemp = -40.0 + ui32T * 0.5;
+		for(ui32H = 0; ui32H < BENCH_HUMIDITY_STEPS; ui32H++)
+		{
+			dHumidity = 1.0 + ui32H * 0.5;
+			derivedCompute((float)dTemp, (float)dHumidity, 101325.0f, &sDerived);
+
+			/* The reference gets the inputs the float code saw */
+			benchError(&BenchQuantities[0], sDerived.fDewPoint,
+					   benchDewPoint((float)dTemp, (float)dHumidity), dTemp);
+			benchError(&BenchQuantities[1], sDerived.fHeatIndex,
+					   benchHeatIndex((float)dTemp, (float)dHumidity), dTemp);
+		}
+	}
+
+	for(ui32P = 0; ui32P < BENCH_PRESSURE_STEPS; ui32P++)
+	{
+		dPressure = 30000.0 + ui32P * 10.0;
+		derivedCompute(20.0f, 50.0f, (float)dPressure, &sDerived);
+		benchError(&BenchQuantities[2], sDerived.fAltitude, benchAltitude(dPressure), dPressure);
+	}
+
+	for(ui32A = 0; ui32A < BENCH_ALTITUDE_STEPS; ui32A++)
+	{
+		dAltitude = -500.0 + ui32A * 10.0;
+		derivedSetStationAltitude((float)dAltitude);
+		for(ui32P = 0; ui32P < BENCH_PRESSURE_STEPS; ui32P += 100)
+		{
+			dPressure = 30000.0 + ui32P * 10.0;
+			derivedCompute(20.0f, 50.0f, (float)dPressure, &sDerived);
+			benchError(&BenchQuantities[3], sDerived.fSeaLevelPressure,
+					   benchSeaLevel(dPressure, dAltitude), dAltitude);
+		}
+	}
+	derivedSetStationAltitude(WS_STATION_ALTITUDE_M);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32Iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+	uint32_t ui32Iter, ui32Idx;
+	volatile float fSink = 0.0f;
+	WS_Derived_t sDerived;
+	uint64_t ui64Start, ui64Ns;
+	bool bPass = true;
+
+	if(!ui32Iterations)
+	{
+		ui32Iterations = 1;
+	}
+
+	benchSweep();
+
+	printf("quantity             max error     bound  unit  worst at\n");
+	for(ui32Idx = 0; ui32Idx < sizeof(BenchQuantities) / sizeof(BenchQuantities[0]); ui32Idx++)
+	{
+		printf("%-18s %11.2e %9.2f  %-4s  %.1f%s\n", BenchQuantities[ui32Idx].pcName,
+			   BenchQuantities[ui32Idx].dMaxError, BenchQuantities[ui32Idx].dBound,
+			   BenchQuantities[ui32Idx].pcUnit, BenchQuantities[ui32Idx].dWorstInput,
+			   (BenchQuantities[ui32Idx].dMaxError > BenchQuantities[ui32Idx].dBound) ?
+			   "  (over the bound)" : "");
+		bPass &= (BenchQuantities[ui32Idx].dMaxError <= BenchQuantities[ui32Idx].dBound);
+	}
+	if(!bPass)
+	{
+		return(1);
+	}
+
+	/* Inputs that change a little, as the filtered measurements do */
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		derivedCompute(20.0f + (ui32Iter & 63) * 0.25f, 30.0f + (ui32Iter & 127) * 0.5f,
+					   95000.0f + (ui32Iter & 1023) * 10.0f, &sDerived);
+		fSink += sDerived.fDewPoint;
+	}
+	ui64Ns = benchNs() - ui64Start;
+
+	printf("\nderivedCompute %.1f ns/set\n", (double)ui64Ns / ui32Iterations);
+
+	return(0);
+}
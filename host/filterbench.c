@@ -0,0 +1,500 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "weather_station/weather_station.h"
+#include "weather_station/ws_cycles.h"
+#include "weather_station/ws_filter.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Benchmark of the sensor noise filters (weather_station/ws_filter.h).
+ *
+ *  First the kernels are checked against double precision versions of the
+ *  same filters on a synthetic signal: the median has to match exactly, the
+ *  EMA and the Kalman filter may only differ by their fixed-point rounding.
+ *  A disagreement is printed and the exit status is 1. Then each kernel and
+ *  each sensor's filter of the station (SensorFilterConfig) is timed, in ns
+ *  per sample, and the station's filters run on a synthetic signal with
+ *  noise of the sensor's size, where the truth is known: the RMS error of
+ *  the raw and the filtered values shows the noise reduction.
+ *
+ *      ./build/filterbench [-n iterations]
+ *
+ *  With -d, or a trace in WS_SIM_TRACE, the firmware runs next and every
+ *  measurement it filters is recorded, raw and filtered (the build wraps
+ *  filterUpdateFloat). On a trace captured on the board that is the noise
+ *  reduction on real sensor data. The truth is not known there, the values
+ *  are compared with a centred moving average of the raw ones
+ *  (FILTERBENCH_REFERENCE samples), so lag counts against a filter too:
+ *
+ *      WS_SIM_TRACE=sensors.trace WS_SIM_SPEED=10 ./build/filterbench
+ *      ./build/filterbench -d 60
+ *
+ *  -n iterations of the timing loops, -d duration of the firmware run in s,
+ *  -v keeps the firmware's UART output. */
+//*****************************************************************************
+
+#define FILTERBENCH_SIGNAL		65536		/* Samples of the synthetic signal */
+#define FILTERBENCH_RECORD		(1 << 18)	/* Samples kept per sensor, 3.6 h at 20 Hz */
+#define FILTERBENCH_REFERENCE	41			/* Centred average of the recorded raw values */
+
+typedef struct {
+	const char *pcName;
+	double dNoise;					/* Sensor noise, RMS, thousandths */
+	double dBase;					/* Level of the synthetic signal */
+	double dSwing;					/* and its slow variation */
+	double dSpikes;					/* Share of samples with a flicker spike */
+}FilterBenchSensor_t;
+
+/* What the sensors show at rest: TMP006 die temperature in 1/32 degC steps,
+ * SHT21, BMP180 in its standard mode, ISL29023 under mains light */
+static const FilterBenchSensor_t FilterBenchSensors[WS_NUM_SENSORS] =
+{
+	{ "temperature",	30.0,	22500.0,	500.0,		0.0 },
+	{ "humidity",		40.0,	45000.0,	2000.0,		0.0 },
+	{ "pressure",		6000.0,	101325000.0, 300000.0,	0.0 },
+	{ "light",			500.0,	350000.0,	50000.0,	0.01 }
+};
+
+/* A sensor's recording from the firmware run */
+typedef struct {
+	const WS_Filter_t *psFilter;	/* Identifies the sensor */
+	uint32_t ui32Count;
+	uint64_t ui64Ns;
+	int32_t *pi32Raw;
+	int32_t *pi32Filtered;
+}FilterBenchRecord_t;
+
+/* The station's filters, weather_station.c */
+extern const WS_FilterConfig_t SensorFilterConfig[WS_NUM_SENSORS];
+
+extern int firmwareMain(void);
+extern float __real_filterUpdateFloat(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig,
+									  float fSample);
+
+static int32_t FilterBenchTruth[FILTERBENCH_SIGNAL];
+static int32_t FilterBenchInput[FILTERBENCH_SIGNAL];
+
+static uint32_t FilterBenchDurationMs;
+static uint64_t FilterBenchRunStart;
+static FilterBenchRecord_t FilterBenchRecords[WS_NUM_SENSORS];
+
+//*****************************************************************************
+//
+// Synthetic signals.
+//
+//*****************************************************************************
+static double filterBenchGauss(void)
+{
+	double dU = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double dV = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return(sqrt(-2.0 * log(dU)) * cos(2.0 * M_PI * dV));
+}
+
+/* A slow swing with a step in the middle, plus the sensor's noise */
+static void filterBenchSignal(const FilterBenchSensor_t *psSensor)
+{
+	uint32_t ui32Idx;
+	double dTruth, dValue;
+
+	srand(1);
+	for(ui32Idx = 0; ui32Idx < FILTERBENCH_SIGNAL; ui32Idx++)
+	{
+		dTruth = psSensor->dBase + psSensor->dSwing * sin(2.0 * M_PI * ui32Idx / 4096.0);
+		if(ui32Idx >= FILTERBENCH_SIGNAL / 2)
+		{
+			dTruth += psSensor->dSwing / 2.0;
+		}
+
+		dValue = dTruth + psSensor->dNoise * filterBenchGauss();
+		if((double)rand() / RAND_MAX < psSensor->dSpikes)
+		{
+			dValue *= 1.5;
+		}
+
+		FilterBenchTruth[ui32Idx] = (int32_t)lround(dTruth);
+		FilterBenchInput[ui32Idx] = (int32_t)lround(dValue);
+	}
+}
+
+//*****************************************************************************
+//
+// Double precision reference filters.
+//
+//*****************************************************************************
+typedef struct {
+	bool bPrimed;
+	double dEstimate;
+	double dVariance;
+	double dGain;					/* Of the last update */
+	int32_t pi32Window[WS_FILTER_MEDIAN_LEN];
+	uint32_t ui32Next;
+}FilterBenchRef_t;
+
+static int filterBenchCompare(const void *pvA, const void *pvB)
+{
+	int32_t i32A = *(const int32_t *)pvA, i32B = *(const int32_t *)pvB;
+
+	return((i32A > i32B) - (i32A < i32B));
+}
+
+static double filterBenchReference(FilterBenchRef_t *psRef, const WS_FilterConfig_t *psConfig,
+								   int32_t i32Sample)
+{
+	int32_t pi32Sorted[WS_FILTER_MEDIAN_LEN];
+	double dVariance, dGain;
+	uint32_t ui32Idx;
+
+	if(!psRef->bPrimed)
+	{
+		psRef->bPrimed = true;
+		psRef->dEstimate = i32Sample;
+		psRef->dVariance = psConfig->ui32MeasNoise;
+		for(ui32Idx = 0; ui32Idx < WS_FILTER_MEDIAN_LEN; ui32Idx++)
+		{
+			psRef->pi32Window[ui32Idx] = i32Sample;
+		}
+		return(i32Sample);
+	}
+
+	switch(psConfig->eType)
+	{
+		case WS_FilterEMA:
+			psRef->dGain = psConfig->ui32Alpha / 65536.0;
+			psRef->dEstimate += psRef->dGain * (i32Sample - psRef->dEstimate);
+			return(psRef->dEstimate);
+		case WS_FilterMedian5:
+			psRef->pi32Window[psRef->ui32Next] = i32Sample;
+			psRef->ui32Next = (psRef->ui32Next + 1) % WS_FILTER_MEDIAN_LEN;
+			memcpy(pi32Sorted, psRef->pi32Window, sizeof(pi32Sorted));
+			qsort(pi32Sorted, WS_FILTER_MEDIAN_LEN, sizeof(int32_t), filterBenchCompare);
+			return(pi32Sorted[WS_FILTER_MEDIAN_LEN / 2]);
+		case WS_FilterKalman:
+			dVariance = psRef->dVariance + psConfig->ui32ProcessNoise;
+			dGain = dVariance / (dVariance + psConfig->ui32MeasNoise);
+			psRef->dGain = dGain;
+			psRef->dEstimate += dGain * (i32Sample - psRef->dEstimate);
+			psRef->dVariance = (1.0 - dGain) * dVariance;
+			return(psRef->dEstimate);
+		default:
+			return(i32Sample);
+	}
+}
+
+/* The fixed-point kernels against the reference. Each update may round the
+ * estimate by half a unit and, for the Kalman filter, truncate the Q16 gain
+ * by up to 1/65536 of the innovation; what came before decays by (1 - gain)
+ * a step. That bound, plus a unit of slack, is what the kernels may be off. */
+static bool filterBenchCheck(const char *pcName, const WS_FilterConfig_t *psConfig)
+{
+	FilterBenchRef_t sRef;
+	WS_Filter_t sFilter;
+	double dRef, dInnovation, dError, dBound = 0.0, dMaxError = 0.0, dMaxBound = 0.0;
+	uint32_t ui32Idx;
+	int32_t i32Out;
+
+	memset(&sRef, 0, sizeof(sRef));
+	memset(&sFilter, 0, sizeof(sFilter));
+	for(ui32Idx = 0; ui32Idx < FILTERBENCH_SIGNAL; ui32Idx++)
+	{
+		dInnovation = sRef.bPrimed ? fabs(FilterBenchInput[ui32Idx] - sRef.dEstimate) : 0.0;
+		i32Out = filterUpdate(&sFilter, psConfig, FilterBenchInput[ui32Idx]);
+		dRef = filterBenchReference(&sRef, psConfig, FilterBenchInput[ui32Idx]);
+
+		if(psConfig->eType == WS_FilterEMA)
+		{
+			dBound = (1.0 - sRef.dGain) * dBound + 0.5;
+		}
+		else if(psConfig->eType == WS_FilterKalman)
+		{
+			dBound = (1.0 - sRef.dGain) * dBound + 0.5 + dInnovation / 65536.0;
+		}
+
+		dError = fabs(i32Out - dRef);
+		if(dError > dMaxError)
+		{
+			dMaxError = dError;
+		}
+		if(dBound > dMaxBound)
+		{
+			dMaxBound = dBound;
+		}
+		if(dError > ((psConfig->eType == WS_FilterMedian5) ? 0.0 : (dBound + 1.0)))
+		{
+			printf("%s: sample %u gives %d, the reference %.3f\n", pcName, ui32Idx, i32Out, dRef);
+			return(false);
+		}
+	}
+
+	printf("%-26s %10.3f %10.1f\n", pcName, dMaxError, dMaxBound);
+	return(true);
+}
+
+//*****************************************************************************
+//
+// Timing and noise reduction of the kernels.
+//
+//*****************************************************************************
+static double filterBenchNs(const WS_FilterConfig_t *psConfig, uint32_t ui32Iterations)
+{
+	WS_Filter_t sFilter;
+	volatile int32_t i32Sink = 0;
+	uint32_t ui32Iter, ui32Start;
+
+	memset(&sFilter, 0, sizeof(sFilter));
+	ui32Start = cyclesGet();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		i32Sink += filterUpdate(&sFilter, psConfig, FilterBenchInput[ui32Iter % FILTERBENCH_SIGNAL]);
+	}
+
+	/* The host cycle counter counts ns */
+	return((double)(uint32_t)(cyclesGet() - ui32Start) / ui32Iterations);
+}
+
+static double filterBenchRMS(const int32_t *pi32Values, const int32_t *pi32Reference, uint32_t ui32Count)
+{
+	double dSum = 0.0, dError;
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+	{
+		dError = (double)pi32Values[ui32Idx] - pi32Reference[ui32Idx];
+		dSum += dError * dError;
+	}
+
+	return(ui32Count ? sqrt(dSum / ui32Count) : 0.0);
+}
+
+static void filterBenchReduction(const FilterBenchSensor_t *psSensor, const WS_FilterConfig_t *psConfig,
+								 uint32_t ui32Iterations)
+{
+	static int32_t pi32Filtered[FILTERBENCH_SIGNAL];
+	WS_Filter_t sFilter;
+	double dRaw, dFiltered;
+	uint32_t ui32Idx;
+
+	filterBenchSignal(psSensor);
+	memset(&sFilter, 0, sizeof(sFilter));
+	for(ui32Idx = 0; ui32Idx < FILTERBENCH_SIGNAL; ui32Idx++)
+	{
+		pi32Filtered[ui32Idx] = filterUpdate(&sFilter, psConfig, FilterBenchInput[ui32Idx]);
+	}
+
+	dRaw = filterBenchRMS(FilterBenchInput, FilterBenchTruth, FILTERBENCH_SIGNAL);
+	dFiltered = filterBenchRMS(pi32Filtered, FilterBenchTruth, FILTERBENCH_SIGNAL);
+	printf("%-12s %10.1f %12.1f %12.1f %9.2fx\n", psSensor->pcName,
+		   filterBenchNs(psConfig, ui32Iterations), dRaw, dFiltered, dFiltered ? (dRaw / dFiltered) : 0.0);
+}
+
+//*****************************************************************************
+//
+// The firmware run: every filterUpdateFloat call is recorded.
+//
+//*****************************************************************************
+float __wrap_filterUpdateFloat(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, float fSample)
+{
+	FilterBenchRecord_t *psRecord = NULL;
+	uint32_t ui32Idx, ui32Start;
+	float fFiltered;
+
+	ui32Start = cyclesGet();
+	fFiltered = __real_filterUpdateFloat(psFilter, psConfig, fSample);
+	ui32Start = cyclesGet() - ui32Start;
+
+	for(ui32Idx = 0; ui32Idx < WS_NUM_SENSORS; ui32Idx++)
+	{
+		if(!FilterBenchRecords[ui32Idx].psFilter)
+		{
+			FilterBenchRecords[ui32Idx].psFilter = psFilter;
+		}
+		if(FilterBenchRecords[ui32Idx].psFilter == psFilter)
+		{
+			psRecord = &FilterBenchRecords[ui32Idx];
+			break;
+		}
+	}
+
+	if(psRecord && (psRecord->ui32Count < FILTERBENCH_RECORD))
+	{
+		psRecord->pi32Raw[psRecord->ui32Count] = filterToMilli(fSample);
+		psRecord->pi32Filtered[psRecord->ui32Count] = filterToMilli(fFiltered);
+		psRecord->ui32Count++;
+		psRecord->ui64Ns += ui32Start;
+	}
+
+	return(fFiltered);
+}
+
+/* The filter states are an array in sensor order, SensorFilter */
+static int filterBenchByFilter(const void *pvA, const void *pvB)
+{
+	const FilterBenchRecord_t *psA = pvA, *psB = pvB;
+
+	return((psA->psFilter > psB->psFilter) - (psA->psFilter < psB->psFilter));
+}
+
+static void filterBenchReport(void)
+{
+	static int32_t pi32Reference[FILTERBENCH_RECORD];
+	const FilterBenchRecord_t *psRecord;
+	uint32_t ui32Sensor, ui32Idx, ui32Half = FILTERBENCH_REFERENCE / 2, ui32Count;
+	int64_t i64Sum;
+	double dRaw, dFiltered;
+
+	if(!FilterBenchRunStart)
+	{
+		return;
+	}
+
+	qsort(FilterBenchRecords, WS_NUM_SENSORS, sizeof(FilterBenchRecord_t), filterBenchByFilter);
+
+	printf("\nrecorded     samples   ns/sample     raw RMS   filtered RMS   reduction\n");
+	for(ui32Sensor = 0; ui32Sensor < WS_NUM_SENSORS; ui32Sensor++)
+	{
+		psRecord = &FilterBenchRecords[ui32Sensor];
+		if(psRecord->ui32Count <= FILTERBENCH_REFERENCE)
+		{
+			printf("%-12s %7u too few samples\n", FilterBenchSensors[ui32Sensor].pcName,
+				   psRecord->ui32Count);
+			continue;
+		}
+
+		/* Centred moving average of the raw values, the ends are left out */
+		ui32Count = psRecord->ui32Count - 2 * ui32Half;
+		i64Sum = 0;
+		for(ui32Idx = 0; ui32Idx < FILTERBENCH_REFERENCE; ui32Idx++)
+		{
+			i64Sum += psRecord->pi32Raw[ui32Idx];
+		}
+		for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+		{
+			pi32Reference[ui32Idx] = (int32_t)(i64Sum / FILTERBENCH_REFERENCE);
+			if(ui32Idx + FILTERBENCH_REFERENCE < psRecord->ui32Count)
+			{
+				i64Sum += psRecord->pi32Raw[ui32Idx + FILTERBENCH_REFERENCE] - psRecord->pi32Raw[ui32Idx];
+			}
+		}
+
+		dRaw = filterBenchRMS(&psRecord->pi32Raw[ui32Half], pi32Reference, ui32Count);
+		dFiltered = filterBenchRMS(&psRecord->pi32Filtered[ui32Half], pi32Reference, ui32Count);
+		printf("%-12s %7u %11.1f %11.1f %14.1f %10.2fx\n", FilterBenchSensors[ui32Sensor].pcName,
+			   psRecord->ui32Count, (double)psRecord->ui64Ns / psRecord->ui32Count, dRaw, dFiltered,
+			   dFiltered ? (dRaw / dFiltered) : 0.0);
+	}
+	fflush(stdout);
+}
+
+static void filterBenchIdle(void)
+{
+	uint64_t ui64Now = simMicros();
+
+	if(!FilterBenchRunStart)
+	{
+		FilterBenchRunStart = ui64Now;
+	}
+
+	if(FilterBenchDurationMs &&
+	   (ui64Now - FilterBenchRunStart >= (uint64_t)FilterBenchDurationMs * 1000u))
+	{
+		exit(0);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const WS_FilterConfig_t psKernels[] =
+	{
+		{ WS_FilterEMA,		WS_FILTER_ALPHA(0.25f),	0,				0 },
+		{ WS_FilterEMA,		WS_FILTER_ALPHA(0.125f),	0,				0 },
+		{ WS_FilterMedian5,	0,						0,				0 },
+		{ WS_FilterKalman,	0,						2000u * 2000u,	6000u * 6000u },
+		{ WS_FilterKalman,	0,						100u * 100u,	6000u * 6000u }
+	};
+	static const char * const ppcKernels[] =
+	{
+		"EMA 1/4", "EMA 1/8", "median of 5", "Kalman Q=(2)^2 R=(6)^2", "Kalman Q=(0.1)^2 R=(6)^2"
+	};
+	uint32_t ui32Iterations = 10000000, ui32Idx;
+	bool bVerbose = false;
+	int iOpt;
+
+	while((iOpt = getopt(argc, argv, "n:d:v")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 'n':
+				ui32Iterations = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				FilterBenchDurationMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'v':
+				bVerbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-n iterations] [-d seconds] [-v]\n", argv[0]);
+				return(1);
+		}
+	}
+	if(!ui32Iterations)
+	{
+		ui32Iterations = 1;
+	}
+
+	/* The kernels against the reference, on the noisiest signal */
+	printf("kernel                      max error  max bound\n");
+	filterBenchSignal(&FilterBenchSensors[WS_PressureSensor - 1]);
+	for(ui32Idx = 0; ui32Idx < sizeof(psKernels) / sizeof(psKernels[0]); ui32Idx++)
+	{
+		if(!filterBenchCheck(ppcKernels[ui32Idx], &psKernels[ui32Idx]))
+		{
+			return(1);
+		}
+	}
+
+	printf("\nkernel                      ns/sample\n");
+	for(ui32Idx = 0; ui32Idx < sizeof(psKernels) / sizeof(psKernels[0]); ui32Idx++)
+	{
+		printf("%-26s %10.1f\n", ppcKernels[ui32Idx], filterBenchNs(&psKernels[ui32Idx], ui32Iterations));
+	}
+
+	printf("\nstation       ns/sample  raw RMS err filtered RMS  reduction\n");
+	for(ui32Idx = 0; ui32Idx < WS_NUM_SENSORS; ui32Idx++)
+	{
+		filterBenchReduction(&FilterBenchSensors[ui32Idx], &SensorFilterConfig[ui32Idx], ui32Iterations);
+	}
+	fflush(stdout);
+
+	if(!FilterBenchDurationMs && !getenv("WS_SIM_TRACE"))
+	{
+		return(0);
+	}
+
+	for(ui32Idx = 0; ui32Idx < WS_NUM_SENSORS; ui32Idx++)
+	{
+		FilterBenchRecords[ui32Idx].pi32Raw = malloc(FILTERBENCH_RECORD * sizeof(int32_t));
+		FilterBenchRecords[ui32Idx].pi32Filtered = malloc(FILTERBENCH_RECORD * sizeof(int32_t));
+		if(!FilterBenchRecords[ui32Idx].pi32Raw || !FilterBenchRecords[ui32Idx].pi32Filtered)
+		{
+			perror("malloc");
+			return(1);
+		}
+	}
+
+	/* The replay exits when the trace ends */
+	atexit(filterBenchReport);
+
+	simInit();
+	simUARTQuiet(!bVerbose);
+	simIdleHookSet(filterBenchIdle);
+
+	return(firmwareMain());
+}
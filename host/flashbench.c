@@ -0,0 +1,554 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "weather_station/ws_flashlog.h"
+
+//*****************************************************************************
+/*  Check and benchmark of the flash sample log (weather_station/ws_flashlog.h)
+ *  on the RAM simulated flash, with the geometry of the internal flash
+ *  backend: 16 sectors of 16 KB.
+ *
+ *      ./build/flashbench [days]
+ *
+ *  1 s samples drifting like the station's means are appended. At a number
+ *  of fill levels the log is remounted, as after a reset, and the mount is
+ *  timed against a read of the whole history, which is what a mount that
+ *  scanned the payload would cost. Every remount has to give back every
+ *  sample still in the area, in order and unchanged.
+ *
+ *  A power cut is simulated while a block is written: its CRC word is never
+ *  programmed. After the remount the reader has to skip exactly that block.
+ *
+ *  Reboots restart the uptime at 0, one of them after a torn block, one
+ *  with the wall clock set. The log times stamped through flashLogTime have
+ *  to keep growing, and paging through the log by from= and the next cursor,
+ *  as /cgi-bin/history does, has to give every sample once, in order.
+ *
+ *  Then [days] (default 7) of samples wrap the area several times. The
+ *  bytes programmed per sample give the write amplification against the raw
+ *  20 byte sample, the erase counts per sector show the wear spread, which
+ *  may not exceed one erase. The exit status is 1 on a mismatch. */
+//*****************************************************************************
+
+#define FLASHBENCH_SECTOR_SIZE	0x4000
+#define FLASHBENCH_SECTORS		16
+
+/* Samples the reference keeps: two wraps of the area at the shortest coding,
+ * five one byte varints a sample */
+#define FLASHBENCH_MAX_SAMPLES	(2 * FLASHBENCH_SECTORS * FLASHBENCH_SECTOR_SIZE / 5)
+
+#define FLASHBENCH_MOUNT_REPEAT	1000
+
+/* Uptime of the first logged second after a reboot */
+#define FLASHBENCH_BOOT_S		3
+
+typedef struct {
+	WS_FlashBackend_t sRam;			/* The RAM flash the calls go to */
+	uint32_t pui32Erases[FLASHBENCH_SECTORS];
+	uint32_t ui32Programs;
+	uint32_t ui32FailProgram;		/* Program call that fails, 0 for none */
+}FlashBenchFlash_t;
+
+static uint8_t FlashBenchMem[FLASHBENCH_SECTORS * FLASHBENCH_SECTOR_SIZE];
+static WS_FlashRam_t FlashBenchRam;
+static FlashBenchFlash_t FlashBenchFlash;
+static WS_FlashBackend_t FlashBenchBackend;
+
+/* Reference of what was appended and, for the power cut, what was lost */
+static WS_LogSample_t *FlashBenchSamples;
+static uint32_t FlashBenchCount;
+static uint32_t FlashBenchLostFirst, FlashBenchLostEnd;
+
+static uint64_t flashBenchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+//*****************************************************************************
+//
+// The backend in front of the RAM flash: per sector erase counts and the
+// power cut.
+//
+//*****************************************************************************
+static int32_t flashBenchRead(void *pvContext, uint32_t ui32Offset, void *pvData, uint32_t ui32Count)
+{
+	FlashBenchFlash_t *psFlash = (FlashBenchFlash_t *)pvContext;
+
+	return(psFlash->sRam.pfnRead(psFlash->sRam.pvContext, ui32Offset, pvData, ui32Count));
+}
+
+static int32_t flashBenchProgram(void *pvContext, uint32_t ui32Offset, const void *pvData, uint32_t ui32Count)
+{
+	FlashBenchFlash_t *psFlash = (FlashBenchFlash_t *)pvContext;
+
+	if(++psFlash->ui32Programs == psFlash->ui32FailProgram)
+	{
+		return(-1);
+	}
+	return(psFlash->sRam.pfnProgram(psFlash->sRam.pvContext, ui32Offset, pvData, ui32Count));
+}
+
+static int32_t flashBenchErase(void *pvContext, uint32_t ui32Sector)
+{
+	FlashBenchFlash_t *psFlash = (FlashBenchFlash_t *)pvContext;
+
+	psFlash->pui32Erases[ui32Sector]++;
+	return(psFlash->sRam.pfnErase(psFlash->sRam.pvContext, ui32Sector));
+}
+
+static uint32_t flashBenchErases(void)
+{
+	uint32_t ui32Sector, ui32Erases = 0;
+
+	for(ui32Sector = 0; ui32Sector < FLASHBENCH_SECTORS; ui32Sector++)
+	{
+		ui32Erases += FlashBenchFlash.pui32Erases[ui32Sector];
+	}
+
+	return(ui32Erases);
+}
+
+/* An erased area and an empty reference */
+static void flashBenchReset(void)
+{
+	memset(&FlashBenchFlash, 0, sizeof(FlashBenchFlash));
+	flashLogRamInit(&FlashBenchFlash.sRam, &FlashBenchRam, FlashBenchMem, FLASHBENCH_SECTOR_SIZE,
+					FLASHBENCH_SECTORS);
+
+	FlashBenchBackend = FlashBenchFlash.sRam;
+	FlashBenchBackend.pvContext = &FlashBenchFlash;
+	FlashBenchBackend.pfnRead = flashBenchRead;
+	FlashBenchBackend.pfnProgram = flashBenchProgram;
+	FlashBenchBackend.pfnErase = flashBenchErase;
+
+	FlashBenchCount = 0;
+	FlashBenchLostFirst = FlashBenchLostEnd = 0;
+}
+
+//*****************************************************************************
+//
+// Samples and their check.
+//
+//*****************************************************************************
+
+/* 1 s means in thousandths: slow drifts with a little noise */
+static void flashBenchSample(uint32_t ui32Index, WS_LogSample_t *psSample)
+{
+	psSample->ui32Time = 1000 + ui32Index;
+	psSample->pi32Values[0] = 20000 + (int32_t)((ui32Index / 7) % 4000) - 2000 + rand() % 21 - 10;
+	psSample->pi32Values[1] = 45000 + rand() % 101 - 50;
+	psSample->pi32Values[2] = 101325000 - (int32_t)(ui32Index % 100000) + rand() % 201 - 100;
+	psSample->pi32Values[3] = (int32_t)((ui32Index % 86400) * 11) + rand() % 1001;
+}
+
+static bool flashBenchAppend(WS_FlashLog_t *psLog, uint32_t ui32Count)
+{
+	WS_LogSample_t sSample;
+
+	while(ui32Count--)
+	{
+		if(FlashBenchSamples && (FlashBenchCount >= FLASHBENCH_MAX_SAMPLES))
+		{
+			printf("more samples than the reference keeps\n");
+			return(false);
+		}
+		flashBenchSample(FlashBenchCount, &sSample);
+		if(flashLogAppend(psLog, &sSample))
+		{
+			printf("append of sample %u failed\n", FlashBenchCount);
+			return(false);
+		}
+		if(FlashBenchSamples)
+		{
+			FlashBenchSamples[FlashBenchCount] = sSample;
+		}
+		FlashBenchCount++;
+	}
+
+	return(true);
+}
+
+/* The log has to hold the newest samples, everything from its oldest one
+ * on except the lost block, in order */
+static bool flashBenchVerify(const WS_FlashLog_t *psLog, uint32_t *pui32Read)
+{
+	WS_FlashLogIter_t sIter;
+	WS_LogSample_t sSample;
+	uint32_t ui32Expect = 0, ui32Read = 0;
+
+	flashLogIterInit(psLog, &sIter, 0);
+	while(flashLogIterNext(&sIter, &sSample))
+	{
+		if(!ui32Read)
+		{
+			/* The oldest sample left, the wrap dropped what came before */
+			ui32Expect = sSample.ui32Time - 1000;
+		}
+		if((ui32Expect >= FlashBenchLostFirst) && (ui32Expect < FlashBenchLostEnd))
+		{
+			ui32Expect = FlashBenchLostEnd;
+		}
+		if((ui32Expect >= FlashBenchCount) ||
+		   memcmp(&sSample, &FlashBenchSamples[ui32Expect], sizeof(sSample)))
+		{
+			printf("sample %u of the log is not sample %u appended\n", ui32Read, ui32Expect);
+			return(false);
+		}
+		ui32Expect++;
+		ui32Read++;
+	}
+
+	if(ui32Expect != FlashBenchCount)
+	{
+		printf("the log ends at sample %u of %u\n", ui32Expect, FlashBenchCount);
+		return(false);
+	}
+
+	*pui32Read = ui32Read;
+	return(true);
+}
+
+//*****************************************************************************
+//
+// The runs.
+//
+//*****************************************************************************
+
+/* Remount at growing fill levels, time it against a history read */
+static bool flashBenchMount(void)
+{
+	static const uint32_t pui32Fill[] = { 1, 2, 4, 8, 15, 16, 32 };
+	WS_FlashLog_t sLog, sMounted;
+	WS_FlashLogIter_t sIter;
+	WS_LogSample_t sSample;
+	uint32_t ui32Fill, ui32Rep, ui32Read, ui32Reads;
+	uint64_t ui64Start, ui64MountNs, ui64ReadNs;
+
+	flashBenchReset();
+	if(flashLogMount(&sLog, &FlashBenchBackend))
+	{
+		printf("mount of the erased area failed\n");
+		return(false);
+	}
+
+	printf("sectors written  samples  mount us  header reads  history read us\n");
+	for(ui32Fill = 0; ui32Fill < sizeof(pui32Fill) / sizeof(pui32Fill[0]); ui32Fill++)
+	{
+		/* Fill up to the level, the erases count the sectors started */
+		do
+		{
+			if(!flashBenchAppend(&sLog, 100))
+			{
+				return(false);
+			}
+		}
+		while(flashBenchErases() < pui32Fill[ui32Fill]);
+		if(flashLogFlush(&sLog))
+		{
+			printf("flush failed\n");
+			return(false);
+		}
+
+		ui64Start = flashBenchNs();
+		for(ui32Rep = 0; ui32Rep < FLASHBENCH_MOUNT_REPEAT; ui32Rep++)
+		{
+			flashLogMount(&sMounted, &FlashBenchBackend);
+		}
+		ui64MountNs = (flashBenchNs() - ui64Start) / FLASHBENCH_MOUNT_REPEAT;
+		ui32Reads = sMounted.sStats.ui32MountReads;
+
+		if( (sMounted.ui32Active != sLog.ui32Active) || (sMounted.ui32Offset != sLog.ui32Offset) ||
+			(sMounted.ui32NextTime != sLog.ui32NextTime) || memcmp(sMounted.pui32Seq, sLog.pui32Seq, sizeof(sLog.pui32Seq)) )
+		{
+			printf("%u sectors: the mount does not find the end of the log\n", pui32Fill[ui32Fill]);
+			return(false);
+		}
+		if(!flashBenchVerify(&sMounted, &ui32Read))
+		{
+			return(false);
+		}
+
+		ui64Start = flashBenchNs();
+		flashLogIterInit(&sMounted, &sIter, 0);
+		while(flashLogIterNext(&sIter, &sSample))
+		{
+		}
+		ui64ReadNs = flashBenchNs() - ui64Start;
+
+		printf("%15u  %7u  %8.1f  %12u  %15.1f\n", pui32Fill[ui32Fill], ui32Read, ui64MountNs / 1000.0,
+			   ui32Reads, ui64ReadNs / 1000.0);
+
+		/* Appending goes on from the mounted state, as after a reset */
+		sLog = sMounted;
+	}
+
+	return(true);
+}
+
+/* The CRC word of a block is never programmed */
+static bool flashBenchPowerCut(void)
+{
+	WS_FlashLog_t sLog;
+	uint32_t ui32Read;
+
+	flashBenchReset();
+	if(flashLogMount(&sLog, &FlashBenchBackend) || !flashBenchAppend(&sLog, 1000) || flashLogFlush(&sLog))
+	{
+		printf("power cut: the log does not start\n");
+		return(false);
+	}
+
+	/* Header, payload, CRC: the third program call of the flush fails */
+	FlashBenchLostFirst = FlashBenchCount;
+	if(!flashBenchAppend(&sLog, 20))
+	{
+		return(false);
+	}
+	FlashBenchLostEnd = FlashBenchCount;
+	FlashBenchFlash.ui32FailProgram = FlashBenchFlash.ui32Programs + 3;
+	if(!flashLogFlush(&sLog))
+	{
+		printf("power cut: the flush did not fail\n");
+		return(false);
+	}
+	FlashBenchFlash.ui32FailProgram = 0;
+
+	/* Reset, then the log goes on */
+	if(flashLogMount(&sLog, &FlashBenchBackend) || !flashBenchAppend(&sLog, 1000) || flashLogFlush(&sLog))
+	{
+		printf("power cut: the log does not continue\n");
+		return(false);
+	}
+
+	if(!flashBenchVerify(&sLog, &ui32Read))
+	{
+		return(false);
+	}
+	if(ui32Read != FlashBenchCount - (FlashBenchLostEnd - FlashBenchLostFirst))
+	{
+		printf("power cut: %u samples read back, %u expected\n", ui32Read,
+			   FlashBenchCount - (FlashBenchLostEnd - FlashBenchLostFirst));
+		return(false);
+	}
+	printf("\npower cut in a block write: the %u samples of the torn block are skipped, %u read back\n",
+		   FlashBenchLostEnd - FlashBenchLostFirst, ui32Read);
+
+	return(true);
+}
+
+/* Pages of the history endpoint: up to ui32Page samples from ui32From on,
+ * the time of the first one left out is the next from, 0 at the end */
+static uint32_t flashBenchPage(const WS_FlashLog_t *psLog, uint32_t ui32From, uint32_t ui32Page,
+							   WS_LogSample_t *psOut, uint32_t *pui32Count)
+{
+	WS_FlashLogIter_t sIter;
+	WS_LogSample_t sSample;
+
+	*pui32Count = 0;
+	flashLogIterInit(psLog, &sIter, ui32From);
+	while(flashLogIterNext(&sIter, &sSample))
+	{
+		if(*pui32Count == ui32Page)
+		{
+			return(sSample.ui32Time);
+		}
+		psOut[(*pui32Count)++] = sSample;
+	}
+
+	return(0);
+}
+
+/* Boots of the station: uptime from 0, the clock set in one of them */
+static bool flashBenchReboot(void)
+{
+	static const struct {
+		uint32_t ui32Samples;
+		uint32_t ui32Unix;			/* Wall clock of uptime 0, 0 if not set */
+		bool bTorn;					/* Power cut in the last block write */
+	} psBoots[] = {
+		{ 3000, 0, false },
+		{ 2500, 0, true },
+		{ 40, 0, false },
+		{ 4000, 1700000000, false },
+		{ 1500, 0, false },
+	};
+	WS_FlashLog_t sLog;
+	WS_LogSample_t sSample, psPage[64];
+	uint32_t ui32Boot, ui32Uptime, ui32Base, ui32Lost, ui32From, ui32Next, ui32Count, ui32Idx, ui32Pages, ui32Sample;
+
+	flashBenchReset();
+
+	for(ui32Boot = 0; ui32Boot < sizeof(psBoots) / sizeof(psBoots[0]); ui32Boot++)
+	{
+		if(flashLogMount(&sLog, &FlashBenchBackend))
+		{
+			printf("reboot %u: mount failed\n", ui32Boot);
+			return(false);
+		}
+
+		/* Without the clock uptime 0 is the second after the newest sample
+		 * in flash. The first second is logged a few seconds into the boot. */
+		ui32Base = psBoots[ui32Boot].ui32Unix ? psBoots[ui32Boot].ui32Unix :
+				   (FlashBenchCount ? (FlashBenchSamples[FlashBenchCount - 1].ui32Time + 1) : 0);
+		for(ui32Uptime = FLASHBENCH_BOOT_S; ui32Uptime < FLASHBENCH_BOOT_S + psBoots[ui32Boot].ui32Samples;
+			ui32Uptime++)
+		{
+			flashBenchSample(FlashBenchCount, &sSample);
+			sSample.ui32Time = flashLogTime(&sLog, ui32Uptime,
+											psBoots[ui32Boot].ui32Unix ? (psBoots[ui32Boot].ui32Unix + ui32Uptime) : 0);
+			if(sSample.ui32Time != ui32Base + ui32Uptime)
+			{
+				printf("reboot %u: uptime %u is logged at %u\n", ui32Boot, ui32Uptime, sSample.ui32Time);
+				return(false);
+			}
+			if(flashLogAppend(&sLog, &sSample))
+			{
+				printf("reboot %u: append failed\n", ui32Boot);
+				return(false);
+			}
+			FlashBenchSamples[FlashBenchCount++] = sSample;
+		}
+
+		/* The samples of the torn block are gone */
+		if(psBoots[ui32Boot].bTorn)
+		{
+			ui32Lost = sLog.ui32BlockCount;
+			FlashBenchFlash.ui32FailProgram = FlashBenchFlash.ui32Programs + 3;
+			if(!flashLogFlush(&sLog))
+			{
+				printf("reboot %u: the flush did not fail\n", ui32Boot);
+				return(false);
+			}
+			FlashBenchFlash.ui32FailProgram = 0;
+			FlashBenchCount -= ui32Lost;
+		}
+		else if(flashLogFlush(&sLog))
+		{
+			printf("reboot %u: flush failed\n", ui32Boot);
+			return(false);
+		}
+	}
+	if(flashLogMount(&sLog, &FlashBenchBackend))
+	{
+		return(false);
+	}
+
+	/* Pages of the history, from the start */
+	ui32From = 0;
+	ui32Idx = 0;
+	ui32Pages = 0;
+	do
+	{
+		ui32Next = flashBenchPage(&sLog, ui32From, sizeof(psPage) / sizeof(psPage[0]), psPage, &ui32Count);
+		for(ui32Sample = 0; ui32Sample < ui32Count; ui32Sample++, ui32Idx++)
+		{
+			if((ui32Idx >= FlashBenchCount) || memcmp(&psPage[ui32Sample], &FlashBenchSamples[ui32Idx], sizeof(sSample)))
+			{
+				printf("reboot: page %u sample %u (t %u) is not sample %u appended\n", ui32Pages, ui32Sample,
+					   psPage[ui32Sample].ui32Time, ui32Idx);
+				return(false);
+			}
+		}
+		if(ui32Next && (ui32Next <= ui32From))
+		{
+			printf("reboot: page %u does not move on (from %u, next %u)\n", ui32Pages, ui32From, ui32Next);
+			return(false);
+		}
+		ui32From = ui32Next;
+		ui32Pages++;
+	}
+	while(ui32Next);
+
+	if(ui32Idx != FlashBenchCount)
+	{
+		printf("reboot: %u samples paged, %u appended\n", ui32Idx, FlashBenchCount);
+		return(false);
+	}
+	printf("\n%u reboots, one after a torn block: %u samples in %u pages of %u, times %u..%u\n",
+		   (unsigned)(sizeof(psBoots) / sizeof(psBoots[0])), ui32Idx, ui32Pages,
+		   (unsigned)(sizeof(psPage) / sizeof(psPage[0])), FlashBenchSamples[0].ui32Time,
+		   FlashBenchSamples[FlashBenchCount - 1].ui32Time);
+
+	return(true);
+}
+
+/* Days of samples, write amplification and wear */
+static bool flashBenchWear(uint32_t ui32Days)
+{
+	WS_FlashLog_t sLog;
+	uint32_t ui32Sector, ui32Min = UINT32_MAX, ui32Max = 0;
+	uint64_t ui64Start, ui64Ns;
+
+	flashBenchReset();
+	if(flashLogMount(&sLog, &FlashBenchBackend))
+	{
+		return(false);
+	}
+
+	/* Not kept, days do not fit the reference */
+	FlashBenchSamples = NULL;
+	ui64Start = flashBenchNs();
+	if(!flashBenchAppend(&sLog, ui32Days * 86400))
+	{
+		return(false);
+	}
+	ui64Ns = flashBenchNs() - ui64Start;
+
+	for(ui32Sector = 0; ui32Sector < FLASHBENCH_SECTORS; ui32Sector++)
+	{
+		ui32Min = (FlashBenchFlash.pui32Erases[ui32Sector] < ui32Min) ? FlashBenchFlash.pui32Erases[ui32Sector] : ui32Min;
+		ui32Max = (FlashBenchFlash.pui32Erases[ui32Sector] > ui32Max) ? FlashBenchFlash.pui32Erases[ui32Sector] : ui32Max;
+	}
+
+	printf("\n%u days, %u samples: %u blocks, %u erases, %.2f bytes programmed per sample, "
+		   "write amplification %.3f against the raw %u byte sample\n", ui32Days, sLog.sStats.ui32Samples,
+		   sLog.sStats.ui32Blocks, sLog.sStats.ui32Erases,
+		   (double)FlashBenchRam.ui32ProgramBytes / sLog.sStats.ui32Samples,
+		   (double)FlashBenchRam.ui32ProgramBytes / ((double)sLog.sStats.ui32Samples * sizeof(WS_LogSample_t)),
+		   (unsigned)sizeof(WS_LogSample_t));
+	printf("erases per sector %u..%u, the area holds %.1f h, flashLogAppend %.1f ns/sample\n",
+		   ui32Min, ui32Max,
+		   (double)sLog.sStats.ui32Samples * FLASHBENCH_SECTORS * FLASHBENCH_SECTOR_SIZE /
+		   FlashBenchRam.ui32ProgramBytes / 3600.0, (double)ui64Ns / sLog.sStats.ui32Samples);
+
+	if(ui32Max - ui32Min > 1)
+	{
+		printf("the wear is not level\n");
+		return(false);
+	}
+
+	return(true);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32Days = (argc > 1) ? strtoul(argv[1], NULL, 0) : 7;
+
+	if(!ui32Days)
+	{
+		fprintf(stderr, "usage: %s [days]\n", argv[0]);
+		return(1);
+	}
+
+	FlashBenchSamples = malloc(FLASHBENCH_MAX_SAMPLES * sizeof(WS_LogSample_t));
+	if(!FlashBenchSamples)
+	{
+		perror("malloc");
+		return(1);
+	}
+	srand(1);
+
+	if(!flashBenchMount() || !flashBenchPowerCut() || !flashBenchReboot() || !flashBenchWear(ui32Days))
+	{
+		return(1);
+	}
+
+	return(0);
+}
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "weather_station/i2c_dma.h"
+#include "weather_station/ws_trace.h"
+
+//*****************************************************************************
+/*  Interrupts per sample of the sensor I2C master, interrupt per byte against
+ *  uDMA, from the model in weather_station/i2c_dma_model.c:
+ *
+ *      ./build/i2cdmabench
+ *      ./build/i2cdmabench sensors.trace
+ *
+ *  Given a sensor trace captured on the board it also counts the interrupts
+ *  of the transactions the drivers actually issued, per sample, and checks
+ *  them against the model. A sample is one BMP180 pressure readout, every
+ *  acquisition round has exactly one. The trace may show more interrupts
+ *  than the model (SHT21 polls, light range changes, retries), never fewer:
+ *  then the model lists transactions the drivers no longer issue and the
+ *  exit status is 1, as it is when uDMA would not save interrupts. */
+//*****************************************************************************
+
+/* BMP180 address and its result register */
+#define I2CDMABENCH_BMP180_ADDR		0x77
+#define I2CDMABENCH_BMP180_RESULT	0xF6
+
+static uint8_t I2CDMABenchTrace[1 << 20];
+
+static bool i2cDMABenchTrace(const char *pcPath, uint32_t *pui32Samples, uint32_t *pui32Transactions,
+							 uint32_t *pui32IntsPIO, uint32_t *pui32IntsDMA)
+{
+	WS_TraceReader_t sReader;
+	WS_TraceRecord_t sRecord;
+	uint32_t ui32Len;
+	FILE *psFile;
+
+	psFile = fopen(pcPath, "rb");
+	if(!psFile)
+	{
+		perror(pcPath);
+		return(false);
+	}
+	ui32Len = (uint32_t)fread(I2CDMABenchTrace, 1, sizeof(I2CDMABenchTrace), psFile);
+	fclose(psFile);
+
+	if(!traceReaderInit(&sReader, I2CDMABenchTrace, ui32Len))
+	{
+		fprintf(stderr, "%s: not a sensor trace\n", pcPath);
+		return(false);
+	}
+
+	*pui32Samples = *pui32Transactions = *pui32IntsPIO = *pui32IntsDMA = 0;
+	while(traceReaderNext(&sReader, &sRecord))
+	{
+		(*pui32Transactions)++;
+		*pui32IntsPIO += I2CDMAModelTransactionInts(sRecord.ui8WriteCount, sRecord.ui8ReadCount, false);
+		*pui32IntsDMA += I2CDMAModelTransactionInts(sRecord.ui8WriteCount, sRecord.ui8ReadCount, true);
+
+		if((sRecord.ui8Addr == I2CDMABENCH_BMP180_ADDR) && (sRecord.ui8WriteCount == 1) &&
+		   (sRecord.pui8Write[0] == I2CDMABENCH_BMP180_RESULT) && (sRecord.ui8ReadCount == 3))
+		{
+			(*pui32Samples)++;
+		}
+	}
+
+	return(true);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32ModelPIO = I2CDMAModelSampleInts(false);
+	uint32_t ui32ModelDMA = I2CDMAModelSampleInts(true);
+	uint32_t ui32Samples, ui32Transactions, ui32IntsPIO, ui32IntsDMA;
+	double dTracePIO, dTraceDMA;
+
+	if(argc > 2)
+	{
+		fprintf(stderr, "usage: %s [trace]\n", argv[0]);
+		return(1);
+	}
+
+	printf("%-28s %12s %12s %10s\n", "interrupts per sample", "per byte", "uDMA", "saved");
+	printf("%-28s %12u %12u %9.0f%%\n", "model", ui32ModelPIO, ui32ModelDMA,
+		   100.0 * (ui32ModelPIO - ui32ModelDMA) / ui32ModelPIO);
+	if(ui32ModelDMA >= ui32ModelPIO)
+	{
+		printf("model: uDMA saves no interrupts\n");
+		return(1);
+	}
+
+	if(argc < 2)
+	{
+		return(0);
+	}
+
+	if(!i2cDMABenchTrace(argv[1], &ui32Samples, &ui32Transactions, &ui32IntsPIO, &ui32IntsDMA))
+	{
+		return(1);
+	}
+	if(!ui32Samples)
+	{
+		printf("%s: no pressure readout in %u transactions\n", argv[1], ui32Transactions);
+		return(1);
+	}
+
+	dTracePIO = (double)ui32IntsPIO / ui32Samples;
+	dTraceDMA = (double)ui32IntsDMA / ui32Samples;
+	printf("%-28s %12.1f %12.1f %9.0f%%\n", "trace", dTracePIO, dTraceDMA,
+		   100.0 * (dTracePIO - dTraceDMA) / dTracePIO);
+	printf("%u samples, %.1f transactions per sample\n", ui32Samples,
+		   (double)ui32Transactions / ui32Samples);
+
+	if((dTracePIO < ui32ModelPIO) || (dTraceDMA < ui32ModelDMA))
+	{
+		printf("trace: fewer interrupts than the model, the model lists transactions the "
+			   "drivers do not issue\n");
+		return(1);
+	}
+
+	return(0);
+}
@@ -0,0 +1,40 @@
+#ifndef HOST_ARCH_CC_H_
+#define HOST_ARCH_CC_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//*****************************************************************************
+/*  lwIP compiler and platform definitions for a Linux host with gcc. */
+//*****************************************************************************
+typedef uint8_t		u8_t;
+typedef int8_t		s8_t;
+typedef uint16_t	u16_t;
+typedef int16_t		s16_t;
+typedef uint32_t	u32_t;
+typedef int32_t		s32_t;
+typedef uintptr_t	mem_ptr_t;
+
+#define U16_F		"hu"
+#define S16_F		"hd"
+#define X16_F		"hx"
+#define U32_F		"u"
+#define S32_F		"d"
+#define X32_F		"x"
+#define SZT_F		"zu"
+
+#ifndef BYTE_ORDER
+#define BYTE_ORDER	LITTLE_ENDIAN
+#endif
+
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_STRUCT	__attribute__((packed))
+#define PACK_STRUCT_END
+#define PACK_STRUCT_FIELD(x)	x
+
+#define LWIP_PLATFORM_DIAG(x)	do { printf x; } while(0)
+#define LWIP_PLATFORM_ASSERT(x)	do { fprintf(stderr, "lwIP assertion \"%s\" failed at %s:%d\n", \
+										 x, __FILE__, __LINE__); abort(); } while(0)
+
+#endif /* HOST_ARCH_CC_H_ */
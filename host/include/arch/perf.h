@@ -0,0 +1,7 @@
+#ifndef HOST_ARCH_PERF_H_
+#define HOST_ARCH_PERF_H_
+
+#define PERF_START
+#define PERF_STOP(x)
+
+#endif /* HOST_ARCH_PERF_H_ */
@@ -0,0 +1,10 @@
+#ifndef HOST_ARCH_SYS_ARCH_H_
+#define HOST_ARCH_SYS_ARCH_H_
+
+//*****************************************************************************
+/*  NO_SYS port: the stack only runs in interrupt handlers, which the
+ *  simulation never runs concurrently, so protection is a no-op. */
+//*****************************************************************************
+typedef int sys_prot_t;
+
+#endif /* HOST_ARCH_SYS_ARCH_H_ */
@@ -0,0 +1,29 @@
+#ifndef HOST_DRIVERLIB_ROM_H_
+#define HOST_DRIVERLIB_ROM_H_
+
+//*****************************************************************************
+/*  Host replacement of driverlib/rom.h. There is no ROM, the ROM_ calls the
+ *  firmware makes go to the simulated driverlib functions of sim_hal.c and
+ *  sim_int.c. */
+//*****************************************************************************
+
+#define ROM_GPIOIntTypeSet				GPIOIntTypeSet
+#define ROM_GPIOPinConfigure			GPIOPinConfigure
+#define ROM_GPIOPinRead					GPIOPinRead
+#define ROM_GPIOPinTypeGPIOInput		GPIOPinTypeGPIOInput
+#define ROM_GPIOPinTypeGPIOOutput		GPIOPinTypeGPIOOutput
+#define ROM_GPIOPinTypeI2C				GPIOPinTypeI2C
+#define ROM_GPIOPinWrite				GPIOPinWrite
+#define ROM_IntEnable					IntEnable
+#define ROM_IntMasterEnable				IntMasterEnable
+#define ROM_SysCtlDelay					SysCtlDelay
+#define ROM_SysCtlPeripheralEnable		SysCtlPeripheralEnable
+#define ROM_SysCtlPeripheralReady		SysCtlPeripheralReady
+#define ROM_SysCtlSleep					SysCtlSleep
+#define ROM_TimerConfigure				TimerConfigure
+#define ROM_TimerDisable				TimerDisable
+#define ROM_TimerEnable					TimerEnable
+#define ROM_TimerIntEnable				TimerIntEnable
+#define ROM_TimerLoadSet				TimerLoadSet
+
+#endif /* HOST_DRIVERLIB_ROM_H_ */
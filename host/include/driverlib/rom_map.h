@@ -0,0 +1,26 @@
+#ifndef HOST_DRIVERLIB_ROM_MAP_H_
+#define HOST_DRIVERLIB_ROM_MAP_H_
+
+//*****************************************************************************
+/*  Host replacement of driverlib/rom_map.h, the MAP_ calls the firmware
+ *  makes go to the simulated driverlib functions. */
+//*****************************************************************************
+
+#define MAP_FlashErase					FlashErase
+#define MAP_FlashProgram				FlashProgram
+#define MAP_FlashUserGet				FlashUserGet
+#define MAP_IntMasterDisable			IntMasterDisable
+#define MAP_IntMasterEnable				IntMasterEnable
+#define MAP_IntPrioritySet				IntPrioritySet
+#define MAP_SysCtlClockFreqSet			SysCtlClockFreqSet
+#define MAP_SysCtlSleep					SysCtlSleep
+#define MAP_SysTickEnable				SysTickEnable
+#define MAP_SysTickIntEnable			SysTickIntEnable
+#define MAP_SysTickPeriodSet			SysTickPeriodSet
+#define MAP_TimerIntClear				TimerIntClear
+#define MAP_uDMAChannelAssign			uDMAChannelAssign
+#define MAP_uDMAChannelAttributeDisable	uDMAChannelAttributeDisable
+#define MAP_uDMAControlBaseSet			uDMAControlBaseSet
+#define MAP_uDMAEnable					uDMAEnable
+
+#endif /* HOST_DRIVERLIB_ROM_MAP_H_ */
@@ -0,0 +1,16 @@
+#ifndef HOST_INC_HW_TYPES_H_
+#define HOST_INC_HW_TYPES_H_
+
+//*****************************************************************************
+/*  Host wrapper of inc/hw_types.h. There is no bit-band alias region on the
+ *  host, HWREGBITW becomes a one bit field at the same position of the word.
+ *  Unlike the alias it is a read-modify-write, which is fine with the
+ *  handlers never preempting each other. HWREG is left as it is, the host
+ *  build does not touch registers. */
+//*****************************************************************************
+#include_next "inc/hw_types.h"
+
+#undef HWREGBITW
+#define HWREGBITW(x, b)			(((volatile struct { uint32_t : (b); uint32_t ui1Bit : 1; } *)(x))->ui1Bit)
+
+#endif /* HOST_INC_HW_TYPES_H_ */
@@ -0,0 +1,14 @@
+#ifndef HOST_LWIPOPTS_H_
+#define HOST_LWIPOPTS_H_
+
+//*****************************************************************************
+/*  lwIP options of the host build: the firmware's settings with the few
+ *  changes a 64 bit host needs. */
+//*****************************************************************************
+#include "../../lwipopts.h"
+
+/* Pointers are 8 bytes wide */
+#undef MEM_ALIGNMENT
+#define MEM_ALIGNMENT			8
+
+#endif /* HOST_LWIPOPTS_H_ */
@@ -0,0 +1,44 @@
+#ifndef HOST_UTILS_LWIPLIB_H_
+#define HOST_UTILS_LWIPLIB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Host replacement of utils/lwiplib.h. Same API as the TivaWare wrapper, the
+ *  interface behind it is the simulated link of sim_lwiplib.c instead of the
+ *  Ethernet controller. */
+//*****************************************************************************
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/init.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/ip_addr.h"
+#include "lwip/raw.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/dhcp.h"
+#include "lwip/autoip.h"
+#include "lwip/stats.h"
+#include "lwip/timers.h"
+
+#define IPADDR_USE_STATIC		0
+#define IPADDR_USE_DHCP			1
+#define IPADDR_USE_AUTOIP		2
+
+void lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8MAC, uint32_t ui32IPAddr,
+			  uint32_t ui32NetMask, uint32_t ui32GWAddr, uint32_t ui32IPMode);
+void lwIPTimer(uint32_t ui32TimeMS);
+void lwIPEthernetIntHandler(void);
+uint32_t lwIPLocalIPAddrGet(void);
+uint32_t lwIPLocalNetMaskGet(void);
+uint32_t lwIPLocalGWAddrGet(void);
+void lwIPLocalMACGet(uint8_t *pui8MAC);
+void lwIPNetworkConfigChange(uint32_t ui32IPAddr, uint32_t ui32NetMask, uint32_t ui32GWAddr,
+							 uint32_t ui32IPMode);
+
+#endif /* HOST_UTILS_LWIPLIB_H_ */
@@ -0,0 +1,811 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils/lwiplib.h"
+#include "lwip/tcp.h"
+#include "lwip/tcp_impl.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+#include "weather_station/ws_netstats.h"
+#include "weather_station/ws_http.h"
+#include "weather_station/ws_tick.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  HTTP load generator of the host build.
+ *
+ *  N simulated dashboards run inside the firmware process as lwIP raw TCP
+ *  clients of the station's own address, so every request goes through the
+ *  same stack, pools and web server the target runs. Each dashboard does what
+ *  index.html does in a browser: it fetches / and /javascript.js, then polls
+ *  /cgi-bin/send_data every poll period. The dashboards are started evenly
+ *  spread over the first poll period.
+ *
+ *  By default every request is an HTTP/1.0 one on a connection of its own,
+ *  closed after the response. With -k the dashboards speak HTTP/1.1 and keep
+ *  their connection as a browser does, -P also pipelines the page load: /
+ *  and /javascript.js go out back to back on one connection. A response ends
+ *  with its Content-Length, or when the station closes the connection if it
+ *  has none.
+ *
+ *  A request fails when no PCB can be allocated, the connection is refused
+ *  or reset, it times out or the status is not 200. The clients share the
+ *  pools with the server: a connection takes a TCP_PCB on each side. The
+ *  station's own PCBs, the ones on port 80, are counted apart, open and in
+ *  TIME_WAIT.
+ *
+ *  The results are printed as one JSON object when the run ends:
+ *
+ *      ./build/loadgen -c 8 -d 30 -o result.json
+ *      ./build/loadgen -c 8 -d 30 -k -P -o result.json
+ *
+ *  -c clients, -d duration in s, -p poll period in ms, -t request timeout in
+ *  ms, -k keep-alive, -P pipelining (implies -k), -o output file (stdout by
+ *  default), -v keeps the firmware's UART output. */
+//*****************************************************************************
+
+#define LOADGEN_MAX_CLIENTS		64
+#define LOADGEN_PORT			80
+
+/* Address of the station on the simulated link */
+#define LOADGEN_SERVER(a)		IP4_ADDR((a), 10, 0, 0, 2)
+
+/* Response headers kept to be parsed, the rest is counted only */
+#define LOADGEN_HEADER_LEN		256
+
+/* Body of a response without a Content-Length, ends with the connection */
+#define LOADGEN_UNTIL_CLOSE		UINT32_MAX
+
+typedef enum {
+	LoadGenIdle				= 0x00u,	/* No connection */
+	LoadGenConnecting		= 0x01u,
+	LoadGenReceiving		= 0x02u,
+	LoadGenOpen				= 0x03u		/* Kept connection, no request */
+}LoadGenState_t;
+
+typedef enum {
+	LoadGenFailPCB			= 0x00u,	/* tcp_new found the pool empty */
+	LoadGenFailConnect		= 0x01u,	/* Connect refused or not sent */
+	LoadGenFailReset		= 0x02u,	/* Connection reset or aborted */
+	LoadGenFailTimeout		= 0x03u,
+	LoadGenFailStatus		= 0x04u,	/* Response other than 200 */
+	LOADGEN_NUM_FAILS		= 0x05u
+}LoadGenFail_t;
+
+/* Page loaded by a dashboard, the last one is polled */
+typedef enum {
+	LoadGenURLIndex			= 0x00u,
+	LoadGenURLScript		= 0x01u,
+	LoadGenURLData			= 0x02u,
+	LOADGEN_NUM_URLS		= 0x03u
+}LoadGenURL_t;
+
+typedef struct {
+	const char *pcPath;
+	uint32_t ui32OK;
+	uint32_t ui32Failed;
+	uint64_t ui64Bytes;
+	uint32_t *pui32Latency;		/* Latency of the successful requests, us */
+	uint32_t ui32Size;
+}LoadGenURLStats_t;
+
+typedef struct {
+	LoadGenState_t eState;
+	LoadGenURL_t eURL;			/* Of the oldest request outstanding */
+	uint32_t ui32Outstanding;	/* Requests sent, not answered */
+	struct tcp_pcb *psPCB;
+	uint64_t ui64Start;
+	uint64_t ui64Next;
+	uint32_t ui32Bytes;
+
+	/* Response being received */
+	char pcHeader[LOADGEN_HEADER_LEN];
+	uint32_t ui32HeaderLen;
+	uint32_t ui32HeaderEnd;		/* Bytes of "\r\n\r\n" matched */
+	bool bHeaderDone;
+	bool bStatusOK;
+	bool bServerClose;			/* Connection: close, or no length */
+	uint32_t ui32BodyLeft;
+}LoadGenClient_t;
+
+static LoadGenURLStats_t LoadGenURLs[LOADGEN_NUM_URLS] =
+{
+	{ "/" },
+	{ "/javascript.js" },
+	{ "/cgi-bin/send_data" },
+};
+
+static const char * const LoadGenFailNames[LOADGEN_NUM_FAILS] =
+{
+	"pcb", "connect", "reset", "timeout", "status"
+};
+
+static const char * const LoadGenPoolNames[MEMP_MAX] =
+{
+#define LWIP_MEMPOOL(name, num, size, desc)		#name,
+#include "lwip/memp_std.h"
+};
+
+static LoadGenClient_t LoadGenClients[LOADGEN_MAX_CLIENTS];
+static uint32_t LoadGenNumClients = 8;
+static uint32_t LoadGenDurationMs = 10000;
+static uint32_t LoadGenPollMs = 1000;
+static uint32_t LoadGenTimeoutMs = 5000;
+static bool LoadGenKeepAlive;
+static bool LoadGenPipeline;
+static FILE *LoadGenOut;
+
+static uint32_t LoadGenFails[LOADGEN_NUM_FAILS];
+static uint32_t LoadGenMaxInFlight;
+static uint32_t LoadGenQuery;
+static uint64_t LoadGenRunStart;
+static uint64_t LoadGenRunEnd;
+static uint32_t LoadGenConnects;
+
+/* The station's PCBs, port 80 */
+static uint32_t LoadGenServerMax;
+static uint32_t LoadGenTimeWaitMax;
+static WS_HttpStats_t LoadGenHttpStart;
+
+/* Pool errors before the run, the report counts the ones of the run */
+static uint32_t LoadGenPoolErr[MEMP_MAX];
+static uint32_t LoadGenHeapErr;
+static uint32_t LoadGenFsErr;
+static uint64_t LoadGenIdleWakeups;
+static uint64_t LoadGenIdleUs;
+static uint32_t LoadGenSysTicks;
+
+extern int firmwareMain(void);
+
+//*****************************************************************************
+//
+// Requests.
+//
+//*****************************************************************************
+static void loadGenRecord(LoadGenURLStats_t *psURL, uint32_t ui32Latency)
+{
+	if(psURL->ui32OK == psURL->ui32Size)
+	{
+		psURL->ui32Size = psURL->ui32Size ? (psURL->ui32Size * 2) : 1024;
+		psURL->pui32Latency = realloc(psURL->pui32Latency, psURL->ui32Size * sizeof(uint32_t));
+		if(!psURL->pui32Latency)
+		{
+			perror("loadgen");
+			exit(1);
+		}
+	}
+	psURL->pui32Latency[psURL->ui32OK++] = ui32Latency;
+}
+
+/* Result of the oldest request outstanding */
+static void loadGenResult(LoadGenClient_t *psClient, bool bOK, LoadGenFail_t eFail)
+{
+	LoadGenURLStats_t *psURL = &LoadGenURLs[psClient->eURL];
+
+	if(bOK)
+	{
+		loadGenRecord(psURL, (uint32_t)(simMicros() - psClient->ui64Start));
+		psURL->ui64Bytes += psClient->ui32Bytes;
+	}
+	else
+	{
+		psURL->ui32Failed++;
+		LoadGenFails[eFail]++;
+	}
+
+	psClient->ui32Bytes = 0;
+	psClient->ui32HeaderLen = 0;
+	psClient->ui32HeaderEnd = 0;
+	psClient->bHeaderDone = false;
+}
+
+/* Nothing is outstanding any more, schedule the next request of the
+ * dashboard */
+static void loadGenDone(LoadGenClient_t *psClient)
+{
+	uint64_t ui64Now = simMicros();
+
+	psClient->ui32Outstanding = 0;
+	psClient->eState = psClient->psPCB ? LoadGenOpen : LoadGenIdle;
+
+	/* The page loads back to back, then the script's setInterval */
+	if(psClient->eURL == LoadGenURLData)
+	{
+		psClient->ui64Next = psClient->ui64Start + LoadGenPollMs * 1000u;
+		if(psClient->ui64Next < ui64Now)
+		{
+			psClient->ui64Next = ui64Now;
+		}
+	}
+	else
+	{
+		psClient->eURL++;
+		psClient->ui64Next = ui64Now;
+	}
+}
+
+/* Every request outstanding failed */
+static void loadGenFail(LoadGenClient_t *psClient, LoadGenFail_t eFail)
+{
+	for(;;)
+	{
+		loadGenResult(psClient, false, eFail);
+		if(psClient->ui32Outstanding <= 1)
+		{
+			break;
+		}
+		psClient->ui32Outstanding--;
+		psClient->eURL++;
+	}
+
+	loadGenDone(psClient);
+}
+
+static void loadGenDetach(struct tcp_pcb *psPCB)
+{
+	tcp_arg(psPCB, NULL);
+	tcp_err(psPCB, NULL);
+	tcp_recv(psPCB, NULL);
+}
+
+/* Close the connection without calling back into the client, ERR_ABRT if
+ * it had to be aborted */
+static err_t loadGenClose(LoadGenClient_t *psClient)
+{
+	struct tcp_pcb *psPCB = psClient->psPCB;
+
+	loadGenDetach(psPCB);
+	psClient->psPCB = NULL;
+	if(tcp_close(psPCB) != ERR_OK)
+	{
+		tcp_abort(psPCB);
+		return(ERR_ABRT);
+	}
+
+	return(ERR_OK);
+}
+
+/* Drop the connection without calling back into the client */
+static void loadGenAbort(LoadGenClient_t *psClient, LoadGenFail_t eFail)
+{
+	loadGenDetach(psClient->psPCB);
+	tcp_abort(psClient->psPCB);
+	psClient->psPCB = NULL;
+
+	loadGenFail(psClient, eFail);
+}
+
+static void loadGenError(void *pvArg, err_t eErr)
+{
+	LoadGenClient_t *psClient = pvArg;
+
+	/* The PCB is already freed */
+	psClient->psPCB = NULL;
+	if(psClient->eState == LoadGenOpen)
+	{
+		psClient->eState = LoadGenIdle;
+		return;
+	}
+
+	loadGenFail(psClient, (psClient->eState == LoadGenConnecting) ?
+				LoadGenFailConnect : LoadGenFailReset);
+}
+
+/* The headers of a response are in */
+static void loadGenHeader(LoadGenClient_t *psClient)
+{
+	const char *pcLength;
+
+	psClient->pcHeader[psClient->ui32HeaderLen] = 0;
+	psClient->bStatusOK = !memcmp(psClient->pcHeader, "HTTP/1.", 7) &&
+						  !memcmp(psClient->pcHeader + 8, " 200", 4);
+
+	pcLength = strstr(psClient->pcHeader, "Content-Length:");
+	psClient->ui32BodyLeft = pcLength ? strtoul(pcLength + 15, NULL, 10) : LOADGEN_UNTIL_CLOSE;
+	psClient->bServerClose = !pcLength || strstr(psClient->pcHeader, "Connection: close");
+	psClient->bHeaderDone = true;
+}
+
+/* Parse received bytes, returns the ones of the current response. *pbEnd is
+ * set when they complete it. */
+static uint32_t loadGenParse(LoadGenClient_t *psClient, const char *pcData, uint32_t ui32Len,
+							 bool *pbEnd)
+{
+	uint32_t ui32Idx;
+	char c;
+
+	if(!psClient->bHeaderDone)
+	{
+		for(ui32Idx = 0; (ui32Idx < ui32Len) && !psClient->bHeaderDone; ui32Idx++)
+		{
+			c = pcData[ui32Idx];
+			if(psClient->ui32HeaderLen < (LOADGEN_HEADER_LEN - 1))
+			{
+				psClient->pcHeader[psClient->ui32HeaderLen++] = c;
+			}
+			if(c == "\r\n\r\n"[psClient->ui32HeaderEnd])
+			{
+				psClient->ui32HeaderEnd++;
+			}
+			else
+			{
+				psClient->ui32HeaderEnd = (c == '\r');
+			}
+			if(psClient->ui32HeaderEnd == 4)
+			{
+				loadGenHeader(psClient);
+			}
+		}
+	}
+	else
+	{
+		ui32Idx = ui32Len;
+		if(psClient->ui32BodyLeft != LOADGEN_UNTIL_CLOSE)
+		{
+			ui32Idx = (ui32Len < psClient->ui32BodyLeft) ? ui32Len : psClient->ui32BodyLeft;
+			psClient->ui32BodyLeft -= ui32Idx;
+		}
+	}
+
+	psClient->ui32Bytes += ui32Idx;
+	*pbEnd = psClient->bHeaderDone && !psClient->ui32BodyLeft;
+
+	return(ui32Idx);
+}
+
+/* A response is complete, the next pipelined one follows or the request is
+ * over */
+static err_t loadGenAnswered(LoadGenClient_t *psClient)
+{
+	bool bClose = psClient->bServerClose || !LoadGenKeepAlive;
+	err_t eErr = ERR_OK;
+
+	loadGenResult(psClient, psClient->bStatusOK, LoadGenFailStatus);
+	if(psClient->ui32Outstanding > 1)
+	{
+		psClient->ui32Outstanding--;
+		psClient->eURL++;
+		return(ERR_OK);
+	}
+
+	if(bClose && psClient->psPCB)
+	{
+		eErr = loadGenClose(psClient);
+	}
+	loadGenDone(psClient);
+
+	return(eErr);
+}
+
+static err_t loadGenReceive(void *pvArg, struct tcp_pcb *psPCB, struct pbuf *p, err_t eErr)
+{
+	LoadGenClient_t *psClient = pvArg;
+	struct pbuf *q;
+	uint32_t ui32Offset;
+	bool bEnd;
+
+	if(!p)
+	{
+		/* The station closed the connection: the end of a response without a
+		 * length, a failure of one with, nothing if none is outstanding */
+		bEnd = psClient->bHeaderDone && (psClient->ui32BodyLeft == LOADGEN_UNTIL_CLOSE);
+		eErr = loadGenClose(psClient);
+		if(psClient->eState == LoadGenOpen)
+		{
+			psClient->eState = LoadGenIdle;
+		}
+		else
+		{
+			if(bEnd)
+			{
+				loadGenAnswered(psClient);
+			}
+			if(psClient->eState == LoadGenReceiving)
+			{
+				loadGenFail(psClient, LoadGenFailReset);
+			}
+		}
+		return(eErr);
+	}
+
+	tcp_recved(psPCB, p->tot_len);
+	eErr = ERR_OK;
+	for(q = p; q && (psClient->psPCB == psPCB) && (psClient->eState == LoadGenReceiving); q = q->next)
+	{
+		for(ui32Offset = 0; (ui32Offset < q->len) && (psClient->psPCB == psPCB) &&
+			(psClient->eState == LoadGenReceiving); )
+		{
+			ui32Offset += loadGenParse(psClient, (const char *)q->payload + ui32Offset,
+									   q->len - ui32Offset, &bEnd);
+			if(bEnd)
+			{
+				eErr = loadGenAnswered(psClient);
+			}
+		}
+	}
+	pbuf_free(p);
+
+	return(eErr);
+}
+
+/* One request per outstanding one, for the URLs from eURL on */
+static bool loadGenSend(LoadGenClient_t *psClient)
+{
+	char pcRequest[256];
+	uint32_t ui32Idx;
+	LoadGenURL_t eURL;
+	int iLen = 0;
+
+	for(ui32Idx = 0; ui32Idx < psClient->ui32Outstanding; ui32Idx++)
+	{
+		eURL = psClient->eURL + ui32Idx;
+
+		/* The script appends a random query against caching */
+		iLen += snprintf(pcRequest + iLen, sizeof(pcRequest) - iLen, "GET %s", LoadGenURLs[eURL].pcPath);
+		if(eURL == LoadGenURLData)
+		{
+			iLen += snprintf(pcRequest + iLen, sizeof(pcRequest) - iLen, "?id%u", LoadGenQuery++);
+		}
+		iLen += snprintf(pcRequest + iLen, sizeof(pcRequest) - iLen, "%s\r\n\r\n",
+						 LoadGenKeepAlive ? " HTTP/1.1\r\nHost: 10.0.0.2" : " HTTP/1.0");
+	}
+
+	if(tcp_write(psClient->psPCB, pcRequest, (u16_t)iLen, TCP_WRITE_FLAG_COPY) != ERR_OK)
+	{
+		return(false);
+	}
+	tcp_output(psClient->psPCB);
+
+	psClient->eState = LoadGenReceiving;
+	return(true);
+}
+
+static err_t loadGenConnected(void *pvArg, struct tcp_pcb *psPCB, err_t eErr)
+{
+	LoadGenClient_t *psClient = pvArg;
+
+	if(!loadGenSend(psClient))
+	{
+		loadGenAbort(psClient, LoadGenFailConnect);
+		return(ERR_ABRT);
+	}
+
+	return(ERR_OK);
+}
+
+static void loadGenStart(LoadGenClient_t *psClient, uint64_t ui64Now)
+{
+	ip_addr_t sServer;
+
+	psClient->ui64Start = ui64Now;
+	psClient->ui32Bytes = 0;
+	psClient->ui32HeaderLen = 0;
+	psClient->ui32HeaderEnd = 0;
+	psClient->bHeaderDone = false;
+	psClient->ui32Outstanding = (LoadGenPipeline && (psClient->eURL == LoadGenURLIndex)) ? 2 : 1;
+
+	/* A kept connection takes the request right away */
+	if(psClient->psPCB)
+	{
+		if(!loadGenSend(psClient))
+		{
+			loadGenAbort(psClient, LoadGenFailReset);
+		}
+		return;
+	}
+
+	psClient->psPCB = tcp_new();
+	if(!psClient->psPCB)
+	{
+		loadGenFail(psClient, LoadGenFailPCB);
+		return;
+	}
+
+	tcp_arg(psClient->psPCB, psClient);
+	tcp_err(psClient->psPCB, loadGenError);
+	tcp_recv(psClient->psPCB, loadGenReceive);
+
+	psClient->eState = LoadGenConnecting;
+	LoadGenConnects++;
+	LOADGEN_SERVER(&sServer);
+	if(tcp_connect(psClient->psPCB, &sServer, LOADGEN_PORT, loadGenConnected) != ERR_OK)
+	{
+		loadGenAbort(psClient, LoadGenFailConnect);
+	}
+}
+
+/* High-water marks of the station's PCBs, open and in TIME_WAIT */
+static void loadGenPCBs(void)
+{
+	struct tcp_pcb *psPCB;
+	uint32_t ui32Open = 0, ui32TimeWait = 0;
+
+	for(psPCB = tcp_active_pcbs; psPCB; psPCB = psPCB->next)
+	{
+		ui32Open += (psPCB->local_port == LOADGEN_PORT);
+	}
+	for(psPCB = tcp_tw_pcbs; psPCB; psPCB = psPCB->next)
+	{
+		ui32TimeWait += (psPCB->local_port == LOADGEN_PORT);
+	}
+
+	if(ui32Open > LoadGenServerMax)
+	{
+		LoadGenServerMax = ui32Open;
+	}
+	if(ui32TimeWait > LoadGenTimeWaitMax)
+	{
+		LoadGenTimeWaitMax = ui32TimeWait;
+	}
+}
+
+//*****************************************************************************
+//
+// Report.
+//
+//*****************************************************************************
+static int loadGenCompare(const void *pvA, const void *pvB)
+{
+	uint32_t ui32A = *(const uint32_t *)pvA;
+	uint32_t ui32B = *(const uint32_t *)pvB;
+
+	return((ui32A > ui32B) - (ui32A < ui32B));
+}
+
+/* Nearest rank percentile of sorted samples */
+static uint32_t loadGenPercentile(const uint32_t *pui32Sorted, uint32_t ui32Count, uint32_t ui32Pct)
+{
+	uint32_t ui32Rank;
+
+	if(!ui32Count)
+	{
+		return(0);
+	}
+
+	ui32Rank = (ui32Count * ui32Pct + 99) / 100;
+	return(pui32Sorted[ui32Rank ? (ui32Rank - 1) : 0]);
+}
+
+static void loadGenLatency(const uint32_t *pui32Samples, uint32_t ui32Count)
+{
+	uint32_t *pui32Sorted = malloc((ui32Count ? ui32Count : 1) * sizeof(uint32_t));
+
+	memcpy(pui32Sorted, pui32Samples, ui32Count * sizeof(uint32_t));
+	qsort(pui32Sorted, ui32Count, sizeof(uint32_t), loadGenCompare);
+
+	fprintf(LoadGenOut, "{\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+			loadGenPercentile(pui32Sorted, ui32Count, 50),
+			loadGenPercentile(pui32Sorted, ui32Count, 90),
+			loadGenPercentile(pui32Sorted, ui32Count, 99),
+			ui32Count ? pui32Sorted[ui32Count - 1] : 0);
+
+	free(pui32Sorted);
+}
+
+static void loadGenReport(void)
+{
+	double dSeconds = (double)(LoadGenRunEnd - LoadGenRunStart) / 1e6;
+	uint32_t ui32OK = 0, ui32Failed = 0, ui32InFlight = 0;
+	uint64_t ui64Bytes = 0;
+	uint32_t *pui32All, ui32Idx, ui32Count;
+	uint64_t ui64Wakeups, ui64IdleUs;
+
+	for(ui32Idx = 0; ui32Idx < LOADGEN_NUM_URLS; ui32Idx++)
+	{
+		ui32OK += LoadGenURLs[ui32Idx].ui32OK;
+		ui32Failed += LoadGenURLs[ui32Idx].ui32Failed;
+		ui64Bytes += LoadGenURLs[ui32Idx].ui64Bytes;
+	}
+	for(ui32Idx = 0; ui32Idx < LoadGenNumClients; ui32Idx++)
+	{
+		ui32InFlight += (LoadGenClients[ui32Idx].eState == LoadGenConnecting) ||
+						(LoadGenClients[ui32Idx].eState == LoadGenReceiving);
+	}
+
+	fprintf(LoadGenOut, "{\"clients\":%u,\"durationMs\":%u,\"pollMs\":%u,\"timeoutMs\":%u,",
+			LoadGenNumClients, LoadGenDurationMs, LoadGenPollMs, LoadGenTimeoutMs);
+	fprintf(LoadGenOut, "\"requests\":%u,\"ok\":%u,\"failed\":%u,\"inFlight\":%u,"
+			"\"maxInFlight\":%u,", ui32OK + ui32Failed, ui32OK, ui32Failed, ui32InFlight,
+			LoadGenMaxInFlight);
+	fprintf(LoadGenOut, "\"requestsPerSec\":%.2f,\"bytesPerSec\":%.0f,",
+			ui32OK / dSeconds, ui64Bytes / dSeconds);
+
+	/* Connections and what they cost the station */
+	fprintf(LoadGenOut, "\"keepAlive\":%s,\"pipeline\":%s,\"connections\":%u,"
+			"\"connectionsPerSec\":%.2f,\"requestsPerConnection\":%.2f,",
+			LoadGenKeepAlive ? "true" : "false", LoadGenPipeline ? "true" : "false",
+			LoadGenConnects, LoadGenConnects / dSeconds,
+			LoadGenConnects ? ((double)(ui32OK + ui32Failed) / LoadGenConnects) : 0.0);
+	fprintf(LoadGenOut, "\"serverPCBs\":{\"openMax\":%u,\"timeWaitMax\":%u},",
+			LoadGenServerMax, LoadGenTimeWaitMax);
+	fprintf(LoadGenOut, "\"http\":{\"accepted\":%u,\"requests\":%u,\"reused\":%u,"
+			"\"pipelined\":%u,\"idleClosed\":%u,\"evicted\":%u,\"refused\":%u,\"openMax\":%u},",
+			HttpStats.ui32Accepted - LoadGenHttpStart.ui32Accepted,
+			HttpStats.ui32Requests - LoadGenHttpStart.ui32Requests,
+			HttpStats.ui32Reused - LoadGenHttpStart.ui32Reused,
+			HttpStats.ui32Pipelined - LoadGenHttpStart.ui32Pipelined,
+			HttpStats.ui32IdleClosed - LoadGenHttpStart.ui32IdleClosed,
+			HttpStats.ui32Evicted - LoadGenHttpStart.ui32Evicted,
+			HttpStats.ui32Refused - LoadGenHttpStart.ui32Refused, HttpStats.ui32MaxOpen);
+
+	/* Sleep of the firmware thread, the power proxy of the run */
+	simIdleStats(&ui64Wakeups, &ui64IdleUs);
+	fprintf(LoadGenOut, "\"wakeupsPerSec\":%.1f,\"sysTickPerSec\":%.1f,\"idleResidency\":%.4f,",
+			(ui64Wakeups - LoadGenIdleWakeups) / dSeconds,
+			(TickStats.ui32Wakeups - LoadGenSysTicks) / dSeconds,
+			(double)(ui64IdleUs - LoadGenIdleUs) / (double)(LoadGenRunEnd - LoadGenRunStart));
+
+	fprintf(LoadGenOut, "\"failures\":{");
+	for(ui32Idx = 0; ui32Idx < LOADGEN_NUM_FAILS; ui32Idx++)
+	{
+		fprintf(LoadGenOut, "%s\"%s\":%u", ui32Idx ? "," : "", LoadGenFailNames[ui32Idx],
+				LoadGenFails[ui32Idx]);
+	}
+
+	/* Latency over all pages, then per page */
+	pui32All = malloc((ui32OK ? ui32OK : 1) * sizeof(uint32_t));
+	for(ui32Idx = 0, ui32Count = 0; ui32Idx < LOADGEN_NUM_URLS; ui32Idx++)
+	{
+		memcpy(pui32All + ui32Count, LoadGenURLs[ui32Idx].pui32Latency,
+			   LoadGenURLs[ui32Idx].ui32OK * sizeof(uint32_t));
+		ui32Count += LoadGenURLs[ui32Idx].ui32OK;
+	}
+	fprintf(LoadGenOut, "},\"latencyUs\":");
+	loadGenLatency(pui32All, ui32Count);
+	free(pui32All);
+
+	fprintf(LoadGenOut, ",\"urls\":[");
+	for(ui32Idx = 0; ui32Idx < LOADGEN_NUM_URLS; ui32Idx++)
+	{
+		fprintf(LoadGenOut, "%s{\"path\":\"%s\",\"ok\":%u,\"failed\":%u,\"bytes\":%llu,"
+				"\"latencyUs\":", ui32Idx ? "," : "", LoadGenURLs[ui32Idx].pcPath,
+				LoadGenURLs[ui32Idx].ui32OK, LoadGenURLs[ui32Idx].ui32Failed,
+				(unsigned long long)LoadGenURLs[ui32Idx].ui64Bytes);
+		loadGenLatency(LoadGenURLs[ui32Idx].pui32Latency, LoadGenURLs[ui32Idx].ui32OK);
+		fprintf(LoadGenOut, "}");
+	}
+
+	/* Allocation failures of the run and high-water marks, by pool */
+	fprintf(LoadGenOut, "],\"pools\":{\"HEAP\":{\"err\":%u,\"max\":%u,\"avail\":%u}",
+			(uint32_t)(lwip_stats.mem.err - LoadGenHeapErr), (uint32_t)lwip_stats.mem.max,
+			(uint32_t)lwip_stats.mem.avail);
+	for(ui32Idx = 0; ui32Idx < MEMP_MAX; ui32Idx++)
+	{
+		fprintf(LoadGenOut, ",\"%s\":{\"err\":%u,\"max\":%u,\"avail\":%u}",
+				LoadGenPoolNames[ui32Idx],
+				(uint32_t)(lwip_stats.memp[ui32Idx].err - LoadGenPoolErr[ui32Idx]),
+				(uint32_t)lwip_stats.memp[ui32Idx].max, (uint32_t)lwip_stats.memp[ui32Idx].avail);
+	}
+	fprintf(LoadGenOut, "},\"fsOpenAllocFail\":%u}\n", FsOpenAllocFail - LoadGenFsErr);
+	fflush(LoadGenOut);
+}
+
+//*****************************************************************************
+//
+// Run, on the firmware thread between interrupts.
+//
+//*****************************************************************************
+static void loadGenIdle(void)
+{
+	LoadGenClient_t *psClient;
+	uint64_t ui64Now = simMicros();
+	uint32_t ui32Idx, ui32InFlight = 0;
+
+	if(!LoadGenRunStart)
+	{
+		/* The firmware is up and sleeping, start the dashboards */
+		LoadGenRunStart = ui64Now;
+		for(ui32Idx = 0; ui32Idx < MEMP_MAX; ui32Idx++)
+		{
+			LoadGenPoolErr[ui32Idx] = lwip_stats.memp[ui32Idx].err;
+		}
+		LoadGenHeapErr = lwip_stats.mem.err;
+		LoadGenFsErr = FsOpenAllocFail;
+		simIdleStats(&LoadGenIdleWakeups, &LoadGenIdleUs);
+		LoadGenSysTicks = TickStats.ui32Wakeups;
+		LoadGenHttpStart = HttpStats;
+
+		for(ui32Idx = 0; ui32Idx < LoadGenNumClients; ui32Idx++)
+		{
+			LoadGenClients[ui32Idx].ui64Next = ui64Now +
+				(uint64_t)LoadGenPollMs * 1000u * ui32Idx / LoadGenNumClients;
+		}
+	}
+
+	if(ui64Now - LoadGenRunStart >= (uint64_t)LoadGenDurationMs * 1000u)
+	{
+		LoadGenRunEnd = ui64Now;
+		loadGenReport();
+		exit(0);
+	}
+
+	for(ui32Idx = 0; ui32Idx < LoadGenNumClients; ui32Idx++)
+	{
+		psClient = &LoadGenClients[ui32Idx];
+		if((psClient->eState == LoadGenIdle) || (psClient->eState == LoadGenOpen))
+		{
+			if(ui64Now >= psClient->ui64Next)
+			{
+				loadGenStart(psClient, ui64Now);
+			}
+		}
+		else if(ui64Now - psClient->ui64Start >= (uint64_t)LoadGenTimeoutMs * 1000u)
+		{
+			loadGenAbort(psClient, LoadGenFailTimeout);
+		}
+
+		ui32InFlight += (psClient->eState == LoadGenConnecting) ||
+						(psClient->eState == LoadGenReceiving);
+	}
+	loadGenPCBs();
+
+	if(ui32InFlight > LoadGenMaxInFlight)
+	{
+		LoadGenMaxInFlight = ui32InFlight;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool bVerbose = false;
+	int iOpt;
+
+	LoadGenOut = stdout;
+	while((iOpt = getopt(argc, argv, "c:d:p:t:kPo:v")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 'c':
+				LoadGenNumClients = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				LoadGenDurationMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'p':
+				LoadGenPollMs = strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				LoadGenTimeoutMs = strtoul(optarg, NULL, 0);
+				break;
+			case 'k':
+				LoadGenKeepAlive = true;
+				break;
+			case 'P':
+				LoadGenKeepAlive = true;
+				LoadGenPipeline = true;
+				break;
+			case 'o':
+				LoadGenOut = fopen(optarg, "w");
+				if(!LoadGenOut)
+				{
+					perror(optarg);
+					return(1);
+				}
+				break;
+			case 'v':
+				bVerbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-c clients] [-d seconds] [-p poll_ms] "
+						"[-t timeout_ms] [-k] [-P] [-o file] [-v]\n", argv[0]);
+				return(1);
+		}
+	}
+	if(!LoadGenNumClients || (LoadGenNumClients > LOADGEN_MAX_CLIENTS) || !LoadGenDurationMs)
+	{
+		fprintf(stderr, "1 to %u clients and a duration of at least 1 s\n", LOADGEN_MAX_CLIENTS);
+		return(1);
+	}
+
+	simInit();
+	simUARTQuiet(!bVerbose);
+	simIdleHookSet(loadGenIdle);
+
+	return(firmwareMain());
+}
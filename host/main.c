@@ -0,0 +1,17 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Entry point of the host build. The firmware's main is compiled as
+ *  firmwareMain, it runs after the simulated board is up and never returns. */
+//*****************************************************************************
+extern int firmwareMain(void);
+
+int main(void)
+{
+	simInit();
+
+	return(firmwareMain());
+}
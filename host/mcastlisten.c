@@ -0,0 +1,236 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "mcastrx.h"
+
+//*****************************************************************************
+/*  Print the samples the station sends to its multicast group, one per
+ *  line:
+ *
+ *      <sequence> <uptime us> <unix ms> <temperature> <humidity> <pressure> <light>
+ *
+ *  and the received, lost, late and restart counts at the end. -n stops
+ *  after that many samples, -w gives up after that many seconds without
+ *  one. The host build sends the station's datagrams out on the loopback
+ *  interface, so
+ *
+ *      ./build/weather_station &
+ *      ./build/mcastlisten -i 127.0.0.1 -n 100
+ *
+ *  follows the simulated station. -t sends a scripted sequence over
+ *  loopback multicast instead, with a gap, a duplicate, a reordered
+ *  datagram, a restart and a foreign datagram, and checks what the receiver
+ *  made of it. */
+//*****************************************************************************
+
+#define MCASTLISTEN_TEST_IF		"127.0.0.1"
+
+/* Values of the scripted samples, the temperature below zero */
+static const int32_t McastListenValues[WS_PACKET_CHANNELS] = { -4250, 61500, 1013250, 350000 };
+
+static void mcastListenPrint(const WS_Packet_t *psPacket)
+{
+	uint32_t ui32Ch;
+
+	printf("%u %llu %llu", psPacket->ui32Sequence, (unsigned long long)psPacket->ui64TimeUs,
+		   (unsigned long long)psPacket->ui64UnixMs);
+	for(ui32Ch = 0; ui32Ch < psPacket->ui32Channels; ui32Ch++)
+	{
+		printf(" %s%d.%03d", (psPacket->pi32Values[ui32Ch] < 0) ? "-" : "",
+			   abs(psPacket->pi32Values[ui32Ch]) / 1000, abs(psPacket->pi32Values[ui32Ch]) % 1000);
+	}
+	printf("\n");
+}
+
+static void mcastListenReport(const WS_McastRx_t *psRx)
+{
+	fprintf(stderr, "received %u, lost %u, late %u, restarts %u, invalid %u\n",
+			psRx->ui32Received, psRx->ui32Lost, psRx->ui32Late, psRx->ui32Restarts,
+			psRx->ui32Invalid);
+}
+
+/* Send one scripted sample, ui32Channels may exceed what the receiver knows */
+static void mcastListenSend(int iSocket, const struct sockaddr_in *psDest, uint32_t ui32Sequence,
+							uint64_t ui64TimeUs, uint32_t ui32Channels)
+{
+	uint8_t pui8Data[WS_PACKET_MAX_LEN + 8];
+	WS_Packet_t sPacket;
+	uint32_t ui32Len;
+
+	sPacket.ui32Sequence = ui32Sequence;
+	sPacket.ui64TimeUs = ui64TimeUs;
+	sPacket.ui64UnixMs = 1700000000000ull + ui64TimeUs / 1000u;
+	sPacket.ui32Channels = WS_PACKET_CHANNELS;
+	memcpy(sPacket.pi32Values, McastListenValues, sizeof(McastListenValues));
+	ui32Len = packetEncode(pui8Data, sizeof(pui8Data), &sPacket);
+
+	/* Channels of a later version, zeros */
+	if(ui32Channels > WS_PACKET_CHANNELS)
+	{
+		memset(pui8Data + ui32Len, 0, 4 * (ui32Channels - WS_PACKET_CHANNELS));
+		ui32Len += 4 * (ui32Channels - WS_PACKET_CHANNELS);
+		pui8Data[3] = (uint8_t)ui32Channels;
+	}
+
+	sendto(iSocket, pui8Data, ui32Len, 0, (const struct sockaddr *)psDest, sizeof(*psDest));
+}
+
+static int mcastListenTest(const char *pcGroup, uint16_t ui16Port)
+{
+	/* Sequence numbers as sent and as they have to come out of the receiver.
+	 * 3 and 4 are lost, 5 is duplicated, 4 comes late, then the station
+	 * restarts and its sample 0 is lost. */
+	static const uint32_t pui32Sent[] = { 0, 1, 2, 5, 5, 4, 6, 1, 2 };
+	static const uint32_t pui32Expected[] = { 0, 1, 2, 5, 6, 1, 2 };
+	const uint32_t ui32Count = sizeof(pui32Sent) / sizeof(pui32Sent[0]);
+	const uint32_t ui32Expected = sizeof(pui32Expected) / sizeof(pui32Expected[0]);
+	struct sockaddr_in sDest;
+	struct in_addr sIf;
+	WS_McastRx_t sRx;
+	WS_Packet_t sPacket;
+	uint32_t ui32Idx, ui32Got = 0;
+	uint64_t ui64TimeUs;
+	bool bOk = true;
+	int iSocket;
+
+	if(!mcastRxOpen(&sRx, pcGroup, ui16Port, MCASTLISTEN_TEST_IF))
+	{
+		perror("join");
+		return(1);
+	}
+
+	inet_aton(MCASTLISTEN_TEST_IF, &sIf);
+	memset(&sDest, 0, sizeof(sDest));
+	sDest.sin_family = AF_INET;
+	inet_aton(pcGroup, &sDest.sin_addr);
+	sDest.sin_port = htons(ui16Port);
+	iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if((iSocket < 0) || setsockopt(iSocket, IPPROTO_IP, IP_MULTICAST_IF, &sIf, sizeof(sIf)))
+	{
+		perror("send socket");
+		return(1);
+	}
+
+	/* A sample every 50 ms, the first run from an uptime of an hour */
+	for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+	{
+		ui64TimeUs = ((ui32Idx < 7) ? 3600000000ull : 0) + pui32Sent[ui32Idx] * 50000u;
+		mcastListenSend(iSocket, &sDest, pui32Sent[ui32Idx], ui64TimeUs,
+						(ui32Idx == 1) ? (WS_PACKET_CHANNELS + 2) : WS_PACKET_CHANNELS);
+		if(ui32Idx == 4)
+		{
+			sendto(iSocket, "not a sample", 12, 0, (struct sockaddr *)&sDest, sizeof(sDest));
+		}
+	}
+	close(iSocket);
+
+	while(mcastRxNext(&sRx, &sPacket, 1000) == 1)
+	{
+		if((ui32Got >= ui32Expected) || (sPacket.ui32Sequence != pui32Expected[ui32Got]) ||
+		   (sPacket.ui32Channels != WS_PACKET_CHANNELS) ||
+		   memcmp(sPacket.pi32Values, McastListenValues, sizeof(McastListenValues)) ||
+		   (sPacket.ui64UnixMs != (1700000000000ull + sPacket.ui64TimeUs / 1000u)))
+		{
+			fprintf(stderr, "unexpected sample: ");
+			bOk = false;
+		}
+		mcastListenPrint(&sPacket);
+		ui32Got++;
+	}
+	mcastListenReport(&sRx);
+	mcastRxClose(&sRx);
+
+	/* 3 and 4 before the restart, 0 after it */
+	if(!bOk || (ui32Got != ui32Expected) || (sRx.ui32Lost != 2 + 1) || (sRx.ui32Late != 2) ||
+	   (sRx.ui32Restarts != 1) || (sRx.ui32Invalid != 1))
+	{
+		fprintf(stderr, "self-test failed, expected received %u, lost 3, late 2, restarts 1, "
+				"invalid 1\n", ui32Expected);
+		return(1);
+	}
+
+	fprintf(stderr, "self-test OK\n");
+	return(0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *pcGroup = WS_MCASTRX_GROUP;
+	const char *pcInterface = NULL;
+	uint16_t ui16Port = WS_MCASTRX_PORT;
+	uint32_t ui32Count = 0, ui32WaitS = 0;
+	bool bTest = false;
+	WS_McastRx_t sRx;
+	WS_Packet_t sPacket;
+	int iOpt, iResult;
+
+	while((iOpt = getopt(argc, argv, "g:p:i:n:w:t")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 'g':
+				pcGroup = optarg;
+				break;
+			case 'p':
+				ui16Port = (uint16_t)strtoul(optarg, NULL, 0);
+				break;
+			case 'i':
+				pcInterface = optarg;
+				break;
+			case 'n':
+				ui32Count = strtoul(optarg, NULL, 0);
+				break;
+			case 'w':
+				ui32WaitS = strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				bTest = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-g group] [-p port] [-i interface_address] "
+						"[-n samples] [-w seconds] [-t]\n", argv[0]);
+				return(1);
+		}
+	}
+
+	if(bTest)
+	{
+		return(mcastListenTest(pcGroup, ui16Port));
+	}
+
+	if(!mcastRxOpen(&sRx, pcGroup, ui16Port, pcInterface))
+	{
+		perror(pcGroup);
+		return(1);
+	}
+
+	for(;;)
+	{
+		iResult = mcastRxNext(&sRx, &sPacket, ui32WaitS ? (int32_t)(ui32WaitS * 1000u) : -1);
+		if(iResult != 1)
+		{
+			if(iResult < 0)
+			{
+				perror("receive");
+			}
+			break;
+		}
+		mcastListenPrint(&sPacket);
+		fflush(stdout);
+		if(ui32Count && (sRx.ui32Received == ui32Count))
+		{
+			break;
+		}
+	}
+	mcastListenReport(&sRx);
+	mcastRxClose(&sRx);
+
+	return((iResult == 1) ? 0 : 1);
+}
@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "mcastrx.h"
+
+bool mcastRxOpen(WS_McastRx_t *psRx, const char *pcGroup, uint16_t ui16Port,
+				 const char *pcInterface)
+{
+	struct sockaddr_in sAddr;
+	struct ip_mreq sReq;
+	int iReuse = 1;
+
+	memset(psRx, 0, sizeof(*psRx));
+	memset(&sReq, 0, sizeof(sReq));
+	if(!inet_aton(pcGroup, &sReq.imr_multiaddr) || !IN_MULTICAST(ntohl(sReq.imr_multiaddr.s_addr)) ||
+	   (pcInterface && !inet_aton(pcInterface, &sReq.imr_interface)))
+	{
+		errno = EINVAL;
+		return(false);
+	}
+	if(!pcInterface)
+	{
+		sReq.imr_interface.s_addr = htonl(INADDR_ANY);
+	}
+
+	psRx->iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if(psRx->iSocket < 0)
+	{
+		return(false);
+	}
+
+	/* Bound to the group, so datagrams to other groups on the same port stay
+	 * out; several receivers may share the port */
+	memset(&sAddr, 0, sizeof(sAddr));
+	sAddr.sin_family = AF_INET;
+	sAddr.sin_addr = sReq.imr_multiaddr;
+	sAddr.sin_port = htons(ui16Port);
+	if(setsockopt(psRx->iSocket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse)) ||
+	   bind(psRx->iSocket, (struct sockaddr *)&sAddr, sizeof(sAddr)) ||
+	   setsockopt(psRx->iSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &sReq, sizeof(sReq)))
+	{
+		mcastRxClose(psRx);
+		return(false);
+	}
+
+	return(true);
+}
+
+bool mcastRxTrack(WS_McastRx_t *psRx, const WS_Packet_t *psPacket)
+{
+	int32_t i32Ahead = (int32_t)(psPacket->ui32Sequence - psRx->ui32Next);
+
+	if(!psRx->bStarted)
+	{
+		i32Ahead = 0;
+	}
+	else if((psPacket->ui64TimeUs + WS_MCASTRX_REORDER_US) < psRx->ui64LastUs)
+	{
+		/* The station started over, its sequence with it */
+		psRx->ui32Restarts++;
+		i32Ahead = (int32_t)psPacket->ui32Sequence;
+	}
+	else if(i32Ahead < 0)
+	{
+		psRx->ui32Late++;
+		return(false);
+	}
+
+	psRx->ui32Lost += (uint32_t)i32Ahead;
+	psRx->ui32Next = psPacket->ui32Sequence + 1;
+	psRx->ui64LastUs = psPacket->ui64TimeUs;
+	psRx->ui32Received++;
+	psRx->bStarted = true;
+
+	return(true);
+}
+
+int mcastRxNext(WS_McastRx_t *psRx, WS_Packet_t *psPacket, int32_t i32TimeoutMs)
+{
+	uint8_t pui8Data[512];
+	struct pollfd sPoll;
+	ssize_t iLen;
+	int iReady;
+
+	sPoll.fd = psRx->iSocket;
+	sPoll.events = POLLIN;
+
+	for(;;)
+	{
+		iReady = poll(&sPoll, 1, i32TimeoutMs);
+		if(iReady <= 0)
+		{
+			return(((iReady < 0) && (errno != EINTR)) ? -1 : 0);
+		}
+
+		iLen = recv(psRx->iSocket, pui8Data, sizeof(pui8Data), 0);
+		if(iLen < 0)
+		{
+			return(-1);
+		}
+
+		if(!packetDecode(pui8Data, (uint32_t)iLen, psPacket))
+		{
+			psRx->ui32Invalid++;
+		}
+		else if(mcastRxTrack(psRx, psPacket))
+		{
+			return(1);
+		}
+	}
+}
+
+void mcastRxClose(WS_McastRx_t *psRx)
+{
+	if(psRx->iSocket >= 0)
+	{
+		close(psRx->iSocket);
+	}
+	psRx->iSocket = -1;
+}
@@ -0,0 +1,57 @@
+#ifndef HOST_MCASTRX_H_
+#define HOST_MCASTRX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "weather_station/ws_packet.h"
+
+//*****************************************************************************
+/*  Receiver of the station's multicast samples, for Linux hosts.
+ *
+ *  mcastRxOpen joins the group on one interface; mcastRxNext returns the
+ *  samples in the order the station published them and keeps the loss
+ *  count from the sequence numbers. A sample older than the last one
+ *  returned (reordered or duplicated on the way) is counted as late and not
+ *  returned. An uptime more than WS_MCASTRX_REORDER_US before the last one
+ *  is a restart of the station, the samples it published before the first
+ *  one received count as lost.
+ *
+ *  Needs only libc and ws_packet.c, so it can be copied into any program
+ *  that wants the samples. */
+//*****************************************************************************
+
+#define WS_MCASTRX_GROUP		"239.255.87.83"		/* WS_MCAST_GROUP */
+#define WS_MCASTRX_PORT			47883				/* WS_MCAST_PORT */
+
+/* Uptime going back further than this is a restart, less is reordering */
+#define WS_MCASTRX_REORDER_US	1000000u
+
+typedef struct {
+	int iSocket;
+	bool bStarted;				/* A sample was returned */
+	uint32_t ui32Next;			/* Sequence number expected next */
+	uint64_t ui64LastUs;		/* Uptime of the last sample returned */
+	uint32_t ui32Received;		/* Samples returned */
+	uint32_t ui32Lost;			/* Sequence numbers skipped */
+	uint32_t ui32Late;			/* Reordered or duplicated, dropped */
+	uint32_t ui32Restarts;		/* Station restarts seen */
+	uint32_t ui32Invalid;		/* Datagrams that were not samples */
+}WS_McastRx_t;
+
+/* Join pcGroup on the interface with address pcInterface (NULL for the
+ * default one) and bind ui16Port. False, with errno set, on failure. */
+bool mcastRxOpen(WS_McastRx_t *psRx, const char *pcGroup, uint16_t ui16Port,
+				 const char *pcInterface);
+
+/* Wait up to i32TimeoutMs (-1 for ever) for the next sample. 1 if one was
+ * returned, 0 on time out, -1 on error. */
+int mcastRxNext(WS_McastRx_t *psRx, WS_Packet_t *psPacket, int32_t i32TimeoutMs);
+
+/* Account a decoded sample, true if it is to be returned. mcastRxNext calls
+ * it, it is exported for receivers with their own socket. */
+bool mcastRxTrack(WS_McastRx_t *psRx, const WS_Packet_t *psPacket);
+
+void mcastRxClose(WS_McastRx_t *psRx);
+
+#endif /* HOST_MCASTRX_H_ */
@@ -0,0 +1,590 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "utils/lwiplib.h"
+#include "lwip/tcp.h"
+
+#include "weather_station/ws_mqtt.h"
+#include "weather_station/ws_probe.h"
+#include "weather_station/ws_tick.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Benchmark of the MQTT publisher of the host build.
+ *
+ *  The simulated link only reaches the station's own address, so the broker
+ *  runs inside the firmware process as well: a minimal MQTT 3.1.1 broker on
+ *  lwIP raw TCP, port 1883 of 10.0.0.2, that the station is configured to
+ *  publish to. It accepts one client, answers CONNECT, PINGREQ and, at QoS
+ *  1, PUBLISH, and checks every line of every PUBLISH.
+ *
+ *  The link can be made slow or unreliable on the broker's side:
+ *
+ *      -l <ms>     delay every PUBACK
+ *      -r <B/s>    open the receive window at that rate only, the station's
+ *                  send queue backs up as it would behind a slow uplink
+ *      -x <s>      reset the connection that often
+ *
+ *  The results are printed as one JSON object when the run ends: PUBLISHes
+ *  and samples per second, the batch sizes, the age of the samples when they
+ *  reached the broker, what the station counted and the time it spent in
+ *  its MQTT code per PUBLISH (the mqtt probe):
+ *
+ *      ./build/mqttbench -d 30 -o result.json
+ *      ./build/mqttbench -d 30 -r 2000 -l 200 -x 10
+ *
+ *  -d duration in s, -q QoS of the station, -o output file (stdout by
+ *  default), -v keeps the firmware's UART output. */
+//*****************************************************************************
+
+#define MQTTBENCH_PORT			1883
+
+/* Address of the station on the simulated link, the broker's too */
+#define MQTTBENCH_BROKER(a)		IP4_ADDR((a), 10, 0, 0, 2)
+
+/* Longest packet taken from the station */
+#define MQTTBENCH_PACKET_LEN	1024
+
+/* PUBACKs held back by -l */
+#define MQTTBENCH_PUBACKS		64
+
+#define MQTTBENCH_TOPICS		4
+
+typedef struct {
+	uint16_t ui16Id;
+	uint64_t ui64Due;
+}MqttBenchPuback_t;
+
+static const char * const MqttBenchTopics[MQTTBENCH_TOPICS] =
+{
+	WS_MQTT_TOPIC_PREFIX "temperature",
+	WS_MQTT_TOPIC_PREFIX "humidity",
+	WS_MQTT_TOPIC_PREFIX "pressure",
+	WS_MQTT_TOPIC_PREFIX "light"
+};
+
+static uint32_t MqttBenchDurationMs = 10000;
+static uint8_t MqttBenchQoS = WS_MQTT_QOS;
+static uint32_t MqttBenchPubackMs;
+static uint32_t MqttBenchRate;			/* Receive window, B/s, 0 unlimited */
+static uint32_t MqttBenchDropMs;
+static FILE *MqttBenchOut;
+
+/* The one client connection and the packet being received on it */
+static struct tcp_pcb *MqttBenchPCB;
+static uint8_t MqttBenchPacket[MQTTBENCH_PACKET_LEN];
+static uint32_t MqttBenchGot;
+static uint32_t MqttBenchUnacked;		/* Received, window not opened yet */
+static uint64_t MqttBenchCredit;		/* Receive window earned, B * 1e6 */
+static uint64_t MqttBenchLastUs;
+static uint64_t MqttBenchNextDrop;
+static MqttBenchPuback_t MqttBenchPubacks[MQTTBENCH_PUBACKS];
+static uint32_t MqttBenchPubackHead;
+static uint32_t MqttBenchPubackCount;
+
+/* Run */
+static uint64_t MqttBenchRunStart;
+static uint64_t MqttBenchRunEnd;
+static WS_MqttStats_t MqttBenchStart;
+static WS_ProbeStats_t MqttBenchProbeStart;
+
+/* What the broker saw */
+static uint32_t MqttBenchAccepted;
+static uint32_t MqttBenchConnects;
+static uint32_t MqttBenchDrops;
+static uint32_t MqttBenchPublishes;
+static uint32_t MqttBenchDuplicates;	/* PUBLISHes with DUP set */
+static uint32_t MqttBenchInvalid;
+static uint32_t MqttBenchPings;
+static uint64_t MqttBenchBytes;
+static uint32_t MqttBenchLines[MQTTBENCH_TOPICS];
+static uint32_t MqttBenchMaxBatch;
+static uint64_t MqttBenchAgeSumMs;
+static uint32_t MqttBenchAgeMaxMs;
+
+extern int firmwareMain(void);
+
+//*****************************************************************************
+//
+// Broker.
+//
+//*****************************************************************************
+static uint64_t mqttBenchUnixMs(void)
+{
+	struct timeval sNow;
+
+	gettimeofday(&sNow, NULL);
+	return((uint64_t)sNow.tv_sec * 1000u + sNow.tv_usec / 1000u);
+}
+
+static void mqttBenchWrite(const uint8_t *pui8Data, uint32_t ui32Len)
+{
+	if(MqttBenchPCB && (tcp_write(MqttBenchPCB, pui8Data, (u16_t)ui32Len, TCP_WRITE_FLAG_COPY) == ERR_OK))
+	{
+		tcp_output(MqttBenchPCB);
+	}
+}
+
+static void mqttBenchPuback(uint16_t ui16Id)
+{
+	uint8_t pui8Puback[4] = { 0x40, 2, (uint8_t)(ui16Id >> 8), (uint8_t)ui16Id };
+
+	mqttBenchWrite(pui8Puback, sizeof(pui8Puback));
+}
+
+/* Close the client connection, ERR_ABRT if it had to be aborted */
+static err_t mqttBenchClose(bool bAbort)
+{
+	struct tcp_pcb *psPCB = MqttBenchPCB;
+
+	MqttBenchPCB = NULL;
+	MqttBenchPubackCount = 0;
+	if(!psPCB)
+	{
+		return(ERR_OK);
+	}
+
+	tcp_arg(psPCB, NULL);
+	tcp_recv(psPCB, NULL);
+	tcp_err(psPCB, NULL);
+	if(bAbort || (tcp_close(psPCB) != ERR_OK))
+	{
+		tcp_abort(psPCB);
+		return(ERR_ABRT);
+	}
+
+	return(ERR_OK);
+}
+
+/* Check the lines of a PUBLISH, "<unix ms> <value>" or "+<uptime ms>
+ * <value>", and account them */
+static void mqttBenchLines(uint32_t ui32Topic, const char *pcData, uint32_t ui32Len)
+{
+	uint64_t ui64UnixMs = mqttBenchUnixMs(), ui64UptimeMs = tickNowUs() / 1000u;
+	uint32_t ui32Lines = 0, ui32Age;
+	uint64_t ui64TimeMs;
+	const char *pcEnd = pcData + ui32Len;
+	char *pcNext;
+	bool bUptime;
+
+	while(pcData < pcEnd)
+	{
+		bUptime = (*pcData == '+');
+		ui64TimeMs = strtoull(pcData + bUptime, &pcNext, 10);
+		if((pcNext == pcData + bUptime) || (*pcNext != ' '))
+		{
+			break;
+		}
+		strtod(pcNext + 1, &pcNext);
+		if((pcNext >= pcEnd) || (*pcNext != '\n') || (pcNext[-1] == ' '))
+		{
+			break;
+		}
+		pcData = pcNext + 1;
+
+		ui32Age = (uint32_t)((bUptime ? ui64UptimeMs : ui64UnixMs) - ui64TimeMs);
+		MqttBenchAgeSumMs += ui32Age;
+		if(ui32Age > MqttBenchAgeMaxMs)
+		{
+			MqttBenchAgeMaxMs = ui32Age;
+		}
+		ui32Lines++;
+	}
+
+	if((pcData != pcEnd) || !ui32Lines)
+	{
+		MqttBenchInvalid++;
+	}
+
+	MqttBenchLines[ui32Topic] += ui32Lines;
+	if(ui32Lines > MqttBenchMaxBatch)
+	{
+		MqttBenchMaxBatch = ui32Lines;
+	}
+}
+
+static void mqttBenchPublish(uint8_t ui8Flags, const uint8_t *pui8Body, uint32_t ui32Len)
+{
+	uint32_t ui32TopicLen, ui32Topic, ui32Pos;
+	uint8_t ui8QoS = (ui8Flags >> 1) & 3;
+	uint16_t ui16Id = 0;
+
+	ui32TopicLen = (ui32Len >= 2) ? ((pui8Body[0] << 8) | pui8Body[1]) : UINT32_MAX;
+	ui32Pos = 2 + ui32TopicLen + (ui8QoS ? 2 : 0);
+	if((ui32Len < 2) || (ui32Pos > ui32Len) || (ui8QoS > 1))
+	{
+		MqttBenchInvalid++;
+		return;
+	}
+	if(ui8QoS)
+	{
+		ui16Id = (pui8Body[ui32Pos - 2] << 8) | pui8Body[ui32Pos - 1];
+	}
+
+	MqttBenchPublishes++;
+	MqttBenchDuplicates += (ui8Flags & 0x08) != 0;
+	for(ui32Topic = 0; ui32Topic < MQTTBENCH_TOPICS; ui32Topic++)
+	{
+		if((strlen(MqttBenchTopics[ui32Topic]) == ui32TopicLen) &&
+		   !memcmp(pui8Body + 2, MqttBenchTopics[ui32Topic], ui32TopicLen))
+		{
+			mqttBenchLines(ui32Topic, (const char *)pui8Body + ui32Pos, ui32Len - ui32Pos);
+			break;
+		}
+	}
+	if(ui32Topic == MQTTBENCH_TOPICS)
+	{
+		MqttBenchInvalid++;
+	}
+
+	if(!ui8QoS)
+	{
+		return;
+	}
+	if(!MqttBenchPubackMs || (MqttBenchPubackCount == MQTTBENCH_PUBACKS))
+	{
+		mqttBenchPuback(ui16Id);
+		return;
+	}
+	MqttBenchPubacks[(MqttBenchPubackHead + MqttBenchPubackCount) % MQTTBENCH_PUBACKS] =
+		(MqttBenchPuback_t){ ui16Id, simMicros() + MqttBenchPubackMs * 1000ull };
+	MqttBenchPubackCount++;
+}
+
+/* Handle the packets complete in MqttBenchPacket, false on a protocol error */
+static bool mqttBenchPackets(void)
+{
+	static const uint8_t pui8Connack[4] = { 0x20, 2, 0, 0 };
+	static const uint8_t pui8Pingresp[2] = { 0xD0, 0 };
+	uint32_t ui32Pos, ui32Len, ui32Shift, ui32Total;
+	uint8_t ui8Type;
+
+	for(;;)
+	{
+		/* Fixed header: type and a remaining length of up to four bytes */
+		for(ui32Pos = 1, ui32Len = 0, ui32Shift = 0; ui32Pos < MqttBenchGot; ui32Pos++, ui32Shift += 7)
+		{
+			ui32Len |= (uint32_t)(MqttBenchPacket[ui32Pos] & 0x7F) << ui32Shift;
+			if(!(MqttBenchPacket[ui32Pos] & 0x80))
+			{
+				break;
+			}
+		}
+		if((ui32Pos >= MqttBenchGot) || (ui32Shift > 21))
+		{
+			return(ui32Shift <= 21);
+		}
+		ui32Pos++;
+		ui32Total = ui32Pos + ui32Len;
+		if(ui32Total > MQTTBENCH_PACKET_LEN)
+		{
+			return(false);
+		}
+		if(ui32Total > MqttBenchGot)
+		{
+			return(true);
+		}
+
+		ui8Type = MqttBenchPacket[0];
+		switch(ui8Type & 0xF0)
+		{
+			case 0x10:
+				/* CONNECT, "MQTT" level 4 */
+				if((ui32Len < 10) || memcmp(MqttBenchPacket + ui32Pos, "\0\4MQTT\4", 7))
+				{
+					return(false);
+				}
+				MqttBenchConnects++;
+				mqttBenchWrite(pui8Connack, sizeof(pui8Connack));
+				break;
+			case 0x30:
+				mqttBenchPublish(ui8Type & 0x0F, MqttBenchPacket + ui32Pos, ui32Len);
+				break;
+			case 0xC0:
+				MqttBenchPings++;
+				mqttBenchWrite(pui8Pingresp, sizeof(pui8Pingresp));
+				break;
+			default:
+				return(false);
+		}
+
+		MqttBenchGot -= ui32Total;
+		memmove(MqttBenchPacket, MqttBenchPacket + ui32Total, MqttBenchGot);
+	}
+}
+
+static err_t mqttBenchReceive(void *pvArg, struct tcp_pcb *psPCB, struct pbuf *p, err_t eErr)
+{
+	uint32_t ui32Copy, ui32Offset = 0;
+
+	if(!p)
+	{
+		return(mqttBenchClose(false));
+	}
+
+	MqttBenchBytes += p->tot_len;
+	if(MqttBenchRate)
+	{
+		MqttBenchUnacked += p->tot_len;
+	}
+	else
+	{
+		tcp_recved(psPCB, p->tot_len);
+	}
+
+	while(ui32Offset < p->tot_len)
+	{
+		ui32Copy = p->tot_len - ui32Offset;
+		if(ui32Copy > (MQTTBENCH_PACKET_LEN - MqttBenchGot))
+		{
+			ui32Copy = MQTTBENCH_PACKET_LEN - MqttBenchGot;
+		}
+		pbuf_copy_partial(p, MqttBenchPacket + MqttBenchGot, (u16_t)ui32Copy, (u16_t)ui32Offset);
+		MqttBenchGot += ui32Copy;
+		ui32Offset += ui32Copy;
+
+		if(!mqttBenchPackets())
+		{
+			pbuf_free(p);
+			MqttBenchInvalid++;
+			return(mqttBenchClose(true));
+		}
+	}
+	pbuf_free(p);
+
+	return(ERR_OK);
+}
+
+static void mqttBenchError(void *pvArg, err_t eErr)
+{
+	/* The PCB is already freed */
+	MqttBenchPCB = NULL;
+	MqttBenchPubackCount = 0;
+}
+
+static err_t mqttBenchAccept(void *pvArg, struct tcp_pcb *psPCB, err_t eErr)
+{
+	struct tcp_pcb *psListen = pvArg;
+
+	tcp_accepted(psListen);
+
+	/* A reconnect replaces what is left of the old connection */
+	mqttBenchClose(true);
+	MqttBenchAccepted++;
+	MqttBenchPCB = psPCB;
+	MqttBenchGot = 0;
+	MqttBenchUnacked = 0;
+	MqttBenchCredit = 0;
+	tcp_nagle_disable(psPCB);
+	tcp_recv(psPCB, mqttBenchReceive);
+	tcp_err(psPCB, mqttBenchError);
+
+	return(ERR_OK);
+}
+
+static void mqttBenchListen(void)
+{
+	struct tcp_pcb *psPCB = tcp_new();
+
+	if(!psPCB || (tcp_bind(psPCB, IP_ADDR_ANY, MQTTBENCH_PORT) != ERR_OK) ||
+	   !(psPCB = tcp_listen(psPCB)))
+	{
+		fprintf(stderr, "mqttbench: no listening PCB\n");
+		exit(1);
+	}
+	tcp_arg(psPCB, psPCB);
+	tcp_accept(psPCB, mqttBenchAccept);
+}
+
+//*****************************************************************************
+//
+// Report.
+//
+//*****************************************************************************
+static void mqttBenchReport(void)
+{
+	double dSeconds = (double)(MqttBenchRunEnd - MqttBenchRunStart) / 1e6;
+	const WS_ProbeStats_t *psProbe = &ProbeStats[WS_ProbeMqtt];
+	uint32_t ui32Publishes = MqttStats.ui32Publishes - MqttBenchStart.ui32Publishes;
+	uint32_t ui32Calls = psProbe->ui32Count - MqttBenchProbeStart.ui32Count;
+	uint64_t ui64CostNs = psProbe->ui64Sum - MqttBenchProbeStart.ui64Sum;
+	uint32_t ui32Idx, ui32Lines = 0;
+
+	for(ui32Idx = 0; ui32Idx < MQTTBENCH_TOPICS; ui32Idx++)
+	{
+		ui32Lines += MqttBenchLines[ui32Idx];
+	}
+
+	fprintf(MqttBenchOut, "{\"durationMs\":%u,\"qos\":%u,\"pubackDelayMs\":%u,"
+			"\"receiveRate\":%u,\"dropPeriodMs\":%u,", MqttBenchDurationMs, MqttBenchQoS,
+			MqttBenchPubackMs, MqttBenchRate, MqttBenchDropMs);
+
+	/* The broker's side */
+	fprintf(MqttBenchOut, "\"publishes\":%u,\"publishesPerSec\":%.2f,\"samples\":%u,"
+			"\"samplesPerSec\":%.2f,\"bytesPerSec\":%.0f,", MqttBenchPublishes,
+			MqttBenchPublishes / dSeconds, ui32Lines, ui32Lines / dSeconds,
+			MqttBenchBytes / dSeconds);
+	fprintf(MqttBenchOut, "\"batch\":{\"mean\":%.2f,\"max\":%u},"
+			"\"sampleAgeMs\":{\"mean\":%.1f,\"max\":%u},",
+			MqttBenchPublishes ? ((double)ui32Lines / MqttBenchPublishes) : 0.0, MqttBenchMaxBatch,
+			ui32Lines ? ((double)MqttBenchAgeSumMs / ui32Lines) : 0.0, MqttBenchAgeMaxMs);
+	fprintf(MqttBenchOut, "\"duplicates\":%u,\"invalid\":%u,\"pings\":%u,\"accepted\":%u,"
+			"\"connects\":%u,\"drops\":%u,\"topics\":{", MqttBenchDuplicates, MqttBenchInvalid,
+			MqttBenchPings, MqttBenchAccepted, MqttBenchConnects, MqttBenchDrops);
+	for(ui32Idx = 0; ui32Idx < MQTTBENCH_TOPICS; ui32Idx++)
+	{
+		fprintf(MqttBenchOut, "%s\"%s\":%u", ui32Idx ? "," : "", MqttBenchTopics[ui32Idx],
+				MqttBenchLines[ui32Idx]);
+	}
+
+	/* The station's side */
+	fprintf(MqttBenchOut, "},\"station\":{\"connects\":%u,\"failures\":%u,\"publishes\":%u,"
+			"\"samples\":%u,\"acked\":%u,\"resent\":%u,\"overrun\":%u,\"maxBatch\":%u,"
+			"\"connected\":%s},",
+			MqttStats.ui32Connects - MqttBenchStart.ui32Connects,
+			MqttStats.ui32Failures - MqttBenchStart.ui32Failures, ui32Publishes,
+			MqttStats.ui32Samples - MqttBenchStart.ui32Samples,
+			MqttStats.ui32Acked - MqttBenchStart.ui32Acked,
+			MqttStats.ui32Resent - MqttBenchStart.ui32Resent,
+			MqttStats.ui32Overrun - MqttBenchStart.ui32Overrun, MqttStats.ui32MaxBatch,
+			MqttStats.bConnected ? "true" : "false");
+
+	/* Time in the publisher, host ns, so relative only */
+	fprintf(MqttBenchOut, "\"cost\":{\"calls\":%u,\"ns\":%llu,\"nsPerCall\":%.0f,"
+			"\"nsPerPublish\":%.0f,\"maxNs\":%u}}\n", ui32Calls, (unsigned long long)ui64CostNs,
+			ui32Calls ? ((double)ui64CostNs / ui32Calls) : 0.0,
+			ui32Publishes ? ((double)ui64CostNs / ui32Publishes) : 0.0, psProbe->ui32Max);
+	fflush(MqttBenchOut);
+}
+
+//*****************************************************************************
+//
+// Run, on the firmware thread between interrupts.
+//
+//*****************************************************************************
+static void mqttBenchIdle(void)
+{
+	uint64_t ui64Now = simMicros();
+	uint32_t ui32Open;
+
+	if(!MqttBenchRunStart)
+	{
+		/* The firmware is up and sleeping */
+		MqttBenchRunStart = ui64Now;
+		MqttBenchLastUs = ui64Now;
+		MqttBenchNextDrop = ui64Now + MqttBenchDropMs * 1000ull;
+		MqttBenchStart = MqttStats;
+		MqttBenchProbeStart = ProbeStats[WS_ProbeMqtt];
+		mqttBenchListen();
+	}
+
+	if(ui64Now - MqttBenchRunStart >= (uint64_t)MqttBenchDurationMs * 1000u)
+	{
+		MqttBenchRunEnd = ui64Now;
+		mqttBenchReport();
+		exit(0);
+	}
+
+	/* PUBACKs that are due */
+	while(MqttBenchPubackCount && (MqttBenchPubacks[MqttBenchPubackHead].ui64Due <= ui64Now))
+	{
+		mqttBenchPuback(MqttBenchPubacks[MqttBenchPubackHead].ui16Id);
+		MqttBenchPubackHead = (MqttBenchPubackHead + 1) % MQTTBENCH_PUBACKS;
+		MqttBenchPubackCount--;
+	}
+
+	/* Open the window by what the rate allows since the last time */
+	if(MqttBenchRate)
+	{
+		MqttBenchCredit += (ui64Now - MqttBenchLastUs) * MqttBenchRate;
+		ui32Open = (uint32_t)((MqttBenchCredit / 1000000u < MqttBenchUnacked) ?
+							  (MqttBenchCredit / 1000000u) : MqttBenchUnacked);
+		if(ui32Open && MqttBenchPCB)
+		{
+			tcp_recved(MqttBenchPCB, (u16_t)ui32Open);
+			MqttBenchUnacked -= ui32Open;
+			MqttBenchCredit -= ui32Open * 1000000ull;
+		}
+		/* No credit piles up while the window is open anyway */
+		if(!MqttBenchUnacked)
+		{
+			MqttBenchCredit = 0;
+		}
+	}
+	MqttBenchLastUs = ui64Now;
+
+	if(MqttBenchDropMs && (ui64Now >= MqttBenchNextDrop))
+	{
+		MqttBenchNextDrop = ui64Now + MqttBenchDropMs * 1000ull;
+		if(MqttBenchPCB)
+		{
+			MqttBenchDrops++;
+			mqttBenchClose(true);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	ip_addr_t sBroker;
+	bool bVerbose = false;
+	int iOpt;
+
+	MqttBenchOut = stdout;
+	while((iOpt = getopt(argc, argv, "d:q:l:r:x:o:v")) != -1)
+	{
+		switch(iOpt)
+		{
+			case 'd':
+				MqttBenchDurationMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'q':
+				MqttBenchQoS = (uint8_t)strtoul(optarg, NULL, 0);
+				break;
+			case 'l':
+				MqttBenchPubackMs = strtoul(optarg, NULL, 0);
+				break;
+			case 'r':
+				MqttBenchRate = strtoul(optarg, NULL, 0);
+				break;
+			case 'x':
+				MqttBenchDropMs = strtoul(optarg, NULL, 0) * 1000u;
+				break;
+			case 'o':
+				MqttBenchOut = fopen(optarg, "w");
+				if(!MqttBenchOut)
+				{
+					perror(optarg);
+					return(1);
+				}
+				break;
+			case 'v':
+				bVerbose = true;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-d seconds] [-q qos] [-l puback_ms] [-r bytes_per_s] "
+						"[-x drop_s] [-o file] [-v]\n", argv[0]);
+				return(1);
+		}
+	}
+	if(!MqttBenchDurationMs || (MqttBenchQoS > 1))
+	{
+		fprintf(stderr, "a duration of at least 1 s and QoS 0 or 1\n");
+		return(1);
+	}
+
+	MQTTBENCH_BROKER(&sBroker);
+	mqttConfigure(sBroker.addr, MQTTBENCH_PORT, MqttBenchQoS);
+
+	simInit();
+	simUARTQuiet(!bVerbose);
+	simIdleHookSet(mqttBenchIdle);
+
+	return(firmwareMain());
+}
@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "weather_station/ws_rollup.h"
+
+//*****************************************************************************
+/*  Check and benchmark of the cascading rollups (weather_station/ws_rollup.h).
+ *
+ *  A synthetic day and more of sample sets at the firmware's 20 per second,
+ *  with temperatures below zero and a few gaps, is fed to rollupAddSample
+ *  and timed. Then every closed bucket of every level is recomputed from the
+ *  raw samples of its period: count, min and max have to match exactly, the
+ *  mean to the rounding rollupMean does. The buckets of a level have to be
+ *  aligned to its period and in order. The exit status is 1 on a mismatch.
+ *
+ *      ./build/rollupbench [hours] */
+//*****************************************************************************
+
+#define ROLLUPBENCH_RATE_HZ		20
+
+typedef struct {
+	uint32_t ui32TimeS;
+	int32_t pi32Values[WS_ROLLUP_CHANNELS];
+}RollupBenchSample_t;
+
+static RollupBenchSample_t *RollupBenchSamples;
+static uint32_t RollupBenchCount;
+
+static uint64_t rollupBenchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+/* Daily swings in thousandths, with noise. A sensor stall drops a few
+ * minutes every five hours. */
+static void rollupBenchSynthesize(uint32_t ui32Hours)
+{
+	uint32_t ui32Second, ui32Tick;
+	double dDay;
+
+	RollupBenchSamples = malloc((size_t)ui32Hours * 3600 * ROLLUPBENCH_RATE_HZ * sizeof(RollupBenchSample_t));
+	if(!RollupBenchSamples)
+	{
+		perror("malloc");
+		exit(1);
+	}
+
+	srand(1);
+	for(ui32Second = 0; ui32Second < ui32Hours * 3600; ui32Second++)
+	{
+		if((ui32Second % (5 * 3600)) >= (5 * 3600 - 200))
+		{
+			continue;
+		}
+		dDay = sin(2.0 * M_PI * ui32Second / 86400.0);
+		for(ui32Tick = 0; ui32Tick < ROLLUPBENCH_RATE_HZ; ui32Tick++)
+		{
+			RollupBenchSamples[RollupBenchCount].ui32TimeS = ui32Second;
+			RollupBenchSamples[RollupBenchCount].pi32Values[0] = (int32_t)(8000.0 * dDay) + rand() % 201 - 100;
+			RollupBenchSamples[RollupBenchCount].pi32Values[1] = 60000 - (int32_t)(20000.0 * dDay) + rand() % 501;
+			RollupBenchSamples[RollupBenchCount].pi32Values[2] = 101325000 + (int32_t)(900000.0 * dDay) +
+																 rand() % 10001 - 5000;
+			RollupBenchSamples[RollupBenchCount].pi32Values[3] = (dDay > 0.0) ? (int32_t)(90000000.0 * dDay) : 0;
+			RollupBenchCount++;
+		}
+	}
+}
+
+/* First sample at or after a time */
+static uint32_t rollupBenchFind(uint32_t ui32TimeS)
+{
+	uint32_t ui32Low = 0, ui32High = RollupBenchCount, ui32Mid;
+
+	while(ui32Low < ui32High)
+	{
+		ui32Mid = (ui32Low + ui32High) / 2;
+		if(RollupBenchSamples[ui32Mid].ui32TimeS < ui32TimeS)
+		{
+			ui32Low = ui32Mid + 1;
+		}
+		else
+		{
+			ui32High = ui32Mid;
+		}
+	}
+
+	return(ui32Low);
+}
+
+/* A closed bucket against the raw samples of its period */
+static bool rollupBenchCheckBucket(const WS_RollupLevel_t *psLevel, const WS_RollupBucket_t *psBucket)
+{
+	uint32_t ui32First, ui32End, ui32Idx, ui32Ch;
+	int32_t i32Min, i32Max, i32Mean;
+	int64_t i64Sum;
+
+	ui32First = rollupBenchFind(psBucket->ui32Start);
+	ui32End = rollupBenchFind(psBucket->ui32Start + psLevel->ui32Period);
+	if((ui32End - ui32First) != psBucket->ui32Count)
+	{
+		printf("%us bucket at %u: %u samples, %u in the trace\n", psLevel->ui32Period,
+			   psBucket->ui32Start, psBucket->ui32Count, ui32End - ui32First);
+		return(false);
+	}
+
+	for(ui32Ch = 0; ui32Ch < WS_ROLLUP_CHANNELS; ui32Ch++)
+	{
+		i32Min = INT32_MAX;
+		i32Max = INT32_MIN;
+		i64Sum = 0;
+		for(ui32Idx = ui32First; ui32Idx < ui32End; ui32Idx++)
+		{
+			if(RollupBenchSamples[ui32Idx].pi32Values[ui32Ch] < i32Min)
+			{
+				i32Min = RollupBenchSamples[ui32Idx].pi32Values[ui32Ch];
+			}
+			if(RollupBenchSamples[ui32Idx].pi32Values[ui32Ch] > i32Max)
+			{
+				i32Max = RollupBenchSamples[ui32Idx].pi32Values[ui32Ch];
+			}
+			i64Sum += RollupBenchSamples[ui32Idx].pi32Values[ui32Ch];
+		}
+		i32Mean = (int32_t)llround((double)i64Sum / (ui32End - ui32First));
+
+		if((psBucket->psStat[ui32Ch].i32Min != i32Min) || (psBucket->psStat[ui32Ch].i32Max != i32Max) ||
+		   (psBucket->psStat[ui32Ch].i32Mean != i32Mean))
+		{
+			printf("%us bucket at %u channel %u: min/max/mean %d/%d/%d, the trace gives %d/%d/%d\n",
+				   psLevel->ui32Period, psBucket->ui32Start, ui32Ch, psBucket->psStat[ui32Ch].i32Min,
+				   psBucket->psStat[ui32Ch].i32Max, psBucket->psStat[ui32Ch].i32Mean, i32Min, i32Max,
+				   i32Mean);
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t pui32Periods[WS_ROLLUP_LEVELS] = { 1, 60, 600, 3600 };
+	uint32_t ui32Hours = (argc > 1) ? strtoul(argv[1], NULL, 0) : 50;
+	const WS_RollupLevel_t *psLevel;
+	const WS_RollupBucket_t *psBucket;
+	uint32_t ui32Sample, ui32Level, ui32Idx, ui32Last, ui32Failures = 0;
+	uint64_t ui64Start, ui64Ns;
+
+	if(ui32Hours < 2)
+	{
+		fprintf(stderr, "usage: %s [hours, at least 2]\n", argv[0]);
+		return(1);
+	}
+	rollupBenchSynthesize(ui32Hours);
+
+	ui64Start = rollupBenchNs();
+	for(ui32Sample = 0; ui32Sample < RollupBenchCount; ui32Sample++)
+	{
+		rollupAddSample(RollupBenchSamples[ui32Sample].ui32TimeS, RollupBenchSamples[ui32Sample].pi32Values);
+	}
+	ui64Ns = rollupBenchNs() - ui64Start;
+
+	printf("level      size  checked\n");
+	for(ui32Level = 0; ui32Level < WS_ROLLUP_LEVELS; ui32Level++)
+	{
+		psLevel = rollupLevelGet(pui32Periods[ui32Level]);
+		if(!psLevel || !psLevel->ui32Count)
+		{
+			printf("%us: no level or no closed bucket\n", pui32Periods[ui32Level]);
+			return(1);
+		}
+
+		ui32Last = 0;
+		for(ui32Idx = 0; ui32Idx < psLevel->ui32Count; ui32Idx++)
+		{
+			psBucket = rollupBucketGet(psLevel, ui32Idx);
+			if((psBucket->ui32Start % psLevel->ui32Period) || (ui32Idx && (psBucket->ui32Start <= ui32Last)))
+			{
+				printf("%us bucket %u starts at %u\n", psLevel->ui32Period, ui32Idx, psBucket->ui32Start);
+				ui32Failures++;
+			}
+			else if(!rollupBenchCheckBucket(psLevel, psBucket))
+			{
+				ui32Failures++;
+			}
+			ui32Last = psBucket->ui32Start;
+		}
+		printf("%5us  %8u  %7u\n", psLevel->ui32Period, psLevel->ui32Size, psLevel->ui32Count);
+	}
+
+	if(ui32Failures)
+	{
+		printf("%u mismatches\n", ui32Failures);
+		return(1);
+	}
+
+	printf("\n%u samples over %u h, rollupAddSample %.1f ns/sample\n", RollupBenchCount, ui32Hours,
+		   (double)ui64Ns / RollupBenchCount);
+
+	return(0);
+}
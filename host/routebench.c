@@ -0,0 +1,312 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils/ustdlib.h"
+
+#include "weather_station/ws_route.h"
+
+//*****************************************************************************
+/*  Benchmark of the route lookup, the ustrncmp ladder fs_open had and the
+ *  list scan of the file system image against routeFind.
+ *
+ *  The first table resolves the names the dashboard and the pages ask for,
+ *  the dynamic files, the static files and a miss, through both. The second
+ *  grows the route count and times a lookup of a route added first, of one
+ *  added last and of a miss: the ladder gets slower with every route, the
+ *  hash should not. Both paths have to resolve every name alike, the query
+ *  has to come from the name and a CGI has to answer GET only.
+ *
+ *  The third renders the SSI tags of the pages through routeSSI, as ws_http
+ *  does, once registered plain and once, under a name of their own, with
+ *  WS_ROUTE_SSI_CACHE, with and without a routeSSIChanged before each
+ *  render. Every render has to give the text of the tag's own function.
+ *
+ *      ./build/routebench [iterations] */
+//*****************************************************************************
+
+#define BENCH_ROUTES			32
+
+static const char BenchData[] = "x";
+
+static const char *benchOpen(const char *pcQuery, uint32_t *pui32Len)
+{
+	*pui32Len = 1;
+	return(BenchData);
+}
+
+static const char *benchCGI(const tCGIQuery *psQuery)
+{
+	return("/index.html");
+}
+
+/* The ladder of fs_open, then the file list */
+static const char * const BenchLadder[] =
+{
+	"/cgi-bin/send_data", "/cgi-bin/trend", "/cgi-bin/rollup", "/cgi-bin/stack",
+	"/cgi-bin/trace", "/metrics", "/cgi-bin/history", "/toggle_led", "/ledstate",
+	"/get_speed", "/cgi-bin/set_speed"
+};
+
+static const char * const BenchFiles[] =
+{
+	"/weather.ico", "/styles.css", "/README.md", "/LICENSE", "/javascript.js", "/index.html"
+};
+
+#define BENCH_NUM_LADDER		(sizeof(BenchLadder) / sizeof(BenchLadder[0]))
+#define BENCH_NUM_FILES			(sizeof(BenchFiles) / sizeof(BenchFiles[0]))
+
+/* What a dashboard asks for, mostly send_data */
+static const char * const BenchMix[] =
+{
+	"/cgi-bin/send_data", "/cgi-bin/send_data", "/cgi-bin/send_data", "/cgi-bin/send_data",
+	"/cgi-bin/trend", "/metrics", "/index.html", "/javascript.js", "/styles.css",
+	"/weather.ico", "/ledstate", "/cgi-bin/history", "/favicon.png"
+};
+
+#define BENCH_NUM_MIX			(sizeof(BenchMix) / sizeof(BenchMix[0]))
+
+static char BenchNames[BENCH_ROUTES][32];
+
+/* The tags of enet_io.c, with what io.c would report */
+static bool BenchLedOn = true;
+static uint32_t BenchSpeed = 75;
+
+static int32_t benchLedState(char *pcInsert, int32_t i32InsertLen)
+{
+	usnprintf(pcInsert, i32InsertLen, BenchLedOn ? "ON" : "OFF");
+	return(strlen(pcInsert));
+}
+
+static int32_t benchFormVars(char *pcInsert, int32_t i32InsertLen)
+{
+	usnprintf(pcInsert, i32InsertLen, "%sls=%d;\nsp=%d;\n%s",
+			  "<script type='text/javascript' language='JavaScript'><!--\n",
+			  BenchLedOn, BenchSpeed, "//--></script>\n");
+	return(strlen(pcInsert));
+}
+
+static int32_t benchSpeed(char *pcInsert, int32_t i32InsertLen)
+{
+	usnprintf(pcInsert, i32InsertLen, "%d%%", BenchSpeed);
+	return(strlen(pcInsert));
+}
+
+static const WS_RouteSSI_t BenchTags[] = { benchLedState, benchFormVars, benchSpeed };
+static const char * const BenchTagNames[] = { "LEDtxt", "FormVars", "speed" };
+static const char * const BenchCachedNames[] = { "LEDtxtC", "FormVarsC", "speedC" };
+
+#define BENCH_NUM_TAGS			(sizeof(BenchTags) / sizeof(BenchTags[0]))
+
+static uint64_t benchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+/* Index of the name in the ladder or the file list, -1 if neither has it */
+static int32_t benchLadder(const char *pcName, const char * const *ppcLadder, uint32_t ui32Ladder,
+						   const char * const *ppcFiles, uint32_t ui32Files)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < ui32Ladder; ui32Idx++)
+	{
+		if(ustrncmp(pcName, ppcLadder[ui32Idx], strlen(ppcLadder[ui32Idx])) == 0)
+		{
+			return(ui32Idx);
+		}
+	}
+	for(ui32Idx = 0; ui32Idx < ui32Files; ui32Idx++)
+	{
+		if(ustrncmp(pcName, ppcFiles[ui32Idx], strlen(ppcFiles[ui32Idx]) + 1) == 0)
+		{
+			return(ui32Ladder + ui32Idx);
+		}
+	}
+
+	return(-1);
+}
+
+/* ns per lookup of the names through both, false if they disagree */
+static bool benchTime(const char * const *ppcNames, uint32_t ui32Names, const char * const *ppcLadder,
+					  uint32_t ui32Ladder, const char * const *ppcFiles, uint32_t ui32Files,
+					  uint32_t ui32Iterations, double *pdOldNs, double *pdNewNs)
+{
+	const char *pcQuery;
+	uint64_t ui64Start, ui64OldSum = 0, ui64NewSum = 0;
+	uint32_t ui32Iter;
+	const WS_Route_t *psRoute;
+
+	for(ui32Iter = 0; ui32Iter < ui32Names; ui32Iter++)
+	{
+		if((benchLadder(ppcNames[ui32Iter], ppcLadder, ui32Ladder, ppcFiles, ui32Files) < 0) !=
+		   (routeFind(ppcNames[ui32Iter], &pcQuery) == NULL))
+		{
+			printf("%s resolves differently\n", ppcNames[ui32Iter]);
+			return(false);
+		}
+	}
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		ui64OldSum += benchLadder(ppcNames[ui32Iter % ui32Names], ppcLadder, ui32Ladder, ppcFiles,
+								  ui32Files) >= 0;
+	}
+	*pdOldNs = (double)(benchNs() - ui64Start) / ui32Iterations;
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		psRoute = routeFind(ppcNames[ui32Iter % ui32Names], &pcQuery);
+		ui64NewSum += (psRoute != NULL);
+	}
+	*pdNewNs = (double)(benchNs() - ui64Start) / ui32Iterations;
+
+	return(ui64OldSum == ui64NewSum);
+}
+
+/* ns per render of tag ui32Tag registered as pcName, false if a render
+ * differs from the tag's function. bChange calls routeSSIChanged and moves
+ * the speed before every render. */
+static bool benchRender(const char *pcName, uint32_t ui32Tag, bool bChange, uint32_t ui32Iterations,
+						double *pdNs)
+{
+	char pcInsert[WS_ROUTE_SSI_CACHE_LEN], pcExpect[WS_ROUTE_SSI_CACHE_LEN];
+	uint64_t ui64Start, ui64Sum = 0;
+	uint32_t ui32Iter, ui32NameLen = strlen(pcName);
+	int32_t i32Len;
+
+	for(ui32Iter = 0; ui32Iter < 256; ui32Iter++)
+	{
+		if(bChange || (ui32Iter == 0))
+		{
+			BenchSpeed = ui32Iter % 101;
+			BenchLedOn = ui32Iter & 1;
+			routeSSIChanged();
+		}
+		i32Len = routeSSI(pcName, ui32NameLen, pcInsert, sizeof(pcInsert));
+		if((i32Len != BenchTags[ui32Tag](pcExpect, sizeof(pcExpect))) || strcmp(pcInsert, pcExpect))
+		{
+			printf("%s renders \"%s\", not \"%s\"\n", BenchTagNames[ui32Tag], pcInsert, pcExpect);
+			return(false);
+		}
+	}
+
+	ui64Start = benchNs();
+	for(ui32Iter = 0; ui32Iter < ui32Iterations; ui32Iter++)
+	{
+		if(bChange)
+		{
+			BenchSpeed = ui32Iter & 63;
+			routeSSIChanged();
+		}
+		ui64Sum += routeSSI(pcName, ui32NameLen, pcInsert, sizeof(pcInsert));
+	}
+	*pdNs = (double)(benchNs() - ui64Start) / ui32Iterations;
+
+	return(ui64Sum != 0);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32Iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+	const char *ppcProbe[3], *ppcLadder[BENCH_ROUTES], *pcQuery;
+	const WS_Route_t *psRoute;
+	uint32_t ui32Idx, ui32Routes;
+	double dOldNs, dNewNs;
+
+	for(ui32Idx = 0; ui32Idx < BENCH_NUM_LADDER; ui32Idx++)
+	{
+		routeAdd(BenchLadder[ui32Idx], 0, benchOpen);
+	}
+	for(ui32Idx = 0; ui32Idx < BENCH_NUM_FILES; ui32Idx++)
+	{
+		routeAddFile(BenchFiles[ui32Idx], BenchData, 1);
+	}
+	routeAddCGI("/iocontrol.cgi", benchCGI);
+
+	psRoute = routeFind("/cgi-bin/rollup?level=60&n=4", &pcQuery);
+	if(!psRoute || strcmp(pcQuery, "level=60&n=4") || !routeAllows(psRoute, WS_ROUTE_HEAD))
+	{
+		printf("/cgi-bin/rollup?level=60&n=4: no route, or not its query or HEAD\n");
+		return(1);
+	}
+	psRoute = routeFind("/iocontrol.cgi?LEDOn=1", &pcQuery);
+	if(!psRoute || !routeAllows(psRoute, WS_ROUTE_GET) || routeAllows(psRoute, WS_ROUTE_HEAD))
+	{
+		printf("/iocontrol.cgi: no route, or not GET only\n");
+		return(1);
+	}
+
+	if(!benchTime(BenchMix, BENCH_NUM_MIX, BenchLadder, BENCH_NUM_LADDER, BenchFiles,
+				  BENCH_NUM_FILES, ui32Iterations, &dOldNs, &dNewNs))
+	{
+		return(1);
+	}
+	printf("request mix  ladder ns/lookup  route ns/lookup  speedup\n");
+	printf("%11u  %16.1f  %15.1f  %6.2fx\n\n", (uint32_t)BENCH_NUM_MIX, dOldNs, dNewNs,
+		   dOldNs / dNewNs);
+
+	/* Routes of their own, on top of the ones above */
+	printf("routes  first ns old/new  last ns old/new  miss ns old/new\n");
+	for(ui32Routes = 0; ui32Routes < BENCH_ROUTES; ui32Routes++)
+	{
+		sprintf(BenchNames[ui32Routes], "/api/v1/station/value_%02u", ui32Routes);
+		ppcLadder[ui32Routes] = BenchNames[ui32Routes];
+		routeAdd(BenchNames[ui32Routes], 0, benchOpen);
+		if((ui32Routes + 1) & ui32Routes)
+		{
+			continue;
+		}
+
+		printf("%6u", ui32Routes + 1);
+		ppcProbe[0] = BenchNames[0];
+		ppcProbe[1] = BenchNames[ui32Routes];
+		ppcProbe[2] = "/api/v1/station/missing";
+		for(ui32Idx = 0; ui32Idx < 3; ui32Idx++)
+		{
+			if(!benchTime(&ppcProbe[ui32Idx], 1, ppcLadder, ui32Routes + 1, NULL, 0,
+						  ui32Iterations, &dOldNs, &dNewNs))
+			{
+				return(1);
+			}
+			printf("  %7.1f/%-7.1f", dOldNs, dNewNs);
+		}
+		printf("\n");
+	}
+
+	/* Each tag plain, then the same function cached */
+	for(ui32Idx = 0; ui32Idx < BENCH_NUM_TAGS; ui32Idx++)
+	{
+		routeAddSSI(BenchTagNames[ui32Idx], 0, BenchTags[ui32Idx]);
+	}
+	for(ui32Idx = 0; ui32Idx < BENCH_NUM_TAGS; ui32Idx++)
+	{
+		routeAddSSI(BenchCachedNames[ui32Idx], WS_ROUTE_SSI_CACHE, BenchTags[ui32Idx]);
+	}
+
+	printf("\nSSI tag   render ns  cached ns  speedup  changed ns\n");
+	for(ui32Idx = 0; ui32Idx < BENCH_NUM_TAGS; ui32Idx++)
+	{
+		if(!benchRender(BenchTagNames[ui32Idx], ui32Idx, false, ui32Iterations, &dOldNs) ||
+		   !benchRender(BenchCachedNames[ui32Idx], ui32Idx, false, ui32Iterations, &dNewNs))
+		{
+			return(1);
+		}
+		printf("%-8s  %9.1f  %9.1f  %6.2fx", BenchTagNames[ui32Idx], dOldNs, dNewNs, dOldNs / dNewNs);
+		if(!benchRender(BenchCachedNames[ui32Idx], ui32Idx, true, ui32Iterations, &dNewNs))
+		{
+			return(1);
+		}
+		printf("  %10.1f\n", dNewNs);
+	}
+
+	return(0);
+}
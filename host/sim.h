@@ -0,0 +1,122 @@
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Host (Linux) simulation of the EK-TM4C1294XL board.
+ *
+ *  The firmware runs unmodified on a single thread. A tick thread stands in
+ *  for the timers: every millisecond it marks the periodic interrupt sources
+ *  that are due as pending. Pending interrupts are taken by the firmware
+ *  thread whenever it sleeps or delays (SysCtlSleep, SysCtlDelay), highest
+ *  priority first, one after the other. Handlers run to completion, there is
+ *  no preemption, so the nesting depth is always one.
+ *
+ *  Everything shared with the tick thread is behind simLock. */
+//*****************************************************************************
+
+/* Clock reported to the firmware, SysTick and timer loads are in its cycles */
+#define WS_SIM_SYSCLOCK			120000000u
+
+/* Periodic interrupt sources driven by the tick thread */
+typedef enum {
+	WS_SimSourceSysTick		= 0x00u,
+	WS_SimSourceTimer2A		= 0x01u,	/* Animation timer */
+	WS_SimSourceTempDRDY	= 0x02u,	/* TMP006 conversion ready pin */
+	WS_SimSourceI2CBus0		= 0x03u,	/* Transfer end on a timed I2C bus */
+	WS_SimSourceI2CBus1		= 0x04u,
+	WS_SIM_NUM_SOURCES		= 0x05u
+}WS_SimSource_t;
+
+/* A device on a simulated I2C bus. A transaction is a write of
+ * ui32Count bytes (register pointer first for register devices) optionally
+ * followed by a read after a repeated start. */
+typedef struct {
+	uint8_t ui8Addr;
+	void *pvDevice;
+	void (*pfnWrite)(void *pvDevice, const uint8_t *pui8Data, uint32_t ui32Count);
+	void (*pfnRead)(void *pvDevice, uint8_t *pui8Data, uint32_t ui32Count);
+}WS_SimI2CDevice_t;
+
+/* Start the tick thread and attach the simulated peripherals. Call before
+ * the firmware's main. */
+void simInit(void);
+
+/* Time since simInit */
+uint32_t simMillis(void);
+uint64_t simMicros(void);
+
+/* Serialize with the tick thread */
+void simLock(void);
+void simUnlock(void);
+
+/* Interrupt controller. simIntPend may be called from any thread,
+ * simIntPendLocked with the lock held. */
+void simIntPend(uint32_t ui32Int);
+void simIntPendLocked(uint32_t ui32Int);
+void simIntDispatch(void);
+void simIntWait(uint64_t ui64DeadlineUs);
+uint32_t simIntNesting(void);
+void simVectorSet(uint32_t ui32Int, void (*pfnHandler)(void));
+
+/* Run eSource every ui32PeriodUs, pending ui32Int. If ui32GPIOBase is not
+ * zero the source is a pin and ui8Pins are latched in the port's raw
+ * interrupt status first. A zero period stops the source. Call with the
+ * lock held. */
+void simSourceSet(WS_SimSource_t eSource, uint32_t ui32PeriodUs, uint32_t ui32Int,
+				  uint32_t ui32GPIOBase, uint8_t ui8Pins);
+
+/* Pend ui32Int once, ui32DelayUs from now (at the resolution of the tick
+ * thread, 1 ms). Call with the lock held. */
+void simSourceOnce(WS_SimSource_t eSource, uint32_t ui32DelayUs, uint32_t ui32Int);
+
+/* Latch an edge on ui8Pins of a port and pend its interrupt if enabled.
+ * Call with the lock held. */
+void simGPIOEdge(uint32_t ui32Port, uint8_t ui8Pins);
+
+/* Run pfnHook on the firmware thread each time SysCtlSleep returns, after
+ * the pending interrupts were taken. The hook runs between handlers, like
+ * the handlers themselves it may call lwIP. */
+void simIdleHookSet(void (*pfnHook)(void));
+
+/* Idle accounting of SysCtlSleep: the wakeups and the time spent asleep
+ * since simInit, simulated microseconds. */
+void simIdleStats(uint64_t *pui64Wakeups, uint64_t *pui64IdleUs);
+
+/* Drop the debug UART output */
+void simUARTQuiet(bool bQuiet);
+
+/* Simulated I2C buses, see sim_i2cm.c. simI2CStats gives the transfers
+ * of a bus and, with WS_SIM_I2C_HZ set, the time it was busy. */
+void simI2CAttach(uint32_t ui32Base, const WS_SimI2CDevice_t *psDevice);
+void simI2CStats(uint32_t ui32Bus, uint32_t *pui32Transfers, uint64_t *pui64BusyUs);
+
+/* Peripheral models */
+void simSensorsInit(void);
+void simFlashInit(void);
+
+/* Sensor trace replay, see sim_trace.c. simTraceReplay overrides the read
+ * data and the status of a transfer with the matching record and returns
+ * true, or returns false when no trace is replayed or none matches. */
+void simTraceInit(void);
+bool simTraceReplay(uint32_t ui32Bus, uint8_t ui8Addr, const uint8_t *pui8Write,
+					uint32_t ui32WriteCount, uint8_t *pui8Read, uint32_t ui32ReadCount,
+					uint_fast8_t *pui8Status);
+
+/* Send a UDP datagram to a multicast group from a host socket, see
+ * sim_mcast.c. ui32Group is in network byte order. */
+void simMcastSend(uint32_t ui32Group, uint16_t ui16Port, uint8_t ui8TTL, const uint8_t *pui8Data,
+				  uint32_t ui32Len);
+
+/* Watch every IPv4 packet the link delivers to the station, both
+ * directions of the in-process clients. pfnTap runs on the sending side
+ * and must not keep p; NULL stops. */
+struct pbuf;
+void simLinkTapSet(void (*pfnTap)(const struct pbuf *p));
+
+/* Vector table of the host build, see sim_vectors.c */
+void simVectorsInit(void);
+
+#endif /* HOST_SIM_H_ */
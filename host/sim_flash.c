@@ -0,0 +1,102 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "driverlib/flash.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  The sample log region of the internal flash. It is mapped at the address
+ *  it has on the target, so ws_flashlog_flash.c reads it through plain
+ *  pointers as it does on the device. Programming only clears bits, erase
+ *  sets a 16 KB sector to 0xFF.
+ *
+ *  With WS_SIM_FLASH=<file> in the environment the region is backed by that
+ *  file and the log survives restarts of the simulation. */
+//*****************************************************************************
+#define SIM_FLASH_BASE			0x000C0000u
+#define SIM_FLASH_SIZE			0x00040000u
+#define SIM_FLASH_SECTOR		0x4000u
+
+static uint8_t *SimFlash;
+
+void simFlashInit(void)
+{
+	const char *pcPath = getenv("WS_SIM_FLASH");
+	int iFd = -1;
+	int iFlags = MAP_FIXED_NOREPLACE;
+	bool bErase = true;
+
+	if(pcPath)
+	{
+		iFd = open(pcPath, O_RDWR | O_CREAT, 0644);
+		if(iFd < 0)
+		{
+			perror(pcPath);
+			exit(1);
+		}
+		bErase = (lseek(iFd, 0, SEEK_END) < SIM_FLASH_SIZE);
+		if(bErase && ftruncate(iFd, SIM_FLASH_SIZE))
+		{
+			perror(pcPath);
+			exit(1);
+		}
+		iFlags |= MAP_SHARED;
+	}
+	else
+	{
+		iFlags |= MAP_PRIVATE | MAP_ANONYMOUS;
+	}
+
+	SimFlash = mmap((void *)(uintptr_t)SIM_FLASH_BASE, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+					iFlags, iFd, 0);
+	if(SimFlash != (uint8_t *)(uintptr_t)SIM_FLASH_BASE)
+	{
+		fprintf(stderr, "Cannot map the flash at 0x%08x\n", SIM_FLASH_BASE);
+		exit(1);
+	}
+
+	if(bErase)
+	{
+		memset(SimFlash, 0xFF, SIM_FLASH_SIZE);
+	}
+}
+
+int32_t FlashErase(uint32_t ui32Address)
+{
+	if((ui32Address < SIM_FLASH_BASE) || (ui32Address >= SIM_FLASH_BASE + SIM_FLASH_SIZE) ||
+	   (ui32Address & (SIM_FLASH_SECTOR - 1)))
+	{
+		return(-1);
+	}
+
+	memset(SimFlash + (ui32Address - SIM_FLASH_BASE), 0xFF, SIM_FLASH_SECTOR);
+	return(0);
+}
+
+int32_t FlashProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	uint32_t *pui32Flash;
+
+	if((ui32Address < SIM_FLASH_BASE) || (ui32Count > SIM_FLASH_BASE + SIM_FLASH_SIZE - ui32Address) ||
+	   (ui32Address & 3) || (ui32Count & 3))
+	{
+		return(-1);
+	}
+
+	/* NOR flash: programming can only clear bits */
+	pui32Flash = (uint32_t *)(SimFlash + (ui32Address - SIM_FLASH_BASE));
+	for(ui32Count /= 4; ui32Count; ui32Count--)
+	{
+		*pui32Flash++ &= *pui32Data++;
+	}
+
+	return(0);
+}
@@ -0,0 +1,343 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/udma.h"
+#include "driverlib/i2c.h"
+#include "driverlib/flash.h"
+#include "drivers/pinout.h"
+#include "utils/uartstdio.h"
+#include "utils/ustdlib.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  driverlib stand-ins of the host build: system control, GPIO, the
+ *  animation timer, uDMA and the debug UART. Configuration calls with no
+ *  effect in the simulation are accepted and ignored. */
+//*****************************************************************************
+
+/* MAC address reported in USER0/USER1, a locally administered one */
+#define SIM_USER0				0x00b61a02u
+#define SIM_USER1				0x00563412u
+
+typedef struct {
+	uint32_t ui32Base;
+	uint32_t ui32Int;
+	uint8_t ui8IntMask;
+	uint8_t ui8IntRaw;
+	uint8_t ui8Data;
+}SimGPIOPort_t;
+
+static SimGPIOPort_t SimGPIOPorts[] =
+{
+	{ GPIO_PORTA_BASE, INT_GPIOA }, { GPIO_PORTB_BASE, INT_GPIOB },
+	{ GPIO_PORTC_BASE, INT_GPIOC }, { GPIO_PORTD_BASE, INT_GPIOD },
+	{ GPIO_PORTE_BASE, INT_GPIOE }, { GPIO_PORTF_BASE, INT_GPIOF },
+	{ GPIO_PORTG_BASE, INT_GPIOG }, { GPIO_PORTH_BASE, INT_GPIOH },
+	{ GPIO_PORTJ_BASE, INT_GPIOJ }, { GPIO_PORTK_BASE, INT_GPIOK },
+	{ GPIO_PORTL_BASE, INT_GPIOL }, { GPIO_PORTM_BASE, INT_GPIOM },
+	{ GPIO_PORTN_BASE, INT_GPION }
+};
+
+#define SIM_NUM_GPIO_PORTS		(sizeof(SimGPIOPorts) / sizeof(SimGPIOPorts[0]))
+
+/* Animation timer, Timer 2A */
+static uint32_t SimTimerLoad;
+static bool SimTimerEnabled;
+static bool SimTimerIntEnabled;
+
+static SimGPIOPort_t *simGPIOPort(uint32_t ui32Port)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < SIM_NUM_GPIO_PORTS; ui32Idx++)
+	{
+		if(SimGPIOPorts[ui32Idx].ui32Base == ui32Port)
+		{
+			return(&SimGPIOPorts[ui32Idx]);
+		}
+	}
+
+	return(NULL);
+}
+
+void simGPIOEdge(uint32_t ui32Port, uint8_t ui8Pins)
+{
+	SimGPIOPort_t *psPort = simGPIOPort(ui32Port);
+
+	if(!psPort)
+	{
+		return;
+	}
+
+	psPort->ui8IntRaw |= ui8Pins;
+	if(psPort->ui8IntRaw & psPort->ui8IntMask)
+	{
+		simIntPendLocked(psPort->ui32Int);
+	}
+}
+
+//*****************************************************************************
+//
+// System control.
+//
+//*****************************************************************************
+void SysCtlMOSCConfigSet(uint32_t ui32Config)
+{
+}
+
+uint32_t SysCtlClockFreqSet(uint32_t ui32Config, uint32_t ui32SysClock)
+{
+	return(WS_SIM_SYSCLOCK);
+}
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral)
+{
+}
+
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral)
+{
+	return(true);
+}
+
+void PinoutSet(bool bEthernet, bool bUSB)
+{
+}
+
+//*****************************************************************************
+//
+// GPIO.
+//
+//*****************************************************************************
+void GPIOPinConfigure(uint32_t ui32PinConfig)
+{
+}
+
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void GPIOPinTypeGPIOOutput(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void GPIOPinTypeI2C(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void GPIOPinTypeI2CSCL(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType)
+{
+}
+
+void GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+	SimGPIOPort_t *psPort = simGPIOPort(ui32Port);
+
+	simLock();
+	psPort->ui8IntMask |= (uint8_t)ui32IntFlags;
+	simUnlock();
+}
+
+uint32_t GPIOIntStatus(uint32_t ui32Port, bool bMasked)
+{
+	SimGPIOPort_t *psPort = simGPIOPort(ui32Port);
+	uint32_t ui32Status;
+
+	simLock();
+	ui32Status = bMasked ? (psPort->ui8IntRaw & psPort->ui8IntMask) : psPort->ui8IntRaw;
+	simUnlock();
+
+	return(ui32Status);
+}
+
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+	SimGPIOPort_t *psPort = simGPIOPort(ui32Port);
+
+	simLock();
+	psPort->ui8IntRaw &= (uint8_t)~ui32IntFlags;
+	simUnlock();
+}
+
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val)
+{
+	SimGPIOPort_t *psPort = simGPIOPort(ui32Port);
+
+	psPort->ui8Data = (psPort->ui8Data & ~ui8Pins) | (ui8Val & ui8Pins);
+}
+
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins)
+{
+	return(simGPIOPort(ui32Port)->ui8Data & ui8Pins);
+}
+
+//*****************************************************************************
+//
+// Animation timer. Only the periodic mode of Timer 2A is modelled.
+//
+//*****************************************************************************
+/* Lock held */
+static void simTimerUpdate(void)
+{
+	uint32_t ui32PeriodUs = 0;
+
+	if(SimTimerEnabled && SimTimerIntEnabled)
+	{
+		ui32PeriodUs = (uint32_t)(((uint64_t)SimTimerLoad + 1) * 1000000u / WS_SIM_SYSCLOCK);
+		if(!ui32PeriodUs)
+		{
+			ui32PeriodUs = 1;
+		}
+	}
+	simSourceSet(WS_SimSourceTimer2A, ui32PeriodUs, INT_TIMER2A, 0, 0);
+}
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config)
+{
+}
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+	simLock();
+	SimTimerLoad = ui32Value;
+	simTimerUpdate();
+	simUnlock();
+}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	simLock();
+	SimTimerEnabled = true;
+	simTimerUpdate();
+	simUnlock();
+}
+
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+	simLock();
+	SimTimerEnabled = false;
+	simTimerUpdate();
+	simUnlock();
+}
+
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+	simLock();
+	SimTimerIntEnabled = true;
+	simTimerUpdate();
+	simUnlock();
+}
+
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+}
+
+//*****************************************************************************
+//
+// uDMA. The fake I2C master never uses it.
+//
+//*****************************************************************************
+void uDMAEnable(void)
+{
+}
+
+void uDMAControlBaseSet(void *pControlTable)
+{
+}
+
+void uDMAChannelAssign(uint32_t ui32Mapping)
+{
+}
+
+void uDMAChannelAttributeDisable(uint32_t ui32ChannelNum, uint32_t ui32Attr)
+{
+}
+
+//*****************************************************************************
+//
+// I2C master. The fake I2C master driver reports its errors itself, the
+// registers never hold one.
+//
+//*****************************************************************************
+uint32_t I2CMasterErr(uint32_t ui32Base)
+{
+	return(I2C_MASTER_ERR_NONE);
+}
+
+//*****************************************************************************
+//
+// Flash user registers, they hold the MAC address.
+//
+//*****************************************************************************
+int32_t FlashUserGet(uint32_t *pui32User0, uint32_t *pui32User1)
+{
+	*pui32User0 = SIM_USER0;
+	*pui32User1 = SIM_USER1;
+	return(0);
+}
+
+//*****************************************************************************
+//
+// Debug UART, printed on stdout unless quiet.
+//
+//*****************************************************************************
+static bool SimUARTQuiet;
+
+void simUARTQuiet(bool bQuiet)
+{
+	SimUARTQuiet = bQuiet;
+}
+
+void UARTStdioConfig(uint32_t ui32Port, uint32_t ui32Baud, uint32_t ui32SrcClock)
+{
+}
+
+int UARTwrite(const char *pcBuf, uint32_t ui32Len)
+{
+	if(SimUARTQuiet)
+	{
+		return((int)ui32Len);
+	}
+
+	return((int)fwrite(pcBuf, 1, ui32Len, stdout));
+}
+
+void UARTvprintf(const char *pcString, va_list vaArgP)
+{
+	char pcBuf[256];
+	int iLen;
+
+	if(SimUARTQuiet)
+	{
+		return;
+	}
+
+	/* Same formatter as the firmware so the output matches the target */
+	iLen = uvsnprintf(pcBuf, sizeof(pcBuf), pcString, vaArgP);
+	if(iLen >= (int)sizeof(pcBuf))
+	{
+		iLen = sizeof(pcBuf) - 1;
+	}
+	UARTwrite(pcBuf, (uint32_t)iLen);
+	fflush(stdout);
+}
+
+void UARTprintf(const char *pcString, ...)
+{
+	va_list vaArgP;
+
+	va_start(vaArgP, pcString);
+	UARTvprintf(pcString, vaArgP);
+	va_end(vaArgP);
+}
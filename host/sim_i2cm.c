@@ -0,0 +1,471 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensorlib/i2cm_drv.h"
+
+#include "weather_station/ws_trace.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Fake of the sensorlib I2C master driver (i2cm_drv.c). It keeps the API and
+ *  the completion model of the real driver: commands are queued, each one
+ *  completes in the bus interrupt handler, which calls the callback and
+ *  starts the next queued command. The bytes are exchanged with the device
+ *  models attached to the bus in one go. By default the command completes
+ *  right away; WS_SIM_I2C_HZ=<clock> in the environment makes the first two
+ *  buses take the time the bytes need on the wire at that clock (9 bits a
+ *  byte, address bytes included, rounded up to the 1 ms tick), so
+ *  transactions on different buses overlap as they do on the board.
+ *
+ *  The register operations run as the transfers the real driver splits them
+ *  into (a read-modify-write is a read, then a write), and every transfer
+ *  goes to the sensor trace: it is captured while a capture runs and
+ *  answered from the trace being replayed, if any. The buses are numbered in
+ *  the order they were attached, sim_sensors.c attaches I2C7 first so the
+ *  numbers are the firmware's WS_I2CBus_t. */
+//*****************************************************************************
+
+#define SIM_I2C_MAX_BUSES		4
+#define SIM_I2C_MAX_DEVICES		8
+#define SIM_I2C_QUEUE_LEN		NUM_I2CM_COMMANDS
+#define SIM_I2C_MAX_WRITE		64
+
+typedef enum {
+	SimI2COpCommand,			/* Write, then read after a repeated start */
+	SimI2COpRMW8,				/* Read-modify-write of an 8 bit register */
+	SimI2COpRMW16LE,			/* Same on a 16 bit little endian register */
+	SimI2COpRMW16BE,			/* Same on a 16 bit big endian register */
+	SimI2COpWrite8,				/* Register address followed by bytes */
+	SimI2COpWrite16LE,			/* Register address followed by 16 bit words */
+	SimI2COpWrite16BE
+}SimI2COp_t;
+
+typedef struct {
+	SimI2COp_t eOp;
+	uint8_t ui8Addr;
+	uint8_t ui8Reg;
+	uint16_t ui16Mask;
+	uint16_t ui16Value;
+	const uint8_t *pui8WriteData;
+	uint16_t ui16WriteCount;
+	uint8_t *pui8ReadData;
+	uint16_t ui16ReadCount;
+	tSensorCallback *pfnCallback;
+	void *pvCallbackData;
+}SimI2CCommand_t;
+
+typedef struct {
+	tI2CMInstance *psInst;
+	uint32_t ui32Base;
+	uint32_t ui32Int;
+	const WS_SimI2CDevice_t *ppsDevices[SIM_I2C_MAX_DEVICES];
+	uint32_t ui32NumDevices;
+	SimI2CCommand_t psQueue[SIM_I2C_QUEUE_LEN];
+	uint32_t ui32Head;
+	uint32_t ui32Count;
+	uint32_t ui32Transfers;
+	uint64_t ui64BusyUs;
+}SimI2CBus_t;
+
+static SimI2CBus_t SimI2CBuses[SIM_I2C_MAX_BUSES];
+
+/* Bus clock of the timed buses, 0 if commands complete at once */
+static uint32_t SimI2CHz;
+
+/* The wrappers are inline in the header, keep external definitions of them
+ * for the callers the compiler did not inline into. */
+extern uint_fast8_t I2CMRead(tI2CMInstance *psInst, uint_fast8_t ui8Addr,
+							 const uint8_t *pui8WriteData, uint_fast16_t ui16WriteCount,
+							 uint8_t *pui8ReadData, uint_fast16_t ui16ReadCount,
+							 tSensorCallback *pfnCallback, void *pvCallbackData);
+extern uint_fast8_t I2CMWrite(tI2CMInstance *psInst, uint_fast8_t ui8Addr,
+							  const uint8_t *pui8Data, uint_fast16_t ui16Count,
+							  tSensorCallback *pfnCallback, void *pvCallbackData);
+
+static SimI2CBus_t *simI2CBusByBase(uint32_t ui32Base)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < SIM_I2C_MAX_BUSES; ui32Idx++)
+	{
+		if(SimI2CBuses[ui32Idx].ui32Base == ui32Base)
+		{
+			return(&SimI2CBuses[ui32Idx]);
+		}
+	}
+	for(ui32Idx = 0; ui32Idx < SIM_I2C_MAX_BUSES; ui32Idx++)
+	{
+		if(!SimI2CBuses[ui32Idx].ui32Base)
+		{
+			SimI2CBuses[ui32Idx].ui32Base = ui32Base;
+			return(&SimI2CBuses[ui32Idx]);
+		}
+	}
+
+	return(NULL);
+}
+
+static SimI2CBus_t *simI2CBusByInst(tI2CMInstance *psInst)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < SIM_I2C_MAX_BUSES; ui32Idx++)
+	{
+		if(SimI2CBuses[ui32Idx].psInst == psInst)
+		{
+			return(&SimI2CBuses[ui32Idx]);
+		}
+	}
+
+	return(NULL);
+}
+
+void simI2CAttach(uint32_t ui32Base, const WS_SimI2CDevice_t *psDevice)
+{
+	SimI2CBus_t *psBus = simI2CBusByBase(ui32Base);
+
+	if(psBus && (psBus->ui32NumDevices < SIM_I2C_MAX_DEVICES))
+	{
+		psBus->ppsDevices[psBus->ui32NumDevices++] = psDevice;
+	}
+}
+
+static const WS_SimI2CDevice_t *simI2CDevice(SimI2CBus_t *psBus, uint8_t ui8Addr)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < psBus->ui32NumDevices; ui32Idx++)
+	{
+		if(psBus->ppsDevices[ui32Idx]->ui8Addr == ui8Addr)
+		{
+			return(psBus->ppsDevices[ui32Idx]);
+		}
+	}
+
+	return(NULL);
+}
+
+/* Bytes a command puts on the wire, address bytes included */
+static uint32_t simI2CCommandBytes(const SimI2CCommand_t *psCommand)
+{
+	switch(psCommand->eOp)
+	{
+		case SimI2COpCommand:
+			return(1 + psCommand->ui16WriteCount +
+				   (psCommand->ui16ReadCount ? (1 + psCommand->ui16ReadCount) : 0));
+		case SimI2COpRMW8:
+			return(2 + 2 + 3);
+		case SimI2COpRMW16LE:
+		case SimI2COpRMW16BE:
+			return(2 + 3 + 4);
+		case SimI2COpWrite8:
+			return(2 + psCommand->ui16WriteCount);
+		default:
+			return(2 + psCommand->ui16WriteCount * 2);
+	}
+}
+
+/* Start the command at the head of the queue: its interrupt is pended now,
+ * or when the transfer would end on a timed bus */
+static void simI2CStart(SimI2CBus_t *psBus)
+{
+	uint32_t ui32Bus = (uint32_t)(psBus - SimI2CBuses);
+	uint32_t ui32Us;
+
+	if(!SimI2CHz || (ui32Bus > (WS_SimSourceI2CBus1 - WS_SimSourceI2CBus0)))
+	{
+		simIntPend(psBus->ui32Int);
+		return;
+	}
+
+	ui32Us = (uint32_t)((uint64_t)simI2CCommandBytes(&psBus->psQueue[psBus->ui32Head]) * 9 *
+						1000000u / SimI2CHz);
+	psBus->ui64BusyUs += ui32Us;
+
+	simLock();
+	simSourceOnce((WS_SimSource_t)(WS_SimSourceI2CBus0 + ui32Bus), ui32Us, psBus->ui32Int);
+	simUnlock();
+}
+
+/* Queue a command, the first one in an idle queue starts right away */
+static uint_fast8_t simI2CQueue(tI2CMInstance *psInst, const SimI2CCommand_t *psCommand)
+{
+	SimI2CBus_t *psBus = simI2CBusByInst(psInst);
+
+	if(!psBus || (psBus->ui32Count == SIM_I2C_QUEUE_LEN))
+	{
+		return(0);
+	}
+
+	psBus->psQueue[(psBus->ui32Head + psBus->ui32Count) % SIM_I2C_QUEUE_LEN] = *psCommand;
+	if(psBus->ui32Count++ == 0)
+	{
+		simI2CStart(psBus);
+	}
+
+	return(1);
+}
+
+/* One transfer on the bus: a write, then a read after a repeated start.
+ * Returns the I2CM status. */
+static uint_fast8_t simI2CTransfer(SimI2CBus_t *psBus, uint8_t ui8Addr, const uint8_t *pui8Write,
+								   uint32_t ui32WriteCount, uint8_t *pui8Read, uint32_t ui32ReadCount)
+{
+	const WS_SimI2CDevice_t *psDevice = simI2CDevice(psBus, ui8Addr);
+	uint32_t ui32Bus = (uint32_t)(psBus - SimI2CBuses);
+	uint_fast8_t ui8Status = I2CM_STATUS_SUCCESS;
+
+	psBus->ui32Transfers++;
+	if(!psDevice)
+	{
+		ui8Status = I2CM_STATUS_ADDR_NACK;
+	}
+	else
+	{
+		if(ui32WriteCount)
+		{
+			psDevice->pfnWrite(psDevice->pvDevice, pui8Write, ui32WriteCount);
+		}
+		if(ui32ReadCount)
+		{
+			psDevice->pfnRead(psDevice->pvDevice, pui8Read, ui32ReadCount);
+		}
+	}
+
+	/* The models keep their side effects, the trace has the last word */
+	simTraceReplay(ui32Bus, ui8Addr, pui8Write, ui32WriteCount, pui8Read, ui32ReadCount,
+				   &ui8Status);
+	traceRecord(ui32Bus, ui8Addr, pui8Write, ui32WriteCount, pui8Read,
+				(ui8Status == I2CM_STATUS_SUCCESS) ? ui32ReadCount : 0, ui8Status);
+
+	return(ui8Status);
+}
+
+/* Run one command, returns the I2CM status */
+static uint_fast8_t simI2CExecute(SimI2CBus_t *psBus, SimI2CCommand_t *psCommand)
+{
+	uint8_t pui8Buf[SIM_I2C_MAX_WRITE + 1];
+	uint_fast8_t ui8Status;
+	uint32_t ui32Idx, ui32Size;
+	uint16_t ui16Old;
+
+	pui8Buf[0] = psCommand->ui8Reg;
+	switch(psCommand->eOp)
+	{
+		case SimI2COpCommand:
+			return(simI2CTransfer(psBus, psCommand->ui8Addr, psCommand->pui8WriteData,
+								  psCommand->ui16WriteCount, psCommand->pui8ReadData,
+								  psCommand->ui16ReadCount));
+
+		case SimI2COpRMW8:
+			ui8Status = simI2CTransfer(psBus, psCommand->ui8Addr, pui8Buf, 1, &pui8Buf[1], 1);
+			if(ui8Status != I2CM_STATUS_SUCCESS)
+			{
+				return(ui8Status);
+			}
+			pui8Buf[1] = (pui8Buf[1] & psCommand->ui16Mask) | psCommand->ui16Value;
+			return(simI2CTransfer(psBus, psCommand->ui8Addr, pui8Buf, 2, NULL, 0));
+
+		case SimI2COpRMW16LE:
+		case SimI2COpRMW16BE:
+			ui8Status = simI2CTransfer(psBus, psCommand->ui8Addr, pui8Buf, 1, &pui8Buf[1], 2);
+			if(ui8Status != I2CM_STATUS_SUCCESS)
+			{
+				return(ui8Status);
+			}
+			if(psCommand->eOp == SimI2COpRMW16LE)
+			{
+				ui16Old = pui8Buf[1] | (pui8Buf[2] << 8);
+			}
+			else
+			{
+				ui16Old = (pui8Buf[1] << 8) | pui8Buf[2];
+			}
+			ui16Old = (ui16Old & psCommand->ui16Mask) | psCommand->ui16Value;
+			if(psCommand->eOp == SimI2COpRMW16LE)
+			{
+				pui8Buf[1] = ui16Old & 0xff;
+				pui8Buf[2] = ui16Old >> 8;
+			}
+			else
+			{
+				pui8Buf[1] = ui16Old >> 8;
+				pui8Buf[2] = ui16Old & 0xff;
+			}
+			return(simI2CTransfer(psBus, psCommand->ui8Addr, pui8Buf, 3, NULL, 0));
+
+		case SimI2COpWrite8:
+			if(psCommand->ui16WriteCount > SIM_I2C_MAX_WRITE)
+			{
+				return(I2CM_STATUS_ERROR);
+			}
+			memcpy(&pui8Buf[1], psCommand->pui8WriteData, psCommand->ui16WriteCount);
+			return(simI2CTransfer(psBus, psCommand->ui8Addr, pui8Buf,
+								  psCommand->ui16WriteCount + 1, NULL, 0));
+
+		case SimI2COpWrite16LE:
+		case SimI2COpWrite16BE:
+			ui32Size = psCommand->ui16WriteCount * 2;
+			if(ui32Size > SIM_I2C_MAX_WRITE)
+			{
+				return(I2CM_STATUS_ERROR);
+			}
+			for(ui32Idx = 0; ui32Idx < psCommand->ui16WriteCount; ui32Idx++)
+			{
+				ui16Old = ((const uint16_t *)psCommand->pui8WriteData)[ui32Idx];
+				pui8Buf[1 + ui32Idx * 2] = (psCommand->eOp == SimI2COpWrite16LE) ? (ui16Old & 0xff) : (ui16Old >> 8);
+				pui8Buf[2 + ui32Idx * 2] = (psCommand->eOp == SimI2COpWrite16LE) ? (ui16Old >> 8) : (ui16Old & 0xff);
+			}
+			return(simI2CTransfer(psBus, psCommand->ui8Addr, pui8Buf, ui32Size + 1, NULL, 0));
+	}
+
+	return(I2CM_STATUS_ERROR);
+}
+
+void I2CMInit(tI2CMInstance *psInst, uint32_t ui32Base, uint_fast8_t ui8Int,
+			  uint_fast8_t ui8TxDMA, uint_fast8_t ui8RxDMA, uint32_t ui32Clock)
+{
+	SimI2CBus_t *psBus = simI2CBusByBase(ui32Base);
+	const char *pcHz = getenv("WS_SIM_I2C_HZ");
+
+	SimI2CHz = pcHz ? (uint32_t)strtoul(pcHz, NULL, 0) : 0;
+
+	psInst->ui32Base = ui32Base;
+	psInst->ui8Int = ui8Int;
+	psBus->psInst = psInst;
+	psBus->ui32Int = ui8Int;
+	psBus->ui32Head = 0;
+	psBus->ui32Count = 0;
+}
+
+void I2CMIntHandler(tI2CMInstance *psInst)
+{
+	SimI2CBus_t *psBus = simI2CBusByInst(psInst);
+	SimI2CCommand_t sCommand;
+	uint_fast8_t ui8Status;
+
+	if(!psBus || !psBus->ui32Count)
+	{
+		return;
+	}
+
+	/* Complete the command at the head of the queue */
+	sCommand = psBus->psQueue[psBus->ui32Head];
+	ui8Status = simI2CExecute(psBus, &sCommand);
+	psBus->ui32Head = (psBus->ui32Head + 1) % SIM_I2C_QUEUE_LEN;
+	psBus->ui32Count--;
+
+	/* The next one starts before the callback, which may queue more */
+	if(psBus->ui32Count)
+	{
+		simI2CStart(psBus);
+	}
+
+	if(sCommand.pfnCallback)
+	{
+		sCommand.pfnCallback(sCommand.pvCallbackData, ui8Status);
+	}
+}
+
+uint_fast8_t I2CMCommand(tI2CMInstance *psInst, uint_fast8_t ui8Addr,
+						 const uint8_t *pui8WriteData, uint_fast16_t ui16WriteCount,
+						 uint_fast16_t ui16WriteBatchSize, uint8_t *pui8ReadData,
+						 uint_fast16_t ui16ReadCount, uint_fast16_t ui16ReadBatchSize,
+						 tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	SimI2CCommand_t sCommand;
+
+	/* Batches are not split, the whole transfer completes at once */
+	memset(&sCommand, 0, sizeof(sCommand));
+	sCommand.eOp = SimI2COpCommand;
+	sCommand.ui8Addr = ui8Addr;
+	sCommand.pui8WriteData = pui8WriteData;
+	sCommand.ui16WriteCount = ui16WriteCount;
+	sCommand.pui8ReadData = pui8ReadData;
+	sCommand.ui16ReadCount = ui16ReadCount;
+	sCommand.pfnCallback = pfnCallback;
+	sCommand.pvCallbackData = pvCallbackData;
+
+	return(simI2CQueue(psInst, &sCommand));
+}
+
+static uint_fast8_t simI2CRegOp(tI2CMInstance *psInst, SimI2COp_t eOp, uint_fast8_t ui8Addr,
+								uint_fast8_t ui8Reg, uint_fast16_t ui16Mask, uint_fast16_t ui16Value,
+								const void *pvData, uint_fast16_t ui16Count,
+								tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	SimI2CCommand_t sCommand;
+
+	memset(&sCommand, 0, sizeof(sCommand));
+	sCommand.eOp = eOp;
+	sCommand.ui8Addr = ui8Addr;
+	sCommand.ui8Reg = ui8Reg;
+	sCommand.ui16Mask = ui16Mask;
+	sCommand.ui16Value = ui16Value;
+	sCommand.pui8WriteData = (const uint8_t *)pvData;
+	sCommand.ui16WriteCount = ui16Count;
+	sCommand.pfnCallback = pfnCallback;
+	sCommand.pvCallbackData = pvCallbackData;
+
+	return(simI2CQueue(psInst, &sCommand));
+}
+
+uint_fast8_t I2CMReadModifyWrite8(tI2CMReadModifyWrite8 *psInst, tI2CMInstance *psI2CInst,
+								  uint_fast8_t ui8Addr, uint_fast8_t ui8Reg, uint_fast8_t ui8Mask,
+								  uint_fast8_t ui8Value, tSensorCallback *pfnCallback,
+								  void *pvCallbackData)
+{
+	return(simI2CRegOp(psI2CInst, SimI2COpRMW8, ui8Addr, ui8Reg, ui8Mask, ui8Value, NULL, 0,
+					   pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t I2CMReadModifyWrite16LE(tI2CMReadModifyWrite16 *psInst, tI2CMInstance *psI2CInst,
+									 uint_fast8_t ui8Addr, uint_fast8_t ui8Reg,
+									 uint_fast16_t ui16Mask, uint_fast16_t ui16Value,
+									 tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(simI2CRegOp(psI2CInst, SimI2COpRMW16LE, ui8Addr, ui8Reg, ui16Mask, ui16Value, NULL, 0,
+					   pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t I2CMReadModifyWrite16BE(tI2CMReadModifyWrite16 *psInst, tI2CMInstance *psI2CInst,
+									 uint_fast8_t ui8Addr, uint_fast8_t ui8Reg,
+									 uint_fast16_t ui16Mask, uint_fast16_t ui16Value,
+									 tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(simI2CRegOp(psI2CInst, SimI2COpRMW16BE, ui8Addr, ui8Reg, ui16Mask, ui16Value, NULL, 0,
+					   pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t I2CMWrite8(tI2CMWrite8 *psInst, tI2CMInstance *psI2CInst, uint_fast8_t ui8Addr,
+						uint_fast8_t ui8Reg, const uint8_t *pui8Data, uint_fast16_t ui16Count,
+						tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(simI2CRegOp(psI2CInst, SimI2COpWrite8, ui8Addr, ui8Reg, 0, 0, pui8Data, ui16Count,
+					   pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t I2CMWrite16LE(tI2CMWrite16 *psInst, tI2CMInstance *psI2CInst, uint_fast8_t ui8Addr,
+						   uint_fast8_t ui8Reg, const uint16_t *pui16Data, uint_fast16_t ui16Count,
+						   tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(simI2CRegOp(psI2CInst, SimI2COpWrite16LE, ui8Addr, ui8Reg, 0, 0, pui16Data, ui16Count,
+					   pfnCallback, pvCallbackData));
+}
+
+uint_fast8_t I2CMWrite16BE(tI2CMWrite16 *psInst, tI2CMInstance *psI2CInst, uint_fast8_t ui8Addr,
+						   uint_fast8_t ui8Reg, const uint16_t *pui16Data, uint_fast16_t ui16Count,
+						   tSensorCallback *pfnCallback, void *pvCallbackData)
+{
+	return(simI2CRegOp(psI2CInst, SimI2COpWrite16BE, ui8Addr, ui8Reg, 0, 0, pui16Data, ui16Count,
+					   pfnCallback, pvCallbackData));
+}
+
+void simI2CStats(uint32_t ui32Bus, uint32_t *pui32Transfers, uint64_t *pui64BusyUs)
+{
+	*pui32Transfers = (ui32Bus < SIM_I2C_MAX_BUSES) ? SimI2CBuses[ui32Bus].ui32Transfers : 0;
+	*pui64BusyUs = (ui32Bus < SIM_I2C_MAX_BUSES) ? SimI2CBuses[ui32Bus].ui64BusyUs : 0;
+}
@@ -0,0 +1,478 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+
+#include "weather_station/ws_tick.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Interrupt controller, SysTick and the tick thread of the host build.
+ *
+ *  WS_SIM_SPEED=<factor> in the environment runs the simulated clock that
+ *  much faster than real time; the periodic sources, the sensor conversions
+ *  and the firmware's delays all follow it.
+ *
+ *  WS_SIM_IDLE_REPORT=<seconds> prints the wakeups per second and the idle
+ *  residency of the firmware thread on stderr that often. */
+//*****************************************************************************
+
+/* Resolution of the periodic sources */
+#define SIM_TICK_US				1000u
+
+/* Shortest real time step of the tick thread at high speed factors */
+#define SIM_TICK_MIN_NS			20000
+
+typedef struct {
+	uint32_t ui32PeriodUs;			/* 0 if stopped */
+	uint64_t ui64NextUs;
+	uint32_t ui32Int;
+	uint32_t ui32GPIOBase;
+	uint8_t ui8Pins;
+	bool bOnce;						/* Stops after the first period */
+}SimSource_t;
+
+static pthread_mutex_t SimMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t SimWake;
+static struct timespec SimStart;
+static double SimSpeed = 1.0;
+
+static void (*SimVectors[NUM_INTERRUPTS])(void);
+static bool SimIntEnabled[NUM_INTERRUPTS];
+static bool SimIntPending[NUM_INTERRUPTS];
+static uint8_t SimIntPriority[NUM_INTERRUPTS];
+static bool SimIntMaster;
+static uint32_t SimNesting;
+
+static SimSource_t SimSources[WS_SIM_NUM_SOURCES];
+
+/* SysTick configuration, the source runs while both enables are set */
+static uint32_t SimSysTickPeriod;
+static bool SimSysTickEnabled;
+static bool SimSysTickIntEnabled;
+
+/* Called by the firmware thread after every SysCtlSleep */
+static void (*SimIdleHook)(void);
+
+/* Idle accounting, firmware thread only */
+static uint64_t SimIdleWakeups;
+static uint64_t SimIdleUs;
+static uint64_t SimIdleReportUs;
+static uint64_t SimIdleReportNext;
+
+void simLock(void)
+{
+	pthread_mutex_lock(&SimMutex);
+}
+
+void simUnlock(void)
+{
+	pthread_mutex_unlock(&SimMutex);
+}
+
+uint64_t simMicros(void)
+{
+	struct timespec sNow;
+	int64_t i64Ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	i64Ns = (int64_t)(sNow.tv_sec - SimStart.tv_sec) * 1000000000 + (sNow.tv_nsec - SimStart.tv_nsec);
+
+	return((uint64_t)((double)i64Ns * SimSpeed / 1000.0));
+}
+
+uint32_t simMillis(void)
+{
+	return((uint32_t)(simMicros() / 1000));
+}
+
+void simVectorSet(uint32_t ui32Int, void (*pfnHandler)(void))
+{
+	SimVectors[ui32Int] = pfnHandler;
+}
+
+void simIntPendLocked(uint32_t ui32Int)
+{
+	SimIntPending[ui32Int] = true;
+	pthread_cond_signal(&SimWake);
+}
+
+void simIntPend(uint32_t ui32Int)
+{
+	simLock();
+	simIntPendLocked(ui32Int);
+	simUnlock();
+}
+
+/* Highest priority pending interrupt that can be taken, or 0. Lock held. */
+static uint32_t simIntNext(void)
+{
+	uint32_t ui32Int;
+	uint32_t ui32Best = 0;
+
+	if(!SimIntMaster)
+	{
+		return(0);
+	}
+
+	for(ui32Int = FAULT_SYSTICK; ui32Int < NUM_INTERRUPTS; ui32Int++)
+	{
+		/* System exceptions are always enabled at the NVIC */
+		if(SimIntPending[ui32Int] && SimVectors[ui32Int] &&
+		   (SimIntEnabled[ui32Int] || (ui32Int < 16)))
+		{
+			if(!ui32Best || (SimIntPriority[ui32Int] < SimIntPriority[ui32Best]))
+			{
+				ui32Best = ui32Int;
+			}
+		}
+	}
+
+	return(ui32Best);
+}
+
+void simIntDispatch(void)
+{
+	uint32_t ui32Int;
+
+	/* Handlers do not preempt each other */
+	if(SimNesting)
+	{
+		return;
+	}
+
+	simLock();
+	while((ui32Int = simIntNext()) != 0)
+	{
+		SimIntPending[ui32Int] = false;
+		SimNesting++;
+		simUnlock();
+
+		SimVectors[ui32Int]();
+
+		simLock();
+		SimNesting--;
+	}
+	simUnlock();
+}
+
+/* Sleep until an interrupt can be taken or the deadline passes, 0 waits
+ * without a deadline. */
+void simIntWait(uint64_t ui64DeadlineUs)
+{
+	struct timespec sUntil;
+	uint64_t ui64RealNs;
+
+	simLock();
+	while(!simIntNext())
+	{
+		if(!ui64DeadlineUs)
+		{
+			pthread_cond_wait(&SimWake, &SimMutex);
+			continue;
+		}
+		if(simMicros() >= ui64DeadlineUs)
+		{
+			break;
+		}
+		/* Back to real time */
+		ui64RealNs = (uint64_t)((double)ui64DeadlineUs * 1000.0 / SimSpeed);
+		sUntil.tv_sec = SimStart.tv_sec + (time_t)(ui64RealNs / 1000000000u);
+		sUntil.tv_nsec = SimStart.tv_nsec + (long)(ui64RealNs % 1000000000u);
+		if(sUntil.tv_nsec >= 1000000000)
+		{
+			sUntil.tv_sec++;
+			sUntil.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&SimWake, &SimMutex, &sUntil);
+	}
+	simUnlock();
+}
+
+uint32_t simIntNesting(void)
+{
+	return(SimNesting);
+}
+
+void simSourceSet(WS_SimSource_t eSource, uint32_t ui32PeriodUs, uint32_t ui32Int,
+				  uint32_t ui32GPIOBase, uint8_t ui8Pins)
+{
+	SimSource_t *psSource = &SimSources[eSource];
+
+	psSource->ui32PeriodUs = ui32PeriodUs;
+	psSource->ui64NextUs = simMicros() + ui32PeriodUs;
+	psSource->ui32Int = ui32Int;
+	psSource->ui32GPIOBase = ui32GPIOBase;
+	psSource->ui8Pins = ui8Pins;
+	psSource->bOnce = false;
+}
+
+void simSourceOnce(WS_SimSource_t eSource, uint32_t ui32DelayUs, uint32_t ui32Int)
+{
+	/* A zero period is a stopped source */
+	simSourceSet(eSource, ui32DelayUs ? ui32DelayUs : 1, ui32Int, 0, 0);
+	SimSources[eSource].bOnce = true;
+}
+
+static void *simTickThread(void *pvArg)
+{
+	struct timespec sNext;
+	uint64_t ui64Now;
+	uint32_t ui32Source;
+	SimSource_t *psSource;
+	long lStepNs;
+
+	lStepNs = (long)(SIM_TICK_US * 1000.0 / SimSpeed);
+	if(lStepNs < SIM_TICK_MIN_NS)
+	{
+		lStepNs = SIM_TICK_MIN_NS;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &sNext);
+	while(1)
+	{
+		sNext.tv_nsec += lStepNs;
+		if(sNext.tv_nsec >= 1000000000)
+		{
+			sNext.tv_sec++;
+			sNext.tv_nsec -= 1000000000;
+		}
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &sNext, NULL) == EINTR)
+		{
+		}
+
+		simLock();
+		ui64Now = simMicros();
+		for(ui32Source = 0; ui32Source < WS_SIM_NUM_SOURCES; ui32Source++)
+		{
+			psSource = &SimSources[ui32Source];
+			if(!psSource->ui32PeriodUs || (ui64Now < psSource->ui64NextUs))
+			{
+				continue;
+			}
+
+			/* A late tick thread drops periods instead of bursting them */
+			if(psSource->bOnce)
+			{
+				psSource->ui32PeriodUs = 0;
+			}
+			psSource->ui64NextUs += psSource->ui32PeriodUs;
+			if(psSource->ui64NextUs <= ui64Now)
+			{
+				psSource->ui64NextUs = ui64Now + psSource->ui32PeriodUs;
+			}
+
+			if(psSource->ui32GPIOBase)
+			{
+				simGPIOEdge(psSource->ui32GPIOBase, psSource->ui8Pins);
+			}
+			else
+			{
+				simIntPendLocked(psSource->ui32Int);
+			}
+		}
+		simUnlock();
+	}
+
+	return(NULL);
+}
+
+void simInit(void)
+{
+	pthread_condattr_t sAttr;
+	pthread_t sThread;
+	const char *pcSpeed = getenv("WS_SIM_SPEED");
+	const char *pcReport = getenv("WS_SIM_IDLE_REPORT");
+
+	if(pcSpeed && (strtod(pcSpeed, NULL) > 0.0))
+	{
+		SimSpeed = strtod(pcSpeed, NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &SimStart);
+
+	/* Timed waits run on the same clock as simMicros */
+	pthread_condattr_init(&sAttr);
+	pthread_condattr_setclock(&sAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(&SimWake, &sAttr);
+
+	if(pcReport && (strtod(pcReport, NULL) > 0.0))
+	{
+		SimIdleReportUs = (uint64_t)(strtod(pcReport, NULL) * 1e6);
+		SimIdleReportNext = SimIdleReportUs;
+	}
+
+	simVectorsInit();
+	simFlashInit();
+	simSensorsInit();
+	simTraceInit();
+
+	pthread_create(&sThread, NULL, simTickThread, NULL);
+}
+
+//*****************************************************************************
+//
+// driverlib interrupt, SysTick and power functions.
+//
+//*****************************************************************************
+void IntEnable(uint32_t ui32Interrupt)
+{
+	simLock();
+	SimIntEnabled[ui32Interrupt] = true;
+	simUnlock();
+}
+
+void IntDisable(uint32_t ui32Interrupt)
+{
+	simLock();
+	SimIntEnabled[ui32Interrupt] = false;
+	simUnlock();
+}
+
+bool IntMasterEnable(void)
+{
+	bool bWasDisabled;
+
+	simLock();
+	bWasDisabled = !SimIntMaster;
+	SimIntMaster = true;
+	pthread_cond_signal(&SimWake);
+	simUnlock();
+
+	return(bWasDisabled);
+}
+
+bool IntMasterDisable(void)
+{
+	bool bWasDisabled;
+
+	simLock();
+	bWasDisabled = !SimIntMaster;
+	SimIntMaster = false;
+	simUnlock();
+
+	return(bWasDisabled);
+}
+
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority)
+{
+	simLock();
+	SimIntPriority[ui32Interrupt] = ui8Priority;
+	simUnlock();
+}
+
+void IntPendSet(uint32_t ui32Interrupt)
+{
+	simIntPend(ui32Interrupt);
+}
+
+/* Lock held */
+static void simSysTickUpdate(void)
+{
+	uint32_t ui32PeriodUs = 0;
+
+	if(SimSysTickEnabled && SimSysTickIntEnabled)
+	{
+		ui32PeriodUs = (uint32_t)((uint64_t)SimSysTickPeriod * 1000000u / WS_SIM_SYSCLOCK);
+	}
+	simSourceSet(WS_SimSourceSysTick, ui32PeriodUs, FAULT_SYSTICK, 0, 0);
+}
+
+void SysTickPeriodSet(uint32_t ui32Period)
+{
+	simLock();
+	SimSysTickPeriod = ui32Period;
+	simSysTickUpdate();
+	simUnlock();
+}
+
+void SysTickEnable(void)
+{
+	simLock();
+	SimSysTickEnabled = true;
+	simSysTickUpdate();
+	simUnlock();
+}
+
+void SysTickIntEnable(void)
+{
+	simLock();
+	SimSysTickIntEnabled = true;
+	simSysTickUpdate();
+	simUnlock();
+}
+
+void simIdleHookSet(void (*pfnHook)(void))
+{
+	SimIdleHook = pfnHook;
+}
+
+void simIdleStats(uint64_t *pui64Wakeups, uint64_t *pui64IdleUs)
+{
+	*pui64Wakeups = SimIdleWakeups;
+	*pui64IdleUs = SimIdleUs;
+}
+
+/* Print the idle accounting of the last report period. Firmware thread. */
+static void simIdleReport(uint64_t ui64Now)
+{
+	static uint64_t ui64Wakeups, ui64IdleUs, ui64Last;
+	static uint32_t ui32SysTicks;
+	double dSeconds = (double)(ui64Now - ui64Last) / 1e6;
+
+	fprintf(stderr, "idle: %.1f wakeups/s, %.1f SysTick/s, %.2f%% asleep\n",
+			(SimIdleWakeups - ui64Wakeups) / dSeconds,
+			(TickStats.ui32Wakeups - ui32SysTicks) / dSeconds,
+			100.0 * (double)(SimIdleUs - ui64IdleUs) / (double)(ui64Now - ui64Last));
+
+	ui64Wakeups = SimIdleWakeups;
+	ui64IdleUs = SimIdleUs;
+	ui32SysTicks = TickStats.ui32Wakeups;
+	ui64Last = ui64Now;
+}
+
+void SysCtlSleep(void)
+{
+	uint64_t ui64Start = simMicros();
+	uint64_t ui64Now;
+
+	/* WFI: wait for an interrupt and take it */
+	simIntWait(0);
+	ui64Now = simMicros();
+	SimIdleUs += ui64Now - ui64Start;
+	SimIdleWakeups++;
+	if(SimIdleReportUs && (ui64Now >= SimIdleReportNext))
+	{
+		simIdleReport(ui64Now);
+		SimIdleReportNext = ui64Now + SimIdleReportUs;
+	}
+
+	simIntDispatch();
+
+	if(SimIdleHook)
+	{
+		SimIdleHook();
+	}
+}
+
+void SysCtlDelay(uint32_t ui32Count)
+{
+	/* Three cycles per loop, interrupts are taken meanwhile */
+	uint64_t ui64Deadline = simMicros() + (uint64_t)ui32Count * 3 * 1000000u / WS_SIM_SYSCLOCK;
+
+	do
+	{
+		simIntDispatch();
+		simIntWait(ui64Deadline);
+	}
+	while(simMicros() < ui64Deadline);
+	simIntDispatch();
+}
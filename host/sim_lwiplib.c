@@ -0,0 +1,331 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "inc/hw_ints.h"
+#include "utils/lwiplib.h"
+#include "lwip/sys.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
+
+#include "weather_station/ws_time.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Host replacement of utils/lwiplib.c. The network interface is a
+ *  simulated link that delivers what is sent to the station's own address
+ *  back to it, so clients running in the same process (see the load
+ *  generator) reach the web server through the whole stack. Received frames
+ *  are queued and handed to lwIP from the Ethernet interrupt, as the Tiva
+ *  port does it. The gateway answers SNTP requests with the host's wall
+ *  clock. UDP datagrams to a multicast group go on to the host's network
+ *  (see sim_mcast.c). Everything else sent on the link is dropped. A tap
+ *  sees every packet delivered, so a benchmark can count the bytes on the
+ *  wire (see coapbench.c).
+ *
+ *  The address is static, DHCP is not run whatever ui32IPMode asks for. */
+//*****************************************************************************
+
+/* Address of the station on the simulated link, 10.0.0.2/24 */
+#define SIM_IPADDR(a)			IP4_ADDR((a), 10, 0, 0, 2)
+#define SIM_NETMASK(a)			IP4_ADDR((a), 255, 255, 255, 0)
+#define SIM_GWADDR(a)			IP4_ADDR((a), 10, 0, 0, 1)
+
+/* Frames in flight on the link */
+#define SIM_LINK_QUEUE_LEN		64
+
+/* IPv4 and UDP header fields the SNTP answer and the multicast forward touch */
+#define SIM_IP_TTL				8
+#define SIM_IP_PROTO			9
+#define SIM_IP_CHKSUM			10
+#define SIM_IP_SRC				12
+#define SIM_IP_DEST				16
+#define SIM_UDP_SRC				0
+#define SIM_UDP_DEST			2
+#define SIM_UDP_CHKSUM			6
+#define SIM_UDP_HLEN			8
+#define SIM_SNTP_LEN			48
+
+/* Longest multicast datagram forwarded to the host, with its headers */
+#define SIM_MCAST_MAX_LEN		576
+
+#if HOST_TMR_INTERVAL
+extern void lwIPHostTimerHandler(void);
+#endif
+
+static struct netif SimNetIF;
+static uint8_t SimMAC[6];
+
+static struct pbuf *SimLinkQueue[SIM_LINK_QUEUE_LEN];
+static uint32_t SimLinkHead;
+static uint32_t SimLinkCount;
+
+static uint32_t SimHostTimer;
+
+static void (*SimLinkTap)(const struct pbuf *p);
+
+/* Queue a frame for the station. The sender keeps its pbuf for
+ * retransmission, the link owns a copy. */
+static err_t simLinkDeliver(struct pbuf *p)
+{
+	struct pbuf *q;
+
+	if(SimLinkTap)
+	{
+		SimLinkTap(p);
+	}
+	if(SimLinkCount == SIM_LINK_QUEUE_LEN)
+	{
+		LINK_STATS_INC(link.drop);
+		return(ERR_OK);
+	}
+	q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+	if(!q)
+	{
+		LINK_STATS_INC(link.memerr);
+		return(ERR_MEM);
+	}
+	pbuf_copy(q, p);
+
+	SimLinkQueue[(SimLinkHead + SimLinkCount) % SIM_LINK_QUEUE_LEN] = q;
+	SimLinkCount++;
+	LINK_STATS_INC(link.xmit);
+
+	simIntPend(INT_EMAC0);
+
+	return(ERR_OK);
+}
+
+static void simNtpPut(uint8_t *pui8Stamp, const struct timespec *psTime)
+{
+	uint32_t ui32Seconds = (uint32_t)psTime->tv_sec + WS_NTP_UNIX_OFFSET;
+	uint32_t ui32Fraction = (uint32_t)(((uint64_t)psTime->tv_nsec << 32) / 1000000000u);
+
+	pui8Stamp[0] = (uint8_t)(ui32Seconds >> 24);
+	pui8Stamp[1] = (uint8_t)(ui32Seconds >> 16);
+	pui8Stamp[2] = (uint8_t)(ui32Seconds >> 8);
+	pui8Stamp[3] = (uint8_t)ui32Seconds;
+	pui8Stamp[4] = (uint8_t)(ui32Fraction >> 24);
+	pui8Stamp[5] = (uint8_t)(ui32Fraction >> 16);
+	pui8Stamp[6] = (uint8_t)(ui32Fraction >> 8);
+	pui8Stamp[7] = (uint8_t)ui32Fraction;
+}
+
+/* The gateway's SNTP server: answer a request in place, stratum 1 */
+static void simSntpAnswer(struct pbuf *p)
+{
+	uint8_t pui8Frame[128], pui8Swap[4], *pui8UDP, *pui8NTP;
+	uint32_t ui32IPLen;
+	struct timespec sNow;
+	struct pbuf *q;
+	u16_t ui16Sum;
+
+	ui32IPLen = (pbuf_get_at(p, 0) & 0x0F) * 4;
+	if((p->tot_len > sizeof(pui8Frame)) ||
+	   (p->tot_len < (ui32IPLen + SIM_UDP_HLEN + SIM_SNTP_LEN)))
+	{
+		return;
+	}
+	pbuf_copy_partial(p, pui8Frame, p->tot_len, 0);
+	pui8UDP = pui8Frame + ui32IPLen;
+	pui8NTP = pui8UDP + SIM_UDP_HLEN;
+	if((pui8Frame[SIM_IP_PROTO] != IP_PROTO_UDP) ||
+	   (((pui8UDP[SIM_UDP_DEST] << 8) | pui8UDP[SIM_UDP_DEST + 1]) != WS_SNTP_PORT))
+	{
+		return;
+	}
+
+	/* Back to the sender */
+	memcpy(pui8Swap, pui8Frame + SIM_IP_SRC, 4);
+	memcpy(pui8Frame + SIM_IP_SRC, pui8Frame + SIM_IP_DEST, 4);
+	memcpy(pui8Frame + SIM_IP_DEST, pui8Swap, 4);
+	memcpy(pui8Swap, pui8UDP + SIM_UDP_SRC, 2);
+	memcpy(pui8UDP + SIM_UDP_SRC, pui8UDP + SIM_UDP_DEST, 2);
+	memcpy(pui8UDP + SIM_UDP_DEST, pui8Swap, 2);
+	pui8Frame[SIM_IP_CHKSUM] = 0;
+	pui8Frame[SIM_IP_CHKSUM + 1] = 0;
+	ui16Sum = inet_chksum(pui8Frame, ui32IPLen);
+	memcpy(pui8Frame + SIM_IP_CHKSUM, &ui16Sum, 2);
+
+	/* No UDP checksum, IPv4 allows it */
+	pui8UDP[SIM_UDP_CHKSUM] = 0;
+	pui8UDP[SIM_UDP_CHKSUM + 1] = 0;
+
+	/* Version 4, server, stratum 1, the request's transmit time as the
+	 * originate time */
+	clock_gettime(CLOCK_REALTIME, &sNow);
+	memcpy(pui8NTP + 24, pui8NTP + 40, 8);
+	pui8NTP[0] = 0x24;
+	pui8NTP[1] = 1;
+	simNtpPut(pui8NTP + 32, &sNow);
+	simNtpPut(pui8NTP + 40, &sNow);
+
+	q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+	if(q)
+	{
+		pbuf_take(q, pui8Frame, p->tot_len);
+		simLinkDeliver(q);
+		pbuf_free(q);
+	}
+}
+
+/* A UDP datagram to a multicast group, out to the host */
+static void simMcastForward(struct pbuf *p, ip_addr_t *psGroup)
+{
+	uint8_t pui8Frame[SIM_MCAST_MAX_LEN], *pui8UDP;
+	uint32_t ui32IPLen;
+
+	ui32IPLen = (pbuf_get_at(p, 0) & 0x0F) * 4;
+	if((p->tot_len > sizeof(pui8Frame)) || (p->tot_len < (ui32IPLen + SIM_UDP_HLEN)))
+	{
+		return;
+	}
+	pbuf_copy_partial(p, pui8Frame, p->tot_len, 0);
+	pui8UDP = pui8Frame + ui32IPLen;
+	if(pui8Frame[SIM_IP_PROTO] != IP_PROTO_UDP)
+	{
+		return;
+	}
+
+	simMcastSend(psGroup->addr, (pui8UDP[SIM_UDP_DEST] << 8) | pui8UDP[SIM_UDP_DEST + 1],
+				 pui8Frame[SIM_IP_TTL], pui8UDP + SIM_UDP_HLEN,
+				 p->tot_len - ui32IPLen - SIM_UDP_HLEN);
+}
+
+static err_t simLinkOutput(struct netif *psNetIF, struct pbuf *p, ip_addr_t *psAddr)
+{
+	if(ip_addr_ismulticast(psAddr))
+	{
+		simMcastForward(p, psAddr);
+		return(ERR_OK);
+	}
+
+	if(ip_addr_cmp(psAddr, &psNetIF->gw))
+	{
+		simSntpAnswer(p);
+		return(ERR_OK);
+	}
+
+	if(!ip_addr_cmp(psAddr, &psNetIF->ip_addr))
+	{
+		LINK_STATS_INC(link.drop);
+		return(ERR_OK);
+	}
+
+	return(simLinkDeliver(p));
+}
+
+static err_t simLinkInit(struct netif *psNetIF)
+{
+	psNetIF->name[0] = 's';
+	psNetIF->name[1] = 'm';
+	psNetIF->output = simLinkOutput;
+	psNetIF->mtu = 1500;
+	psNetIF->hwaddr_len = 6;
+	memcpy(psNetIF->hwaddr, SimMAC, 6);
+	psNetIF->flags = NETIF_FLAG_LINK_UP;
+
+	return(ERR_OK);
+}
+
+void simLinkTapSet(void (*pfnTap)(const struct pbuf *p))
+{
+	SimLinkTap = pfnTap;
+}
+
+void lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8MAC, uint32_t ui32IPAddr,
+			  uint32_t ui32NetMask, uint32_t ui32GWAddr, uint32_t ui32IPMode)
+{
+	ip_addr_t sIPAddr, sNetMask, sGWAddr;
+
+	memcpy(SimMAC, pui8MAC, 6);
+
+	lwip_init();
+
+	SIM_IPADDR(&sIPAddr);
+	SIM_NETMASK(&sNetMask);
+	SIM_GWADDR(&sGWAddr);
+	netif_add(&SimNetIF, &sIPAddr, &sNetMask, &sGWAddr, NULL, simLinkInit, ip_input);
+	netif_set_default(&SimNetIF);
+	netif_set_up(&SimNetIF);
+}
+
+void lwIPTimer(uint32_t ui32TimeMS)
+{
+	sys_check_timeouts();
+
+#if HOST_TMR_INTERVAL
+	SimHostTimer += ui32TimeMS;
+	if(SimHostTimer >= HOST_TMR_INTERVAL)
+	{
+		SimHostTimer -= HOST_TMR_INTERVAL;
+		lwIPHostTimerHandler();
+	}
+#endif
+}
+
+void lwIPEthernetIntHandler(void)
+{
+	struct pbuf *p;
+	uint32_t ui32Frames = SimLinkCount;
+
+	/* Frames the handler sends itself wait for the next interrupt */
+	while(ui32Frames--)
+	{
+		p = SimLinkQueue[SimLinkHead];
+		SimLinkHead = (SimLinkHead + 1) % SIM_LINK_QUEUE_LEN;
+		SimLinkCount--;
+
+		LINK_STATS_INC(link.recv);
+		if(SimNetIF.input(p, &SimNetIF) != ERR_OK)
+		{
+			pbuf_free(p);
+		}
+	}
+}
+
+uint32_t lwIPLocalIPAddrGet(void)
+{
+	return((uint32_t)SimNetIF.ip_addr.addr);
+}
+
+uint32_t lwIPLocalNetMaskGet(void)
+{
+	return((uint32_t)SimNetIF.netmask.addr);
+}
+
+uint32_t lwIPLocalGWAddrGet(void)
+{
+	return((uint32_t)SimNetIF.gw.addr);
+}
+
+void lwIPLocalMACGet(uint8_t *pui8MAC)
+{
+	memcpy(pui8MAC, SimMAC, 6);
+}
+
+void lwIPNetworkConfigChange(uint32_t ui32IPAddr, uint32_t ui32NetMask, uint32_t ui32GWAddr,
+							 uint32_t ui32IPMode)
+{
+}
+
+//*****************************************************************************
+//
+// NO_SYS port functions.
+//
+//*****************************************************************************
+u32_t sys_now(void)
+{
+	return(simMillis());
+}
+
+sys_prot_t sys_arch_protect(void)
+{
+	return(0);
+}
+
+void sys_arch_unprotect(sys_prot_t xValue)
+{
+}
@@ -0,0 +1,82 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  The simulated link's way out to the host: the UDP datagrams the station
+ *  sends to a multicast group are sent again, same group and port, from a
+ *  socket of the host. The interface defaults to the loopback one, so
+ *  receivers on the same machine get them; WS_SIM_MCAST_IF=<address> in the
+ *  environment names the address of another one.
+ *
+ *  This file has no lwIP headers, they clash with the BSD socket ones. */
+//*****************************************************************************
+
+#define SIM_MCAST_IF_DEFAULT	"127.0.0.1"
+
+static int SimMcastSocket = -1;
+static bool SimMcastFailed;
+
+static bool simMcastOpen(void)
+{
+	const char *pcIf = getenv("WS_SIM_MCAST_IF");
+	struct in_addr sIf;
+	unsigned char ucLoop = 1;
+
+	if(!pcIf)
+	{
+		pcIf = SIM_MCAST_IF_DEFAULT;
+	}
+	if(!inet_aton(pcIf, &sIf))
+	{
+		fprintf(stderr, "WS_SIM_MCAST_IF: %s is not an address\n", pcIf);
+		return(false);
+	}
+
+	SimMcastSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if(SimMcastSocket < 0)
+	{
+		perror("multicast socket");
+		return(false);
+	}
+	if(setsockopt(SimMcastSocket, IPPROTO_IP, IP_MULTICAST_IF, &sIf, sizeof(sIf)) ||
+	   setsockopt(SimMcastSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &ucLoop, sizeof(ucLoop)))
+	{
+		perror("multicast socket");
+		close(SimMcastSocket);
+		SimMcastSocket = -1;
+		return(false);
+	}
+
+	return(true);
+}
+
+void simMcastSend(uint32_t ui32Group, uint16_t ui16Port, uint8_t ui8TTL, const uint8_t *pui8Data,
+				  uint32_t ui32Len)
+{
+	struct sockaddr_in sDest;
+	unsigned char ucTTL = ui8TTL;
+
+	/* One complaint, then the datagrams are dropped as on a dead link */
+	if(SimMcastFailed || ((SimMcastSocket < 0) && !simMcastOpen()))
+	{
+		SimMcastFailed = true;
+		return;
+	}
+
+	setsockopt(SimMcastSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ucTTL, sizeof(ucTTL));
+
+	memset(&sDest, 0, sizeof(sDest));
+	sDest.sin_family = AF_INET;
+	sDest.sin_addr.s_addr = ui32Group;
+	sDest.sin_port = htons(ui16Port);
+	sendto(SimMcastSocket, pui8Data, ui32Len, 0, (struct sockaddr *)&sDest, sizeof(sDest));
+}
@@ -0,0 +1,523 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Register level models of the BoosterPack sensors: TMP006, SHT21, BMP180
+ *  and ISL29023. The readings follow a slowly varying synthetic weather with
+ *  a little noise. Conversions finish instantly, every read returns a fresh
+ *  measurement.
+ *
+ *  A copy of each sensor answers on both buses, so any bus assignment in the
+ *  firmware's SensorConfig table finds its devices. */
+//*****************************************************************************
+
+#define SIM_PI					3.14159265358979
+
+/* I2C addresses, the same as in weather_station.h */
+#define SIM_TMP006_ADDR			0x41
+#define SIM_SHT21_ADDR			0x40
+#define SIM_BMP180_ADDR			0x77
+#define SIM_ISL29023_ADDR		0x44
+
+/* TMP006 registers and configuration bits */
+#define TMP006_REG_VOBJECT		0x00
+#define TMP006_REG_TAMBIENT		0x01
+#define TMP006_REG_CONFIG		0x02
+#define TMP006_REG_MANUF_ID		0xFE
+#define TMP006_REG_DEVICE_ID	0xFF
+#define TMP006_CFG_RESET		0x8000
+#define TMP006_CFG_MOD_M		0x7000
+#define TMP006_CFG_CR_S			9
+#define TMP006_CFG_CR_M			0x0E00
+#define TMP006_CFG_EN_DRDY		0x0100
+#define TMP006_CFG_DRDY			0x0080
+#define TMP006_CFG_DEFAULT		0x7400
+/* Object voltage equal to the sensor offset voltage (-29.4 uV in 156.25 nV
+ * steps), the object temperature then equals the die temperature */
+#define TMP006_VOBJ_NEUTRAL		(-188)
+
+/* SHT21 commands */
+#define SHT21_TEMP_HOLD			0xE3
+#define SHT21_RH_HOLD			0xE5
+#define SHT21_TEMP_NOHOLD		0xF3
+#define SHT21_RH_NOHOLD			0xF5
+#define SHT21_USER_WRITE		0xE6
+#define SHT21_USER_READ			0xE7
+#define SHT21_SOFT_RESET		0xFE
+#define SHT21_USER_DEFAULT		0x02
+
+/* BMP180 registers */
+#define BMP180_REG_CALIB		0xAA
+#define BMP180_REG_ID			0xD0
+#define BMP180_REG_RESET		0xE0
+#define BMP180_REG_CTRL			0xF4
+#define BMP180_REG_OUT			0xF6
+#define BMP180_CHIP_ID			0x55
+#define BMP180_CTRL_SCO			0x20
+#define BMP180_CTRL_TEMP		0x2E
+
+/* ISL29023 registers */
+#define ISL29023_REG_CMD_I		0x00
+#define ISL29023_REG_CMD_II		0x01
+#define ISL29023_REG_DATA_L		0x02
+#define ISL29023_REG_INT_LT		0x04
+#define ISL29023_REG_INT_HT		0x06
+#define ISL29023_CMD_I_OP_M		0xE0
+#define ISL29023_CMD_I_INT_FLAG	0x04
+#define ISL29023_NUM_REGS		8
+
+typedef struct {
+	double dTemperature;		/* degC */
+	double dHumidity;			/* %RH */
+	double dPressure;			/* Pa at the sensor */
+	double dLight;				/* lux */
+}SimWeather_t;
+
+typedef struct {
+	uint8_t ui8Ptr;
+	uint16_t ui16Config;
+}SimTMP006_t;
+
+typedef struct {
+	uint8_t ui8Command;
+	uint8_t ui8User;
+}SimSHT21_t;
+
+typedef struct {
+	uint8_t ui8Ptr;
+	uint8_t pui8Regs[256];
+}SimBMP180_t;
+
+typedef struct {
+	uint8_t ui8Ptr;
+	uint8_t pui8Regs[ISL29023_NUM_REGS];
+}SimISL29023_t;
+
+/* BMP180 calibration, the example set of the datasheet */
+static const int16_t BMP180Calib[11] =
+{
+	408, -72, -14383, (int16_t)32741, (int16_t)32757, 23153, 6190, 4, -32768, -8711, 2868
+};
+
+static uint32_t SimNoiseState = 0x2545F491u;
+
+static SimTMP006_t SimTMP006[2];
+static SimSHT21_t SimSHT21[2];
+static SimBMP180_t SimBMP180[2];
+static SimISL29023_t SimISL29023[2];
+
+static const uint32_t SimBuses[2] = { I2C7_BASE, I2C8_BASE };
+
+//*****************************************************************************
+//
+// Synthetic weather.
+//
+//*****************************************************************************
+/* Uniform noise in [-dAmplitude, dAmplitude] */
+static double simNoise(double dAmplitude)
+{
+	SimNoiseState = SimNoiseState * 1664525u + 1013904223u;
+	return(dAmplitude * ((double)(SimNoiseState >> 8) / (double)(1u << 23) - 1.0));
+}
+
+static void simWeather(SimWeather_t *psWeather)
+{
+	double dT = simMicros() / 1e6;
+
+	psWeather->dTemperature = 21.0 + 4.0 * sin(2 * SIM_PI * dT / 900.0) + simNoise(0.05);
+	psWeather->dHumidity = 50.0 + 15.0 * sin(2 * SIM_PI * dT / 1200.0 + 1.0) + simNoise(0.3);
+	psWeather->dPressure = 101325.0 + 120.0 * sin(2 * SIM_PI * dT / 3600.0) + simNoise(4.0);
+	psWeather->dLight = 400.0 + 350.0 * sin(2 * SIM_PI * dT / 300.0) + simNoise(2.0);
+}
+
+//*****************************************************************************
+//
+// TMP006 infrared thermopile.
+//
+//*****************************************************************************
+static void simTMP006DRDY(SimTMP006_t *psDev)
+{
+	static const uint32_t pui32PeriodMs[8] = { 250, 500, 1000, 2000, 4000, 4000, 4000, 4000 };
+	uint32_t ui32PeriodUs = 0;
+
+	/* The DRDY pin pulses once per conversion when enabled */
+	if((psDev->ui16Config & TMP006_CFG_MOD_M) && (psDev->ui16Config & TMP006_CFG_EN_DRDY))
+	{
+		ui32PeriodUs = pui32PeriodMs[(psDev->ui16Config & TMP006_CFG_CR_M) >> TMP006_CFG_CR_S] * 1000;
+	}
+
+	simLock();
+	simSourceSet(WS_SimSourceTempDRDY, ui32PeriodUs, INT_GPIOH, GPIO_PORTH_BASE, GPIO_PIN_2);
+	simUnlock();
+}
+
+static void simTMP006Write(void *pvDevice, const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimTMP006_t *psDev = pvDevice;
+	uint16_t ui16Value;
+
+	psDev->ui8Ptr = pui8Data[0];
+	if((ui32Count < 3) || (psDev->ui8Ptr != TMP006_REG_CONFIG))
+	{
+		return;
+	}
+
+	ui16Value = (pui8Data[1] << 8) | pui8Data[2];
+	if(ui16Value & TMP006_CFG_RESET)
+	{
+		psDev->ui16Config = TMP006_CFG_DEFAULT;
+	}
+	else
+	{
+		psDev->ui16Config = ui16Value & ~TMP006_CFG_DRDY;
+	}
+	simTMP006DRDY(psDev);
+}
+
+static void simTMP006Read(void *pvDevice, uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimTMP006_t *psDev = pvDevice;
+	SimWeather_t sWeather;
+	uint16_t ui16Value;
+	uint32_t ui32Idx;
+
+	switch(psDev->ui8Ptr)
+	{
+		case TMP006_REG_VOBJECT:
+			ui16Value = (uint16_t)TMP006_VOBJ_NEUTRAL;
+			break;
+		case TMP006_REG_TAMBIENT:
+			/* 14 bit, 1/32 degC, left aligned */
+			simWeather(&sWeather);
+			ui16Value = (uint16_t)((int16_t)lround(sWeather.dTemperature * 32.0) << 2);
+			break;
+		case TMP006_REG_CONFIG:
+			ui16Value = psDev->ui16Config | TMP006_CFG_DRDY;
+			break;
+		case TMP006_REG_MANUF_ID:
+			ui16Value = 0x5449;
+			break;
+		case TMP006_REG_DEVICE_ID:
+			ui16Value = 0x0067;
+			break;
+		default:
+			ui16Value = 0;
+			break;
+	}
+
+	for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+	{
+		pui8Data[ui32Idx] = (ui32Idx & 1) ? (ui16Value & 0xff) : (ui16Value >> 8);
+	}
+}
+
+//*****************************************************************************
+//
+// SHT21 humidity sensor.
+//
+//*****************************************************************************
+static uint8_t simSHT21CRC(const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint8_t ui8CRC = 0;
+	uint32_t ui32Bit;
+
+	/* x^8 + x^5 + x^4 + 1 */
+	while(ui32Count--)
+	{
+		ui8CRC ^= *pui8Data++;
+		for(ui32Bit = 0; ui32Bit < 8; ui32Bit++)
+		{
+			ui8CRC = (ui8CRC & 0x80) ? ((ui8CRC << 1) ^ 0x31) : (ui8CRC << 1);
+		}
+	}
+
+	return(ui8CRC);
+}
+
+static void simSHT21Write(void *pvDevice, const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimSHT21_t *psDev = pvDevice;
+
+	psDev->ui8Command = pui8Data[0];
+	if(psDev->ui8Command == SHT21_SOFT_RESET)
+	{
+		psDev->ui8User = SHT21_USER_DEFAULT;
+	}
+	else if((psDev->ui8Command == SHT21_USER_WRITE) && (ui32Count > 1))
+	{
+		psDev->ui8User = pui8Data[1];
+	}
+}
+
+static void simSHT21Read(void *pvDevice, uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimSHT21_t *psDev = pvDevice;
+	SimWeather_t sWeather;
+	uint8_t pui8Out[3];
+	uint16_t ui16Raw;
+
+	if(psDev->ui8Command == SHT21_USER_READ)
+	{
+		memset(pui8Data, psDev->ui8User, ui32Count);
+		return;
+	}
+
+	simWeather(&sWeather);
+	if((psDev->ui8Command == SHT21_TEMP_HOLD) || (psDev->ui8Command == SHT21_TEMP_NOHOLD))
+	{
+		ui16Raw = (uint16_t)((sWeather.dTemperature + 46.85) / 175.72 * 65536.0) & 0xFFFC;
+	}
+	else
+	{
+		/* Bit 1 marks a humidity result */
+		ui16Raw = ((uint16_t)((sWeather.dHumidity + 6.0) / 125.0 * 65536.0) & 0xFFFC) | 0x0002;
+	}
+
+	pui8Out[0] = ui16Raw >> 8;
+	pui8Out[1] = ui16Raw & 0xff;
+	pui8Out[2] = simSHT21CRC(pui8Out, 2);
+	memcpy(pui8Data, pui8Out, (ui32Count < 3) ? ui32Count : 3);
+}
+
+//*****************************************************************************
+//
+// BMP180 barometer. The raw values are found by bisection on the datasheet's
+// compensation, so the driver reads back the simulated weather.
+//
+//*****************************************************************************
+static int32_t simBMP180B5(int32_t i32UT)
+{
+	int32_t i32X1 = ((i32UT - (uint16_t)BMP180Calib[5]) * (uint16_t)BMP180Calib[4]) >> 15;
+	int32_t i32X2 = ((int32_t)BMP180Calib[9] << 11) / (i32X1 + BMP180Calib[10]);
+
+	return(i32X1 + i32X2);
+}
+
+static int32_t simBMP180Pressure(int32_t i32UP, int32_t i32B5, uint32_t ui32OSS)
+{
+	int32_t i32B6, i32X1, i32X2, i32X3, i32B3, i32P;
+	uint32_t ui32B4, ui32B7;
+
+	i32B6 = i32B5 - 4000;
+	i32X1 = (BMP180Calib[7] * ((i32B6 * i32B6) >> 12)) >> 11;
+	i32X2 = (BMP180Calib[1] * i32B6) >> 11;
+	i32X3 = i32X1 + i32X2;
+	i32B3 = ((((int32_t)BMP180Calib[0] * 4 + i32X3) << ui32OSS) + 2) >> 2;
+	i32X1 = (BMP180Calib[2] * i32B6) >> 13;
+	i32X2 = (BMP180Calib[6] * ((i32B6 * i32B6) >> 12)) >> 16;
+	i32X3 = ((i32X1 + i32X2) + 2) >> 2;
+	ui32B4 = ((uint32_t)(uint16_t)BMP180Calib[3] * (uint32_t)(i32X3 + 32768)) >> 15;
+	ui32B7 = ((uint32_t)i32UP - i32B3) * (50000 >> ui32OSS);
+	i32P = (ui32B7 < 0x80000000) ? (int32_t)((ui32B7 * 2) / ui32B4) : (int32_t)((ui32B7 / ui32B4) * 2);
+	i32X1 = (i32P >> 8) * (i32P >> 8);
+	i32X1 = (i32X1 * 3038) >> 16;
+	i32X2 = (-7357 * i32P) >> 16;
+
+	return(i32P + ((i32X1 + i32X2 + 3791) >> 4));
+}
+
+static void simBMP180Convert(SimBMP180_t *psDev, uint8_t ui8Ctrl)
+{
+	SimWeather_t sWeather;
+	uint32_t ui32OSS = ui8Ctrl >> 6;
+	uint32_t ui32Raw;
+	int32_t i32Low, i32High, i32Mid, i32UT, i32B5;
+
+	simWeather(&sWeather);
+
+	/* The temperature calibration also drives the pressure compensation */
+	i32Low = 0;
+	i32High = 0xFFFF;
+	while(i32Low < i32High)
+	{
+		i32Mid = (i32Low + i32High) / 2;
+		if(((simBMP180B5(i32Mid) + 8) >> 4) < lround(sWeather.dTemperature * 10.0))
+		{
+			i32Low = i32Mid + 1;
+		}
+		else
+		{
+			i32High = i32Mid;
+		}
+	}
+	i32UT = i32Low;
+
+	if((ui8Ctrl & 0x3F) == BMP180_CTRL_TEMP)
+	{
+		ui32Raw = (uint32_t)i32UT << 8;
+	}
+	else
+	{
+		i32B5 = simBMP180B5(i32UT);
+		i32Low = 0;
+		i32High = (1 << (16 + ui32OSS)) - 1;
+		while(i32Low < i32High)
+		{
+			i32Mid = (i32Low + i32High) / 2;
+			if(simBMP180Pressure(i32Mid, i32B5, ui32OSS) < lround(sWeather.dPressure))
+			{
+				i32Low = i32Mid + 1;
+			}
+			else
+			{
+				i32High = i32Mid;
+			}
+		}
+		ui32Raw = (uint32_t)i32Low << (8 - ui32OSS);
+	}
+
+	psDev->pui8Regs[BMP180_REG_OUT] = (ui32Raw >> 16) & 0xff;
+	psDev->pui8Regs[BMP180_REG_OUT + 1] = (ui32Raw >> 8) & 0xff;
+	psDev->pui8Regs[BMP180_REG_OUT + 2] = ui32Raw & 0xff;
+	psDev->pui8Regs[BMP180_REG_CTRL] = ui8Ctrl & ~BMP180_CTRL_SCO;
+}
+
+static void simBMP180Reset(SimBMP180_t *psDev)
+{
+	uint32_t ui32Idx;
+
+	memset(psDev->pui8Regs, 0, sizeof(psDev->pui8Regs));
+	for(ui32Idx = 0; ui32Idx < 11; ui32Idx++)
+	{
+		psDev->pui8Regs[BMP180_REG_CALIB + ui32Idx * 2] = (uint16_t)BMP180Calib[ui32Idx] >> 8;
+		psDev->pui8Regs[BMP180_REG_CALIB + ui32Idx * 2 + 1] = (uint16_t)BMP180Calib[ui32Idx] & 0xff;
+	}
+	psDev->pui8Regs[BMP180_REG_ID] = BMP180_CHIP_ID;
+}
+
+static void simBMP180Write(void *pvDevice, const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimBMP180_t *psDev = pvDevice;
+	uint32_t ui32Idx;
+
+	psDev->ui8Ptr = pui8Data[0];
+	for(ui32Idx = 1; ui32Idx < ui32Count; ui32Idx++, psDev->ui8Ptr++)
+	{
+		if(psDev->ui8Ptr == BMP180_REG_CTRL)
+		{
+			simBMP180Convert(psDev, pui8Data[ui32Idx]);
+		}
+		else if((psDev->ui8Ptr == BMP180_REG_RESET) && (pui8Data[ui32Idx] == 0xB6))
+		{
+			simBMP180Reset(psDev);
+		}
+	}
+}
+
+static void simBMP180Read(void *pvDevice, uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimBMP180_t *psDev = pvDevice;
+
+	while(ui32Count--)
+	{
+		*pui8Data++ = psDev->pui8Regs[psDev->ui8Ptr++];
+	}
+}
+
+//*****************************************************************************
+//
+// ISL29023 ambient light sensor.
+//
+//*****************************************************************************
+static void simISL29023Convert(SimISL29023_t *psDev)
+{
+	static const double pdRange[4] = { 1000.0, 4000.0, 16000.0, 64000.0 };
+	SimWeather_t sWeather;
+	uint8_t ui8CmdII = psDev->pui8Regs[ISL29023_REG_CMD_II];
+	uint32_t ui32Bits = 16 - 4 * ((ui8CmdII >> 2) & 3);
+	uint32_t ui32Max = (1u << ui32Bits) - 1;
+	uint32_t ui32Count, ui32Low, ui32High;
+	double dCount;
+
+	simWeather(&sWeather);
+	dCount = sWeather.dLight / pdRange[ui8CmdII & 3] * (double)(1u << ui32Bits);
+	ui32Count = (dCount <= 0.0) ? 0 : (dCount >= ui32Max) ? ui32Max : (uint32_t)dCount;
+
+	psDev->pui8Regs[ISL29023_REG_DATA_L] = ui32Count & 0xff;
+	psDev->pui8Regs[ISL29023_REG_DATA_L + 1] = ui32Count >> 8;
+
+	/* Out of the threshold window: set the flag and pull the INT pin */
+	ui32Low = psDev->pui8Regs[ISL29023_REG_INT_LT] | (psDev->pui8Regs[ISL29023_REG_INT_LT + 1] << 8);
+	ui32High = psDev->pui8Regs[ISL29023_REG_INT_HT] | (psDev->pui8Regs[ISL29023_REG_INT_HT + 1] << 8);
+	if((psDev->pui8Regs[ISL29023_REG_CMD_I] & ISL29023_CMD_I_OP_M) &&
+	   !(psDev->pui8Regs[ISL29023_REG_CMD_I] & ISL29023_CMD_I_INT_FLAG) &&
+	   ((ui32Count < ui32Low) || (ui32Count > ui32High)))
+	{
+		psDev->pui8Regs[ISL29023_REG_CMD_I] |= ISL29023_CMD_I_INT_FLAG;
+		simLock();
+		simGPIOEdge(GPIO_PORTE_BASE, GPIO_PIN_5);
+		simUnlock();
+	}
+}
+
+static void simISL29023Write(void *pvDevice, const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimISL29023_t *psDev = pvDevice;
+	uint32_t ui32Idx;
+
+	psDev->ui8Ptr = pui8Data[0];
+	for(ui32Idx = 1; ui32Idx < ui32Count; ui32Idx++, psDev->ui8Ptr++)
+	{
+		if(psDev->ui8Ptr < ISL29023_NUM_REGS)
+		{
+			psDev->pui8Regs[psDev->ui8Ptr] = pui8Data[ui32Idx];
+		}
+	}
+}
+
+static void simISL29023Read(void *pvDevice, uint8_t *pui8Data, uint32_t ui32Count)
+{
+	SimISL29023_t *psDev = pvDevice;
+
+	if(psDev->ui8Ptr == ISL29023_REG_DATA_L)
+	{
+		simISL29023Convert(psDev);
+	}
+
+	while(ui32Count--)
+	{
+		*pui8Data++ = (psDev->ui8Ptr < ISL29023_NUM_REGS) ? psDev->pui8Regs[psDev->ui8Ptr] : 0;
+		psDev->ui8Ptr++;
+	}
+}
+
+//*****************************************************************************
+//
+// Attach a copy of every sensor to both buses.
+//
+//*****************************************************************************
+static WS_SimI2CDevice_t SimDevices[2][4];
+
+void simSensorsInit(void)
+{
+	uint32_t ui32Bus;
+
+	for(ui32Bus = 0; ui32Bus < 2; ui32Bus++)
+	{
+		SimTMP006[ui32Bus].ui16Config = TMP006_CFG_DEFAULT;
+		SimSHT21[ui32Bus].ui8User = SHT21_USER_DEFAULT;
+		simBMP180Reset(&SimBMP180[ui32Bus]);
+
+		SimDevices[ui32Bus][0] = (WS_SimI2CDevice_t){ SIM_TMP006_ADDR, &SimTMP006[ui32Bus],
+													  simTMP006Write, simTMP006Read };
+		SimDevices[ui32Bus][1] = (WS_SimI2CDevice_t){ SIM_SHT21_ADDR, &SimSHT21[ui32Bus],
+													  simSHT21Write, simSHT21Read };
+		SimDevices[ui32Bus][2] = (WS_SimI2CDevice_t){ SIM_BMP180_ADDR, &SimBMP180[ui32Bus],
+													  simBMP180Write, simBMP180Read };
+		SimDevices[ui32Bus][3] = (WS_SimI2CDevice_t){ SIM_ISL29023_ADDR, &SimISL29023[ui32Bus],
+													  simISL29023Write, simISL29023Read };
+
+		simI2CAttach(SimBuses[ui32Bus], &SimDevices[ui32Bus][0]);
+		simI2CAttach(SimBuses[ui32Bus], &SimDevices[ui32Bus][1]);
+		simI2CAttach(SimBuses[ui32Bus], &SimDevices[ui32Bus][2]);
+		simI2CAttach(SimBuses[ui32Bus], &SimDevices[ui32Bus][3]);
+	}
+}
@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "weather_station/ws_stack.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Host side of the stack monitor. The firmware runs on the host thread's
+ *  stack, which has nothing in common with the 1 KB system stack. stackInit
+ *  paints SIM_STACK_BYTES of it below its own frame, the report gives how
+ *  deep the simulation went into that window, frames of the host's libc
+ *  included.
+ *
+ *  Under AddressSanitizer the window is not painted: the live frames in it
+ *  have poisoned red zones that stackScan would read. The report gives 0
+ *  then, as before. */
+//*****************************************************************************
+#define SIM_STACK_BYTES			(64 * 1024)
+
+#if defined(__SANITIZE_ADDRESS__)
+#define SIM_STACK_PAINT			0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SIM_STACK_PAINT			0
+#endif
+#endif
+#ifndef SIM_STACK_PAINT
+#define SIM_STACK_PAINT			1
+#endif
+
+static uint32_t SimStackMaxNesting;
+
+/* The painted window, kept as addresses: it outlives the frame that holds it
+ * while painting */
+static uintptr_t SimStackLow, SimStackHigh;
+
+#if SIM_STACK_PAINT
+static void __attribute__((noinline)) simStackPaint(void)
+{
+	uint32_t pui32Window[SIM_STACK_BYTES / 4];
+
+	stackPaint(pui32Window, pui32Window + SIM_STACK_BYTES / 4);
+	SimStackLow = (uintptr_t)pui32Window;
+	SimStackHigh = (uintptr_t)(pui32Window + SIM_STACK_BYTES / 4);
+}
+#endif
+
+void stackInit(void)
+{
+#if SIM_STACK_PAINT
+	simStackPaint();
+#endif
+}
+
+void stackSampleNesting(void)
+{
+	if(simIntNesting() > SimStackMaxNesting)
+	{
+		SimStackMaxNesting = simIntNesting();
+	}
+}
+
+void stackReport(WS_StackReport_t *psReport)
+{
+	psReport->ui32Size = 0;
+	psReport->ui32Used = 0;
+	if(SimStackHigh)
+	{
+		psReport->ui32Size = SIM_STACK_BYTES;
+		psReport->ui32Used = SIM_STACK_BYTES - stackScan((const uint32_t *)SimStackLow,
+														 (const uint32_t *)SimStackHigh);
+	}
+	psReport->ui32MaxNesting = SimStackMaxNesting;
+}
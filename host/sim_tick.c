@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "driverlib/systick.h"
+
+#include "weather_station/ws_tick.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Host side of the tickless timekeeping. The simulated clock stands in for
+ *  the free running timer, SysTick is the simulated one: a new period restarts
+ *  it, like the write of the current value register on the target.
+ *
+ *  The timer starts one second before it wraps, so every run goes through
+ *  the 64 bit extension early. WS_SIM_TICK_START=<count> starts it
+ *  elsewhere. */
+//*****************************************************************************
+
+static uint32_t SimTickStart = 0u - WS_TICK_CLOCKS_PER_US * 1000000u;
+
+void tickHwInit(void)
+{
+	const char *pcStart = getenv("WS_SIM_TICK_START");
+
+	if(pcStart)
+	{
+		SimTickStart = (uint32_t)strtoul(pcStart, NULL, 0);
+	}
+
+	SysTickPeriodSet(WS_TICK_MAX_US * WS_TICK_CLOCKS_PER_US);
+	SysTickEnable();
+	SysTickIntEnable();
+}
+
+uint32_t tickHwCount(void)
+{
+	return(SimTickStart + (uint32_t)(simMicros() * WS_TICK_CLOCKS_PER_US));
+}
+
+void tickHwArm(uint32_t ui32Clocks)
+{
+	SysTickPeriodSet(ui32Clocks);
+}
@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "weather_station/ws_trace.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Replay of a sensor I2C trace (weather_station/ws_trace.h).
+ *
+ *  With WS_SIM_TRACE=<file> in the environment the sensors answer with the
+ *  recorded data: a transaction takes the read bytes and the status of the
+ *  next record of its bus with the same address and write bytes. Records are
+ *  searched a few ahead so a run that issues a transaction more or fewer
+ *  times than the capture, a retry or the first configuration writes, stays
+ *  in step. The sensor models still see every transaction, they keep
+ *  producing the data ready and threshold interrupts that pace the firmware.
+ *
+ *  The run ends when a bus has replayed its last record, with a summary on
+ *  stderr. WS_SIM_SPEED runs the whole simulation, and so the replay, faster
+ *  than real time. */
+//*****************************************************************************
+
+/* Records looked ahead for a match */
+#define SIM_TRACE_WINDOW		16
+
+#define SIM_TRACE_MAX_BUSES		4
+
+static WS_TraceRecord_t *SimTraceRecords;
+static uint32_t SimTraceCount;
+static uint32_t SimTraceCursor[SIM_TRACE_MAX_BUSES];
+static uint32_t SimTraceHits;
+static uint32_t SimTraceMisses;
+
+void simTraceInit(void)
+{
+	const char *pcPath = getenv("WS_SIM_TRACE");
+	WS_TraceReader_t sReader;
+	uint8_t *pui8Data;
+	uint32_t ui32Size;
+	long lSize;
+	FILE *psFile;
+
+	if(!pcPath)
+	{
+		return;
+	}
+
+	psFile = fopen(pcPath, "rb");
+	if(!psFile)
+	{
+		perror(pcPath);
+		exit(1);
+	}
+	fseek(psFile, 0, SEEK_END);
+	lSize = ftell(psFile);
+	rewind(psFile);
+	pui8Data = malloc(lSize > 0 ? lSize : 1);
+	if(!pui8Data || (fread(pui8Data, 1, lSize, psFile) != (size_t)lSize))
+	{
+		fprintf(stderr, "%s: cannot read the trace\n", pcPath);
+		exit(1);
+	}
+	fclose(psFile);
+	ui32Size = (uint32_t)lSize;
+
+	if(!traceReaderInit(&sReader, pui8Data, ui32Size))
+	{
+		fprintf(stderr, "%s: not a sensor trace\n", pcPath);
+		exit(1);
+	}
+
+	/* Decoded once, the replay searches the records */
+	SimTraceRecords = malloc((ui32Size / 3 + 1) * sizeof(WS_TraceRecord_t));
+	while(traceReaderNext(&sReader, &SimTraceRecords[SimTraceCount]))
+	{
+		SimTraceCount++;
+	}
+	free(pui8Data);
+
+	fprintf(stderr, "Replaying %u sensor transactions from %s\n", SimTraceCount, pcPath);
+}
+
+static void simTraceEnd(uint32_t ui32Bus)
+{
+	fprintf(stderr, "Trace replayed on bus %u at %u ms: %u transactions matched, %u not in the "
+			"trace\n", ui32Bus, simMillis(), SimTraceHits, SimTraceMisses);
+	exit(0);
+}
+
+bool simTraceReplay(uint32_t ui32Bus, uint8_t ui8Addr, const uint8_t *pui8Write,
+					uint32_t ui32WriteCount, uint8_t *pui8Read, uint32_t ui32ReadCount,
+					uint_fast8_t *pui8Status)
+{
+	const WS_TraceRecord_t *psRecord;
+	uint32_t ui32Idx, ui32Seen;
+
+	if(!SimTraceRecords || (ui32Bus >= SIM_TRACE_MAX_BUSES))
+	{
+		return(false);
+	}
+
+	if(ui32WriteCount > WS_TRACE_MAX_DATA)
+	{
+		ui32WriteCount = WS_TRACE_MAX_DATA;
+	}
+
+	for(ui32Idx = SimTraceCursor[ui32Bus], ui32Seen = 0;
+		(ui32Idx < SimTraceCount) && (ui32Seen < SIM_TRACE_WINDOW); ui32Idx++)
+	{
+		psRecord = &SimTraceRecords[ui32Idx];
+		if(psRecord->ui8Bus != ui32Bus)
+		{
+			continue;
+		}
+		ui32Seen++;
+
+		if((psRecord->ui8Addr != ui8Addr) || (psRecord->ui8WriteCount != ui32WriteCount) ||
+		   memcmp(psRecord->pui8Write, pui8Write, ui32WriteCount))
+		{
+			continue;
+		}
+
+		if(ui32ReadCount > psRecord->ui8ReadCount)
+		{
+			ui32ReadCount = psRecord->ui8ReadCount;
+		}
+		memcpy(pui8Read, psRecord->pui8Read, ui32ReadCount);
+		*pui8Status = psRecord->ui8Status;
+
+		SimTraceHits++;
+		SimTraceCursor[ui32Bus] = ui32Idx + 1;
+
+		/* Nothing left for this bus */
+		for(ui32Idx++; ui32Idx < SimTraceCount; ui32Idx++)
+		{
+			if(SimTraceRecords[ui32Idx].ui8Bus == ui32Bus)
+			{
+				return(true);
+			}
+		}
+		simTraceEnd(ui32Bus);
+	}
+
+	SimTraceMisses++;
+	return(false);
+}
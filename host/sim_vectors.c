@@ -0,0 +1,29 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_ints.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Vector table of the host build, the counterpart of g_pfnVectors in
+ *  startup_ccs.c. Only the vectors the firmware fills in are listed. */
+//*****************************************************************************
+extern void SysTickIntHandler(void);
+extern void EthernetIntHandler(void);
+extern void AnimTimerIntHandler(void);
+extern void UniversalI2CIntHandler(void);
+extern void UniversalI2C8IntHandler(void);
+extern void TempIntHandler(void);
+extern void LightIntHandler(void);
+
+void simVectorsInit(void)
+{
+	simVectorSet(FAULT_SYSTICK, SysTickIntHandler);
+	simVectorSet(INT_GPIOE, LightIntHandler);
+	simVectorSet(INT_GPIOH, TempIntHandler);
+	simVectorSet(INT_TIMER2A, AnimTimerIntHandler);
+	simVectorSet(INT_EMAC0, EthernetIntHandler);
+	simVectorSet(INT_I2C7, UniversalI2CIntHandler);
+	simVectorSet(INT_I2C8, UniversalI2C8IntHandler);
+}
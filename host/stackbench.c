@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "weather_station/ws_stack.h"
+
+//*****************************************************************************
+/*  Check and benchmark of the stack high-water mark (weather_station/
+ *  ws_stack.h).
+ *
+ *      ./build/stackbench [bytes]
+ *
+ *  A buffer of [bytes] (default 1024, the system stack of the firmware) is
+ *  painted with stackPaint, then dirtied from its top down to every depth
+ *  from 0 to the whole buffer, the way the stack grows. stackScan has to
+ *  give the painted bytes left below that depth, whole words only: a word
+ *  touched in one byte is used. A word in the used part that happens to
+ *  hold the pattern may not shorten the mark. The exit status is 1 on a
+ *  mismatch. The cost of stackPaint and of stackScan over an untouched
+ *  buffer, the worst case of /cgi-bin/stack, is printed. */
+//*****************************************************************************
+
+#define STACKBENCH_REPEAT		100000
+
+static uint64_t stackBenchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+/* Paint, dirty the top ui32Depth bytes and scan. With bHole a word in the
+ * middle of the used part holds the pattern again. */
+static bool stackBenchDepth(uint32_t *pui32Buf, uint32_t ui32Words, uint32_t ui32Depth, bool bHole)
+{
+	uint8_t *pui8Top = (uint8_t *)(pui32Buf + ui32Words);
+	uint32_t ui32Free, ui32Expect;
+
+	stackPaint(pui32Buf, pui32Buf + ui32Words);
+	memset(pui8Top - ui32Depth, 0, ui32Depth);
+	if(bHole && (ui32Depth >= 12))
+	{
+		pui32Buf[ui32Words - (ui32Depth / 4) / 2 - 1] = WS_STACK_PATTERN;
+	}
+
+	ui32Free = stackScan(pui32Buf, pui32Buf + ui32Words);
+	ui32Expect = ((ui32Words * 4 - ui32Depth) / 4) * 4;
+	if(ui32Free != ui32Expect)
+	{
+		printf("%u bytes used%s: %u bytes free found, %u expected\n", ui32Depth,
+			   bHole ? " with a pattern word inside" : "", ui32Free, ui32Expect);
+		return(false);
+	}
+
+	return(true);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32Bytes = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1024;
+	uint32_t ui32Words, ui32Depth, ui32Rep, ui32Free = 0;
+	uint32_t *pui32Buf;
+	uint64_t ui64Start, ui64PaintNs, ui64ScanNs;
+
+	if(!ui32Bytes || (ui32Bytes % 4))
+	{
+		fprintf(stderr, "usage: %s [bytes, a multiple of 4]\n", argv[0]);
+		return(1);
+	}
+
+	ui32Words = ui32Bytes / 4;
+	pui32Buf = malloc(ui32Bytes);
+	if(!pui32Buf)
+	{
+		perror("malloc");
+		return(1);
+	}
+
+	for(ui32Depth = 0; ui32Depth <= ui32Bytes; ui32Depth++)
+	{
+		if(!stackBenchDepth(pui32Buf, ui32Words, ui32Depth, false) ||
+		   !stackBenchDepth(pui32Buf, ui32Words, ui32Depth, true))
+		{
+			return(1);
+		}
+	}
+	printf("%u byte stack: the mark is right at all %u depths, with and without a pattern word "
+		   "in the used part\n", ui32Bytes, ui32Bytes + 1);
+
+	ui64Start = stackBenchNs();
+	for(ui32Rep = 0; ui32Rep < STACKBENCH_REPEAT; ui32Rep++)
+	{
+		stackPaint(pui32Buf, pui32Buf + ui32Words);
+	}
+	ui64PaintNs = stackBenchNs() - ui64Start;
+
+	ui64Start = stackBenchNs();
+	for(ui32Rep = 0; ui32Rep < STACKBENCH_REPEAT; ui32Rep++)
+	{
+		ui32Free += stackScan(pui32Buf, pui32Buf + ui32Words);
+	}
+	ui64ScanNs = stackBenchNs() - ui64Start;
+
+	printf("stackPaint %.1f ns, stackScan of the untouched stack %.1f ns (%u bytes free)\n",
+		   (double)ui64PaintNs / STACKBENCH_REPEAT, (double)ui64ScanNs / STACKBENCH_REPEAT,
+		   ui32Free / STACKBENCH_REPEAT);
+
+	free(pui32Buf);
+	return(0);
+}
@@ -0,0 +1,332 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "driverlib/interrupt.h"
+
+#include "weather_station/ws_tick.h"
+
+//*****************************************************************************
+/*  Check of the tickless timekeeping (weather_station/ws_tick.h) on a mocked
+ *  counter.
+ *
+ *  The bench stands in for the hardware layer: the free running count is a
+ *  variable it advances itself, SysTick is the period tickHwArm was last
+ *  given. Nothing else of the simulator is linked.
+ *
+ *  The 64 bit extension is checked from start counts just before the wrap,
+ *  at zero and in between: the counter moves in random steps up to just
+ *  under a full period, with runs of small steps around every wrap, and
+ *  tickNowUs has to equal the reference count since tickInit, divided down.
+ *  Then a SysTick loop runs over the wraps, busy with a 50 ms and a 100 ms
+ *  periodic client and random one-shot delays, and idle with a single 300 s
+ *  deadline that takes many SysTick periods. Every interrupt comes late by
+ *  up to TICKBENCH_LATENCY_CLOCKS. A client has to fire at or after its
+ *  deadline and no later than the latency, every period has to fire once and
+ *  an interrupt with nothing due has to end a full SysTick period. The exit
+ *  status is 1 on a mismatch.
+ *
+ *      ./build/tickbench [simulated hours] */
+//*****************************************************************************
+
+/* Worst interrupt latency of the mocked SysTick */
+#define TICKBENCH_LATENCY_CLOCKS	600u
+
+static uint32_t TickBenchCount;
+static uint32_t TickBenchArmed;
+static bool TickBenchMasked;
+
+//*****************************************************************************
+//
+// The mocked hardware layer and interrupt mask.
+//
+//*****************************************************************************
+void tickHwInit(void)
+{
+}
+
+uint32_t tickHwCount(void)
+{
+	return(TickBenchCount);
+}
+
+void tickHwArm(uint32_t ui32Clocks)
+{
+	TickBenchArmed = ui32Clocks;
+}
+
+bool IntMasterDisable(void)
+{
+	bool bWasMasked = TickBenchMasked;
+
+	TickBenchMasked = true;
+	return(bWasMasked);
+}
+
+bool IntMasterEnable(void)
+{
+	bool bWasMasked = TickBenchMasked;
+
+	TickBenchMasked = false;
+	return(bWasMasked);
+}
+
+static uint64_t tickBenchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+/* Random count of clocks below ui64Max */
+static uint64_t tickBenchRandom(uint64_t ui64Max)
+{
+	uint64_t ui64Value = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+
+	return(ui64Value % ui64Max);
+}
+
+//*****************************************************************************
+//
+// The 64 bit extension.
+//
+//*****************************************************************************
+static uint32_t tickBenchExtension(uint32_t ui32Start, uint32_t ui32Wraps)
+{
+	uint64_t ui64Clocks = 0, ui64Step, ui64LastUs = 0, ui64NowUs;
+	uint32_t ui32Reads = 0, ui32NowMs;
+
+	TickBenchCount = ui32Start;
+	tickInit();
+
+	while((ui64Clocks >> 32) < ui32Wraps)
+	{
+		/* Every other read lands within 2 k clocks of the wrap, the others
+		 * anywhere up to a period on */
+		if(ui32Reads & 1)
+		{
+			ui64Step = (uint32_t)((0u - TickBenchCount) - 0x800u + (uint32_t)tickBenchRandom(0x1000));
+		}
+		else
+		{
+			ui64Step = tickBenchRandom(0xFFFFFFFFu);
+		}
+		ui64Clocks += ui64Step;
+		TickBenchCount += (uint32_t)ui64Step;
+
+		/* A second read of the same count must not extend again */
+		ui64NowUs = tickNowUs();
+		ui32NowMs = tickNowMs();
+		ui32Reads++;
+		if((ui64NowUs != ui64Clocks / WS_TICK_CLOCKS_PER_US) || (ui64NowUs < ui64LastUs) ||
+		   (ui32NowMs != (uint32_t)(ui64Clocks / WS_TICK_CLOCKS_PER_US / 1000u)))
+		{
+			printf("start 0x%08x, count 0x%08x: %llu us and %u ms, %llu us expected\n", ui32Start,
+				   TickBenchCount, (unsigned long long)ui64NowUs, ui32NowMs,
+				   (unsigned long long)(ui64Clocks / WS_TICK_CLOCKS_PER_US));
+			return(0);
+		}
+		ui64LastUs = ui64NowUs;
+	}
+
+	return(ui32Reads);
+}
+
+//*****************************************************************************
+//
+// The SysTick loop.
+//
+//*****************************************************************************
+typedef struct {
+	WS_TickClient_t eClient;
+	uint64_t ui64PeriodUs;			/* 0 for random one-shot delays */
+	uint64_t ui64DeadlineUs;
+	uint64_t ui64MaxLateUs;
+	uint32_t ui32Fired;
+}TickBenchClient_t;
+
+/* The firmware while it measures */
+static TickBenchClient_t TickBenchBusy[] =
+{
+	{ WS_TickLwIP, 100000u },
+	{ WS_TickRefresh, 50000u },
+	{ WS_TickSensorBus1, 0 }
+};
+
+/* A single deadline further away than a SysTick period */
+static TickBenchClient_t TickBenchIdle[] =
+{
+	{ WS_TickSensorBus0, 300000000u }
+};
+
+static uint64_t tickBenchDelay(const TickBenchClient_t *psClient)
+{
+	return(psClient->ui64PeriodUs ? psClient->ui64PeriodUs : 1000u + tickBenchRandom(30000u));
+}
+
+static bool tickBenchLoop(TickBenchClient_t *psClients, uint32_t ui32Clients, uint64_t ui64DurationUs)
+{
+	TickBenchClient_t *psClient;
+	uint64_t ui64NowUs, ui64EarliestUs;
+	uint32_t ui32Due, ui32Idx, ui32Wraps = 0, ui32Expected, ui32Count, ui32Armed;
+	bool bPass = true;
+
+	/* A second before the wrap, like the simulator */
+	TickBenchCount = 0u - WS_TICK_CLOCKS_PER_US * 1000000u;
+	tickInit();
+	TickStats.ui32Wakeups = 0;
+	TickStats.ui32Empty = 0;
+	for(ui32Idx = 0; ui32Idx < ui32Clients; ui32Idx++)
+	{
+		psClient = &psClients[ui32Idx];
+		psClient->ui64DeadlineUs = tickBenchDelay(psClient);
+		tickDeadlineSet(psClient->eClient, psClient->ui64DeadlineUs);
+	}
+	tickArm();
+
+	while(tickNowUs() < ui64DurationUs)
+	{
+		/* SysTick fires, late */
+		ui32Armed = TickBenchArmed;
+		ui32Count = TickBenchCount + ui32Armed + (uint32_t)tickBenchRandom(TICKBENCH_LATENCY_CLOCKS + 1);
+		if(ui32Count < TickBenchCount)
+		{
+			ui32Wraps++;
+		}
+		TickBenchCount = ui32Count;
+
+		ui32Due = tickExpired();
+		ui64NowUs = tickNowUs();
+		ui64EarliestUs = WS_TICK_NONE;
+		for(ui32Idx = 0; ui32Idx < ui32Clients; ui32Idx++)
+		{
+			psClient = &psClients[ui32Idx];
+			if(psClient->ui64DeadlineUs < ui64EarliestUs)
+			{
+				ui64EarliestUs = psClient->ui64DeadlineUs;
+			}
+			if(!(ui32Due & (1u << psClient->eClient)))
+			{
+				if(ui64NowUs >= psClient->ui64DeadlineUs)
+				{
+					printf("client %u missed its deadline %llu us at %llu us\n", psClient->eClient,
+						   (unsigned long long)psClient->ui64DeadlineUs, (unsigned long long)ui64NowUs);
+					bPass = false;
+				}
+				continue;
+			}
+
+			if(ui64NowUs < psClient->ui64DeadlineUs)
+			{
+				printf("client %u fired at %llu us, before its deadline %llu us\n", psClient->eClient,
+					   (unsigned long long)ui64NowUs, (unsigned long long)psClient->ui64DeadlineUs);
+				bPass = false;
+			}
+			if((ui64NowUs - psClient->ui64DeadlineUs) > psClient->ui64MaxLateUs)
+			{
+				psClient->ui64MaxLateUs = ui64NowUs - psClient->ui64DeadlineUs;
+			}
+			psClient->ui32Fired++;
+
+			if(psClient->ui64PeriodUs)
+			{
+				psClient->ui64DeadlineUs = tickNextPeriod(psClient->ui64DeadlineUs, psClient->ui64PeriodUs);
+			}
+			else
+			{
+				psClient->ui64DeadlineUs = ui64NowUs + tickBenchDelay(psClient);
+			}
+			tickDeadlineSet(psClient->eClient, psClient->ui64DeadlineUs);
+		}
+
+		/* An interrupt with nothing due has to end a full SysTick period */
+		if(!ui32Due && (ui32Armed != (WS_TICK_MAX_US * WS_TICK_CLOCKS_PER_US)))
+		{
+			printf("empty wakeup at %llu us after %u clocks, %llu us before the next deadline\n",
+				   (unsigned long long)ui64NowUs, ui32Armed, (unsigned long long)(ui64EarliestUs - ui64NowUs));
+			bPass = false;
+		}
+		tickArm();
+	}
+
+	printf("client  period us     fired  expected  latest us\n");
+	for(ui32Idx = 0; ui32Idx < ui32Clients; ui32Idx++)
+	{
+		psClient = &psClients[ui32Idx];
+		ui32Expected = psClient->ui64PeriodUs ? (uint32_t)(tickNowUs() / psClient->ui64PeriodUs) : 0;
+		printf("%6u  %9llu  %8u  %8u  %9llu\n", psClient->eClient,
+			   (unsigned long long)psClient->ui64PeriodUs, psClient->ui32Fired, ui32Expected,
+			   (unsigned long long)psClient->ui64MaxLateUs);
+
+		/* At most a microsecond of rounding on top of the latency */
+		if((psClient->ui64PeriodUs && (psClient->ui32Fired != ui32Expected)) ||
+		   (psClient->ui64MaxLateUs > (TICKBENCH_LATENCY_CLOCKS / WS_TICK_CLOCKS_PER_US + 1)))
+		{
+			bPass = false;
+		}
+	}
+	printf("%u wakeups, %u with nothing due, %u counter wraps\n\n", TickStats.ui32Wakeups,
+		   TickStats.ui32Empty, ui32Wraps);
+
+	return(bPass);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t pui32Starts[] = { 0xFFFFFFFFu, 0xFFFFF000u, 0, 1, 0x80000000u, 0x7FFFFFFFu };
+	uint32_t ui32Hours = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4;
+	uint32_t ui32Idx, ui32Reads, ui32Calls;
+	uint64_t ui64Start, ui64Ns, ui64LastUs;
+	volatile uint64_t ui64Sink = 0;
+
+	if(!ui32Hours)
+	{
+		fprintf(stderr, "usage: %s [simulated hours]\n", argv[0]);
+		return(1);
+	}
+	srand(1);
+
+	for(ui32Idx = 0; ui32Idx < sizeof(pui32Starts) / sizeof(pui32Starts[0]); ui32Idx++)
+	{
+		ui32Reads = tickBenchExtension(pui32Starts[ui32Idx], 4096);
+		if(!ui32Reads)
+		{
+			return(1);
+		}
+		printf("start 0x%08x: 4096 wraps, %u reads\n", pui32Starts[ui32Idx], ui32Reads);
+	}
+
+	/* No catching up on periods missed while stalled */
+	ui64LastUs = tickNowUs();
+	TickBenchCount += 5 * 50000u * WS_TICK_CLOCKS_PER_US;
+	if(tickNextPeriod(ui64LastUs, 50000u) != (tickNowUs() + 50000u))
+	{
+		printf("tickNextPeriod catches up after a stall\n");
+		return(1);
+	}
+
+	if(!tickBenchLoop(TickBenchBusy, sizeof(TickBenchBusy) / sizeof(TickBenchBusy[0]),
+					  (uint64_t)ui32Hours * 3600u * 1000000u) ||
+	   !tickBenchLoop(TickBenchIdle, sizeof(TickBenchIdle) / sizeof(TickBenchIdle[0]),
+					  (uint64_t)ui32Hours * 3600u * 1000000u))
+	{
+		printf("mismatch\n");
+		return(1);
+	}
+
+	/* Cost of a read, the counter moving by a few microseconds each time */
+	ui32Calls = 10000000;
+	ui64Start = tickBenchNs();
+	for(ui32Idx = 0; ui32Idx < ui32Calls; ui32Idx++)
+	{
+		TickBenchCount += 1000u;
+		ui64Sink += tickNowUs();
+	}
+	ui64Ns = tickBenchNs() - ui64Start;
+	printf("\ntickNowUs %.1f ns\n", (double)ui64Ns / ui32Calls);
+
+	return(0);
+}
@@ -0,0 +1,326 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "driverlib/i2c.h"
+
+#include "weather_station/ws_trace.h"
+
+#include "sim.h"
+
+//*****************************************************************************
+/*  Check of the sensor trace capture and its replay on the host build
+ *  (weather_station/ws_trace.h, sim_trace.c).
+ *
+ *      ./build/tracebench [transactions]
+ *
+ *  Random sensor transactions on two buses, with every status and with
+ *  transfers longer than the trace keeps, are recorded with traceRecord,
+ *  and the capture is decoded again with traceReaderNext. Every record has
+ *  to come back as it was recorded, cut to WS_TRACE_MAX_DATA, at a time that
+ *  does not go backwards. The buffer has to stop the capture when it is
+ *  full, a truncated trace has to end at its last whole record and a bad
+ *  header has to be refused.
+ *
+ *  The capture is then replayed the way the simulated I2C master does it:
+ *  the same transactions go to simTraceReplay, with a retry not in the
+ *  trace every so often and an occasional transaction left out. Each has to
+ *  get the read bytes and the status of its record. The replay ends the
+ *  process when a bus has replayed its last record, the check of that last
+ *  transaction runs at exit. The exit status is 1 on a mismatch. */
+//*****************************************************************************
+
+#define TRACEBENCH_BUSES		2
+
+/* Transactions kept for the checks, the capture buffer holds fewer */
+#define TRACEBENCH_MAX			8192
+
+typedef struct {
+	uint8_t ui8Bus;
+	uint8_t ui8Addr;
+	uint8_t ui8Status;
+	uint8_t ui8WriteCount;
+	uint8_t ui8ReadCount;
+	uint8_t pui8Write[WS_TRACE_MAX_DATA + 8];
+	uint8_t pui8Read[WS_TRACE_MAX_DATA + 8];
+}TraceBenchTransaction_t;
+
+static TraceBenchTransaction_t TraceBenchTransactions[TRACEBENCH_MAX];
+static uint32_t TraceBenchCount;
+
+/* The replay, checked at exit */
+static const TraceBenchTransaction_t *TraceBenchLast;
+static uint8_t TraceBenchRead[WS_TRACE_MAX_DATA];
+static uint_fast8_t TraceBenchStatus;
+static uint32_t TraceBenchReplayed;
+static uint32_t TraceBenchExpected;
+static bool TraceBenchFailed;
+
+/* Time of the replay summary, sim_trace.c */
+uint32_t simMillis(void)
+{
+	return(0);
+}
+
+/* Linked in with traceI2CBefore, which the bench does not call */
+uint32_t I2CMasterErr(uint32_t ui32Base)
+{
+	return(0);
+}
+
+static uint32_t traceBenchMin(uint32_t ui32A, uint32_t ui32B)
+{
+	return((ui32A < ui32B) ? ui32A : ui32B);
+}
+
+//*****************************************************************************
+//
+// Capture and decode.
+//
+//*****************************************************************************
+static void traceBenchGenerate(uint32_t ui32Count)
+{
+	TraceBenchTransaction_t *psTrans;
+	uint32_t ui32Byte;
+
+	srand(1);
+	for(TraceBenchCount = 0; TraceBenchCount < ui32Count; TraceBenchCount++)
+	{
+		psTrans = &TraceBenchTransactions[TraceBenchCount];
+		psTrans->ui8Bus = rand() % TRACEBENCH_BUSES;
+		psTrans->ui8Addr = 0x40 + rand() % 0x38;
+		psTrans->ui8Status = ((rand() % 8) == 0) ? (rand() % 8) : 0;
+		psTrans->ui8WriteCount = ((rand() % 16) == 0) ? (WS_TRACE_MAX_DATA + rand() % 8) : (1 + rand() % 3);
+		psTrans->ui8ReadCount = ((rand() % 16) == 0) ? (WS_TRACE_MAX_DATA + rand() % 8) : (rand() % 7);
+		for(ui32Byte = 0; ui32Byte < sizeof(psTrans->pui8Write); ui32Byte++)
+		{
+			psTrans->pui8Write[ui32Byte] = rand();
+			psTrans->pui8Read[ui32Byte] = rand();
+		}
+
+		/* The replay finds a record by address and write bytes, these
+		 * have to tell the transactions apart */
+		psTrans->pui8Write[0] = (uint8_t)TraceBenchCount;
+	}
+}
+
+static bool traceBenchSame(const WS_TraceRecord_t *psRecord, const TraceBenchTransaction_t *psTrans)
+{
+	uint32_t ui32Write = traceBenchMin(psTrans->ui8WriteCount, WS_TRACE_MAX_DATA);
+	uint32_t ui32Read = traceBenchMin(psTrans->ui8ReadCount, WS_TRACE_MAX_DATA);
+
+	return((psRecord->ui8Bus == psTrans->ui8Bus) && (psRecord->ui8Addr == psTrans->ui8Addr) &&
+		   (psRecord->ui8Status == psTrans->ui8Status) && (psRecord->ui8WriteCount == ui32Write) &&
+		   (psRecord->ui8ReadCount == ui32Read) &&
+		   !memcmp(psRecord->pui8Write, psTrans->pui8Write, ui32Write) &&
+		   !memcmp(psRecord->pui8Read, psTrans->pui8Read, ui32Read));
+}
+
+/* Records of a trace, after checking them against the transactions */
+static uint32_t traceBenchDecode(const uint8_t *pui8Data, uint32_t ui32Len, bool *pbOk)
+{
+	WS_TraceReader_t sReader;
+	WS_TraceRecord_t sRecord;
+	uint32_t ui32Records = 0, ui32LastUs = 0;
+
+	*pbOk = traceReaderInit(&sReader, pui8Data, ui32Len);
+	while(*pbOk && traceReaderNext(&sReader, &sRecord))
+	{
+		if((ui32Records >= TraceBenchCount) || !traceBenchSame(&sRecord, &TraceBenchTransactions[ui32Records]))
+		{
+			printf("record %u does not decode to the transaction recorded\n", ui32Records);
+			*pbOk = false;
+		}
+		else if(sRecord.ui32TimeUs < ui32LastUs)
+		{
+			printf("record %u: time %u us after %u us\n", ui32Records, sRecord.ui32TimeUs, ui32LastUs);
+			*pbOk = false;
+		}
+		ui32LastUs = sRecord.ui32TimeUs;
+		ui32Records++;
+	}
+
+	return(ui32Records);
+}
+
+static bool traceBenchCapture(uint32_t *pui32Records)
+{
+	static uint8_t pui8Copy[WS_TRACE_BUF_SIZE];
+	const TraceBenchTransaction_t *psTrans;
+	const uint8_t *pui8Trace;
+	uint32_t ui32Idx, ui32Len, ui32Records, ui32Cut;
+	bool bOk;
+
+	traceStart();
+	for(ui32Idx = 0; ui32Idx < TraceBenchCount; ui32Idx++)
+	{
+		psTrans = &TraceBenchTransactions[ui32Idx];
+		traceRecord(psTrans->ui8Bus, psTrans->ui8Addr, psTrans->pui8Write, psTrans->ui8WriteCount,
+					psTrans->pui8Read, psTrans->ui8ReadCount, psTrans->ui8Status);
+		if((ui32Idx % 64) == 0)
+		{
+			usleep(50);
+		}
+	}
+	traceStop();
+	pui8Trace = traceData(&ui32Len);
+
+	ui32Records = traceBenchDecode(pui8Trace, ui32Len, &bOk);
+	if(!bOk)
+	{
+		return(false);
+	}
+	printf("%u transactions recorded, %u in %u bytes of trace, %.1f bytes per record\n",
+		   TraceBenchCount, ui32Records, ui32Len, (double)(ui32Len - WS_TRACE_HEADER_SIZE) / ui32Records);
+
+	/* A full buffer stops the capture, nothing may be lost before that */
+	if((ui32Records < TraceBenchCount) && (traceCapturing() || (ui32Len < (WS_TRACE_BUF_SIZE / 2))))
+	{
+		printf("the capture stopped after %u records, the buffer is not full\n", ui32Records);
+		return(false);
+	}
+
+	/* Cut anywhere, the reader ends at the last whole record before the cut */
+	memcpy(pui8Copy, pui8Trace, ui32Len);
+	for(ui32Cut = WS_TRACE_HEADER_SIZE; ui32Cut < ui32Len; ui32Cut += 97)
+	{
+		traceBenchDecode(pui8Copy, ui32Cut, &bOk);
+		if(!bOk)
+		{
+			printf("the trace cut at %u bytes does not decode\n", ui32Cut);
+			return(false);
+		}
+	}
+	pui8Copy[0] ^= 0xff;
+	traceBenchDecode(pui8Copy, ui32Len, &bOk);
+	if(bOk)
+	{
+		printf("a bad header is accepted\n");
+		return(false);
+	}
+
+	*pui32Records = ui32Records;
+	return(true);
+}
+
+//*****************************************************************************
+//
+// Replay.
+//
+//*****************************************************************************
+
+/* The transaction the replay ended on */
+static void traceBenchExit(void)
+{
+	uint32_t ui32Read;
+
+	if(!TraceBenchLast)
+	{
+		return;
+	}
+
+	ui32Read = traceBenchMin(TraceBenchLast->ui8ReadCount, WS_TRACE_MAX_DATA);
+	if(!TraceBenchFailed && (TraceBenchStatus == TraceBenchLast->ui8Status) &&
+	   !memcmp(TraceBenchRead, TraceBenchLast->pui8Read, ui32Read))
+	{
+		TraceBenchReplayed++;
+	}
+
+	printf("replay: %u of %u transactions got their record\n", TraceBenchReplayed, TraceBenchExpected);
+	fflush(stdout);
+	_exit(((TraceBenchReplayed == TraceBenchExpected) && !TraceBenchFailed) ? 0 : 1);
+}
+
+static bool traceBenchReplay(uint32_t ui32Records)
+{
+	static const uint8_t pui8Retry[1] = { 0xee };
+	static char pcPath[] = "/tmp/tracebenchXXXXXX";
+	const TraceBenchTransaction_t *psTrans;
+	const uint8_t *pui8Trace;
+	uint32_t ui32Idx, ui32Len;
+	uint8_t pui8Read[WS_TRACE_MAX_DATA];
+	uint_fast8_t ui8Status;
+	FILE *psFile;
+	int iFd;
+
+	pui8Trace = traceData(&ui32Len);
+	iFd = mkstemp(pcPath);
+	psFile = (iFd < 0) ? NULL : fdopen(iFd, "wb");
+	if(!psFile || (fwrite(pui8Trace, 1, ui32Len, psFile) != ui32Len) || fclose(psFile))
+	{
+		perror(pcPath);
+		return(false);
+	}
+	setenv("WS_SIM_TRACE", pcPath, 1);
+	simTraceInit();
+	unlink(pcPath);
+
+	atexit(traceBenchExit);
+	for(ui32Idx = 0; ui32Idx < ui32Records; ui32Idx++)
+	{
+		psTrans = &TraceBenchTransactions[ui32Idx];
+
+		/* A retry that was not captured gets no record */
+		if((ui32Idx % 50) == 25)
+		{
+			if(simTraceReplay(psTrans->ui8Bus, 0x7f, pui8Retry, 1, pui8Read, 1, &ui8Status))
+			{
+				printf("replay: a transaction not in the trace got a record\n");
+				TraceBenchFailed = true;
+			}
+		}
+
+		/* One the run does not issue, the next ones stay in step */
+		if((ui32Idx % 97) == 50)
+		{
+			continue;
+		}
+
+		TraceBenchLast = psTrans;
+		TraceBenchExpected++;
+		memset(TraceBenchRead, 0, sizeof(TraceBenchRead));
+		if(!simTraceReplay(psTrans->ui8Bus, psTrans->ui8Addr, psTrans->pui8Write, psTrans->ui8WriteCount,
+						   TraceBenchRead, psTrans->ui8ReadCount, &TraceBenchStatus))
+		{
+			printf("replay: transaction %u got no record\n", ui32Idx);
+			TraceBenchFailed = true;
+			continue;
+		}
+		if((TraceBenchStatus != psTrans->ui8Status) ||
+		   memcmp(TraceBenchRead, psTrans->pui8Read, traceBenchMin(psTrans->ui8ReadCount, WS_TRACE_MAX_DATA)))
+		{
+			printf("replay: transaction %u got the wrong record\n", ui32Idx);
+			TraceBenchFailed = true;
+			continue;
+		}
+		TraceBenchReplayed++;
+	}
+
+	/* The last record of a bus ends the replay, it does not come back */
+	printf("replay: the trace did not end the run\n");
+	TraceBenchLast = NULL;
+	return(false);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ui32Count = (argc > 1) ? strtoul(argv[1], NULL, 0) : 3000;
+	uint32_t ui32Records;
+
+	if(!ui32Count || (ui32Count > TRACEBENCH_MAX))
+	{
+		fprintf(stderr, "usage: %s [transactions, up to %u]\n", argv[0], TRACEBENCH_MAX);
+		return(1);
+	}
+
+	traceBenchGenerate(ui32Count);
+	if(!traceBenchCapture(&ui32Records) || !traceBenchReplay(ui32Records))
+	{
+		return(1);
+	}
+
+	return(0);
+}
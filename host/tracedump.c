@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "weather_station/ws_trace.h"
+
+//*****************************************************************************
+/*  Print a sensor I2C trace, one transaction per line:
+ *
+ *      <time us> <bus> <address> <status> w:<bytes> r:<bytes>
+ *
+ *  Two captures can be compared with diff once the time column is cut. */
+//*****************************************************************************
+
+static void traceDumpBytes(const char *pcName, const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Idx;
+
+	printf(" %s:", pcName);
+	for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+	{
+		printf("%02x", pui8Data[ui32Idx]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	WS_TraceReader_t sReader;
+	WS_TraceRecord_t sRecord;
+	static uint8_t pui8Data[1 << 20];
+	uint32_t ui32Len, ui32Count = 0;
+	FILE *psFile;
+
+	if(argc != 2)
+	{
+		fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+		return(1);
+	}
+
+	psFile = fopen(argv[1], "rb");
+	if(!psFile)
+	{
+		perror(argv[1]);
+		return(1);
+	}
+	ui32Len = (uint32_t)fread(pui8Data, 1, sizeof(pui8Data), psFile);
+	fclose(psFile);
+
+	if(!traceReaderInit(&sReader, pui8Data, ui32Len))
+	{
+		fprintf(stderr, "%s: not a sensor trace\n", argv[1]);
+		return(1);
+	}
+
+	while(traceReaderNext(&sReader, &sRecord))
+	{
+		printf("%10u %u 0x%02x %u", sRecord.ui32TimeUs, sRecord.ui8Bus, sRecord.ui8Addr,
+			   sRecord.ui8Status);
+		traceDumpBytes("w", sRecord.pui8Write, sRecord.ui8WriteCount);
+		traceDumpBytes("r", sRecord.pui8Read, sRecord.ui8ReadCount);
+		printf("\n");
+		ui32Count++;
+	}
+
+	if(sReader.ui32Pos != sReader.ui32Len)
+	{
+		fprintf(stderr, "%s: truncated after %u records\n", argv[1], ui32Count);
+		return(1);
+	}
+
+	return(0);
+}
@@ -0,0 +1,287 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "weather_station/ws_trend.h"
+
+//*****************************************************************************
+/*  Check of the barometric tendency (weather_station/ws_trend.h) on a
+ *  replayed pressure trace.
+ *
+ *  The trace is the station's own sample log, the pages of
+ *  GET /cgi-bin/history?from=<s> saved one after the other; every sample
+ *  [time, temperature, humidity, pressure, light] feeds its pressure to
+ *  trendAddSample at its time. Without a file a synthetic seven hour trace
+ *  with noise is replayed: steady, a 4 hPa fall over two hours, a 3 hPa
+ *  rise over three.
+ *
+ *      ./build/trendbench history.json
+ *      ./build/trendbench
+ *
+ *  After every sample the O(1) regression is checked against a least
+ *  squares fit in double precision over the minute ring, rescanned from
+ *  scratch, and the tendency against the one the rescan gives. The
+ *  synthetic trace also has to end each part with its tendency. The exit
+ *  status is 1 on a mismatch. The cost of trendAddSample and trendGet is
+ *  printed with the tendencies seen over the replay. */
+//*****************************************************************************
+
+#define TRENDBENCH_MAX_SAMPLES	(7 * 24 * 3600)
+
+/* Largest difference to the rescan, Pa over three hours. The incremental
+ * sums are exact, what is left is the float slope. */
+#define TRENDBENCH_TOLERANCE_PA	0.01
+
+typedef struct {
+	uint32_t ui32TimeMs;
+	float fPressure;
+}TrendBenchSample_t;
+
+/* A part of the synthetic trace and the tendency it has to end with */
+typedef struct {
+	uint32_t ui32Minutes;
+	float fSlopePaMin;
+	WS_Tendency_t eTendency;
+}TrendBenchPart_t;
+
+static const TrendBenchPart_t TrendBenchParts[] =
+{
+	{ 120, 0.0f, WS_TrendSteady },
+	{ 120, -400.0f / 120.0f, WS_TrendFalling },
+	{ 180, 300.0f / 180.0f, WS_TrendRising }
+};
+
+static TrendBenchSample_t TrendBenchSamples[TRENDBENCH_MAX_SAMPLES];
+static uint32_t TrendBenchCount;
+
+static uint64_t trendBenchNs(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint64_t)sNow.tv_sec * 1000000000u + sNow.tv_nsec);
+}
+
+//*****************************************************************************
+//
+// The traces.
+//
+//*****************************************************************************
+static bool trendBenchLoad(const char *pcPath)
+{
+	static char pcText[64 << 20];
+	double pdValues[5];
+	char *pcPos, *pcEnd;
+	uint32_t ui32Value;
+	size_t iLen;
+	FILE *psFile;
+
+	psFile = fopen(pcPath, "rb");
+	if(!psFile)
+	{
+		perror(pcPath);
+		return(false);
+	}
+	iLen = fread(pcText, 1, sizeof(pcText) - 1, psFile);
+	fclose(psFile);
+	pcText[iLen] = 0;
+
+	/* Every "[" followed by five numbers is a sample, the pages' other
+	 * brackets are not */
+	for(pcPos = strchr(pcText, '['); pcPos && (TrendBenchCount < TRENDBENCH_MAX_SAMPLES);
+		pcPos = strchr(pcPos + 1, '['))
+	{
+		pcEnd = pcPos + 1;
+		for(ui32Value = 0; ui32Value < 5; ui32Value++)
+		{
+			pdValues[ui32Value] = strtod(pcEnd, &pcEnd);
+			if(*pcEnd != ((ui32Value == 4) ? ']' : ','))
+			{
+				break;
+			}
+			pcEnd++;
+		}
+		if(ui32Value == 5)
+		{
+			TrendBenchSamples[TrendBenchCount].ui32TimeMs = (uint32_t)(pdValues[0] * 1000.0);
+			TrendBenchSamples[TrendBenchCount].fPressure = (float)pdValues[3];
+			TrendBenchCount++;
+		}
+	}
+
+	if(!TrendBenchCount)
+	{
+		fprintf(stderr, "%s: no samples, expected /cgi-bin/history pages\n", pcPath);
+		return(false);
+	}
+
+	return(true);
+}
+
+/* One sample a second with +-3 Pa of noise, the sensor's resolution */
+static void trendBenchSynthesize(void)
+{
+	uint32_t ui32Part, ui32Second;
+	float fPressure = 101300.0f;
+
+	srand(1);
+	for(ui32Part = 0; ui32Part < sizeof(TrendBenchParts) / sizeof(TrendBenchParts[0]); ui32Part++)
+	{
+		for(ui32Second = 0; ui32Second < TrendBenchParts[ui32Part].ui32Minutes * 60; ui32Second++)
+		{
+			fPressure += TrendBenchParts[ui32Part].fSlopePaMin / 60.0f;
+			TrendBenchSamples[TrendBenchCount].ui32TimeMs = TrendBenchCount * 1000u;
+			TrendBenchSamples[TrendBenchCount].fPressure = fPressure + (float)(rand() % 7 - 3);
+			TrendBenchCount++;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// Reference: the least squares fit over the ring, rescanned.
+//
+//*****************************************************************************
+static WS_Tendency_t trendBenchReference(const WS_Trend_t *psTrend, double *pdChange3h)
+{
+	double dSumX = 0.0, dSumY = 0.0, dSumXX = 0.0, dSumXY = 0.0, dN, dY;
+	uint32_t ui32X;
+
+	*pdChange3h = 0.0;
+	if(psTrend->ui32Count < WS_TREND_MIN_SAMPLES)
+	{
+		return(WS_TrendUnknown);
+	}
+
+	for(ui32X = 0; ui32X < psTrend->ui32Count; ui32X++)
+	{
+		dY = psTrend->pi32Minutes[(psTrend->ui32Head + ui32X) % WS_TREND_WINDOW_MIN];
+		dSumX += ui32X;
+		dSumY += dY;
+		dSumXX += (double)ui32X * ui32X;
+		dSumXY += ui32X * dY;
+	}
+	dN = psTrend->ui32Count;
+	*pdChange3h = (dN * dSumXY - dSumX * dSumY) / (dN * dSumXX - dSumX * dSumX) * WS_TREND_WINDOW_MIN;
+
+	if(*pdChange3h <= -WS_TREND_THRESHOLD_PA)
+	{
+		return(WS_TrendFalling);
+	}
+	if(*pdChange3h >= WS_TREND_THRESHOLD_PA)
+	{
+		return(WS_TrendRising);
+	}
+	return(WS_TrendSteady);
+}
+
+int main(int argc, char **argv)
+{
+	static WS_Trend_t sTrend;
+	WS_TrendResult_t sResult;
+	WS_Tendency_t eReference;
+	uint32_t pui32Tendencies[4] = { 0 };
+	uint32_t ui32Sample, ui32Part, ui32PartEnd, ui32Minutes, ui32Failures = 0;
+	double dChange3h, dMaxDiff = 0.0;
+	uint64_t ui64Start, ui64AddNs, ui64GetNs;
+
+	if(argc > 2)
+	{
+		fprintf(stderr, "usage: %s [history.json]\n", argv[0]);
+		return(1);
+	}
+	if(argc == 2)
+	{
+		if(!trendBenchLoad(argv[1]))
+		{
+			return(1);
+		}
+	}
+	else
+	{
+		trendBenchSynthesize();
+	}
+
+	/* Replay, checked after every sample */
+	ui32Part = 0;
+	ui32PartEnd = TrendBenchParts[0].ui32Minutes * 60;
+	for(ui32Sample = 0; ui32Sample < TrendBenchCount; ui32Sample++)
+	{
+		trendAddSample(&sTrend, TrendBenchSamples[ui32Sample].ui32TimeMs,
+					   TrendBenchSamples[ui32Sample].fPressure);
+		trendGet(&sTrend, TrendBenchSamples[ui32Sample].fPressure, &sResult);
+		eReference = trendBenchReference(&sTrend, &dChange3h);
+
+		if(fabs(sResult.fChange3h - dChange3h) > dMaxDiff)
+		{
+			dMaxDiff = fabs(sResult.fChange3h - dChange3h);
+		}
+		/* On the threshold a float and a double may round apart */
+		if((sResult.eTendency != eReference) &&
+		   (fabs(fabs(dChange3h) - WS_TREND_THRESHOLD_PA) > TRENDBENCH_TOLERANCE_PA))
+		{
+			if(!ui32Failures++)
+			{
+				printf("sample %u: %s, the rescan gives %s (%.2f Pa)\n", ui32Sample,
+					   trendTendencyName(sResult.eTendency), trendTendencyName(eReference), dChange3h);
+			}
+		}
+		pui32Tendencies[sResult.eTendency]++;
+
+		/* The synthetic parts end with their tendency */
+		if((argc < 2) && (ui32Sample + 1 == ui32PartEnd))
+		{
+			printf("%-8s part: %-8s %8.1f Pa/3h, %c %s\n",
+				   trendTendencyName(TrendBenchParts[ui32Part].eTendency),
+				   trendTendencyName(sResult.eTendency), sResult.fChange3h,
+				   sResult.cZambretti ? sResult.cZambretti : '-', sResult.pcForecast);
+			if(sResult.eTendency != TrendBenchParts[ui32Part].eTendency)
+			{
+				ui32Failures++;
+			}
+			if(++ui32Part < sizeof(TrendBenchParts) / sizeof(TrendBenchParts[0]))
+			{
+				ui32PartEnd += TrendBenchParts[ui32Part].ui32Minutes * 60;
+			}
+		}
+	}
+	ui32Minutes = sTrend.ui32Count;
+
+	printf("%u samples, %u minutes in the window, largest difference to the rescan %.2e Pa/3h\n",
+		   TrendBenchCount, ui32Minutes, dMaxDiff);
+	printf("samples per tendency: unknown %u, falling %u, steady %u, rising %u\n",
+		   pui32Tendencies[WS_TrendUnknown], pui32Tendencies[WS_TrendFalling],
+		   pui32Tendencies[WS_TrendSteady], pui32Tendencies[WS_TrendRising]);
+
+	if(ui32Failures || (dMaxDiff > TRENDBENCH_TOLERANCE_PA))
+	{
+		printf("%u mismatches\n", ui32Failures);
+		return(1);
+	}
+
+	/* Cost, the whole trace again on a fresh state */
+	memset(&sTrend, 0, sizeof(sTrend));
+	ui64Start = trendBenchNs();
+	for(ui32Sample = 0; ui32Sample < TrendBenchCount; ui32Sample++)
+	{
+		trendAddSample(&sTrend, TrendBenchSamples[ui32Sample].ui32TimeMs,
+					   TrendBenchSamples[ui32Sample].fPressure);
+	}
+	ui64AddNs = trendBenchNs() - ui64Start;
+
+	ui64Start = trendBenchNs();
+	for(ui32Sample = 0; ui32Sample < TrendBenchCount; ui32Sample++)
+	{
+		trendGet(&sTrend, TrendBenchSamples[ui32Sample].fPressure, &sResult);
+	}
+	ui64GetNs = trendBenchNs() - ui64Start;
+
+	printf("trendAddSample %.1f ns, trendGet %.1f ns\n", (double)ui64AddNs / TrendBenchCount,
+		   (double)ui64GetNs / TrendBenchCount);
+
+	return(0);
+}
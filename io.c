@@ -34,8 +34,11 @@
 #include "driverlib/interrupt.h"
 #include "driverlib/rom.h"
 #include "utils/ustdlib.h"
+#include "cgifuncs.h"
 #include "io.h"
 #include "weather_station/weather_station.h"
+#include "weather_station/ws_netstats.h"
+#include "weather_station/ws_route.h"
 
 //*****************************************************************************
 //
@@ -60,16 +63,11 @@
 //*****************************************************************************
 extern uint32_t g_ui32SysClock;
 
-/* Extern unsigned data variables for sending */
-extern int32_t tempInteger, tempFraction;
-extern int32_t humidityInteger, humidityFraction;
-extern int32_t pressureInteger, pressureFraction;
-extern int32_t lightInteger, lightFraction;
-
 extern bool TempDataFlag;
 extern bool HumidityDataFlag;
 extern bool PressureDataFlag;
 extern bool LightDataFlag;
+extern WS_SampleTime_t PublishedTime;
 
 //*****************************************************************************
 //
@@ -162,20 +160,320 @@ io_init(void)
     io_set_timer(g_ulAnimSpeed);
 }
 
+//*****************************************************************************
+//
+// Keep the length of a reply inside its buffer.  usnprintf returns the length
+// it would have written, clamped a full buffer truncates the reply instead of
+// the next append writing past it.
+//
+//*****************************************************************************
+static int
+io_clamp(int iLen, int iBufLen)
+{
+    return((iLen < iBufLen) ? iLen : (iBufLen - 1));
+}
+
+/* Names of the published measurements, in deadband channel order */
+static const char * const SendDataNames[WS_DEADBAND_CHANNELS] =
+{
+	"temperature", "humidity", "pressure", "light"
+};
+
 void io_send_data(char * pcBuf, int iBufLen)
 {
-	/* wait until every measurement is ready */
+	uint32_t ui32Probe = probeStart();
+	uint32_t ui32Sensor, ui32Ch, ui32Heartbeats = PublishDeadband.ui32HeartbeatMask;
+	uint64_t ui64UnixUs;
+	int iLen = 0;
+
+	/* The published values in thousandths, zero padded and signed */
+	for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+	{
+		iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, "%s\"%s\":",
+										 ui32Ch ? "," : "{", SendDataNames[ui32Ch]), iBufLen);
+		iLen = io_clamp(iLen + FormatMilli(pcBuf + iLen, iBufLen - iLen,
+										   PublishDeadband.pi32Held[ui32Ch]), iBufLen);
+	}
+
+	/* Which of them the heartbeat republished, unchanged within the deadband */
+	for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+	{
+		iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, "%s%s",
+										 ui32Ch ? "," : ",\"heartbeat\":[",
+										 (ui32Heartbeats & (1u << ui32Ch)) ? "true" : "false"),
+						iBufLen);
+	}
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, "]"), iBufLen);
 
-	usnprintf(pcBuf, iBufLen, "{\"temperature\":%u.%u,\"humidity\":%u.%u,\"pressure\":%u.%u,\"light\":%u.%u}",
-																										tempInteger, tempFraction,
-																										humidityInteger, humidityFraction,
-																										pressureInteger, pressureFraction,
-																										lightInteger, lightFraction);
+	/* Derived quantities */
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"dewPoint\":"), iBufLen);
+	iLen = io_clamp(iLen + FormatFixed(pcBuf + iLen, iBufLen - iLen, DerivedData.fDewPoint), iBufLen);
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"heatIndex\":"), iBufLen);
+	iLen = io_clamp(iLen + FormatFixed(pcBuf + iLen, iBufLen - iLen, DerivedData.fHeatIndex), iBufLen);
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"altitude\":"), iBufLen);
+	iLen = io_clamp(iLen + FormatFixed(pcBuf + iLen, iBufLen - iLen, DerivedData.fAltitude), iBufLen);
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"seaLevelPressure\":"), iBufLen);
+	iLen = io_clamp(iLen + FormatFixed(pcBuf + iLen, iBufLen - iLen, DerivedData.fSeaLevelPressure),
+					iBufLen);
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"derivedCycles\":%u",
+									 DerivedCycles.ui32Last), iBufLen);
+
+	/* Acquisition times, microseconds of uptime and, once SNTP answered,
+	 * milliseconds since 1970 */
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"timeUs\":"), iBufLen);
+	iLen = io_clamp(iLen + timeFormatU64(pcBuf + iLen, iBufLen - iLen, PublishedTime.ui64Us), iBufLen);
+	if(timeUnixUs(PublishedTime.ui64Us, &ui64UnixUs))
+	{
+		iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"unixMs\":"), iBufLen);
+		iLen = io_clamp(iLen + timeFormatU64(pcBuf + iLen, iBufLen - iLen, ui64UnixUs / 1000u),
+						iBufLen);
+	}
+	iLen = io_clamp(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"sensorUs\":["), iBufLen);
+	for(ui32Sensor = 0; ui32Sensor < WS_NUM_SENSORS; ui32Sensor++)
+	{
+		if(ui32Sensor && (iLen < (iBufLen - 1)))
+		{
+			pcBuf[iLen++] = ',';
+		}
+		iLen = io_clamp(iLen + timeFormatU64(pcBuf + iLen, iBufLen - iLen,
+											 PublishedTime.pui64SensorUs[ui32Sensor]), iBufLen);
+	}
+	usnprintf(pcBuf + iLen, iBufLen - iLen, "]}");
+
+	probeEnd(WS_ProbeSendData, ui32Probe);
 //	TempDataFlag == false;
 //	HumidityDataFlag == false;
 //	PressureDataFlag == false;
 //	LightDataFlag == false;
 }
+
+//*****************************************************************************
+//
+// Return the barometric tendency and the Zambretti forecast as JSON.  The
+// change is the fitted pressure change over three hours in hPa.
+//
+//*****************************************************************************
+void
+io_get_trend(char *pcBuf, int iBufLen)
+{
+    WS_TrendResult_t sTrend;
+    int iLen;
+
+    trendGet(&PressureTrend, DerivedData.fSeaLevelPressure, &sTrend);
+
+    iLen = usnprintf(pcBuf, iBufLen, "{\"tendency\":\"%s\",\"change3h\":",
+                     trendTendencyName(sTrend.eTendency));
+    iLen += FormatFixed(pcBuf + iLen, iBufLen - iLen, sTrend.fChange3h * 0.01f);
+    usnprintf(pcBuf + iLen, iBufLen - iLen,
+              ",\"minutes\":%u,\"zambretti\":\"%c\",\"forecast\":\"%s\"}",
+              sTrend.ui32Minutes, sTrend.cZambretti ? sTrend.cZambretti : '-',
+              sTrend.pcForecast);
+}
+
+//*****************************************************************************
+//
+// Return the rollup buckets of one resolution as JSON.  The query string
+// carries res (bucket length in seconds: 1, 60, 600 or 3600) and from (the
+// first bucket start of interest, seconds of uptime).  The response holds as
+// many buckets as fit in the buffer, "next" is the from value of the
+// following page or 0 if every bucket was returned.  Each sensor's entry is
+// [min, max, mean].
+//
+//*****************************************************************************
+static const char * const g_ppcRollupNames[WS_ROLLUP_CHANNELS] =
+{
+    "temperature", "humidity", "pressure", "light"
+};
+
+void
+io_get_rollup(char *pcBuf, int iBufLen, const char *pcQuery)
+{
+    const WS_RollupLevel_t *psLevel;
+    const WS_RollupBucket_t *psBucket;
+    const char *pcParam;
+    uint32_t ui32Res, ui32From, ui32Index, ui32Ch, ui32Next;
+    int32_t i32Res, i32From;
+    int iLen;
+
+    //
+    // Parse the parameters, both are optional.
+    //
+    i32Res = 60;
+    i32From = 0;
+    pcParam = FindQueryValue(pcQuery, "res");
+    if(pcParam && !ParseDecimalParam(pcParam, 1, INT32_MAX, &i32Res))
+    {
+        i32Res = 0;
+    }
+    pcParam = FindQueryValue(pcQuery, "from");
+    if(pcParam && !ParseDecimalParam(pcParam, 0, INT32_MAX, &i32From))
+    {
+        usnprintf(pcBuf, iBufLen, "{\"error\":\"from\"}");
+        return;
+    }
+    ui32Res = i32Res;
+    ui32From = i32From;
+
+    psLevel = rollupLevelGet(ui32Res);
+    if(psLevel == NULL)
+    {
+        usnprintf(pcBuf, iBufLen, "{\"error\":\"res\"}");
+        return;
+    }
+
+    iLen = usnprintf(pcBuf, iBufLen, "{\"res\":%u,\"buckets\":[", ui32Res);
+    ui32Next = 0;
+
+    for(ui32Index = 0; (psBucket = rollupBucketGet(psLevel, ui32Index)) != NULL;
+        ui32Index++)
+    {
+        if(psBucket->ui32Start < ui32From)
+        {
+            continue;
+        }
+
+        //
+        // Keep room for the worst case bucket and the closing part.
+        //
+        if((iBufLen - iLen) < 256)
+        {
+            ui32Next = psBucket->ui32Start;
+            break;
+        }
+
+        iLen += usnprintf(pcBuf + iLen, iBufLen - iLen, "%s{\"t\":%u,\"n\":%u",
+                          (pcBuf[iLen - 1] == '[') ? "" : ",",
+                          psBucket->ui32Start, psBucket->ui32Count);
+        for(ui32Ch = 0; ui32Ch < WS_ROLLUP_CHANNELS; ui32Ch++)
+        {
+            iLen += usnprintf(pcBuf + iLen, iBufLen - iLen, ",\"%s\":[",
+                              g_ppcRollupNames[ui32Ch]);
+            iLen += FormatMilli(pcBuf + iLen, iBufLen - iLen,
+                                psBucket->psStat[ui32Ch].i32Min);
+            pcBuf[iLen++] = ',';
+            iLen += FormatMilli(pcBuf + iLen, iBufLen - iLen,
+                                psBucket->psStat[ui32Ch].i32Max);
+            pcBuf[iLen++] = ',';
+            iLen += FormatMilli(pcBuf + iLen, iBufLen - iLen,
+                                psBucket->psStat[ui32Ch].i32Mean);
+            pcBuf[iLen++] = ']';
+        }
+        pcBuf[iLen++] = '}';
+    }
+
+    usnprintf(pcBuf + iLen, iBufLen - iLen, "],\"next\":%u}", ui32Next);
+}
+
+//*****************************************************************************
+//
+// Return the timing probes and the lwIP memory statistics in Prometheus text
+// format.
+//
+//*****************************************************************************
+void
+io_get_metrics(char *pcBuf, int iBufLen)
+{
+    int iLen;
+
+    iLen = probeFormat(pcBuf, iBufLen);
+    netStatsFormat(pcBuf + iLen, iBufLen - iLen);
+}
+
+//*****************************************************************************
+//
+// Return the stack high-water mark and the deepest interrupt nesting seen.
+//
+//*****************************************************************************
+void
+io_get_stack(char *pcBuf, int iBufLen)
+{
+    WS_StackReport_t sStack;
+
+    stackReport(&sStack);
+    usnprintf(pcBuf, iBufLen,
+              "{\"size\":%u,\"used\":%u,\"free\":%u,\"maxNesting\":%u}",
+              sStack.ui32Size, sStack.ui32Used,
+              sStack.ui32Size - sStack.ui32Used, sStack.ui32MaxNesting);
+}
+
+//*****************************************************************************
+//
+// Start or stop the sensor trace capture as the query asks ("start",
+// "stop", anything else only reads) and return the capture state as JSON.
+//
+//*****************************************************************************
+void
+io_get_trace(char *pcBuf, int iBufLen, const char *pcQuery)
+{
+    if(ustrstr(pcQuery, "start"))
+    {
+        traceStart();
+    }
+    else if(ustrstr(pcQuery, "stop"))
+    {
+        traceStop();
+    }
+
+    traceFormatStatus(pcBuf, iBufLen);
+}
+
+//*****************************************************************************
+//
+// Return the samples of the flash log as JSON, starting at the from
+// parameter of the query (log time in seconds: Unix time once SNTP set the
+// clock, uptime carried on across reboots before).  Each sample is [t, temperature,
+// humidity, pressure, light].  "next" is the from value of the following
+// page or 0 if the log was read to its end.
+//
+//*****************************************************************************
+void
+io_get_history(char *pcBuf, int iBufLen, const char *pcQuery)
+{
+    static WS_FlashLogIter_t sIter;
+    WS_LogSample_t sSample;
+    const char *pcParam;
+    uint32_t ui32From, ui32Ch, ui32Next;
+    int32_t i32From;
+    int iLen;
+
+    i32From = 0;
+    pcParam = FindQueryValue(pcQuery, "from");
+    if(pcParam && !ParseDecimalParam(pcParam, 0, INT32_MAX, &i32From))
+    {
+        usnprintf(pcBuf, iBufLen, "{\"error\":\"from\"}");
+        return;
+    }
+    ui32From = i32From;
+
+    iLen = usnprintf(pcBuf, iBufLen, "{\"samples\":[");
+    ui32Next = 0;
+
+    flashLogIterInit(&FlashLog, &sIter, ui32From);
+    while(flashLogIterNext(&sIter, &sSample))
+    {
+        //
+        // Keep room for the worst case sample and the closing part.
+        //
+        if((iBufLen - iLen) < 96)
+        {
+            ui32Next = sSample.ui32Time;
+            break;
+        }
+
+        iLen += usnprintf(pcBuf + iLen, iBufLen - iLen, "%s[%u",
+                          (pcBuf[iLen - 1] == '[') ? "" : ",",
+                          sSample.ui32Time);
+        for(ui32Ch = 0; ui32Ch < WS_FLASHLOG_CHANNELS; ui32Ch++)
+        {
+            pcBuf[iLen++] = ',';
+            iLen += FormatMilli(pcBuf + iLen, iBufLen - iLen,
+                                sSample.pi32Values[ui32Ch]);
+        }
+        pcBuf[iLen++] = ']';
+    }
+
+    usnprintf(pcBuf + iLen, iBufLen - iLen, "],\"next\":%u}", ui32Next);
+}
 //*****************************************************************************
 //
 // Set the status LED on or off.
@@ -188,6 +486,11 @@ io_set_led(bool bOn)
     // Turn the LED on or off as requested.
     //
     ROM_GPIOPinWrite(LED_PORT_BASE, LED_PIN, bOn ? LED_PIN : 0);
+
+    //
+    // The SSI tags show the LED state.
+    //
+    routeSSIChanged();
 }
 
 //*****************************************************************************
@@ -239,28 +542,18 @@ io_is_led_on(void)
 //
 //*****************************************************************************
 void
-io_set_animation_speed_string(char *pcBuf)
+io_set_animation_speed_string(const char *pcBuf)
 {
-    unsigned long ulSpeed;
-
-    //
-    // Parse the passed parameter as a decimal number.
-    //
-    ulSpeed = 0;
-    while((*pcBuf >= '0') && (*pcBuf <= '9'))
-    {
-        ulSpeed *= 10;
-        ulSpeed += (*pcBuf - '0');
-        pcBuf++;
-    }
+    int32_t i32Speed;
 
     //
-    // If the number is valid, set the new speed.
+    // If the string is a valid percentage, set the new speed.
     //
-    if(ulSpeed <= 100)
+    if(ParseDecimalParam(pcBuf, 0, 100, &i32Speed))
     {
-        g_ulAnimSpeed = ulSpeed;
+        g_ulAnimSpeed = i32Speed;
         io_set_timer(g_ulAnimSpeed);
+        routeSSIChanged();
     }
 }
 
@@ -279,6 +572,7 @@ io_set_animation_speed(unsigned long ulSpeed)
     {
         g_ulAnimSpeed = ulSpeed;
         io_set_timer(g_ulAnimSpeed);
+        routeSSIChanged();
     }
 }
 
@@ -43,12 +43,19 @@ extern volatile unsigned long g_ulAnimSpeed;
 //
 //*****************************************************************************
 void io_init(void);
+void io_fs_init(void);
 void io_set_led(bool bOn);
 void io_get_ledstate(char *pcBuf, int iBufLen);
-void io_set_animation_speed_string(char *pcBuf);
+void io_set_animation_speed_string(const char *pcBuf);
 void io_get_animation_speed_string(char *pcBuf, int iBufLen);
 void io_set_animation_speed(unsigned long ulSpeedPercent);
 void io_send_data(char * pcBuf, int iBufLen);
+void io_get_trend(char *pcBuf, int iBufLen);
+void io_get_rollup(char *pcBuf, int iBufLen, const char *pcQuery);
+void io_get_history(char *pcBuf, int iBufLen, const char *pcQuery);
+void io_get_metrics(char *pcBuf, int iBufLen);
+void io_get_stack(char *pcBuf, int iBufLen);
+void io_get_trace(char *pcBuf, int iBufLen, const char *pcQuery);
 unsigned long io_get_animation_speed(void);
 int io_is_led_on(void);
 
@@ -34,6 +34,10 @@
 #include "httpserver_raw/fs.h"
 #include "httpserver_raw/fsdata.h"
 #include "io.h"
+#include "weather_station/ws_probe.h"
+#include "weather_station/ws_netstats.h"
+#include "weather_station/ws_trace.h"
+#include "weather_station/ws_route.h"
 
 //*****************************************************************************
 //
@@ -51,199 +55,259 @@
 
 //*****************************************************************************
 //
-// Open a file and return a handle to the file, if found.  Otherwise,
-// return NULL.  This function also looks for special file names used to
-// provide specific status information or to control various subsystems.
-// These file names are used by the JavaScript on the "IO Control Demo 1"
-// example web page.
+// Dynamic files.  They build their content in one buffer, which stays valid
+// until a dynamic file is opened again: ws_http has one dynamic file at a
+// time left to queue.  The buffer holds the longest, /metrics, whatever the
+// counters say.  The rollup and the history are paged at IO_PAGE_LEN.
 //
 //*****************************************************************************
-struct fs_file *
-fs_open(const char *pcName)
-{
-    const struct fsdata_file *psTree;
-    struct fs_file *psFile = NULL;
+#define DYNAMIC_BUF_LEN         (WS_PROBE_FORMAT_MAX + WS_NETSTATS_FORMAT_MAX)
+#define IO_PAGE_LEN             4096
 
+static char g_pcDynamicBuf[DYNAMIC_BUF_LEN];
+
+static const char *
+fs_send_data(const char *pcQuery, uint32_t *pui32Len)
+{
     //
-    // Allocate memory for the file system structure.
+    // Get the latest measurements and derived quantities
     //
-    psFile = mem_malloc(sizeof(struct fs_file));
-    if(psFile == NULL)
+    io_send_data(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
+
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
+
+static const char *
+fs_trend(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_trend(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
+
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
+
+static const char *
+fs_rollup(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_rollup(g_pcDynamicBuf, IO_PAGE_LEN, pcQuery);
+
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
+
+static const char *
+fs_stack(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_stack(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
+
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
+
+//
+// Sensor trace: the binary trace itself, or the capture control with a
+// query.
+//
+static const char *
+fs_trace(const char *pcQuery, uint32_t *pui32Len)
+{
+    if(*pcQuery == '\0')
     {
-        return(NULL);
+        return((const char *)traceData(pui32Len));
     }
 
+    io_get_trace(g_pcDynamicBuf, DYNAMIC_BUF_LEN, pcQuery);
 
-    /* requested measurement data? */
-    if(ustrncmp(pcName, "/cgi-bin/send_data", 18) == 0)
-    {
-    	static char pcBuf[150];
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
 
-        //
-        // Get the state of the LED
-        //
-        io_send_data(pcBuf, 150);
+static const char *
+fs_metrics(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_metrics(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
 
-        psFile->data = pcBuf;
-        psFile->len = strlen(pcBuf);
-        psFile->index = psFile->len;
-        psFile->pextension = NULL;
-        return(psFile);
-    }
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
+
+static const char *
+fs_history(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_history(g_pcDynamicBuf, IO_PAGE_LEN, pcQuery);
+
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
+
+static const char *
+fs_toggle_led(const char *pcQuery, uint32_t *pui32Len)
+{
     //
-    // Process request to toggle STATUS LED
+    // Toggle the STATUS LED and get its new state.
     //
-    else if(ustrncmp(pcName, "/toggle_led", 11) == 0)
-    {
-        static char pcBuf[4];
+    io_set_led(!io_is_led_on());
+    io_get_ledstate(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
 
-        //
-        // Toggle the STATUS LED
-        //
-        io_set_led(!io_is_led_on());
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
 
-        //
-        // Get the new state of the LED
-        //
-        io_get_ledstate(pcBuf, 4);
+static const char *
+fs_ledstate(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_ledstate(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
 
-        psFile->data = pcBuf;
-        psFile->len = strlen(pcBuf);
-        psFile->index = psFile->len;
-        psFile->pextension = NULL;
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
 
-        //
-        // Return the psFile system pointer.
-        //
-        return(psFile);
-    }
-    //
-    // Request for LED State?
-    //
-    else if(ustrncmp(pcName, "/ledstate", 9) == 0)
-    {
-        static char pcBuf[4];
+static const char *
+fs_get_speed(const char *pcQuery, uint32_t *pui32Len)
+{
+    io_get_animation_speed_string(g_pcDynamicBuf, DYNAMIC_BUF_LEN);
 
-        //
-        // Get the state of the LED
-        //
-        io_get_ledstate(pcBuf, 4);
+    *pui32Len = strlen(g_pcDynamicBuf);
+    return(g_pcDynamicBuf);
+}
 
-        psFile->data = pcBuf;
-        psFile->len = strlen(pcBuf);
-        psFile->index = psFile->len;
-        psFile->pextension = NULL;
-        return(psFile);
+//*****************************************************************************
+//
+// The dynamic files, registered with the router by io_fs_init.  To add one,
+// add a line here.  The open function gets the query of the request.  A file
+// whose open can change something answers GET only, HEAD must not change it.
+//
+//*****************************************************************************
+typedef struct
+{
+    const char *pcPath;
+    uint32_t ui32Flags;
+    WS_RouteOpen_t pfnOpen;
+}
+tDynamicFile;
+
+static const tDynamicFile g_psDynamicFiles[] =
+{
+    { "/cgi-bin/send_data", 0, fs_send_data },
+    { "/cgi-bin/trend", 0, fs_trend },
+    { "/cgi-bin/rollup", 0, fs_rollup },
+    { "/cgi-bin/stack", 0, fs_stack },
+    { "/cgi-bin/trace", WS_ROUTE_GET, fs_trace },
+    { "/metrics", 0, fs_metrics },
+    { "/cgi-bin/history", 0, fs_history },
+    { "/toggle_led", WS_ROUTE_GET, fs_toggle_led },
+    { "/ledstate", 0, fs_ledstate },
+    { "/get_speed", 0, fs_get_speed }
+};
+
+#define NUM_DYNAMIC_FILES       (sizeof(g_psDynamicFiles) /                   \
+                                 sizeof(g_psDynamicFiles[0]))
+
+//*****************************************************************************
+//
+// Register the dynamic files and the files of the file system image with the
+// router.  The dynamic files come first, they win over a file of the same
+// name.
+//
+//*****************************************************************************
+void
+io_fs_init(void)
+{
+    const struct fsdata_file *psTree;
+    uint32_t ui32Idx;
+
+    for(ui32Idx = 0; ui32Idx < NUM_DYNAMIC_FILES; ui32Idx++)
+    {
+        routeAdd(g_psDynamicFiles[ui32Idx].pcPath,
+                 g_psDynamicFiles[ui32Idx].ui32Flags,
+                 g_psDynamicFiles[ui32Idx].pfnOpen);
     }
-    //
-    // Request for the animation speed?
-    //
-    else if(ustrncmp(pcName, "/get_speed", 10) == 0)
+
+    for(psTree = FS_ROOT; psTree != NULL; psTree = psTree->next)
     {
-        static char pcBuf[6];
+        routeAddFile((const char *)psTree->name, (const char *)psTree->data,
+                     psTree->len);
+    }
+}
 
-        //
-        // Get the current animation speed as a string.
-        //
-        io_get_animation_speed_string(pcBuf, 6);
+//*****************************************************************************
+//
+// Open a file and return a handle to the file, if found.  Otherwise,
+// return NULL.  The router finds the file, a dynamic one is built here.
+//
+//*****************************************************************************
+static struct fs_file *
+fs_open_file(const char *pcName)
+{
+    const WS_Route_t *psRoute;
+    const char *pcQuery;
+    struct fs_file *psFile;
+    uint32_t ui32Len;
 
-        psFile->data = pcBuf;
-        psFile->len = strlen(pcBuf);
-        psFile->index = psFile->len;
-        psFile->pextension = NULL;
-        return(psFile);
-    }
     //
-    // Set the animation speed?
+    // CGIs and paths nobody registered are no files.
     //
-    else if(ustrncmp(pcName, "/cgi-bin/set_speed?percent=", 12) == 0)
+    psRoute = routeFind(pcName, &pcQuery);
+    if((psRoute == NULL) ||
+       ((psRoute->pfnOpen == NULL) && (psRoute->pcData == NULL)))
     {
-        static char pcBuf[6];
-
-        //
-        // Extract the parameter and set the actual speed requested.
-        //
-        io_set_animation_speed_string((char*)pcName + 27);
-
-        //
-        // Get the current speed setting as a string to send back.
-        //
-        io_get_animation_speed_string(pcBuf, 6);
-
-        psFile->data = pcBuf;
-        psFile->len = strlen(pcBuf);
-        psFile->index = psFile->len;
-        psFile->pextension = NULL;
-        return(psFile);
+        return(NULL);
     }
+
     //
-    // If I can't find it there, look in the rest of the main psFile system
+    // Allocate memory for the file system structure.  Every field is
+    // cleared, whatever fields this version of fs.h has besides the ones set
+    // here.
     //
-    else
+    psFile = mem_malloc(sizeof(struct fs_file));
+    if(psFile == NULL)
     {
-        //
-        // Initialize the psFile system tree pointer to the root of the linked
-        // list.
-        //
-        psTree = FS_ROOT;
+        FsOpenAllocFail++;
+        return(NULL);
+    }
+    memset(psFile, 0, sizeof(struct fs_file));
 
-        //
-        // Begin processing the linked list, looking for the requested file name.
-        //
-        while(NULL != psTree)
+    if(psRoute->pfnOpen != NULL)
+    {
+        psFile->data = (char *)psRoute->pfnOpen(pcQuery, &ui32Len);
+        if(psFile->data == NULL)
         {
-            //
-            // Compare the requested file "pcName" to the file name in the
-            // current node.
-            //
-            if(ustrncmp(pcName, (char *)psTree->name, psTree->len) == 0)
-            {
-                //
-                // Fill in the data pointer and length values from the
-                // linked list node.
-                //
-                psFile->data = (char *)psTree->data;
-                psFile->len = psTree->len;
-
-                //
-                // For now, we setup the read index to the end of the file,
-                // indicating that all data has been read.
-                //
-                psFile->index = psTree->len;
-
-                //
-                // We are not using any file system extensions in this
-                // application, so set the pointer to NULL.
-                //
-                psFile->pextension = NULL;
-
-                //
-                // Exit the loop and return the file system pointer.
-                //
-                break;
-            }
-
-            //
-            // If we get here, we did not find the file at this node of the
-            // linked list.  Get the next element in the list.
-            //
-            psTree = psTree->next;
+            mem_free(psFile);
+            return(NULL);
         }
+        psFile->len = ui32Len;
     }
-
-    //
-    // If we didn't find the file, ptTee will be NULL.  Make sure we
-    // return a NULL pointer if this happens.
-    //
-    if(NULL == psTree)
+    else
     {
-        mem_free(psFile);
-        psFile = NULL;
+        psFile->data = (char *)psRoute->pcData;
+        psFile->len = psRoute->ui32Len;
     }
 
     //
-    // Return the file system pointer.
+    // All the data is in memory: the read index starts at the end, and no
+    // file system extensions are used.
     //
+    psFile->index = psFile->len;
+
+    return(psFile);
+}
+
+//*****************************************************************************
+//
+// Open a file, timed by the fs_open probe.
+//
+//*****************************************************************************
+struct fs_file *
+fs_open(const char *pcName)
+{
+    struct fs_file *psFile;
+    uint32_t ui32Probe;
+
+    ui32Probe = probeStart();
+    psFile = fs_open_file(pcName);
+    probeEnd(WS_ProbeFsOpen, ui32Probe);
+
     return(psFile);
 }
 
@@ -309,7 +373,7 @@ fs_read(struct fs_file *psFile, char *pcBuffer, int iCount)
     //
     // Copy the data.
     //
-    memcpy(pcBuffer, psFile->data + iAvailable, iAvailable);
+    memcpy(pcBuffer, psFile->data + psFile->index, iAvailable);
     psFile->index += iAvailable;
 
     //
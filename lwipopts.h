@@ -313,7 +313,7 @@
 // ---------- Statistics options ----------
 //
 //*****************************************************************************
-//#define LWIP_STATS                      1
+#define LWIP_STATS                      1           // pool tuning, see ws_netstats
 //#define LWIP_STATS_DISPLAY              0
 //#define LINK_STATS                      1
 //#define ETHARP_STATS                    (LWIP_ARP)
@@ -323,8 +323,8 @@
 //#define IGMP_STATS                      (LWIP_IGMP)
 //#define UDP_STATS                       (LWIP_UDP)
 //#define TCP_STATS                       (LWIP_TCP)
-//#define MEM_STATS                       1
-//#define MEMP_STATS                      1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
 //#define SYS_STATS                       1
 
 //*****************************************************************************
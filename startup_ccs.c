@@ -56,11 +56,12 @@ extern uint32_t __STACK_TOP;
 // External declarations for the interrupt handlers used by the application.
 //
 //*****************************************************************************
-extern void lwIPEthernetIntHandler(void);
+extern void EthernetIntHandler(void);
 extern void SysTickIntHandler(void);
 extern void AnimTimerIntHandler(void);
 extern void TempIntHandler(void);
 extern void UniversalI2CIntHandler(void);
+extern void UniversalI2C8IntHandler(void);
 extern void LightIntHandler(void);
 
 //*****************************************************************************
@@ -130,7 +131,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // I2C1 Master and Slave
     IntDefaultHandler,                      // CAN0
     IntDefaultHandler,                      // CAN1
-    lwIPEthernetIntHandler,                 // Ethernet
+    EthernetIntHandler,                     // Ethernet
     IntDefaultHandler,                      // Hibernate
     IntDefaultHandler,                      // USB0
     IntDefaultHandler,                      // PWM Generator 3
@@ -199,7 +200,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // HIM PS/2 0
     IntDefaultHandler,                      // HIM LED Sequencer 0
     IntDefaultHandler,                      // HIM Consumer IR 0
-    IntDefaultHandler,                      // I2C8 Master and Slave
+    UniversalI2C8IntHandler,                // I2C8 Master and Slave
     IntDefaultHandler,                      // I2C9 Master and Slave
     IntDefaultHandler                       // GPIO Port T
 };
@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
+
+#include "ws_cycles.h"
+#include "i2c_dma.h"
+
+//*****************************************************************************
+//
+// uDMA channel control table. The controller requires 1024 byte alignment.
+//
+//*****************************************************************************
+#pragma DATA_ALIGN(I2CDMAControlTable, 1024)
+static uint8_t I2CDMAControlTable[1024];
+
+volatile I2CDMA_IntStats_t I2CDMAIntStats;
+
+void I2CDMAInit(void)
+{
+	/* The cycle counter backs the interrupt cost measurement. */
+	cyclesInit();
+
+#if WS_I2C_USE_DMA
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	while(!ROM_SysCtlPeripheralReady(SYSCTL_PERIPH_UDMA))
+	{
+	}
+
+	MAP_uDMAEnable();
+	MAP_uDMAControlBaseSet(I2CDMAControlTable);
+
+	/* Route the I2C7 requests to their channels and make sure no attribute
+	 * left over from a previous owner changes the burst behaviour. */
+	MAP_uDMAChannelAssign(I2C7_DMA_TX_MAPPING);
+	MAP_uDMAChannelAssign(I2C7_DMA_RX_MAPPING);
+	MAP_uDMAChannelAttributeDisable(I2C7_DMA_TX_CHANNEL, UDMA_ATTR_ALL);
+	MAP_uDMAChannelAttributeDisable(I2C7_DMA_RX_CHANNEL, UDMA_ATTR_ALL);
+#endif
+}
+
+void I2CDMAIntAccount(uint32_t ui32Cycles)
+{
+	I2CDMAIntStats.ui32Count++;
+	I2CDMAIntStats.ui32Cycles += ui32Cycles;
+	if(ui32Cycles > I2CDMAIntStats.ui32MaxCycles)
+	{
+		I2CDMAIntStats.ui32MaxCycles = ui32Cycles;
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef WEATHER_STATION_I2C_DMA_H_
+#define WEATHER_STATION_I2C_DMA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  uDMA-backed transfer mode for the sensor I2C master.
+ *
+ *  The sensorlib I2CM driver moves every byte from its interrupt handler
+ *  unless it is given uDMA channels in I2CMInit. With channels assigned it
+ *  lets the uDMA move the data bytes and only takes the completion interrupt
+ *  of each phase, while the sensor drivers and the application callbacks stay
+ *  exactly the same. This module owns the uDMA control table and the channel
+ *  mapping for the I2C7 master. */
+//*****************************************************************************
+
+/* Set to 0 to fall back to the interrupt per byte mode of the I2CM driver. */
+#ifndef WS_I2C_USE_DMA
+#define WS_I2C_USE_DMA          1
+#endif
+
+/* uDMA channel mappings of the I2C7 master (passed to uDMAChannelAssign). */
+#define I2C7_DMA_TX_MAPPING     UDMA_CH23_I2C7TX
+#define I2C7_DMA_RX_MAPPING     UDMA_CH22_I2C7RX
+
+/* Channel numbers as expected by I2CMInit, 0xff means no uDMA. */
+#if WS_I2C_USE_DMA
+#define I2C7_DMA_TX_CHANNEL     (I2C7_DMA_TX_MAPPING & 0xff)
+#define I2C7_DMA_RX_CHANNEL     (I2C7_DMA_RX_MAPPING & 0xff)
+#else
+#define I2C7_DMA_TX_CHANNEL     0xff
+#define I2C7_DMA_RX_CHANNEL     0xff
+#endif
+
+/* Interrupt cost of the sensor I2C master, updated by UniversalI2CIntHandler. */
+typedef struct {
+	uint32_t ui32Count;			/* Number of I2C interrupts taken */
+	uint32_t ui32Cycles;		/* Cycles spent in I2CMIntHandler, wraps */
+	uint32_t ui32MaxCycles;		/* Longest single interrupt */
+}I2CDMA_IntStats_t;
+
+extern volatile I2CDMA_IntStats_t I2CDMAIntStats;
+
+/* Enable the uDMA controller and map the I2C7 channels. Must run before initI2C. */
+void I2CDMAInit(void);
+
+/* Account one I2C interrupt that took ui32Cycles cycles. */
+void I2CDMAIntAccount(uint32_t ui32Cycles);
+
+/* Host-level interrupt model, see i2c_dma_model.c. */
+uint32_t I2CDMAModelTransactionInts(uint32_t ui32WriteCount, uint32_t ui32ReadCount, bool bDMA);
+uint32_t I2CDMAModelSampleInts(bool bDMA);
+
+#endif /* WEATHER_STATION_I2C_DMA_H_ */
@@ -0,0 +1,61 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c_dma.h"
+
+//*****************************************************************************
+/*  Interrupt count model of the sensor I2C traffic. It has no hardware
+ *  dependency so it builds on the host as well, where it is used to compare
+ *  the interrupt per byte mode with the uDMA mode. */
+//*****************************************************************************
+
+/* Shape of a single I2C transaction: register/command bytes written, then
+ * data bytes read back after a repeated start. */
+typedef struct {
+	uint8_t ui8WriteCount;
+	uint8_t ui8ReadCount;
+}I2CDMA_Transaction_t;
+
+/* Transactions issued by the sensorlib drivers for one acquisition round. */
+static const I2CDMA_Transaction_t I2CDMASampleTransactions[] =
+{
+	{ 1, 2 },	/* TMP006 object voltage */
+	{ 1, 2 },	/* TMP006 ambient temperature */
+	{ 1, 0 },	/* SHT21 start humidity measurement */
+	{ 0, 3 },	/* SHT21 humidity result with CRC */
+	{ 2, 0 },	/* BMP180 start temperature conversion */
+	{ 1, 2 },	/* BMP180 raw temperature */
+	{ 2, 0 },	/* BMP180 start pressure conversion */
+	{ 1, 3 },	/* BMP180 raw pressure */
+	{ 1, 2 }	/* ISL29023 visible light data */
+};
+
+#define I2CDMA_NUM_SAMPLE_TRANSACTIONS \
+	(sizeof(I2CDMASampleTransactions) / sizeof(I2CDMASampleTransactions[0]))
+
+uint32_t I2CDMAModelTransactionInts(uint32_t ui32WriteCount, uint32_t ui32ReadCount, bool bDMA)
+{
+	if(!bDMA)
+	{
+		/* The driver is interrupted once for every byte that leaves or enters
+		 * the data register, the address cycle rides along with the first. */
+		return(ui32WriteCount + ui32ReadCount);
+	}
+
+	/* With uDMA each phase ends with a single completion interrupt. */
+	return((ui32WriteCount ? 1 : 0) + (ui32ReadCount ? 1 : 0));
+}
+
+uint32_t I2CDMAModelSampleInts(bool bDMA)
+{
+	uint32_t ui32Idx;
+	uint32_t ui32Ints = 0;
+
+	for(ui32Idx = 0; ui32Idx < I2CDMA_NUM_SAMPLE_TRANSACTIONS; ui32Idx++)
+	{
+		ui32Ints += I2CDMAModelTransactionInts(I2CDMASampleTransactions[ui32Idx].ui8WriteCount,
+		                                       I2CDMASampleTransactions[ui32Idx].ui8ReadCount, bDMA);
+	}
+
+	return(ui32Ints);
+}
@@ -1,11 +1,14 @@
 #include "weather_station.h"
+#include "ws_cycles.h"
+#include "ws_probe.h"
+#include "utils/ustdlib.h"
 
 //*****************************************************************************
 //
-// Global instance structure for the I2C master driver and sensors.
+// Global instance structures for the I2C master drivers and sensors.
 //
 //*****************************************************************************
-tI2CMInstance I2Cinstance;
+tI2CMInstance I2CBusInst[WS_NUM_I2C_BUSES];
 tTMP006 TempInst;
 tSHT21 HumidityInst;
 tBMP180 PressureInst;
@@ -37,8 +40,90 @@ volatile bool LightIntensityFlag;			/* Intensity flag is used for indicating the
 											 * is out of threshold */
 
 //I2C
-bool I2COperationInProgress;
-extern int SystickCounter;
+volatile bool I2CBusBusy[WS_NUM_I2C_BUSES];		/* Set while a transaction is running on the bus */
+static uint32_t I2CBusStart[WS_NUM_I2C_BUSES];		/* Start of the running transaction, cycles */
+
+WS_SampleTime_t SampleTime;
+
+//*****************************************************************************
+/*  Bus configuration. I2C7 is wired to the BoosterPack 1 headers, I2C8 to the
+ *  BoosterPack 2 headers. Only buses with at least one sensor assigned in
+ *  SensorConfig get initialized. */
+//*****************************************************************************
+static const WS_I2CBusConfig_t I2CBusConfig[WS_NUM_I2C_BUSES] =
+{
+	{ I2C7_BASE, INT_I2C7, SYSCTL_PERIPH_I2C7, SYSCTL_PERIPH_GPIOD, GPIO_PORTD_BASE,
+	  GPIO_PD0_I2C7SCL, GPIO_PD1_I2C7SDA, GPIO_PIN_0, GPIO_PIN_1,
+	  I2C7_DMA_TX_CHANNEL, I2C7_DMA_RX_CHANNEL },
+	{ I2C8_BASE, INT_I2C8, SYSCTL_PERIPH_I2C8, SYSCTL_PERIPH_GPIOA, GPIO_PORTA_BASE,
+	  GPIO_PA2_I2C8SCL, GPIO_PA3_I2C8SDA, GPIO_PIN_2, GPIO_PIN_3,
+	  /* No uDMA (0xff), I2CDMAInit maps only the I2C7 channels: I2C8 runs
+	   * interrupt per byte, which for the one or two sensors moved to
+	   * BoosterPack 2 costs a few interrupts per sample */
+	  0xff, 0xff }
+};
+
+/* Sensor to bus assignment. With a single Sensor Hub BoosterPack every sensor
+ * sits on I2C7, move entries to WS_I2CBus8 for sensors on BoosterPack 2. It
+ * is read by initI2C, host/busbench.c moves sensors before that. */
+WS_SensorConfig_t SensorConfig[WS_NUM_SENSORS] =
+{
+	{ WS_TemperatureSensor,	WS_I2CBus7 },
+	{ WS_HumiditySensor,	WS_I2CBus7 },
+	{ WS_PressureSensor,	WS_I2CBus7 },
+	{ WS_LightSensor,		WS_I2CBus7 }
+};
+
+#define SENSOR_BUS(sensor)		(SensorConfig[(sensor) - 1].eBus)
+#define SENSOR_I2C(sensor)		(&I2CBusInst[SENSOR_BUS(sensor)])
+#define SENSOR_CBDATA(sensor)	((void *)&SensorConfig[(sensor) - 1])
+
+//*****************************************************************************
+/*  Noise filters applied to each measurement before it is published. The
+ *  pressure noise of the BMP180 in its standard mode is about 6 Pa RMS, so
+ *  the Kalman filter's R is (6 Pa)^2 = 36 Pa^2; it assumes the true pressure
+ *  wanders about 2 Pa per sample, Q = (2 Pa)^2 = 4 Pa^2. Both are variances
+ *  in milli-Pa^2. The light sensor gets a median to drop flicker spikes.
+ *  host/filterbench.c measures what they do. */
+//*****************************************************************************
+const WS_FilterConfig_t SensorFilterConfig[WS_NUM_SENSORS] =
+{
+	{ WS_FilterEMA,		WS_FILTER_ALPHA(0.25f),		0,				0 },			/* Temperature */
+	{ WS_FilterEMA,		WS_FILTER_ALPHA(0.125f),	0,				0 },			/* Humidity */
+	{ WS_FilterKalman,	0,							2000u * 2000u,	6000u * 6000u },	/* Pressure */
+	{ WS_FilterMedian5,	0,							0,				0 }				/* Light */
+};
+static WS_Filter_t SensorFilter[WS_NUM_SENSORS];
+
+#define SENSOR_FILTER(sensor, value) \
+	filterUpdateFloat(&SensorFilter[(sensor) - 1], &SensorFilterConfig[(sensor) - 1], (value))
+
+/* SHT21 humidity conversion time */
+#define SHT21_MEAS_TIME_MS		33
+
+//*****************************************************************************
+/*  Measurement steps. Every sensor's measurement is split into phases that
+ *  either start an I2C transaction, ask for a delay or finish the sensor.
+ *  measureSensors walks the sensors of each bus through these phases and
+ *  interleaves the buses, so no bus waits for another one. */
+//*****************************************************************************
+typedef enum {
+	WS_StepIssued,		/* An I2C transaction was started on the sensor's bus */
+	WS_StepDelay,		/* Wait for the requested time before the next phase */
+	WS_StepNext,		/* Nothing to send in this phase, go on to the next one */
+	WS_StepDone			/* Nothing more to do for this sensor in this round */
+}WS_Step_t;
+
+typedef WS_Step_t (*WS_SensorStep_t)(uint32_t ui32Phase, uint32_t *pui32DelayMs);
+
+/* Per bus progress of a measurement round */
+typedef struct {
+	uint32_t ui32Cursor;		/* Index of the active entry in SensorConfig */
+	uint32_t ui32Phase;			/* Next phase of the active sensor */
+	uint64_t ui64WakeUs;		/* End of a requested delay, tickNowUs time */
+	bool bDelay;				/* A delay is pending */
+	bool bDone;					/* Every sensor on the bus finished */
+}WS_BusRound_t;
 
 const float LightThresholdHigh[4] =
 {
@@ -56,8 +141,38 @@ extern float HumidityMeas;
 extern float PressureMeas;
 extern float LightMeas;
 
-/* System clock frequency */
-uint32_t g_ui32SysClock;
+/* System clock frequency, set in enet_io.c */
+extern uint32_t g_ui32SysClock;
+
+/* Status variable of a sensor */
+static volatile uint_fast8_t *sensorStatus(WS_Sensor_t sensor)
+{
+	switch(sensor)
+	{
+		case WS_TemperatureSensor:
+			return(&TempStatus);
+		case WS_HumiditySensor:
+			return(&HumidityStatus);
+		case WS_PressureSensor:
+			return(&PressureStatus);
+		default:
+			return(&LightStatus);
+	};
+}
+
+/* Mark the bus of a sensor busy before starting a transaction on it */
+static void I2CBusSetBusy(WS_Sensor_t sensor)
+{
+	I2CBusStart[SENSOR_BUS(sensor)] = probeStart();
+	I2CBusBusy[SENSOR_BUS(sensor)] = true;
+}
+
+/* End of a transaction, called from the driver callbacks */
+static void I2CBusRelease(WS_I2CBus_t eBus)
+{
+	probeEnd(WS_ProbeI2CTransaction, I2CBusStart[eBus]);
+	I2CBusBusy[eBus] = false;
+}
 
 void TemperatureAppCallback(void *pvCallbackData, uint_fast8_t ui8Status)
 {
@@ -72,7 +187,7 @@ void TemperatureAppCallback(void *pvCallbackData, uint_fast8_t ui8Status)
     TempStatus = ui8Status;
 
     /* I2C operation is over */
-    I2COperationInProgress = false;
+    I2CBusRelease(SENSOR_BUS(WS_TemperatureSensor));
 }
 
 void HumidityAppCallback(void * pvCallbackData, uint_fast8_t ui8Status)
@@ -88,7 +203,7 @@ void HumidityAppCallback(void * pvCallbackData, uint_fast8_t ui8Status)
     HumidityStatus = ui8Status;
 
     /* I2C operation is over */
-    I2COperationInProgress = false;
+    I2CBusRelease(SENSOR_BUS(WS_HumiditySensor));
 }
 
 void PressureAppCallback(void* pvCallbackData, uint_fast8_t ui8Status)
@@ -103,7 +218,7 @@ void PressureAppCallback(void* pvCallbackData, uint_fast8_t ui8Status)
     PressureStatus = ui8Status;
 
     /* I2C operation is over */
-    I2COperationInProgress = false;
+    I2CBusRelease(SENSOR_BUS(WS_PressureSensor));
 }
 
 void LightAppCallback(void *pvCallbackData, uint_fast8_t ui8Status)
@@ -118,13 +233,19 @@ void LightAppCallback(void *pvCallbackData, uint_fast8_t ui8Status)
     LightStatus = ui8Status;
 
     /* I2C operation is over */
-    I2COperationInProgress = false;
+    I2CBusRelease(SENSOR_BUS(WS_LightSensor));
 }
 
 void DefaultAppCallback(void *pvCallbackData, uint_fast8_t ui8Status)
 {
+	/* The callback data is the sensor's entry in the configuration table */
+	const WS_SensorConfig_t *psSensor = (const WS_SensorConfig_t *)pvCallbackData;
+
+	/* Store the status so I2CAppWait can report a failed transaction */
+	*sensorStatus(psSensor->eSensor) = ui8Status;
+
 	/* I2C operation is over */
-	I2COperationInProgress = false;
+	I2CBusRelease(psSensor->eBus);
 }
 
 void UniversalAppErrorHandler(char *pcFilename, uint_fast32_t ui32Line, WS_Sensor_t sensor)
@@ -159,56 +280,23 @@ void UniversalAppErrorHandler(char *pcFilename, uint_fast32_t ui32Line, WS_Senso
 
 void I2CAppWait(char *pcFilename, uint_fast32_t ui32Line, WS_Sensor_t sensor)
 {
-
-	switch(sensor)
+	/* Sleep until the transaction on the sensor's bus is over */
+	while( I2CBusBusy[SENSOR_BUS(sensor)] )
 	{
-		case WS_TemperatureSensor:
-			while( I2COperationInProgress )
-			{
-				MAP_SysCtlSleep();
-			}
-			if(TempStatus)
-			{
-				UniversalAppErrorHandler(pcFilename, ui32Line, sensor);
-			}
-		break;
-		case WS_HumiditySensor:
-			while( I2COperationInProgress )
-			{
-				MAP_SysCtlSleep();
-			}
-			if(HumidityStatus)
-			{
-				UniversalAppErrorHandler(pcFilename, ui32Line, sensor);
-			}
-		break;
-		case WS_PressureSensor:
-			while( I2COperationInProgress )
-			{
-				MAP_SysCtlSleep();
-			}
-			if(PressureStatus)
-			{
-				UniversalAppErrorHandler(pcFilename, ui32Line, sensor);
-			}
-		case WS_LightSensor:
-			while( I2COperationInProgress )
-			{
-				MAP_SysCtlSleep();
-			}
-			if(LightStatus)
-			{
-				UniversalAppErrorHandler(pcFilename, ui32Line, sensor);
-			}
-
-		break;
-	};
+		MAP_SysCtlSleep();
+	}
+	if(*sensorStatus(sensor))
+	{
+		UniversalAppErrorHandler(pcFilename, ui32Line, sensor);
+	}
 }
 
 void TempIntHandler(void)
 {
     uint32_t ui32Status;
 
+    stackSampleNesting();
+
     ui32Status = GPIOIntStatus(GPIO_PORTH_BASE, true);
 
     /* Clear all the pin interrupts that are set */
@@ -223,13 +311,40 @@ void TempIntHandler(void)
 
 void UniversalI2CIntHandler(void)
 {
+	uint32_t ui32Start = cyclesGet();
+	WS_TraceI2C_t sTrace;
+
+	stackSampleNesting();
 
 	/* I2CMIntHandler can receive the instance structure pointer as an argument. */
-    I2CMIntHandler(&I2Cinstance);
+	traceI2CBefore(&sTrace, &I2CBusInst[WS_I2CBus7]);
+    I2CMIntHandler(&I2CBusInst[WS_I2CBus7]);
+    traceI2CAfter(&sTrace, &I2CBusInst[WS_I2CBus7], WS_I2CBus7);
+
+    /* Keep track of what the sensor traffic costs in interrupt time */
+    I2CDMAIntAccount(cyclesGet() - ui32Start);
+    probeEnd(WS_ProbeI2CInt, ui32Start);
+}
+
+void UniversalI2C8IntHandler(void)
+{
+	uint32_t ui32Start = cyclesGet();
+	WS_TraceI2C_t sTrace;
+
+	stackSampleNesting();
+
+	traceI2CBefore(&sTrace, &I2CBusInst[WS_I2CBus8]);
+    I2CMIntHandler(&I2CBusInst[WS_I2CBus8]);
+    traceI2CAfter(&sTrace, &I2CBusInst[WS_I2CBus8], WS_I2CBus8);
+
+    I2CDMAIntAccount(cyclesGet() - ui32Start);
+    probeEnd(WS_ProbeI2CInt, ui32Start);
 }
 
 void LightIntHandler(void)
 {
+	stackSampleNesting();
+
 	if(!LightIntensityFlag)
 	{
 		unsigned long ulStatus;
@@ -249,7 +364,7 @@ void LightIntHandler(void)
 	}
 }
 
-void LightAppAdjustRange(tISL29023 *pInst)
+bool LightAppAdjustRange(tISL29023 *pInst)
 {
     float Ambient;
     uint8_t NewRange;
@@ -280,16 +395,18 @@ void LightAppAdjustRange(tISL29023 *pInst)
     }
 
     /* If the desired range value changed then send the new range to the sensor */
-    if(NewRange != LightInst.ui8Range)
+    if(NewRange == LightInst.ui8Range)
     {
-    	I2COperationInProgress = true;
-        ISL29023ReadModifyWrite(&LightInst, ISL29023_O_CMD_II,
-                                ~ISL29023_CMD_II_RANGE_M, NewRange,
-                                DefaultAppCallback, &LightInst);
-
-        /* Wait for transaction to complete */
-        I2CAppWait(__FILE__, __LINE__, WS_LightSensor);
+    	return(false);
     }
+
+    I2CBusSetBusy(WS_LightSensor);
+    ISL29023ReadModifyWrite(&LightInst, ISL29023_O_CMD_II,
+                            ~ISL29023_CMD_II_RANGE_M, NewRange,
+                            DefaultAppCallback, SENSOR_CBDATA(WS_LightSensor));
+
+    /* The caller waits for the bus, the status is in LightStatus */
+    return(true);
 }
 
 int32_t IntegerPart(float Value)
@@ -308,17 +425,135 @@ int32_t FractionPart(float Value)
 	return FractionPart;
 }
 
+int FormatMilli(char *pcBuf, int iBufLen, int32_t Milli)
+{
+	uint32_t ui32Abs = (Milli < 0) ? (uint32_t)-Milli : (uint32_t)Milli;
+
+	/* The sign is printed separately, -0.5 has no integer part to carry it */
+	return(usnprintf(pcBuf, iBufLen, "%s%u.%03u", (Milli < 0) ? "-" : "",
+					 ui32Abs / 1000, ui32Abs % 1000));
+}
+
+int FormatFixed(char *pcBuf, int iBufLen, float Value)
+{
+	return(FormatMilli(pcBuf, iBufLen, filterToMilli(Value)));
+}
+
+void processSample(void)
+{
+	static uint32_t ui32LoggedBuckets;
+	const WS_RollupLevel_t *psSeconds;
+	const WS_RollupBucket_t *psBucket;
+	WS_LogSample_t sLogSample;
+	int32_t pi32Values[WS_ROLLUP_CHANNELS];
+	uint64_t ui64UnixUs;
+	uint32_t ui32Start, ui32Cycles, ui32Ch, ui32Probe;
+
+	ui32Probe = probeStart();
+	ui32Start = cyclesGet();
+	derivedCompute(TempAmbientMeas, HumidityMeas, PressureMeas, &DerivedData);
+	ui32Cycles = cyclesGet() - ui32Start;
+
+	DerivedCycles.ui32Last = ui32Cycles;
+	if(ui32Cycles > DerivedCycles.ui32Max)
+	{
+		DerivedCycles.ui32Max = ui32Cycles;
+	}
+
+	/* Pressure history for the tendency, reduced to sea level so the
+	 * forecast thresholds apply directly */
+	trendAddSample(&PressureTrend, tickNowMs(), DerivedData.fSeaLevelPressure);
+
+	/* Rollups of the published measurements */
+	pi32Values[0] = filterToMilli(TempAmbientMeas);
+	pi32Values[1] = filterToMilli(HumidityMeas);
+	pi32Values[2] = filterToMilli(PressureMeas);
+	pi32Values[3] = filterToMilli(LightMeas);
+	rollupAddSample(tickNowMs() / 1000, pi32Values);
+
+	/* The held values to the listeners on the multicast group and to the
+	 * MQTT broker, when one moved past its deadband or its heartbeat expired */
+	if(deadbandUpdate(&StreamDeadband, &PublishDeadbandConfig, tickNowMs(), pi32Values))
+	{
+		mcastPublish(SampleTime.ui64Us, StreamDeadband.pi32Held, WS_DEADBAND_CHANNELS);
+		mqttPublish(SampleTime.ui64Us, StreamDeadband.pi32Held, WS_DEADBAND_CHANNELS);
+	}
+
+	/* and as the CoAP resources, their observers are notified */
+	coapUpdate(pi32Values, WS_ROLLUP_CHANNELS);
+
+	/* Every closed 1 s bucket goes to the flash log as one sample, stamped
+	 * with the wall clock once SNTP set it. The ring count stops at its size,
+	 * the head keeps moving after that. */
+	psSeconds = rollupLevelGet(1);
+	if((psSeconds->ui32Count + psSeconds->ui32Head) != ui32LoggedBuckets)
+	{
+		ui32LoggedBuckets = psSeconds->ui32Count + psSeconds->ui32Head;
+		psBucket = rollupBucketGet(psSeconds, psSeconds->ui32Count - 1);
+		if(!timeUnixUs((uint64_t)psBucket->ui32Start * 1000000u, &ui64UnixUs))
+		{
+			ui64UnixUs = 0;
+		}
+		sLogSample.ui32Time = flashLogTime(&FlashLog, psBucket->ui32Start, (uint32_t)(ui64UnixUs / 1000000u));
+		for(ui32Ch = 0; ui32Ch < WS_FLASHLOG_CHANNELS; ui32Ch++)
+		{
+			sLogSample.pi32Values[ui32Ch] = psBucket->psStat[ui32Ch].i32Mean;
+		}
+		flashLogAppend(&FlashLog, &sLogSample);
+	}
+
+	probeEnd(WS_ProbeProcessSample, ui32Probe);
+}
+
 void initI2C(void)
 {
-	I2CMInit(&I2Cinstance, I2C7_BASE, INT_I2C7, 0xff, 0xff, g_ui32SysClock);
+	uint32_t ui32Bus, ui32Sensor;
+	bool bUsed;
+
+	/* Set up the uDMA channels first, the I2CM driver uses them when given */
+	I2CDMAInit();
+
+	for(ui32Bus = 0; ui32Bus < WS_NUM_I2C_BUSES; ui32Bus++)
+	{
+		const WS_I2CBusConfig_t *psBus = &I2CBusConfig[ui32Bus];
+
+		/* Leave the pins of unused interfaces alone */
+		bUsed = false;
+		for(ui32Sensor = 0; ui32Sensor < WS_NUM_SENSORS; ui32Sensor++)
+		{
+			if(SensorConfig[ui32Sensor].eBus == ui32Bus)
+			{
+				bUsed = true;
+			}
+		}
+		if(!bUsed)
+		{
+			continue;
+		}
+
+		/* Enable the I2C peripheral and its GPIO port before use. */
+		ROM_SysCtlPeripheralEnable(psBus->ui32GPIOPeriph);
+		ROM_SysCtlPeripheralEnable(psBus->ui32Periph);
+
+		/* Configure the pin muxing for the I2C functions. */
+		ROM_GPIOPinConfigure(psBus->ui32SCLConfig);
+		ROM_GPIOPinConfigure(psBus->ui32SDAConfig);
+
+		/* Select the I2C function for these pins.  This function will also configure the GPIO pins pins for I2C operation, setting them to
+		 * open-drain operation with weak pull-ups. */
+		GPIOPinTypeI2CSCL(psBus->ui32GPIOBase, psBus->ui8SCLPin);
+		ROM_GPIOPinTypeI2C(psBus->ui32GPIOBase, psBus->ui8SDAPin);
+
+		I2CMInit(&I2CBusInst[ui32Bus], psBus->ui32Base, psBus->ui32Int, psBus->ui8TxDMA, psBus->ui8RxDMA, g_ui32SysClock);
+	}
 }
 
 void tempSensorInit(void)
 {
 	 /* Initialize the TMP006 */
-	 I2COperationInProgress = true;
-	 TMP006Init(&TempInst, &I2Cinstance, TMP006_I2C_ADDRESS,
-	               DefaultAppCallback, &TempInst);
+	 I2CBusSetBusy(WS_TemperatureSensor);
+	 TMP006Init(&TempInst, SENSOR_I2C(WS_TemperatureSensor), TMP006_I2C_ADDRESS,
+	               DefaultAppCallback, SENSOR_CBDATA(WS_TemperatureSensor));
 	    /* Put the processor to sleep while we wait for the I2C driver to indicate that the transaction is complete. */
 	    I2CAppWait(__FILE__, __LINE__, WS_TemperatureSensor);
 
@@ -326,11 +561,11 @@ void tempSensorInit(void)
 	    TempDataFlag = 0;
 
 	        /* Enable the DRDY pin indication that a conversion is in progress. */
-	    I2COperationInProgress = true;
+	    I2CBusSetBusy(WS_TemperatureSensor);
 	    TMP006ReadModifyWrite(&TempInst, TMP006_O_CONFIG,
 	    		~TMP006_CONFIG_EN_DRDY_PIN_M,
 				TMP006_CONFIG_EN_DRDY_PIN, DefaultAppCallback,
-				&TempInst);
+				SENSOR_CBDATA(WS_TemperatureSensor));
 	    /* Wait for the DRDY enable I2C transaction to complete. */
 	    I2CAppWait(__FILE__, __LINE__, WS_TemperatureSensor);
 	    /* Delay for 10 milliseconds for TMP006 reset to complete. Not explicitly required. Datasheet does not say how long a reset takes. */
@@ -341,9 +576,9 @@ void tempSensorInit(void)
 
 void humiditySensorInit(void)
 {
-	I2COperationInProgress = true;
-	    SHT21Init(&HumidityInst, &I2Cinstance, SHT21_I2C_ADDRESS,
-	    		DefaultAppCallback, &HumidityInst);
+	I2CBusSetBusy(WS_HumiditySensor);
+	    SHT21Init(&HumidityInst, SENSOR_I2C(WS_HumiditySensor), SHT21_I2C_ADDRESS,
+	    		DefaultAppCallback, SENSOR_CBDATA(WS_HumiditySensor));
 
 	    /* Wait for the I2C transactions to complete before moving forward. */
 	    I2CAppWait(__FILE__, __LINE__, WS_HumiditySensor);
@@ -354,9 +589,9 @@ void humiditySensorInit(void)
 
 void pressureSensorInit(void)
 {
-	I2COperationInProgress = true;
-	    BMP180Init(&PressureInst, &I2Cinstance, BMP180_I2C_ADDRESS,
-	        		DefaultAppCallback, &PressureInst);
+	I2CBusSetBusy(WS_PressureSensor);
+	    BMP180Init(&PressureInst, SENSOR_I2C(WS_PressureSensor), BMP180_I2C_ADDRESS,
+	        		DefaultAppCallback, SENSOR_CBDATA(WS_PressureSensor));
 	        /* Wait for the I2C transactions to complete before moving forward. */
 	    I2CAppWait(__FILE__, __LINE__, WS_PressureSensor);
 	    PressureDataFlag = 0;
@@ -364,9 +599,9 @@ void pressureSensorInit(void)
 
 void lightSensorInit(void)
 {
-	   I2COperationInProgress = true;
-	    ISL29023Init(&LightInst, &I2Cinstance, ISL29023_I2C_ADDRESS,
-	                 DefaultAppCallback, &LightInst);
+	   I2CBusSetBusy(WS_LightSensor);
+	    ISL29023Init(&LightInst, SENSOR_I2C(WS_LightSensor), ISL29023_I2C_ADDRESS,
+	                 DefaultAppCallback, SENSOR_CBDATA(WS_LightSensor));
 	    /* Wait for transaction to complete */
 	    I2CAppWait(__FILE__, __LINE__, WS_LightSensor);
 
@@ -374,11 +609,11 @@ void lightSensorInit(void)
 	     * INT flag. Persistence setting of 8 is sufficient to ignore camera flashes. */
 	    LightMask = (ISL29023_CMD_I_OP_MODE_M | ISL29023_CMD_I_INT_PERSIST_M |
 	                 ISL29023_CMD_I_INT_FLAG_M);
-	    I2COperationInProgress = true;
+	    I2CBusSetBusy(WS_LightSensor);
 	    ISL29023ReadModifyWrite(&LightInst, ISL29023_O_CMD_I, ~LightMask,
 	                           (ISL29023_CMD_I_OP_MODE_ALS_CONT |
 	                            ISL29023_CMD_I_INT_PERSIST_8),
-	                            DefaultAppCallback, &LightInst);
+	                            DefaultAppCallback, SENSOR_CBDATA(WS_LightSensor));
 
 	   /* Wait for transaction to complete */
 	   I2CAppWait(__FILE__, __LINE__, WS_LightSensor);
@@ -386,94 +621,242 @@ void lightSensorInit(void)
 	   /* Configure the upper threshold to 80% of maximum value */
 	   LightInst.pui8Data[1] = 0xCC;
 	   LightInst.pui8Data[2] = 0xCC;
-	   I2COperationInProgress = true;
+	   I2CBusSetBusy(WS_LightSensor);
 	   ISL29023Write(&LightInst, ISL29023_O_INT_HT_LSB,
 	                 LightInst.pui8Data, 2, DefaultAppCallback,
-	                 &LightInst);
+	                 SENSOR_CBDATA(WS_LightSensor));
 	   /* Wait for transaction to complete */
 	   I2CAppWait(__FILE__, __LINE__, WS_LightSensor);
 
 	   /* Configure the lower threshold to 20% of maximum value */
 	   LightInst.pui8Data[1] = 0x33;
 	   LightInst.pui8Data[2] = 0x33;
-	   I2COperationInProgress = true;
+	   I2CBusSetBusy(WS_LightSensor);
 	   ISL29023Write(&LightInst, ISL29023_O_INT_LT_LSB,
 			   LightInst.pui8Data, 2, DefaultAppCallback,
-			   &LightInst);
+			   SENSOR_CBDATA(WS_LightSensor));
 
 	   /* Wait for transaction to complete */
 	   I2CAppWait(__FILE__, __LINE__, WS_LightSensor);
 }
 
-void measureTemp(void)
+static WS_Step_t tempSensorStep(uint32_t ui32Phase, uint32_t *pui32DelayMs)
+{
+	switch(ui32Phase)
+	{
+		case 0:
+			/* Only read the TMP006 when it signalled a finished conversion */
+			if( (TempDataFlag == true) || (TempMeasReady == false) )
+			{
+				return(WS_StepDone);
+			}
+			I2CBusSetBusy(WS_TemperatureSensor);
+			TMP006DataRead(&TempInst, TemperatureAppCallback, &TempInst);
+			return(WS_StepIssued);
+		default:
+			TMP006DataTemperatureGetFloat(&TempInst, &TempAmbientMeas, &TempObjectMeas);
+			TempAmbientMeas = SENSOR_FILTER(WS_TemperatureSensor, TempAmbientMeas);
+			return(WS_StepDone);
+	}
+}
+
+static WS_Step_t humiditySensorStep(uint32_t ui32Phase, uint32_t *pui32DelayMs)
 {
-	if( (TempDataFlag == false) && (TempMeasReady == true))
+	switch(ui32Phase)
 	{
-		I2COperationInProgress = true;
-		TMP006DataRead(&TempInst, TemperatureAppCallback, &TempInst);
-		I2CAppWait(__FILE__, __LINE__, WS_TemperatureSensor);
-		TMP006DataTemperatureGetFloat(&TempInst, &TempAmbientMeas, &TempObjectMeas);
+		case 0:
+			if(HumidityDataFlag == true)
+			{
+				return(WS_StepDone);
+			}
+			/* Write the command to start measurement */
+			I2CBusSetBusy(WS_HumiditySensor);
+			SHT21Write(&HumidityInst, SHT21_CMD_MEAS_RH, HumidityInst.pui8Data, 0,
+					DefaultAppCallback, SENSOR_CBDATA(WS_HumiditySensor));
+			return(WS_StepIssued);
+		case 1:
+			/* Wait 33 milliseconds before attempting to get the result, the
+			 * other buses keep running meanwhile. */
+			*pui32DelayMs = SHT21_MEAS_TIME_MS;
+			return(WS_StepDelay);
+		case 2:
+			/* Get the raw data from the sensor over the I2C bus. */
+			I2CBusSetBusy(WS_HumiditySensor);
+			SHT21DataRead(&HumidityInst, HumidityAppCallback, &HumidityInst);
+			return(WS_StepIssued);
+		default:
+			/* Get a copy of the most recent raw data in floating point format. */
+			SHT21DataHumidityGetFloat(&HumidityInst, &HumidityMeas);
+			HumidityMeas = SENSOR_FILTER(WS_HumiditySensor, HumidityMeas);
+			return(WS_StepDone);
 	}
 }
 
-void measureHumidity(void)
+static WS_Step_t pressureSensorStep(uint32_t ui32Phase, uint32_t *pui32DelayMs)
 {
-	if( (HumidityDataFlag == false) )
+	switch(ui32Phase)
 	{
-	    /* Write the command to start measurement */
-		I2COperationInProgress = true;
-		SHT21Write(&HumidityInst, SHT21_CMD_MEAS_RH, HumidityInst.pui8Data, 0,
-				DefaultAppCallback, &HumidityInst);
-		/* Wait until command is sent */
-		I2CAppWait(__FILE__, __LINE__, WS_TemperatureSensor);
-
-	    /* Wait 33 milliseconds before attempting to get the result. */
-		ROM_SysCtlDelay(g_ui32SysClock / (30 * 3));
-
-		/* Get the raw data from the sensor over the I2C bus. */
-		I2COperationInProgress = true;
-		SHT21DataRead(&HumidityInst, HumidityAppCallback, &HumidityInst);
-		/*Wait for the I2C transactions to complete before moving forward. */
-		I2CAppWait(__FILE__, __LINE__, WS_HumiditySensor);
-
-		/* Get a copy of the most recent raw data in floating point format. */
-		SHT21DataHumidityGetFloat(&HumidityInst, &HumidityMeas);
+		case 0:
+			if(PressureDataFlag == true)
+			{
+				return(WS_StepDone);
+			}
+			/* Start a read of data from the pressure sensor. */
+			I2CBusSetBusy(WS_PressureSensor);
+			BMP180DataRead(&PressureInst, PressureAppCallback, &PressureInst);
+			return(WS_StepIssued);
+		default:
+			/* Get local copy of pressure data in float format */
+			BMP180DataPressureGetFloat(&PressureInst, &PressureMeas);
+			PressureMeas = SENSOR_FILTER(WS_PressureSensor, PressureMeas);
+			return(WS_StepDone);
 	}
 }
 
-void measurePressure(void)
+static WS_Step_t lightSensorStep(uint32_t ui32Phase, uint32_t *pui32DelayMs)
 {
-	if( (PressureDataFlag == false) )
+	switch(ui32Phase)
 	{
+		case 0:
+			if(LightDataFlag == true)
+			{
+				return(WS_StepDone);
+			}
+			/* Intensity threshold changed, adjust range. The range write
+			 * runs like any other phase, the other buses keep going. */
+			if(LightIntensityFlag)
+			{
+				LightIntensityFlag = false;
+				if(LightAppAdjustRange(&LightInst))
+				{
+					return(WS_StepIssued);
+				}
+			}
+			return(WS_StepNext);
+		case 1:
+			/* Start a read of data from the light sensor. */
+			I2CBusSetBusy(WS_LightSensor);
+			ISL29023DataRead(&LightInst, LightAppCallback, &LightInst);
+			return(WS_StepIssued);
+		default:
+			/* Get local copy of light data in float format */
+			ISL29023DataLightVisibleGetFloat(&LightInst, &LightMeas);
+			LightMeas = SENSOR_FILTER(WS_LightSensor, LightMeas);
+			return(WS_StepDone);
+	}
+}
 
-		/* Start a read of data from the pressure sensor. */
-		I2COperationInProgress = true;
-		BMP180DataRead(&PressureInst, PressureAppCallback, &PressureInst);
+/* Step functions indexed by (sensor - 1) */
+static const WS_SensorStep_t SensorSteps[WS_NUM_SENSORS] =
+{
+	tempSensorStep,
+	humiditySensorStep,
+	pressureSensorStep,
+	lightSensorStep
+};
 
-		/* Wait until command is sent */
-		I2CAppWait(__FILE__, __LINE__, WS_PressureSensor);
+/* Move one bus forward as far as possible without waiting.
+ * Returns true if anything happened on the bus. */
+static bool serviceBus(uint32_t ui32Bus, WS_BusRound_t *psRound)
+{
+	const WS_SensorConfig_t *psSensor;
+	uint32_t ui32DelayMs;
+	WS_Step_t eStep;
+	bool bProgress = false;
 
-		/* Get local copy of pressure data in float format */
-		BMP180DataPressureGetFloat(&PressureInst, &PressureMeas);
+	while(!psRound->bDone)
+	{
+		/* The bus is still working on the last transaction */
+		if(I2CBusBusy[ui32Bus])
+		{
+			return(bProgress);
+		}
+
+		/* A delay is running */
+		if(psRound->bDelay)
+		{
+			if(tickNowUs() < psRound->ui64WakeUs)
+			{
+				return(bProgress);
+			}
+			psRound->bDelay = false;
+		}
+
+		/* Skip the entries of the other buses */
+		psSensor = &SensorConfig[psRound->ui32Cursor];
+		if(psSensor->eBus != ui32Bus)
+		{
+			psRound->ui32Cursor++;
+			psRound->bDone = (psRound->ui32Cursor >= WS_NUM_SENSORS);
+			continue;
+		}
+
+		/* Check the result of the previous phase */
+		if( (psRound->ui32Phase != 0) && *sensorStatus(psSensor->eSensor) )
+		{
+			UniversalAppErrorHandler(__FILE__, __LINE__, psSensor->eSensor);
+		}
+
+		ui32DelayMs = 0;
+		eStep = SensorSteps[psSensor->eSensor - 1](psRound->ui32Phase, &ui32DelayMs);
+		bProgress = true;
+
+		switch(eStep)
+		{
+			case WS_StepIssued:
+				psRound->ui32Phase++;
+			break;
+			case WS_StepNext:
+				psRound->ui32Phase++;
+			break;
+			case WS_StepDelay:
+				/* SysTick wakes measureSensors up right at the end */
+				psRound->ui64WakeUs = tickNowUs() + (uint64_t)ui32DelayMs * 1000;
+				tickDeadlineSet((WS_TickClient_t)(WS_TickSensorBus0 + ui32Bus), psRound->ui64WakeUs);
+				psRound->bDelay = true;
+				psRound->ui32Phase++;
+			break;
+			case WS_StepDone:
+				/* Phase 0 only finds the data of the set already there */
+				if(psRound->ui32Phase != 0)
+				{
+					SampleTime.pui64SensorUs[psSensor->eSensor - 1] = tickNowUs();
+					SampleTime.ui64Us = SampleTime.pui64SensorUs[psSensor->eSensor - 1];
+				}
+				psRound->ui32Phase = 0;
+				psRound->ui32Cursor++;
+				psRound->bDone = (psRound->ui32Cursor >= WS_NUM_SENSORS);
+			break;
+		};
 	}
+
+	return(bProgress);
 }
 
-void measureLight(void)
+void measureSensors(void)
 {
-	if( (LightDataFlag == false)  )
+	WS_BusRound_t psRound[WS_NUM_I2C_BUSES];
+	uint32_t ui32Bus;
+	bool bDone, bProgress;
+
+	memset(psRound, 0, sizeof(psRound));
+
+	do
 	{
-		/* Intensity threshold changed, adjust range */
-		if(LightIntensityFlag)
+		bDone = true;
+		bProgress = false;
+		for(ui32Bus = 0; ui32Bus < WS_NUM_I2C_BUSES; ui32Bus++)
+		{
+			bProgress |= serviceBus(ui32Bus, &psRound[ui32Bus]);
+			bDone &= psRound[ui32Bus].bDone;
+		}
+
+		/* Every bus waits for a transaction or a delay, sleep until the next
+		 * interrupt (I2C completion or the SysTick deadline of a delay). */
+		if(!bDone && !bProgress)
 		{
-			LightAppAdjustRange(&LightInst);
-			LightIntensityFlag = false;
+			MAP_SysCtlSleep();
 		}
-		/* Start a read of data from the pressure sensor. */
-		I2COperationInProgress = true;
-		ISL29023DataRead(&LightInst, LightAppCallback, &LightInst);
-		/* Wait until command is sent */
-		I2CAppWait(__FILE__, __LINE__, WS_LightSensor);
-		/* Get local copy of light data in float format */
-		ISL29023DataLightVisibleGetFloat(&LightInst, &LightMeas);
 	}
+	while(!bDone);
 }
@@ -44,6 +44,51 @@
 
 #include "io.h"
 
+// uDMA transfer mode of the sensor I2C master
+#include "i2c_dma.h"
+
+// Measurement noise filters
+#include "ws_filter.h"
+
+// Dew point, heat index, altitude and sea-level pressure
+#include "ws_derived.h"
+
+// Barometric tendency and forecast
+#include "ws_trend.h"
+
+// Min/max/mean rollups
+#include "ws_rollup.h"
+
+// Persistent sample log
+#include "ws_flashlog.h"
+
+// Timing probes
+#include "ws_probe.h"
+
+// Stack high-water and interrupt nesting
+#include "ws_stack.h"
+
+// Sensor I2C trace capture
+#include "ws_trace.h"
+
+// Monotonic clock and SysTick deadlines
+#include "ws_tick.h"
+
+// Wall clock, SNTP
+#include "ws_time.h"
+
+// Multicast publisher of the samples
+#include "ws_mcast.h"
+
+// MQTT publisher of the samples
+#include "ws_mqtt.h"
+
+// CoAP server of the latest values
+#include "ws_coap.h"
+
+// Change based publishing of the measurements
+#include "ws_deadband.h"
+
 //*****************************************************************************
 /*  Define sensor addresses */
 //*****************************************************************************
@@ -60,6 +105,48 @@ typedef enum {
 	WS_LightSensor			= 0x04u
 }WS_Sensor_t;
 
+#define WS_NUM_SENSORS			4
+
+/* I2C buses the sensors can be attached to */
+typedef enum {
+	WS_I2CBus7				= 0x00u,	/* BoosterPack 1 interface, PD0/PD1 */
+	WS_I2CBus8				= 0x01u,	/* BoosterPack 2 interface, PA2/PA3 */
+	WS_NUM_I2C_BUSES
+}WS_I2CBus_t;
+
+/* Hardware description of one I2C bus */
+typedef struct {
+	uint32_t ui32Base;			/* I2C module base address */
+	uint32_t ui32Int;			/* I2C interrupt number */
+	uint32_t ui32Periph;		/* I2C peripheral to enable */
+	uint32_t ui32GPIOPeriph;	/* GPIO port peripheral of the pins */
+	uint32_t ui32GPIOBase;		/* GPIO port base address of the pins */
+	uint32_t ui32SCLConfig;		/* Pin mux value of SCL */
+	uint32_t ui32SDAConfig;		/* Pin mux value of SDA */
+	uint8_t ui8SCLPin;			/* SCL pin on the port */
+	uint8_t ui8SDAPin;			/* SDA pin on the port */
+	uint8_t ui8TxDMA;			/* uDMA channels for the I2CM driver, 0xff if unused */
+	uint8_t ui8RxDMA;
+}WS_I2CBusConfig_t;
+
+/* Assignment of a sensor to a bus */
+typedef struct {
+	WS_Sensor_t eSensor;
+	WS_I2CBus_t eBus;
+}WS_SensorConfig_t;
+
+/* Sensor to bus assignment table, indexed by (sensor - 1) */
+extern WS_SensorConfig_t SensorConfig[WS_NUM_SENSORS];
+
+/* Acquisition times of a sample set, tickNowUs time */
+typedef struct {
+	uint64_t pui64SensorUs[WS_NUM_SENSORS];	/* Data read, indexed by (sensor - 1) */
+	uint64_t ui64Us;						/* Latest of those, time of the set */
+}WS_SampleTime_t;
+
+/* Times of the set being measured */
+extern WS_SampleTime_t SampleTime;
+
 
 /*****************************************************************************
 * Sensor callback functions.  Called at the end of each sensor's driver
@@ -93,11 +180,10 @@ void TempIntHandler(void);
 
 /* Handles the I2C interrupts.
  * Called by the NVIC as a result of I2C Interrupt. I2C7 is the I2C connection
- * to the TMP006 for BoosterPack 1 interface.  I2C8 must be used for
- * BoosterPack 2 interface.  Must also move this function pointer in the
- * startup file interrupt vector table for your tool chain if using BoosterPack
- * 2 interface headers. */
+ * for BoosterPack 1 interface, I2C8 is the one for BoosterPack 2 interface.
+ * Which sensor sits on which bus is set in the SensorConfig table. */
 void UniversalI2CIntHandler(void);
+void UniversalI2C8IntHandler(void);
 
 /* GPIOPortE interrupt handler for light sensor indicating, that light level has crossed outside of
  * the intensity threshold levels set in INT_LT and INT_HT registers. It's a very low priority
@@ -108,15 +194,22 @@ void LightIntHandler(void);
 /* Intensity and Range Tracking Function.  This adjusts the range and interrupt
  * thresholds as needed.  Uses an 80/20 rule. If light is greater then 80% of
  * maximum value in this range then go to next range up. If less than 20% of
- * potential value in this range go the next range down. */
-void LightAppAdjustRange(tISL29023 *pInst);
+ * potential value in this range go the next range down. Returns true if it
+ * started the range write on the light sensor's bus, it does not wait. */
+bool LightAppAdjustRange(tISL29023 *pInst);
 
 /* Functions for splitting floating point number to two unsigned numbers */
 int32_t IntegerPart(float Value);
 
 int32_t FractionPart(float Value);
 
-/* I2C initialization */
+/* Prints a value with three decimals and a correct sign, returns the length */
+int FormatFixed(char *pcBuf, int iBufLen, float Value);
+
+/* Same for a value given in thousandths */
+int FormatMilli(char *pcBuf, int iBufLen, int32_t Milli);
+
+/* I2C initialization of every bus that has a sensor assigned */
 void initI2C(void);
 
 /* Temperature sensor initialization */
@@ -131,17 +224,14 @@ void pressureSensorInit(void);
 /* Light sensor initialization */
 void lightSensorInit(void);
 
-/* Temperature measurement */
-void measureTemp(void);
-
-/* Humidity measurement */
-void measureHumidity(void);
-
-/* Pressure measurement */
-void measurePressure(void);
+/* Runs one measurement round on every sensor that has no fresh data yet.
+ * The buses are serviced side by side, so transactions on different buses
+ * overlap and the round takes as long as the busiest bus. */
+void measureSensors(void);
 
-/* Light measurement */
-void measureLight(void);
+/* Post-processing of a complete set of measurements, called from main once
+ * per refresh period after every sensor delivered. */
+void processSample(void);
 
 
 #endif /* WEATHER_STATION_WEATHER_STATION_H_ */
@@ -0,0 +1,512 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils/lwiplib.h"
+#include "utils/ustdlib.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "ws_coap_msg.h"
+#include "ws_tick.h"
+#include "ws_coap.h"
+
+WS_CoapStats_t CoapStats;
+
+#if WS_COAP_PORT
+
+/* Max-Age a response without the option has */
+#define COAP_MAX_AGE_DEFAULT	60
+
+/* Notifications ahead of the client's copy going stale */
+#define COAP_HEARTBEAT_MS		((WS_COAP_MAX_AGE_S - 1) * 1000u)
+
+#define COAP_OBSERVE_REGISTER	0
+#define COAP_OBSERVE_DEREGISTER	1
+
+#define COAP_WELL_KNOWN			(WS_COAP_RESOURCES)
+
+typedef struct {
+	bool bUsed;
+	ip_addr_t sAddr;
+	uint16_t ui16Port;
+	uint8_t ui8TokenLen;
+	uint8_t pui8Token[WS_COAP_TOKEN_MAX];
+	uint8_t ui8Resource;
+	uint8_t ui8Format;
+	uint32_t ui32Sequence;			/* Observe value of the last notification */
+	int32_t i32Sent;				/* Value of the last notification */
+	uint32_t ui32SentMs;
+	uint32_t ui32Count;				/* Notifications sent */
+	uint16_t ui16LastId;			/* Message ID of the last notification */
+
+	/* CON notification waiting for its ACK */
+	bool bConPending;
+	uint16_t ui16ConId;
+	uint8_t ui8Retries;
+	uint32_t ui32TimeoutMs;
+	uint32_t ui32RetryMs;
+}CoapObserver_t;
+
+static const char * const CoapPaths[WS_COAP_RESOURCES + 1] =
+{
+	"temperature",
+	"humidity",
+	"pressure",
+	"light",
+	".well-known/core"
+};
+
+#define COAP_LINK(path)			"</" path ">;obs;ct=\"0 60\""
+static const char CoapLinks[] = COAP_LINK("temperature") "," COAP_LINK("humidity") ","
+								COAP_LINK("pressure") "," COAP_LINK("light");
+
+static struct udp_pcb *CoapPcb;
+static CoapObserver_t CoapObservers[WS_COAP_OBSERVERS];
+static uint16_t CoapMessageId;
+
+/* Latest values, written by main */
+static int32_t CoapValues[WS_COAP_RESOURCES];
+static bool CoapValid;
+
+/* lwIP context only */
+static uint8_t CoapIn[WS_COAP_MSG_LEN];
+static uint8_t CoapOut[WS_COAP_MSG_LEN];
+
+static void coapSend(const WS_CoapMsg_t *psMsg, ip_addr_t *psAddr, uint16_t ui16Port)
+{
+	uint32_t ui32Len = coapEncode(CoapOut, sizeof(CoapOut), psMsg);
+	struct pbuf *p;
+
+	if(!ui32Len)
+	{
+		return;
+	}
+
+	p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)ui32Len, PBUF_RAM);
+	if(!p)
+	{
+		return;
+	}
+	pbuf_take(p, CoapOut, (u16_t)ui32Len);
+	if(udp_sendto(CoapPcb, p, psAddr, ui16Port) == ERR_OK)
+	{
+		CoapStats.ui32TxBytes += ui32Len;
+	}
+	pbuf_free(p);
+}
+
+/* Representation of a sensor value, returns its length */
+static uint32_t coapPayload(uint8_t *pui8Buf, uint32_t ui32Size, int32_t i32Value, uint8_t ui8Format)
+{
+	uint32_t ui32Abs = (i32Value < 0) ? (uint32_t)-i32Value : (uint32_t)i32Value;
+
+	if(ui8Format == WS_COAP_FORMAT_CBOR)
+	{
+		return(coapCborPutMilli(pui8Buf, i32Value));
+	}
+
+	return(usnprintf((char *)pui8Buf, ui32Size, "%s%u.%03u", (i32Value < 0) ? "-" : "",
+					 ui32Abs / 1000, ui32Abs % 1000));
+}
+
+static void coapForget(CoapObserver_t *psObserver)
+{
+	psObserver->bUsed = false;
+	CoapStats.ui32Observers--;
+}
+
+static CoapObserver_t *coapFind(const ip_addr_t *psAddr, uint16_t ui16Port, const WS_CoapMsg_t *psMsg)
+{
+	CoapObserver_t *psObserver;
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < WS_COAP_OBSERVERS; ui32Idx++)
+	{
+		psObserver = &CoapObservers[ui32Idx];
+		if(psObserver->bUsed && ip_addr_cmp(&psObserver->sAddr, psAddr) &&
+		   (psObserver->ui16Port == ui16Port) && (psObserver->ui8TokenLen == psMsg->ui8TokenLen) &&
+		   !memcmp(psObserver->pui8Token, psMsg->pui8Token, psMsg->ui8TokenLen))
+		{
+			return(psObserver);
+		}
+	}
+
+	return(NULL);
+}
+
+/* Register or refresh an observer, NULL if the table is full */
+static CoapObserver_t *coapObserve(ip_addr_t *psAddr, uint16_t ui16Port, const WS_CoapMsg_t *psMsg,
+								   uint8_t ui8Resource, uint8_t ui8Format)
+{
+	CoapObserver_t *psObserver = coapFind(psAddr, ui16Port, psMsg);
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; !psObserver && (ui32Idx < WS_COAP_OBSERVERS); ui32Idx++)
+	{
+		if(!CoapObservers[ui32Idx].bUsed)
+		{
+			psObserver = &CoapObservers[ui32Idx];
+			memset(psObserver, 0, sizeof(*psObserver));
+			psObserver->bUsed = true;
+			ip_addr_copy(psObserver->sAddr, *psAddr);
+			psObserver->ui16Port = ui16Port;
+			psObserver->ui8TokenLen = psMsg->ui8TokenLen;
+			memcpy(psObserver->pui8Token, psMsg->pui8Token, psMsg->ui8TokenLen);
+			CoapStats.ui32Observers++;
+		}
+	}
+	if(!psObserver)
+	{
+		CoapStats.ui32Refused++;
+		return(NULL);
+	}
+
+	/* The response is the first notification */
+	psObserver->ui8Resource = ui8Resource;
+	psObserver->ui8Format = ui8Format;
+	psObserver->ui32Sequence = (psObserver->ui32Sequence + 1) & 0xFFFFFF;
+	psObserver->i32Sent = CoapValues[ui8Resource];
+	psObserver->ui32SentMs = tickNowMs();
+	psObserver->bConPending = false;
+
+	return(psObserver);
+}
+
+/* Response to a request, piggybacked on the ACK if it is a CON */
+static void coapReply(const WS_CoapMsg_t *psReq, WS_CoapMsg_t *psRsp, uint8_t ui8Code)
+{
+	if(psReq->ui8Type == WS_COAP_CON)
+	{
+		coapMsgInit(psRsp, WS_COAP_ACK, ui8Code, psReq->ui16Id);
+	}
+	else
+	{
+		coapMsgInit(psRsp, WS_COAP_NON, ui8Code, CoapMessageId++);
+	}
+	psRsp->ui8TokenLen = psReq->ui8TokenLen;
+	memcpy(psRsp->pui8Token, psReq->pui8Token, psReq->ui8TokenLen);
+}
+
+static void coapGet(const WS_CoapMsg_t *psReq, ip_addr_t *psAddr, uint16_t ui16Port)
+{
+	uint8_t pui8Payload[WS_COAP_CBOR_MAX + 8];
+	CoapObserver_t *psObserver = NULL, *psOld;
+	WS_CoapMsg_t sRsp;
+	uint32_t ui32Resource, ui32Format;
+
+	coapReply(psReq, &sRsp, WS_COAP_CONTENT);
+	for(ui32Resource = 0; ui32Resource <= COAP_WELL_KNOWN; ui32Resource++)
+	{
+		if(!strcmp(psReq->pcPath, CoapPaths[ui32Resource]))
+		{
+			break;
+		}
+	}
+
+	ui32Format = psReq->ui32Accept;
+	if(ui32Resource == COAP_WELL_KNOWN)
+	{
+		if(ui32Format == WS_COAP_NONE)
+		{
+			ui32Format = WS_COAP_FORMAT_LINK;
+		}
+	}
+	else if(ui32Format == WS_COAP_NONE)
+	{
+		ui32Format = WS_COAP_FORMAT_TEXT;
+	}
+
+	if(psReq->bBadOption)
+	{
+		sRsp.ui8Code = WS_COAP_BAD_OPTION;
+	}
+	else if(ui32Resource > COAP_WELL_KNOWN)
+	{
+		sRsp.ui8Code = WS_COAP_NOT_FOUND;
+	}
+	else if(ui32Resource == COAP_WELL_KNOWN)
+	{
+		if(ui32Format != WS_COAP_FORMAT_LINK)
+		{
+			sRsp.ui8Code = WS_COAP_NOT_ACCEPTABLE;
+		}
+		else
+		{
+			sRsp.ui32Format = WS_COAP_FORMAT_LINK;
+			sRsp.pui8Payload = (const uint8_t *)CoapLinks;
+			sRsp.ui32PayloadLen = sizeof(CoapLinks) - 1;
+		}
+	}
+	else if((ui32Format != WS_COAP_FORMAT_TEXT) && (ui32Format != WS_COAP_FORMAT_CBOR))
+	{
+		sRsp.ui8Code = WS_COAP_NOT_ACCEPTABLE;
+	}
+	else if(!CoapValid)
+	{
+		sRsp.ui8Code = WS_COAP_UNAVAILABLE;
+	}
+	else
+	{
+		if(psReq->ui32Observe == COAP_OBSERVE_REGISTER)
+		{
+			psObserver = coapObserve(psAddr, ui16Port, psReq, (uint8_t)ui32Resource, (uint8_t)ui32Format);
+		}
+		else if(psReq->ui32Observe == COAP_OBSERVE_DEREGISTER)
+		{
+			psOld = coapFind(psAddr, ui16Port, psReq);
+			if(psOld)
+			{
+				coapForget(psOld);
+			}
+		}
+
+		sRsp.ui32Format = ui32Format;
+		if(WS_COAP_MAX_AGE_S != COAP_MAX_AGE_DEFAULT)
+		{
+			sRsp.ui32MaxAge = WS_COAP_MAX_AGE_S;
+		}
+		if(psObserver)
+		{
+			sRsp.ui32Observe = psObserver->ui32Sequence;
+		}
+		sRsp.pui8Payload = pui8Payload;
+		sRsp.ui32PayloadLen = coapPayload(pui8Payload, sizeof(pui8Payload), CoapValues[ui32Resource],
+										  (uint8_t)ui32Format);
+	}
+
+	if(sRsp.ui8Code != WS_COAP_CONTENT)
+	{
+		CoapStats.ui32Errors++;
+	}
+	coapSend(&sRsp, psAddr, ui16Port);
+}
+
+/* An empty message with the ID of one received */
+static void coapEmpty(uint8_t ui8Type, uint16_t ui16Id, ip_addr_t *psAddr, uint16_t ui16Port)
+{
+	WS_CoapMsg_t sMsg;
+
+	coapMsgInit(&sMsg, ui8Type, WS_COAP_EMPTY, ui16Id);
+	coapSend(&sMsg, psAddr, ui16Port);
+}
+
+/* ACK or RST of a notification */
+static void coapAnswer(const WS_CoapMsg_t *psMsg)
+{
+	CoapObserver_t *psObserver;
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < WS_COAP_OBSERVERS; ui32Idx++)
+	{
+		psObserver = &CoapObservers[ui32Idx];
+		if(!psObserver->bUsed)
+		{
+			continue;
+		}
+		if(psMsg->ui8Type == WS_COAP_RST)
+		{
+			/* Not interested any more */
+			if((psObserver->ui16LastId == psMsg->ui16Id) ||
+			   (psObserver->bConPending && (psObserver->ui16ConId == psMsg->ui16Id)))
+			{
+				CoapStats.ui32Resets++;
+				coapForget(psObserver);
+				return;
+			}
+		}
+		else if(psObserver->bConPending && (psObserver->ui16ConId == psMsg->ui16Id))
+		{
+			psObserver->bConPending = false;
+			return;
+		}
+	}
+}
+
+static void coapRecv(void *pvArg, struct udp_pcb *psPcb, struct pbuf *p, ip_addr_t *psAddr, u16_t ui16Port)
+{
+	WS_CoapMsg_t sMsg, sRsp;
+	uint16_t ui16Len = p->tot_len;
+	bool bDecoded;
+
+	/* Too long for any request of this server */
+	if(ui16Len > sizeof(CoapIn))
+	{
+		CoapStats.ui32Errors++;
+		pbuf_free(p);
+		return;
+	}
+	pbuf_copy_partial(p, CoapIn, ui16Len, 0);
+	pbuf_free(p);
+
+	bDecoded = coapDecode(CoapIn, ui16Len, &sMsg);
+	if(!bDecoded || (sMsg.ui8Code == WS_COAP_EMPTY))
+	{
+		if((ui16Len >= WS_COAP_HEADER_LEN) && (((CoapIn[0] >> 4) & 3) == WS_COAP_CON))
+		{
+			/* A malformed CON, or an empty one (a ping), is rejected */
+			coapEmpty(WS_COAP_RST, (uint16_t)((CoapIn[2] << 8) | CoapIn[3]), psAddr, ui16Port);
+		}
+		else if(bDecoded && ((sMsg.ui8Type == WS_COAP_ACK) || (sMsg.ui8Type == WS_COAP_RST)))
+		{
+			coapAnswer(&sMsg);
+		}
+		CoapStats.ui32Errors += !bDecoded;
+		return;
+	}
+
+	/* Only requests are expected, a response is rejected */
+	if((sMsg.ui8Type == WS_COAP_ACK) || (sMsg.ui8Type == WS_COAP_RST) || (sMsg.ui8Code >= 0x20))
+	{
+		if(sMsg.ui8Type == WS_COAP_CON)
+		{
+			coapEmpty(WS_COAP_RST, sMsg.ui16Id, psAddr, ui16Port);
+		}
+		return;
+	}
+
+	CoapStats.ui32Requests++;
+	if(sMsg.ui8Code == WS_COAP_GET)
+	{
+		coapGet(&sMsg, psAddr, ui16Port);
+	}
+	else
+	{
+		/* The resources are read only */
+		coapReply(&sMsg, &sRsp, WS_COAP_NOT_ALLOWED);
+		CoapStats.ui32Errors++;
+		coapSend(&sRsp, psAddr, ui16Port);
+	}
+}
+
+/* Send the current value to an observer. bCon asks for a CON, a pending
+ * one is replaced by it and keeps its retransmission state. */
+static void coapNotify(CoapObserver_t *psObserver, bool bCon, uint32_t ui32NowMs)
+{
+	uint8_t pui8Payload[WS_COAP_CBOR_MAX + 8];
+	WS_CoapMsg_t sMsg;
+
+	bCon = bCon || psObserver->bConPending || !(++psObserver->ui32Count % WS_COAP_CON_EVERY);
+	coapMsgInit(&sMsg, bCon ? WS_COAP_CON : WS_COAP_NON, WS_COAP_CONTENT, CoapMessageId++);
+	sMsg.ui8TokenLen = psObserver->ui8TokenLen;
+	memcpy(sMsg.pui8Token, psObserver->pui8Token, psObserver->ui8TokenLen);
+
+	psObserver->ui32Sequence = (psObserver->ui32Sequence + 1) & 0xFFFFFF;
+	psObserver->i32Sent = CoapValues[psObserver->ui8Resource];
+	psObserver->ui32SentMs = ui32NowMs;
+	psObserver->ui16LastId = sMsg.ui16Id;
+
+	sMsg.ui32Observe = psObserver->ui32Sequence;
+	sMsg.ui32Format = psObserver->ui8Format;
+	if(WS_COAP_MAX_AGE_S != COAP_MAX_AGE_DEFAULT)
+	{
+		sMsg.ui32MaxAge = WS_COAP_MAX_AGE_S;
+	}
+	sMsg.pui8Payload = pui8Payload;
+	sMsg.ui32PayloadLen = coapPayload(pui8Payload, sizeof(pui8Payload), psObserver->i32Sent,
+									  psObserver->ui8Format);
+
+	if(bCon)
+	{
+		if(!psObserver->bConPending)
+		{
+			/* ACK_TIMEOUT times 1 to 1.5, the RFC's ACK_RANDOM_FACTOR */
+			psObserver->bConPending = true;
+			psObserver->ui8Retries = 0;
+			psObserver->ui32TimeoutMs = WS_COAP_ACK_TIMEOUT_MS +
+				(WS_COAP_ACK_TIMEOUT_MS / 2) * ((uint32_t)tickNowUs() & 0xFF) / 256;
+			psObserver->ui32RetryMs = ui32NowMs + psObserver->ui32TimeoutMs;
+		}
+		psObserver->ui16ConId = sMsg.ui16Id;
+	}
+
+	CoapStats.ui32Notifications++;
+	coapSend(&sMsg, &psObserver->sAddr, psObserver->ui16Port);
+}
+#endif
+
+void coapUpdate(const int32_t *pi32Values, uint32_t ui32Channels)
+{
+#if WS_COAP_PORT
+	bool bMasked;
+
+	if(ui32Channels > WS_COAP_RESOURCES)
+	{
+		ui32Channels = WS_COAP_RESOURCES;
+	}
+
+	bMasked = MAP_IntMasterDisable();
+	memcpy(CoapValues, pi32Values, ui32Channels * sizeof(int32_t));
+	CoapValid = true;
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+#endif
+}
+
+void coapTick(void)
+{
+#if WS_COAP_PORT
+	CoapObserver_t *psObserver;
+	uint32_t ui32NowMs = tickNowMs();
+	uint32_t ui32Idx;
+
+	if(!CoapPcb)
+	{
+		/* No address before DHCP finished */
+		if(!netif_default || ip_addr_isany(&netif_default->ip_addr))
+		{
+			return;
+		}
+		CoapPcb = udp_new();
+		if(!CoapPcb)
+		{
+			return;
+		}
+		if(udp_bind(CoapPcb, IP_ADDR_ANY, WS_COAP_PORT) != ERR_OK)
+		{
+			udp_remove(CoapPcb);
+			CoapPcb = NULL;
+			return;
+		}
+		udp_recv(CoapPcb, coapRecv, NULL);
+		CoapMessageId = (uint16_t)tickNowUs();
+	}
+
+	for(ui32Idx = 0; ui32Idx < WS_COAP_OBSERVERS; ui32Idx++)
+	{
+		psObserver = &CoapObservers[ui32Idx];
+		if(!psObserver->bUsed)
+		{
+			continue;
+		}
+
+		if(psObserver->bConPending && ((int32_t)(ui32NowMs - psObserver->ui32RetryMs) >= 0))
+		{
+			/* Retransmitted as the current state, the client is gone when
+			 * the last one goes unanswered too */
+			if(psObserver->ui8Retries == WS_COAP_MAX_RETRANSMIT)
+			{
+				CoapStats.ui32Timeouts++;
+				coapForget(psObserver);
+				continue;
+			}
+			psObserver->ui8Retries++;
+			psObserver->ui32TimeoutMs *= 2;
+			psObserver->ui32RetryMs = ui32NowMs + psObserver->ui32TimeoutMs;
+			coapNotify(psObserver, true, ui32NowMs);
+		}
+		else if(((CoapValues[psObserver->ui8Resource] != psObserver->i32Sent) &&
+				 ((ui32NowMs - psObserver->ui32SentMs) >= WS_COAP_NOTIFY_MS)) ||
+				((ui32NowMs - psObserver->ui32SentMs) >= COAP_HEARTBEAT_MS))
+		{
+			coapNotify(psObserver, false, ui32NowMs);
+		}
+	}
+#endif
+}
@@ -0,0 +1,67 @@
+#ifndef WEATHER_STATION_WS_COAP_H_
+#define WEATHER_STATION_WS_COAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  CoAP server on lwIP's raw UDP API, for clients too small for HTTP.
+ *
+ *  The resources are /temperature, /humidity, /pressure and /light, each the
+ *  last processed value of its sensor, and /.well-known/core lists them. A
+ *  GET answers in text/plain ("-4.250") or, with Accept: 60, in CBOR as a
+ *  decimal fraction (see ws_coap_msg.h). Max-Age is WS_COAP_MAX_AGE_S.
+ *
+ *  A GET with Observe: 0 registers the client (RFC 7641); it then gets a
+ *  notification when the value changes, at most one per WS_COAP_NOTIFY_MS,
+ *  and one every WS_COAP_MAX_AGE_S if it does not, so its copy never goes
+ *  stale. Notifications are NON, every WS_COAP_CON_EVERY-th one is CON and
+ *  retransmitted with the CoAP backoff; a client that acknowledges none of
+ *  them, answers one with RST or sends Observe: 1 is forgotten. Up to
+ *  WS_COAP_OBSERVERS registrations are kept, further ones get the plain
+ *  response.
+ *
+ *  The values come from main; lwIP runs in the Ethernet interrupt, so
+ *  requests are answered there and the notifications are sent from
+ *  lwIPHostTimerHandler, which also binds the port once the interface has
+ *  an address. Build with WS_COAP_PORT=0 to leave the server out. */
+//*****************************************************************************
+
+#ifndef WS_COAP_PORT
+#define WS_COAP_PORT			5683
+#endif
+
+#define WS_COAP_RESOURCES		4		/* Temperature, humidity, pressure, light */
+#define WS_COAP_OBSERVERS		8		/* Registrations over all resources */
+#define WS_COAP_MSG_LEN			256		/* Longest message, in or out */
+
+#define WS_COAP_NOTIFY_MS		1000	/* Shortest time between notifications */
+#define WS_COAP_MAX_AGE_S		60
+#define WS_COAP_CON_EVERY		16		/* Every that many notifications is CON */
+
+/* Transmission parameters of RFC 7252 */
+#define WS_COAP_ACK_TIMEOUT_MS	2000
+#define WS_COAP_MAX_RETRANSMIT	4
+
+typedef struct {
+	uint32_t ui32Requests;
+	uint32_t ui32Notifications;
+	uint32_t ui32Observers;		/* Registered now */
+	uint32_t ui32Refused;		/* Registrations that found the table full */
+	uint32_t ui32Timeouts;		/* Observers forgotten for want of an ACK */
+	uint32_t ui32Resets;		/* Observers that answered with RST */
+	uint32_t ui32Errors;		/* Malformed or unsupported requests */
+	uint32_t ui32TxBytes;		/* CoAP messages sent, without UDP/IP */
+}WS_CoapStats_t;
+
+extern WS_CoapStats_t CoapStats;
+
+/* The values of a processed sample set in thousandths: temperature,
+ * humidity, pressure, light. Called from main. */
+void coapUpdate(const int32_t *pi32Values, uint32_t ui32Channels);
+
+/* Bind the port, send the notifications that are due and retransmit,
+ * called from lwIPHostTimerHandler */
+void coapTick(void);
+
+#endif /* WEATHER_STATION_WS_COAP_H_ */
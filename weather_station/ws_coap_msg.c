@@ -0,0 +1,405 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ws_coap_msg.h"
+
+/* Delta and length nibbles, the values above 12 are extended */
+#define COAP_NIBBLE_8			13
+#define COAP_NIBBLE_16			14
+#define COAP_NIBBLE_ERROR		15
+#define COAP_PAYLOAD_MARKER		0xFF
+
+/* CBOR initial bytes */
+#define COAP_CBOR_UINT			0x00
+#define COAP_CBOR_NINT			0x20
+#define COAP_CBOR_TAG_DECIMAL	0xC4
+#define COAP_CBOR_ARRAY_2		0x82
+#define COAP_CBOR_MINUS_3		0x22
+
+/* Option header and value, returns the length written, 0 if it does not fit */
+static uint32_t coapPutOption(uint8_t *pui8Buf, uint32_t ui32Size, uint32_t ui32Delta,
+							  const uint8_t *pui8Value, uint32_t ui32Len)
+{
+	uint32_t ui32Pos = 1;
+	uint8_t ui8Delta, ui8Len;
+
+	if(ui32Size < (5 + ui32Len))
+	{
+		return(0);
+	}
+
+	if(ui32Delta < COAP_NIBBLE_8)
+	{
+		ui8Delta = (uint8_t)ui32Delta;
+	}
+	else if(ui32Delta < 269)
+	{
+		ui8Delta = COAP_NIBBLE_8;
+		pui8Buf[ui32Pos++] = (uint8_t)(ui32Delta - 13);
+	}
+	else
+	{
+		ui8Delta = COAP_NIBBLE_16;
+		pui8Buf[ui32Pos++] = (uint8_t)((ui32Delta - 269) >> 8);
+		pui8Buf[ui32Pos++] = (uint8_t)(ui32Delta - 269);
+	}
+
+	if(ui32Len < COAP_NIBBLE_8)
+	{
+		ui8Len = (uint8_t)ui32Len;
+	}
+	else
+	{
+		/* Nothing here is longer than 268 */
+		ui8Len = COAP_NIBBLE_8;
+		pui8Buf[ui32Pos++] = (uint8_t)(ui32Len - 13);
+	}
+
+	pui8Buf[0] = (uint8_t)((ui8Delta << 4) | ui8Len);
+	memcpy(pui8Buf + ui32Pos, pui8Value, ui32Len);
+
+	return(ui32Pos + ui32Len);
+}
+
+/* Unsigned option, in as few bytes as it takes */
+static uint32_t coapPutUint(uint8_t *pui8Buf, uint32_t ui32Size, uint32_t ui32Delta,
+							uint32_t ui32Value)
+{
+	uint8_t pui8Value[4];
+	uint32_t ui32Len = 0, ui32Idx;
+
+	while((ui32Len < 4) && (ui32Value >> (8 * ui32Len)))
+	{
+		ui32Len++;
+	}
+	for(ui32Idx = 0; ui32Idx < ui32Len; ui32Idx++)
+	{
+		pui8Value[ui32Idx] = (uint8_t)(ui32Value >> (8 * (ui32Len - 1 - ui32Idx)));
+	}
+
+	return(coapPutOption(pui8Buf, ui32Size, ui32Delta, pui8Value, ui32Len));
+}
+
+/* Extended delta or length, false if cut short or reserved */
+static bool coapGetNibble(const uint8_t *pui8Buf, uint32_t ui32Len, uint32_t *pui32Pos,
+						  uint32_t *pui32Value)
+{
+	if(*pui32Value == COAP_NIBBLE_8)
+	{
+		if(*pui32Pos >= ui32Len)
+		{
+			return(false);
+		}
+		*pui32Value = 13 + pui8Buf[(*pui32Pos)++];
+	}
+	else if(*pui32Value == COAP_NIBBLE_16)
+	{
+		if((*pui32Pos + 2) > ui32Len)
+		{
+			return(false);
+		}
+		*pui32Value = 269 + ((pui8Buf[*pui32Pos] << 8) | pui8Buf[*pui32Pos + 1]);
+		*pui32Pos += 2;
+	}
+	else if(*pui32Value == COAP_NIBBLE_ERROR)
+	{
+		return(false);
+	}
+
+	return(true);
+}
+
+static uint32_t coapGetUint(const uint8_t *pui8Value, uint32_t ui32Len)
+{
+	uint32_t ui32Value = 0;
+
+	while(ui32Len--)
+	{
+		ui32Value = (ui32Value << 8) | *pui8Value++;
+	}
+
+	return(ui32Value);
+}
+
+void coapMsgInit(WS_CoapMsg_t *psMsg, uint8_t ui8Type, uint8_t ui8Code, uint16_t ui16Id)
+{
+	memset(psMsg, 0, sizeof(*psMsg));
+	psMsg->ui8Type = ui8Type;
+	psMsg->ui8Code = ui8Code;
+	psMsg->ui16Id = ui16Id;
+	psMsg->ui32Observe = WS_COAP_NONE;
+	psMsg->ui32Format = WS_COAP_NONE;
+	psMsg->ui32MaxAge = WS_COAP_NONE;
+	psMsg->ui32Accept = WS_COAP_NONE;
+}
+
+uint32_t coapEncode(uint8_t *pui8Buf, uint32_t ui32Size, const WS_CoapMsg_t *psMsg)
+{
+	const char *pcSegment, *pcEnd;
+	uint32_t ui32Pos, ui32Last = 0, ui32Put;
+
+	ui32Pos = WS_COAP_HEADER_LEN + psMsg->ui8TokenLen;
+	if((psMsg->ui8TokenLen > WS_COAP_TOKEN_MAX) || (ui32Size < ui32Pos))
+	{
+		return(0);
+	}
+
+	pui8Buf[0] = (uint8_t)((WS_COAP_VERSION << 6) | (psMsg->ui8Type << 4) | psMsg->ui8TokenLen);
+	pui8Buf[1] = psMsg->ui8Code;
+	pui8Buf[2] = (uint8_t)(psMsg->ui16Id >> 8);
+	pui8Buf[3] = (uint8_t)psMsg->ui16Id;
+	memcpy(pui8Buf + WS_COAP_HEADER_LEN, psMsg->pui8Token, psMsg->ui8TokenLen);
+
+	/* Options in ascending order, each as a delta to the one before */
+	if(psMsg->ui32Observe != WS_COAP_NONE)
+	{
+		ui32Put = coapPutUint(pui8Buf + ui32Pos, ui32Size - ui32Pos, WS_COAP_OPT_OBSERVE - ui32Last,
+							  psMsg->ui32Observe & 0xFFFFFF);
+		if(!ui32Put)
+		{
+			return(0);
+		}
+		ui32Pos += ui32Put;
+		ui32Last = WS_COAP_OPT_OBSERVE;
+	}
+	for(pcSegment = psMsg->pcPath; *pcSegment; pcSegment = *pcEnd ? (pcEnd + 1) : pcEnd)
+	{
+		for(pcEnd = pcSegment; *pcEnd && (*pcEnd != '/'); pcEnd++)
+		{
+		}
+		ui32Put = coapPutOption(pui8Buf + ui32Pos, ui32Size - ui32Pos, WS_COAP_OPT_URI_PATH - ui32Last,
+								(const uint8_t *)pcSegment, (uint32_t)(pcEnd - pcSegment));
+		if(!ui32Put)
+		{
+			return(0);
+		}
+		ui32Pos += ui32Put;
+		ui32Last = WS_COAP_OPT_URI_PATH;
+	}
+	if(psMsg->ui32Format != WS_COAP_NONE)
+	{
+		ui32Put = coapPutUint(pui8Buf + ui32Pos, ui32Size - ui32Pos, WS_COAP_OPT_FORMAT - ui32Last,
+							  psMsg->ui32Format);
+		if(!ui32Put)
+		{
+			return(0);
+		}
+		ui32Pos += ui32Put;
+		ui32Last = WS_COAP_OPT_FORMAT;
+	}
+	if(psMsg->ui32MaxAge != WS_COAP_NONE)
+	{
+		ui32Put = coapPutUint(pui8Buf + ui32Pos, ui32Size - ui32Pos, WS_COAP_OPT_MAX_AGE - ui32Last,
+							  psMsg->ui32MaxAge);
+		if(!ui32Put)
+		{
+			return(0);
+		}
+		ui32Pos += ui32Put;
+		ui32Last = WS_COAP_OPT_MAX_AGE;
+	}
+	if(psMsg->ui32Accept != WS_COAP_NONE)
+	{
+		ui32Put = coapPutUint(pui8Buf + ui32Pos, ui32Size - ui32Pos, WS_COAP_OPT_ACCEPT - ui32Last,
+							  psMsg->ui32Accept);
+		if(!ui32Put)
+		{
+			return(0);
+		}
+		ui32Pos += ui32Put;
+	}
+
+	if(psMsg->ui32PayloadLen)
+	{
+		if((ui32Pos + 1 + psMsg->ui32PayloadLen) > ui32Size)
+		{
+			return(0);
+		}
+		pui8Buf[ui32Pos++] = COAP_PAYLOAD_MARKER;
+		memcpy(pui8Buf + ui32Pos, psMsg->pui8Payload, psMsg->ui32PayloadLen);
+		ui32Pos += psMsg->ui32PayloadLen;
+	}
+
+	return(ui32Pos);
+}
+
+bool coapDecode(const uint8_t *pui8Buf, uint32_t ui32Len, WS_CoapMsg_t *psMsg)
+{
+	uint32_t ui32Pos, ui32Number = 0, ui32Delta, ui32OptLen, ui32PathLen = 0;
+
+	if((ui32Len < WS_COAP_HEADER_LEN) || ((pui8Buf[0] >> 6) != WS_COAP_VERSION) ||
+	   ((pui8Buf[0] & 0x0F) > WS_COAP_TOKEN_MAX))
+	{
+		return(false);
+	}
+
+	coapMsgInit(psMsg, (pui8Buf[0] >> 4) & 3, pui8Buf[1], (uint16_t)((pui8Buf[2] << 8) | pui8Buf[3]));
+	psMsg->ui8TokenLen = pui8Buf[0] & 0x0F;
+	ui32Pos = WS_COAP_HEADER_LEN + psMsg->ui8TokenLen;
+	if(ui32Pos > ui32Len)
+	{
+		return(false);
+	}
+	memcpy(psMsg->pui8Token, pui8Buf + WS_COAP_HEADER_LEN, psMsg->ui8TokenLen);
+
+	while(ui32Pos < ui32Len)
+	{
+		if(pui8Buf[ui32Pos] == COAP_PAYLOAD_MARKER)
+		{
+			/* A marker without a payload is a format error */
+			ui32Pos++;
+			psMsg->pui8Payload = pui8Buf + ui32Pos;
+			psMsg->ui32PayloadLen = ui32Len - ui32Pos;
+			return(psMsg->ui32PayloadLen != 0);
+		}
+
+		ui32Delta = pui8Buf[ui32Pos] >> 4;
+		ui32OptLen = pui8Buf[ui32Pos] & 0x0F;
+		ui32Pos++;
+		if(!coapGetNibble(pui8Buf, ui32Len, &ui32Pos, &ui32Delta) ||
+		   !coapGetNibble(pui8Buf, ui32Len, &ui32Pos, &ui32OptLen) ||
+		   ((ui32Pos + ui32OptLen) > ui32Len))
+		{
+			return(false);
+		}
+		ui32Number += ui32Delta;
+
+		switch(ui32Number)
+		{
+			case WS_COAP_OPT_OBSERVE:
+				psMsg->ui32Observe = coapGetUint(pui8Buf + ui32Pos, (ui32OptLen < 3) ? ui32OptLen : 3);
+				break;
+			case WS_COAP_OPT_URI_PATH:
+				/* A path longer than any resource finds none, an empty
+				 * segment cannot be part of one */
+				if((ui32PathLen + ui32OptLen + 2) > WS_COAP_PATH_LEN)
+				{
+					strcpy(psMsg->pcPath, "/");
+					ui32PathLen = WS_COAP_PATH_LEN;
+					break;
+				}
+				if(ui32PathLen)
+				{
+					psMsg->pcPath[ui32PathLen++] = '/';
+				}
+				memcpy(psMsg->pcPath + ui32PathLen, pui8Buf + ui32Pos, ui32OptLen);
+				ui32PathLen += ui32OptLen;
+				psMsg->pcPath[ui32PathLen] = 0;
+				break;
+			case WS_COAP_OPT_FORMAT:
+				psMsg->ui32Format = coapGetUint(pui8Buf + ui32Pos, (ui32OptLen < 2) ? ui32OptLen : 2);
+				break;
+			case WS_COAP_OPT_MAX_AGE:
+				psMsg->ui32MaxAge = coapGetUint(pui8Buf + ui32Pos, (ui32OptLen < 4) ? ui32OptLen : 4);
+				break;
+			case WS_COAP_OPT_ACCEPT:
+				psMsg->ui32Accept = coapGetUint(pui8Buf + ui32Pos, (ui32OptLen < 2) ? ui32OptLen : 2);
+				break;
+			case WS_COAP_OPT_URI_HOST:
+			case WS_COAP_OPT_URI_PORT:
+				/* The server has one host and one port */
+				break;
+			default:
+				/* Odd numbers are critical */
+				if(ui32Number & 1)
+				{
+					psMsg->bBadOption = true;
+				}
+				break;
+		}
+		ui32Pos += ui32OptLen;
+	}
+
+	return(true);
+}
+
+uint32_t coapCborPutMilli(uint8_t *pui8Buf, int32_t i32Milli)
+{
+	uint32_t ui32Arg, ui32Len = 3;
+	uint8_t ui8Major;
+
+	pui8Buf[0] = COAP_CBOR_TAG_DECIMAL;
+	pui8Buf[1] = COAP_CBOR_ARRAY_2;
+	pui8Buf[2] = COAP_CBOR_MINUS_3;
+
+	/* A negative integer n is coded as -1 - n */
+	if(i32Milli < 0)
+	{
+		ui8Major = COAP_CBOR_NINT;
+		ui32Arg = (uint32_t)(-1 - i32Milli);
+	}
+	else
+	{
+		ui8Major = COAP_CBOR_UINT;
+		ui32Arg = (uint32_t)i32Milli;
+	}
+
+	if(ui32Arg < 24)
+	{
+		pui8Buf[ui32Len++] = ui8Major | (uint8_t)ui32Arg;
+	}
+	else if(ui32Arg < 0x100)
+	{
+		pui8Buf[ui32Len++] = ui8Major | 24;
+		pui8Buf[ui32Len++] = (uint8_t)ui32Arg;
+	}
+	else if(ui32Arg < 0x10000)
+	{
+		pui8Buf[ui32Len++] = ui8Major | 25;
+		pui8Buf[ui32Len++] = (uint8_t)(ui32Arg >> 8);
+		pui8Buf[ui32Len++] = (uint8_t)ui32Arg;
+	}
+	else
+	{
+		pui8Buf[ui32Len++] = ui8Major | 26;
+		pui8Buf[ui32Len++] = (uint8_t)(ui32Arg >> 24);
+		pui8Buf[ui32Len++] = (uint8_t)(ui32Arg >> 16);
+		pui8Buf[ui32Len++] = (uint8_t)(ui32Arg >> 8);
+		pui8Buf[ui32Len++] = (uint8_t)ui32Arg;
+	}
+
+	return(ui32Len);
+}
+
+bool coapCborGetMilli(const uint8_t *pui8Buf, uint32_t ui32Len, int32_t *pi32Milli)
+{
+	uint32_t ui32Info, ui32Bytes, ui32Arg = 0, ui32Idx;
+
+	if((ui32Len < 4) || (pui8Buf[0] != COAP_CBOR_TAG_DECIMAL) ||
+	   (pui8Buf[1] != COAP_CBOR_ARRAY_2) || (pui8Buf[2] != COAP_CBOR_MINUS_3))
+	{
+		return(false);
+	}
+
+	ui32Info = pui8Buf[3] & 0x1F;
+	if(ui32Info < 24)
+	{
+		ui32Bytes = 0;
+		ui32Arg = ui32Info;
+	}
+	else if(ui32Info <= 26)
+	{
+		ui32Bytes = 1u << (ui32Info - 24);
+	}
+	else
+	{
+		return(false);
+	}
+	if((((pui8Buf[3] & 0xE0) != COAP_CBOR_UINT) && ((pui8Buf[3] & 0xE0) != COAP_CBOR_NINT)) ||
+	   (ui32Len != (4 + ui32Bytes)))
+	{
+		return(false);
+	}
+	for(ui32Idx = 0; ui32Idx < ui32Bytes; ui32Idx++)
+	{
+		ui32Arg = (ui32Arg << 8) | pui8Buf[4 + ui32Idx];
+	}
+	if(ui32Arg > INT32_MAX)
+	{
+		return(false);
+	}
+
+	*pi32Milli = ((pui8Buf[3] & 0xE0) == COAP_CBOR_NINT) ? (-1 - (int32_t)ui32Arg) : (int32_t)ui32Arg;
+	return(true);
+}
@@ -0,0 +1,102 @@
+#ifndef WEATHER_STATION_WS_COAP_MSG_H_
+#define WEATHER_STATION_WS_COAP_MSG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  CoAP (RFC 7252) message coding for the CoAP server (ws_coap.h), shared
+ *  with the clients on the hosts. It has no hardware or lwIP dependency.
+ *
+ *  Only the options the server uses are coded: Uri-Host, Observe, Uri-Port,
+ *  Uri-Path, Content-Format, Max-Age and Accept. Any other elective option
+ *  is skipped; any other critical one sets bBadOption, the server answers
+ *  4.02 to it as the RFC asks.
+ *
+ *  The values in CBOR (RFC 8949) are decimal fractions, tag 4 around the
+ *  array [-3, thousandths]:
+ *
+ *      C4 82 22 <integer>
+ *
+ *  so the value of the sensor goes out exactly as it was measured, in 4 to
+ *  8 bytes. */
+//*****************************************************************************
+
+#define WS_COAP_VERSION			1
+#define WS_COAP_HEADER_LEN		4
+#define WS_COAP_TOKEN_MAX		8
+#define WS_COAP_PATH_LEN		32		/* Uri-Path segments joined with '/' */
+
+/* Absent option */
+#define WS_COAP_NONE			0xFFFFFFFFu
+
+/* Message types */
+#define WS_COAP_CON				0
+#define WS_COAP_NON				1
+#define WS_COAP_ACK				2
+#define WS_COAP_RST				3
+
+/* Codes, class << 5 | detail */
+#define WS_COAP_EMPTY			0x00
+#define WS_COAP_GET				0x01
+#define WS_COAP_CONTENT			0x45	/* 2.05 */
+#define WS_COAP_BAD_REQUEST		0x80	/* 4.00 */
+#define WS_COAP_BAD_OPTION		0x82	/* 4.02 */
+#define WS_COAP_NOT_FOUND		0x84	/* 4.04 */
+#define WS_COAP_NOT_ALLOWED		0x85	/* 4.05 */
+#define WS_COAP_NOT_ACCEPTABLE	0x86	/* 4.06 */
+#define WS_COAP_UNAVAILABLE		0xA3	/* 5.03 */
+
+/* Option numbers */
+#define WS_COAP_OPT_URI_HOST	3
+#define WS_COAP_OPT_OBSERVE		6
+#define WS_COAP_OPT_URI_PORT	7
+#define WS_COAP_OPT_URI_PATH	11
+#define WS_COAP_OPT_FORMAT		12
+#define WS_COAP_OPT_MAX_AGE		14
+#define WS_COAP_OPT_ACCEPT		17
+
+/* Content formats */
+#define WS_COAP_FORMAT_TEXT		0		/* text/plain;charset=utf-8 */
+#define WS_COAP_FORMAT_LINK		40		/* application/link-format */
+#define WS_COAP_FORMAT_CBOR		60		/* application/cbor */
+
+/* Longest CBOR value coapCborPutMilli writes */
+#define WS_COAP_CBOR_MAX		8
+
+typedef struct {
+	uint8_t ui8Type;
+	uint8_t ui8Code;
+	uint16_t ui16Id;
+	uint8_t ui8TokenLen;
+	uint8_t pui8Token[WS_COAP_TOKEN_MAX];
+
+	/* Options, WS_COAP_NONE if absent */
+	uint32_t ui32Observe;
+	uint32_t ui32Format;
+	uint32_t ui32MaxAge;
+	uint32_t ui32Accept;
+	char pcPath[WS_COAP_PATH_LEN];	/* Empty if there is no Uri-Path */
+	bool bBadOption;				/* Critical option not understood */
+
+	const uint8_t *pui8Payload;
+	uint32_t ui32PayloadLen;
+}WS_CoapMsg_t;
+
+/* Clear a message, every option absent */
+void coapMsgInit(WS_CoapMsg_t *psMsg, uint8_t ui8Type, uint8_t ui8Code, uint16_t ui16Id);
+
+/* Encode a message, returns the length, 0 if it does not fit in ui32Size */
+uint32_t coapEncode(uint8_t *pui8Buf, uint32_t ui32Size, const WS_CoapMsg_t *psMsg);
+
+/* Decode a message, the payload points into pui8Buf. False if it is not a
+ * CoAP message of this version, or is malformed. */
+bool coapDecode(const uint8_t *pui8Buf, uint32_t ui32Len, WS_CoapMsg_t *psMsg);
+
+/* A value in thousandths as a CBOR decimal fraction, returns the length */
+uint32_t coapCborPutMilli(uint8_t *pui8Buf, int32_t i32Milli);
+
+/* Read back a value coapCborPutMilli wrote, false if it is something else */
+bool coapCborGetMilli(const uint8_t *pui8Buf, uint32_t ui32Len, int32_t *pi32Milli);
+
+#endif /* WEATHER_STATION_WS_COAP_MSG_H_ */
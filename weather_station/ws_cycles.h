@@ -0,0 +1,60 @@
+#ifndef WEATHER_STATION_WS_CYCLES_H_
+#define WEATHER_STATION_WS_CYCLES_H_
+
+#include <stdint.h>
+
+#ifdef WS_HOST_BUILD
+#include <time.h>
+
+//*****************************************************************************
+/*  Host build: there is no cycle counter, the monotonic clock stands in for
+ *  it. The unit is nanoseconds instead of cycles. */
+//*****************************************************************************
+#define WS_CYCLES_PER_US		1000u
+
+static inline void cyclesInit(void)
+{
+}
+
+static inline uint32_t cyclesGet(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return((uint32_t)sNow.tv_sec * 1000000000u + (uint32_t)sNow.tv_nsec);
+}
+
+#else
+#include "inc/hw_types.h"
+
+//*****************************************************************************
+/*  Cortex-M4 DWT cycle counter access. The core debug block is not described
+ *  in the TivaWare register headers, so the addresses are taken from the
+ *  ARMv7-M architecture reference manual. */
+//*****************************************************************************
+#define WS_DEMCR                0xE000EDFC		/* Debug Exception and Monitor Control */
+#define WS_DEMCR_TRCENA         0x01000000		/* Enables the DWT unit */
+#define WS_DWT_CTRL             0xE0001000		/* DWT control register */
+#define WS_DWT_CTRL_CYCCNTENA   0x00000001		/* Enables the cycle counter */
+#define WS_DWT_CYCCNT           0xE0001004		/* Free running cycle counter */
+
+/* The system clock main sets up with SysCtlClockFreqSet */
+#define WS_CYCLES_PER_US		120u
+
+/* Enable the cycle counter. Safe to call more than once. */
+static inline void cyclesInit(void)
+{
+	HWREG(WS_DEMCR) |= WS_DEMCR_TRCENA;
+	HWREG(WS_DWT_CTRL) |= WS_DWT_CTRL_CYCCNTENA;
+}
+
+/* Current value of the cycle counter. Differences are wrap-safe as long as the
+ * measured section is shorter than 2^32 cycles (~35 s at 120 MHz). */
+static inline uint32_t cyclesGet(void)
+{
+	return HWREG(WS_DWT_CYCCNT);
+}
+
+#endif /* WS_HOST_BUILD */
+
+#endif /* WEATHER_STATION_WS_CYCLES_H_ */
@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_deadband.h"
+
+WS_Deadband_t PublishDeadband;
+WS_Deadband_t StreamDeadband;
+WS_DeadbandConfig_t PublishDeadbandConfig =
+{
+	{ WS_DEADBAND_TEMPERATURE, WS_DEADBAND_HUMIDITY, WS_DEADBAND_PRESSURE, WS_DEADBAND_LIGHT },
+	WS_DEADBAND_HEARTBEAT_MS
+};
+
+uint32_t deadbandUpdate(WS_Deadband_t *psDeadband, const WS_DeadbandConfig_t *psConfig,
+						uint32_t ui32NowMs, const int32_t *pi32Values)
+{
+	WS_DeadbandStats_t *psStats;
+	uint32_t ui32Ch, ui32Mask = 0;
+	int64_t i64Delta;
+
+	for(ui32Ch = 0; ui32Ch < WS_DEADBAND_CHANNELS; ui32Ch++)
+	{
+		psStats = &psDeadband->psStats[ui32Ch];
+		psDeadband->pi32Input[ui32Ch] = pi32Values[ui32Ch];
+
+		/* In 64 bits, the difference of two int32 values can overflow */
+		i64Delta = (int64_t)pi32Values[ui32Ch] - psDeadband->pi32Held[ui32Ch];
+		if(i64Delta < 0)
+		{
+			i64Delta = -i64Delta;
+		}
+
+		if(!psDeadband->bPrimed || (i64Delta > psConfig->pi32Threshold[ui32Ch]))
+		{
+			psStats->ui32Published++;
+			psDeadband->ui32HeartbeatMask &= ~(1u << ui32Ch);
+		}
+		else if(psConfig->ui32HeartbeatMs &&
+				((ui32NowMs - psDeadband->pui32HeldMs[ui32Ch]) >= psConfig->ui32HeartbeatMs))
+		{
+			psStats->ui32Heartbeats++;
+			psDeadband->ui32HeartbeatMask |= 1u << ui32Ch;
+		}
+		else
+		{
+			psStats->ui32Suppressed++;
+			continue;
+		}
+
+		psDeadband->pi32Held[ui32Ch] = pi32Values[ui32Ch];
+		psDeadband->pui32HeldMs[ui32Ch] = ui32NowMs;
+		ui32Mask |= 1u << ui32Ch;
+	}
+	psDeadband->bPrimed = true;
+
+	return(ui32Mask);
+}
@@ -0,0 +1,84 @@
+#ifndef WEATHER_STATION_WS_DEADBAND_H_
+#define WEATHER_STATION_WS_DEADBAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Change based (deadband) publishing.
+ *
+ *  Each channel holds the value it last published. An offered value is
+ *  published only when it is more than the channel's threshold away from
+ *  that value, or when the held value is older than the heartbeat; else it
+ *  is suppressed and the held value stays. The held value is what the
+ *  consumers see, so it never trails the input by more than the threshold
+ *  for longer than one update, nor goes older than the heartbeat.
+ *
+ *  Values are thousandths of the sensor unit, the same resolution as the
+ *  published measurements. A zero threshold publishes every change and
+ *  suppresses only repeats, a zero heartbeat never republishes.
+ *
+ *  The station gates its 50 ms refresh through PublishDeadband: what
+ *  io_send_data reports and what the refresh logs on the UART are the held
+ *  values, io_send_data also tells which of them are heartbeats. The
+ *  multicast and MQTT streams go through StreamDeadband, offered every
+ *  processed sample set in main: a set is sent, with the held values, only
+ *  when one of its channels is published. The defaults are a few times the
+ *  noise left after the filters. */
+//*****************************************************************************
+
+#define WS_DEADBAND_CHANNELS	4		/* Temperature, humidity, pressure, light */
+
+/* Default thresholds of the station, thousandths */
+#ifndef WS_DEADBAND_TEMPERATURE
+#define WS_DEADBAND_TEMPERATURE	100		/* 0.1 degC */
+#endif
+#ifndef WS_DEADBAND_HUMIDITY
+#define WS_DEADBAND_HUMIDITY	500		/* 0.5 %RH */
+#endif
+#ifndef WS_DEADBAND_PRESSURE
+#define WS_DEADBAND_PRESSURE	10000	/* 10 Pa */
+#endif
+#ifndef WS_DEADBAND_LIGHT
+#define WS_DEADBAND_LIGHT		2000	/* 2 lux */
+#endif
+
+#ifndef WS_DEADBAND_HEARTBEAT_MS
+#define WS_DEADBAND_HEARTBEAT_MS	60000
+#endif
+
+typedef struct {
+	int32_t pi32Threshold[WS_DEADBAND_CHANNELS];	/* Largest change suppressed */
+	uint32_t ui32HeartbeatMs;						/* Longest hold, 0 forever */
+}WS_DeadbandConfig_t;
+
+typedef struct {
+	uint32_t ui32Published;			/* Changes past the threshold, and the first value */
+	uint32_t ui32Heartbeats;		/* Published because the hold expired */
+	uint32_t ui32Suppressed;
+}WS_DeadbandStats_t;
+
+/* Deadband state. All zero is a valid state, the first value is published. */
+typedef struct {
+	bool bPrimed;
+	int32_t pi32Held[WS_DEADBAND_CHANNELS];			/* Last published */
+	uint32_t pui32HeldMs[WS_DEADBAND_CHANNELS];		/* When it was published */
+	int32_t pi32Input[WS_DEADBAND_CHANNELS];		/* Last offered */
+	uint32_t ui32HeartbeatMask;						/* Bit n: held value n is a heartbeat */
+	WS_DeadbandStats_t psStats[WS_DEADBAND_CHANNELS];
+}WS_Deadband_t;
+
+/* Deadband of the published measurements and its configuration, set before
+ * the first refresh */
+extern WS_Deadband_t PublishDeadband;
+extern WS_DeadbandConfig_t PublishDeadbandConfig;
+
+/* Deadband of the multicast and MQTT samples, with the same configuration */
+extern WS_Deadband_t StreamDeadband;
+
+/* Offer a value per channel at ui32NowMs. Returns a mask with bit n set if
+ * channel n was published, its held value is the offered one then. */
+uint32_t deadbandUpdate(WS_Deadband_t *psDeadband, const WS_DeadbandConfig_t *psConfig,
+						uint32_t ui32NowMs, const int32_t *pi32Values);
+
+#endif /* WEATHER_STATION_WS_DEADBAND_H_ */
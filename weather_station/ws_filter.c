@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_filter.h"
+
+/* Compare and swap used by the median network */
+#define FILTER_SORT(a, b)		{ if((a) > (b)) { int32_t t = (a); (a) = (b); (b) = t; } }
+
+static int32_t filterEMA(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, int32_t i32Sample)
+{
+	int64_t i64Step;
+
+	/* y += alpha * (x - y), rounded to nearest */
+	i64Step = (int64_t)(i32Sample - psFilter->i32Estimate) * psConfig->ui32Alpha;
+	psFilter->i32Estimate += (int32_t)((i64Step + 0x8000) >> 16);
+
+	return(psFilter->i32Estimate);
+}
+
+static int32_t filterMedian5(WS_Filter_t *psFilter, int32_t i32Sample)
+{
+	int32_t p[WS_FILTER_MEDIAN_LEN];
+
+	psFilter->pi32Window[psFilter->ui8Next] = i32Sample;
+	psFilter->ui8Next = (psFilter->ui8Next + 1) % WS_FILTER_MEDIAN_LEN;
+
+	p[0] = psFilter->pi32Window[0];
+	p[1] = psFilter->pi32Window[1];
+	p[2] = psFilter->pi32Window[2];
+	p[3] = psFilter->pi32Window[3];
+	p[4] = psFilter->pi32Window[4];
+
+	/* Seven exchange median network, the median ends up in p[2] */
+	FILTER_SORT(p[0], p[1]);
+	FILTER_SORT(p[3], p[4]);
+	FILTER_SORT(p[0], p[3]);
+	FILTER_SORT(p[1], p[4]);
+	FILTER_SORT(p[1], p[2]);
+	FILTER_SORT(p[2], p[3]);
+	FILTER_SORT(p[1], p[2]);
+
+	return(p[2]);
+}
+
+static int32_t filterKalman(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, int32_t i32Sample)
+{
+	uint32_t ui32Gain;
+	uint32_t ui32Variance;
+	int64_t i64Step;
+
+	/* Predict: the value is modelled as a random walk */
+	ui32Variance = psFilter->ui32Variance + psConfig->ui32ProcessNoise;
+
+	/* Gain K = P / (P + R) in Q16 */
+	ui32Gain = (uint32_t)(((uint64_t)ui32Variance << 16) / ((uint64_t)ui32Variance + psConfig->ui32MeasNoise));
+
+	/* Correct: x += K * (z - x), P = (1 - K) * P */
+	i64Step = (int64_t)(i32Sample - psFilter->i32Estimate) * ui32Gain;
+	psFilter->i32Estimate += (int32_t)((i64Step + 0x8000) >> 16);
+	psFilter->ui32Variance = (uint32_t)(((uint64_t)ui32Variance * (65536 - ui32Gain)) >> 16);
+
+	return(psFilter->i32Estimate);
+}
+
+int32_t filterUpdate(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, int32_t i32Sample)
+{
+	uint32_t ui32Idx;
+
+	/* Start every filter from the first sample instead of from zero */
+	if(!psFilter->bPrimed)
+	{
+		psFilter->bPrimed = true;
+		psFilter->i32Estimate = i32Sample;
+		psFilter->ui32Variance = psConfig->ui32MeasNoise;
+		for(ui32Idx = 0; ui32Idx < WS_FILTER_MEDIAN_LEN; ui32Idx++)
+		{
+			psFilter->pi32Window[ui32Idx] = i32Sample;
+		}
+		psFilter->ui8Next = 0;
+		return(i32Sample);
+	}
+
+	switch(psConfig->eType)
+	{
+		case WS_FilterEMA:
+			return(filterEMA(psFilter, psConfig, i32Sample));
+		case WS_FilterMedian5:
+			return(filterMedian5(psFilter, i32Sample));
+		case WS_FilterKalman:
+			return(filterKalman(psFilter, psConfig, i32Sample));
+		default:
+			return(i32Sample);
+	};
+}
+
+int32_t filterToMilli(float fValue)
+{
+	return((int32_t)(fValue * 1000.0f + ((fValue < 0.0f) ? -0.5f : 0.5f)));
+}
+
+float filterFromMilli(int32_t i32Value)
+{
+	return((float)i32Value / 1000.0f);
+}
+
+float filterUpdateFloat(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, float fSample)
+{
+	if(psConfig->eType == WS_FilterNone)
+	{
+		return(fSample);
+	}
+
+	return(filterFromMilli(filterUpdate(psFilter, psConfig, filterToMilli(fSample))));
+}
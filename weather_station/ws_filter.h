@@ -0,0 +1,55 @@
+#ifndef WEATHER_STATION_WS_FILTER_H_
+#define WEATHER_STATION_WS_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Per sensor noise filters.
+ *
+ *  The kernels work on fixed-point values in thousandths of the sensor unit
+ *  (milli-degC, milli-%RH, milli-Pa, milli-lux), the same resolution the
+ *  measurements are published with. 32 bit integers hold every sensor's full
+ *  range in this format (101325 Pa is 1.01e8 milli-Pa). Each update is a
+ *  handful of integer operations, well below what 100 Hz per sensor needs. */
+//*****************************************************************************
+
+typedef enum {
+	WS_FilterNone		= 0x00u,	/* Pass the samples through */
+	WS_FilterEMA		= 0x01u,	/* Exponential moving average */
+	WS_FilterMedian5	= 0x02u,	/* Median of the last five samples */
+	WS_FilterKalman		= 0x03u		/* 1-D Kalman filter with a random walk model */
+}WS_FilterType_t;
+
+/* Smoothing factor of the EMA in Q16, 65536 is 1.0 */
+#define WS_FILTER_ALPHA(a)		((uint32_t)((a) * 65536.0f))
+
+#define WS_FILTER_MEDIAN_LEN	5
+
+typedef struct {
+	WS_FilterType_t eType;
+	uint32_t ui32Alpha;				/* EMA: weight of the new sample, Q16 */
+	uint32_t ui32ProcessNoise;		/* Kalman: Q, variance added per sample, milli-unit^2 */
+	uint32_t ui32MeasNoise;			/* Kalman: R, sensor noise variance, milli-unit^2 */
+}WS_FilterConfig_t;
+
+/* Filter state. All zero is a valid, unprimed state. */
+typedef struct {
+	bool bPrimed;					/* The first sample has been seen */
+	int32_t i32Estimate;			/* EMA and Kalman output */
+	uint32_t ui32Variance;			/* Kalman: P, estimate variance */
+	int32_t pi32Window[WS_FILTER_MEDIAN_LEN];	/* Median: last samples */
+	uint8_t ui8Next;				/* Median: next slot of the window */
+}WS_Filter_t;
+
+/* Filter one sample given in thousandths of the sensor unit. */
+int32_t filterUpdate(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, int32_t i32Sample);
+
+/* Same on a floating point measurement, converted at the boundary. */
+float filterUpdateFloat(WS_Filter_t *psFilter, const WS_FilterConfig_t *psConfig, float fSample);
+
+/* Convert between floating point units and thousandths of units. */
+int32_t filterToMilli(float fValue);
+float filterFromMilli(int32_t i32Value);
+
+#endif /* WEATHER_STATION_WS_FILTER_H_ */
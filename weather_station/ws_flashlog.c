@@ -0,0 +1,567 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "driverlib/sw_crc.h"
+
+#include "ws_flashlog.h"
+
+#define SECTOR_MAGIC			0x474c5357u		/* "WSLG" */
+#define SECTOR_HEADER_BYTES		16
+#define BLOCK_MAGIC				0x4b42u			/* "BK" */
+#define BLOCK_HEADER_BYTES		12
+#define BLOCK_BLANK				0xffffu
+
+/* Worst case encoded sample, every field a five byte varint */
+#define SAMPLE_MAX_BYTES		(5 * (1 + WS_FLASHLOG_CHANNELS))
+
+#define PAD4(n)					(((n) + 3) & ~3u)
+
+/* Blocks at the end of a sector the mount tries for the newest time, the
+ * last one may be torn */
+#define MOUNT_LAST_BLOCKS		4
+
+WS_FlashLog_t FlashLog;
+
+/* Sector header: magic, sequence, reserved, CRC of the first 12 bytes */
+static bool flashLogSectorRead(const WS_FlashBackend_t *psBackend, uint32_t ui32Sector, uint32_t *pui32Seq)
+{
+	uint32_t pui32Header[SECTOR_HEADER_BYTES / 4];
+
+	if(psBackend->pfnRead(psBackend->pvContext, ui32Sector * psBackend->ui32SectorSize,
+						  pui32Header, SECTOR_HEADER_BYTES))
+	{
+		return(false);
+	}
+
+	if( (pui32Header[0] != SECTOR_MAGIC) || (pui32Header[1] == 0) || (pui32Header[1] == 0xffffffffu) ||
+		(pui32Header[3] != Crc32(0xffffffffu, (const uint8_t *)pui32Header, 12)) )
+	{
+		return(false);
+	}
+
+	*pui32Seq = pui32Header[1];
+	return(true);
+}
+
+/* Erase the next sector and make it the active one */
+static int32_t flashLogRotate(WS_FlashLog_t *psLog)
+{
+	const WS_FlashBackend_t *psBackend = psLog->psBackend;
+	uint32_t pui32Header[SECTOR_HEADER_BYTES / 4];
+	uint32_t ui32Next, ui32Seq;
+
+	ui32Seq = psLog->pui32Seq[psLog->ui32Active] + 1;
+	ui32Next = (psLog->ui32Active + 1) % psBackend->ui32SectorCount;
+
+	/* The oldest data goes, the sector counts as unused until its header
+	 * is in place */
+	psLog->pui32Seq[ui32Next] = 0;
+	if(psBackend->pfnErase(psBackend->pvContext, ui32Next))
+	{
+		return(-1);
+	}
+	psLog->sStats.ui32Erases++;
+
+	pui32Header[0] = SECTOR_MAGIC;
+	pui32Header[1] = ui32Seq;
+	pui32Header[2] = 0xffffffffu;
+	pui32Header[3] = Crc32(0xffffffffu, (const uint8_t *)pui32Header, 12);
+	if(psBackend->pfnProgram(psBackend->pvContext, ui32Next * psBackend->ui32SectorSize,
+							 pui32Header, SECTOR_HEADER_BYTES))
+	{
+		return(-1);
+	}
+	psLog->sStats.ui32FlashBytes += SECTOR_HEADER_BYTES;
+
+	psLog->pui32Seq[ui32Next] = ui32Seq;
+	psLog->ui32Active = ui32Next;
+	psLog->ui32Offset = SECTOR_HEADER_BYTES;
+
+	return(0);
+}
+
+/* Walk the block headers of a sector. Gives the end of its blocks and the
+ * offsets of the last MOUNT_LAST_BLOCKS of them, newest first. */
+static int32_t flashLogWalk(WS_FlashLog_t *psLog, uint32_t ui32Sector, uint32_t *pui32End,
+							uint32_t *pui32Last, uint32_t *pui32LastCount)
+{
+	const WS_FlashBackend_t *psBackend = psLog->psBackend;
+	uint32_t pui32Header[2];
+	uint32_t ui32Offset, ui32Len, ui32Idx;
+
+	*pui32LastCount = 0;
+	ui32Offset = SECTOR_HEADER_BYTES;
+	while((ui32Offset + BLOCK_HEADER_BYTES) <= psBackend->ui32SectorSize)
+	{
+		psLog->sStats.ui32MountReads++;
+		if(psBackend->pfnRead(psBackend->pvContext, ui32Sector * psBackend->ui32SectorSize + ui32Offset,
+							  pui32Header, sizeof(pui32Header)))
+		{
+			return(-1);
+		}
+
+		if((pui32Header[0] & 0xffff) == BLOCK_BLANK)
+		{
+			break;
+		}
+
+		ui32Len = pui32Header[0] >> 16;
+		if( ((pui32Header[0] & 0xffff) != BLOCK_MAGIC) || (ui32Len > WS_FLASHLOG_BLOCK_BYTES) )
+		{
+			/* Unknown content, do not write behind it */
+			ui32Offset = psBackend->ui32SectorSize;
+			break;
+		}
+
+		for(ui32Idx = MOUNT_LAST_BLOCKS - 1; ui32Idx; ui32Idx--)
+		{
+			pui32Last[ui32Idx] = pui32Last[ui32Idx - 1];
+		}
+		pui32Last[0] = ui32Offset;
+		if(*pui32LastCount < MOUNT_LAST_BLOCKS)
+		{
+			(*pui32LastCount)++;
+		}
+
+		ui32Offset += BLOCK_HEADER_BYTES + PAD4(ui32Len);
+	}
+
+	*pui32End = ui32Offset;
+	return(0);
+}
+
+static bool flashLogVarint(const uint8_t *pui8Buf, uint32_t ui32Len, uint32_t *pui32Pos,
+						   uint32_t *pui32Value)
+{
+	uint32_t ui32Value = 0;
+	uint32_t ui32Shift = 0;
+	uint8_t ui8Byte;
+
+	do
+	{
+		if((*pui32Pos >= ui32Len) || (ui32Shift > 28))
+		{
+			return(false);
+		}
+		ui8Byte = pui8Buf[(*pui32Pos)++];
+		ui32Value |= (uint32_t)(ui8Byte & 0x7f) << ui32Shift;
+		ui32Shift += 7;
+	}
+	while(ui8Byte & 0x80);
+
+	*pui32Value = ui32Value;
+	return(true);
+}
+
+/* Map signed to unsigned so small magnitudes give short varints */
+static uint32_t flashLogZigzag(int32_t i32Value)
+{
+	return(((uint32_t)i32Value << 1) ^ (uint32_t)(i32Value >> 31));
+}
+
+static int32_t flashLogUnzigzag(uint32_t ui32Value)
+{
+	return((int32_t)(ui32Value >> 1) ^ -(int32_t)(ui32Value & 1));
+}
+
+/* Time of the newest sample of the block at ui32Base, false if the block is
+ * damaged. The block buffer, empty while mounting, takes the block. */
+static bool flashLogBlockTime(WS_FlashLog_t *psLog, uint32_t ui32Base, uint32_t *pui32Time)
+{
+	const WS_FlashBackend_t *psBackend = psLog->psBackend;
+	const uint8_t *pui8Payload = (const uint8_t *)&psLog->pui32Block[3];
+	uint32_t ui32Len, ui32Count, ui32Pos = 0, ui32Value, ui32Time = 0, ui32Sample, ui32Ch;
+
+	psLog->sStats.ui32MountReads++;
+	if(psBackend->pfnRead(psBackend->pvContext, ui32Base, psLog->pui32Block, BLOCK_HEADER_BYTES))
+	{
+		return(false);
+	}
+	ui32Len = psLog->pui32Block[0] >> 16;
+	ui32Count = psLog->pui32Block[1] & 0xffff;
+	if( (ui32Len > WS_FLASHLOG_BLOCK_BYTES) ||
+		psBackend->pfnRead(psBackend->pvContext, ui32Base + BLOCK_HEADER_BYTES, &psLog->pui32Block[3],
+						   PAD4(ui32Len)) ||
+		(psLog->pui32Block[2] != Crc32(Crc32(0xffffffffu, (const uint8_t *)psLog->pui32Block, 8),
+									   pui8Payload, ui32Len)) )
+	{
+		return(false);
+	}
+
+	for(ui32Sample = 0; ui32Sample < ui32Count; ui32Sample++)
+	{
+		if(!flashLogVarint(pui8Payload, ui32Len, &ui32Pos, &ui32Value))
+		{
+			return(false);
+		}
+		ui32Time = ui32Sample ? (ui32Time + (uint32_t)flashLogUnzigzag(ui32Value)) : ui32Value;
+		for(ui32Ch = 0; ui32Ch < WS_FLASHLOG_CHANNELS; ui32Ch++)
+		{
+			if(!flashLogVarint(pui8Payload, ui32Len, &ui32Pos, &ui32Value))
+			{
+				return(false);
+			}
+		}
+	}
+
+	*pui32Time = ui32Time;
+	return(ui32Count != 0);
+}
+
+/* Time of the newest sample in flash: the last intact block of the newest
+ * sector that has one, going back while the sequence is unbroken */
+static bool flashLogNewestTime(WS_FlashLog_t *psLog, uint32_t *pui32Last, uint32_t ui32LastCount,
+							   uint32_t *pui32Time)
+{
+	const WS_FlashBackend_t *psBackend = psLog->psBackend;
+	uint32_t ui32Sector = psLog->ui32Active, ui32Prev, ui32Step, ui32Idx, ui32End;
+
+	for(ui32Step = 0; ui32Step < psBackend->ui32SectorCount; ui32Step++)
+	{
+		for(ui32Idx = 0; ui32Idx < ui32LastCount; ui32Idx++)
+		{
+			if(flashLogBlockTime(psLog, ui32Sector * psBackend->ui32SectorSize + pui32Last[ui32Idx],
+								 pui32Time))
+			{
+				return(true);
+			}
+		}
+
+		ui32Prev = (ui32Sector + psBackend->ui32SectorCount - 1) % psBackend->ui32SectorCount;
+		if(!psLog->pui32Seq[ui32Prev] || (psLog->pui32Seq[ui32Prev] != (psLog->pui32Seq[ui32Sector] - 1)) ||
+		   flashLogWalk(psLog, ui32Prev, &ui32End, pui32Last, &ui32LastCount))
+		{
+			break;
+		}
+		ui32Sector = ui32Prev;
+	}
+
+	return(false);
+}
+
+int32_t flashLogMount(WS_FlashLog_t *psLog, const WS_FlashBackend_t *psBackend)
+{
+	uint32_t pui32Last[MOUNT_LAST_BLOCKS];
+	uint32_t ui32Sector, ui32Seq, ui32Newest, ui32Offset, ui32LastCount, ui32Time;
+	bool bFound;
+
+	memset(psLog, 0, sizeof(WS_FlashLog_t));
+	psLog->psBackend = psBackend;
+
+	if( (psBackend->ui32SectorCount < 2) || (psBackend->ui32SectorCount > WS_FLASHLOG_MAX_SECTORS) )
+	{
+		return(-1);
+	}
+
+	/* Sector headers only */
+	bFound = false;
+	ui32Newest = 0;
+	for(ui32Sector = 0; ui32Sector < psBackend->ui32SectorCount; ui32Sector++)
+	{
+		psLog->sStats.ui32MountReads++;
+		if(flashLogSectorRead(psBackend, ui32Sector, &ui32Seq))
+		{
+			psLog->pui32Seq[ui32Sector] = ui32Seq;
+			if(!bFound || (ui32Seq > psLog->pui32Seq[ui32Newest]))
+			{
+				ui32Newest = ui32Sector;
+			}
+			bFound = true;
+		}
+	}
+
+	if(!bFound)
+	{
+		/* Empty or foreign content, start a new log in sector 0 */
+		psLog->ui32Active = psBackend->ui32SectorCount - 1;
+		if(flashLogRotate(psLog))
+		{
+			return(-1);
+		}
+		psLog->bMounted = true;
+		return(0);
+	}
+
+	/* Block headers of the newest sector give the write position */
+	psLog->ui32Active = ui32Newest;
+	if(flashLogWalk(psLog, ui32Newest, &ui32Offset, pui32Last, &ui32LastCount))
+	{
+		return(-1);
+	}
+	psLog->ui32Offset = ui32Offset;
+
+	/* Times go on from the newest sample */
+	if(flashLogNewestTime(psLog, pui32Last, ui32LastCount, &ui32Time))
+	{
+		psLog->ui32NextTime = ui32Time + 1;
+		psLog->ui32BootTime = psLog->ui32NextTime;
+	}
+	psLog->bMounted = true;
+
+	return(0);
+}
+
+int32_t flashLogFlush(WS_FlashLog_t *psLog)
+{
+	const WS_FlashBackend_t *psBackend = psLog->psBackend;
+	uint8_t *pui8Block = (uint8_t *)psLog->pui32Block;
+	uint32_t ui32Padded, ui32Base;
+	int32_t i32Ret = -1;
+
+	if(!psLog->bMounted)
+	{
+		return(-1);
+	}
+	if(psLog->ui32BlockCount == 0)
+	{
+		return(0);
+	}
+
+	ui32Padded = PAD4(psLog->ui32BlockLen);
+	memset(pui8Block + BLOCK_HEADER_BYTES + psLog->ui32BlockLen, 0xff, ui32Padded - psLog->ui32BlockLen);
+
+	if((psLog->ui32Offset + BLOCK_HEADER_BYTES + ui32Padded) > psBackend->ui32SectorSize)
+	{
+		if(flashLogRotate(psLog))
+		{
+			goto done;
+		}
+	}
+
+	psLog->pui32Block[0] = BLOCK_MAGIC | (psLog->ui32BlockLen << 16);
+	psLog->pui32Block[1] = psLog->ui32BlockCount | (0xffffu << 16);
+	psLog->pui32Block[2] = Crc32(Crc32(0xffffffffu, pui8Block, 8),
+								 pui8Block + BLOCK_HEADER_BYTES, psLog->ui32BlockLen);
+
+	/* Header, payload, then the CRC that validates both */
+	ui32Base = psLog->ui32Active * psBackend->ui32SectorSize + psLog->ui32Offset;
+	if( psBackend->pfnProgram(psBackend->pvContext, ui32Base, &psLog->pui32Block[0], 8) ||
+		psBackend->pfnProgram(psBackend->pvContext, ui32Base + BLOCK_HEADER_BYTES, &psLog->pui32Block[3], ui32Padded) ||
+		psBackend->pfnProgram(psBackend->pvContext, ui32Base + 8, &psLog->pui32Block[2], 4) )
+	{
+		/* The length is in flash already, step over the broken block */
+		psLog->ui32Offset += BLOCK_HEADER_BYTES + ui32Padded;
+		goto done;
+	}
+
+	psLog->ui32Offset += BLOCK_HEADER_BYTES + ui32Padded;
+	psLog->sStats.ui32Blocks++;
+	psLog->sStats.ui32FlashBytes += BLOCK_HEADER_BYTES + ui32Padded;
+	i32Ret = 0;
+
+done:
+	/* Start a new block either way, a failing sector must not stop logging */
+	psLog->ui32BlockLen = 0;
+	psLog->ui32BlockCount = 0;
+	return(i32Ret);
+}
+
+static uint32_t flashLogPutVarint(uint8_t *pui8Buf, uint32_t ui32Value)
+{
+	uint32_t ui32Len = 0;
+
+	while(ui32Value >= 0x80)
+	{
+		pui8Buf[ui32Len++] = (uint8_t)(ui32Value | 0x80);
+		ui32Value >>= 7;
+	}
+	pui8Buf[ui32Len++] = (uint8_t)ui32Value;
+
+	return(ui32Len);
+}
+
+uint32_t flashLogTime(const WS_FlashLog_t *psLog, uint32_t ui32UptimeS, uint32_t ui32UnixS)
+{
+	uint32_t ui32Time = ui32UnixS ? ui32UnixS : (psLog->ui32BootTime + ui32UptimeS);
+
+	/* A wall clock set back by SNTP does not step the log back */
+	return((ui32Time < psLog->ui32NextTime) ? psLog->ui32NextTime : ui32Time);
+}
+
+int32_t flashLogAppend(WS_FlashLog_t *psLog, const WS_LogSample_t *psSample)
+{
+	uint8_t *pui8Out;
+	uint32_t ui32Ch;
+	int32_t i32Ret = 0;
+
+	if(!psLog->bMounted)
+	{
+		return(-1);
+	}
+
+	if((psLog->ui32BlockLen + SAMPLE_MAX_BYTES) > WS_FLASHLOG_BLOCK_BYTES)
+	{
+		i32Ret = flashLogFlush(psLog);
+	}
+
+	pui8Out = (uint8_t *)psLog->pui32Block + BLOCK_HEADER_BYTES + psLog->ui32BlockLen;
+
+	if(psLog->ui32BlockCount == 0)
+	{
+		/* The first sample of a block stands alone */
+		pui8Out += flashLogPutVarint(pui8Out, psSample->ui32Time);
+		for(ui32Ch = 0; ui32Ch < WS_FLASHLOG_CHANNELS; ui32Ch++)
+		{
+			pui8Out += flashLogPutVarint(pui8Out, flashLogZigzag(psSample->pi32Values[ui32Ch]));
+		}
+	}
+	else
+	{
+		pui8Out += flashLogPutVarint(pui8Out, flashLogZigzag((int32_t)(psSample->ui32Time - psLog->sLast.ui32Time)));
+		for(ui32Ch = 0; ui32Ch < WS_FLASHLOG_CHANNELS; ui32Ch++)
+		{
+			pui8Out += flashLogPutVarint(pui8Out,
+					flashLogZigzag(psSample->pi32Values[ui32Ch] - psLog->sLast.pi32Values[ui32Ch]));
+		}
+	}
+
+	psLog->ui32BlockLen = pui8Out - ((uint8_t *)psLog->pui32Block + BLOCK_HEADER_BYTES);
+	psLog->ui32BlockCount++;
+	psLog->sLast = *psSample;
+	psLog->ui32NextTime = psSample->ui32Time + 1;
+	psLog->sStats.ui32Samples++;
+
+	return(i32Ret);
+}
+
+void flashLogIterInit(const WS_FlashLog_t *psLog, WS_FlashLogIter_t *psIter, uint32_t ui32From)
+{
+	memset(psIter, 0, sizeof(WS_FlashLogIter_t));
+	psIter->psLog = psLog;
+	psIter->ui32From = ui32From;
+	psIter->ui32Sector = psLog->ui32Active;
+	psIter->ui32Offset = psLog->psBackend ? psLog->psBackend->ui32SectorSize : 0;
+}
+
+/* Load the next valid block into the iterator, false at the end of the log */
+static bool flashLogIterLoad(WS_FlashLogIter_t *psIter)
+{
+	const WS_FlashLog_t *psLog = psIter->psLog;
+	const WS_FlashBackend_t *psBackend = psLog->psBackend;
+	uint32_t pui32Header[BLOCK_HEADER_BYTES / 4];
+	uint32_t ui32Base, ui32Len;
+
+	if(!psLog->bMounted)
+	{
+		return(false);
+	}
+
+	while(psIter->ui32Step <= psBackend->ui32SectorCount)
+	{
+		/* Sector done, go to the next one, the active one comes last */
+		if( ((psIter->ui32Offset + BLOCK_HEADER_BYTES) > psBackend->ui32SectorSize) ||
+			((psIter->ui32Sector == psLog->ui32Active) && (psIter->ui32Offset >= psLog->ui32Offset)) )
+		{
+			if(psIter->ui32Step == psBackend->ui32SectorCount)
+			{
+				/* Flash is done, the block still in RAM is the last one */
+				psIter->ui32Step++;
+				if(psLog->ui32BlockCount)
+				{
+					memcpy(psIter->pui8Payload, (const uint8_t *)psLog->pui32Block + BLOCK_HEADER_BYTES,
+						   psLog->ui32BlockLen);
+					psIter->ui32PayloadLen = psLog->ui32BlockLen;
+					psIter->ui32Left = psLog->ui32BlockCount;
+					psIter->ui32Pos = 0;
+					psIter->bFirst = true;
+					return(true);
+				}
+				return(false);
+			}
+			psIter->ui32Step++;
+			psIter->ui32Sector = (psIter->ui32Sector + 1) % psBackend->ui32SectorCount;
+			psIter->ui32Offset = psLog->pui32Seq[psIter->ui32Sector] ? SECTOR_HEADER_BYTES : psBackend->ui32SectorSize;
+			continue;
+		}
+
+		ui32Base = psIter->ui32Sector * psBackend->ui32SectorSize + psIter->ui32Offset;
+		if(psBackend->pfnRead(psBackend->pvContext, ui32Base, pui32Header, BLOCK_HEADER_BYTES))
+		{
+			psIter->ui32Offset = psBackend->ui32SectorSize;
+			continue;
+		}
+
+		ui32Len = pui32Header[0] >> 16;
+		if( ((pui32Header[0] & 0xffff) != BLOCK_MAGIC) || (ui32Len > WS_FLASHLOG_BLOCK_BYTES) )
+		{
+			psIter->ui32Offset = psBackend->ui32SectorSize;
+			continue;
+		}
+		psIter->ui32Offset += BLOCK_HEADER_BYTES + PAD4(ui32Len);
+
+		if(psBackend->pfnRead(psBackend->pvContext, ui32Base + BLOCK_HEADER_BYTES, psIter->pui8Payload, PAD4(ui32Len)))
+		{
+			continue;
+		}
+
+		/* Torn or damaged blocks are skipped */
+		if(pui32Header[2] != Crc32(Crc32(0xffffffffu, (const uint8_t *)pui32Header, 8), psIter->pui8Payload, ui32Len))
+		{
+			continue;
+		}
+
+		psIter->ui32PayloadLen = ui32Len;
+		psIter->ui32Left = pui32Header[1] & 0xffff;
+		psIter->ui32Pos = 0;
+		psIter->bFirst = true;
+		return(true);
+	}
+
+	return(false);
+}
+
+static bool flashLogGetVarint(WS_FlashLogIter_t *psIter, uint32_t *pui32Value)
+{
+	return(flashLogVarint(psIter->pui8Payload, psIter->ui32PayloadLen, &psIter->ui32Pos, pui32Value));
+}
+
+bool flashLogIterNext(WS_FlashLogIter_t *psIter, WS_LogSample_t *psSample)
+{
+	uint32_t ui32Ch, ui32Value = 0;
+	bool bOk;
+
+	while(1)
+	{
+		if(psIter->ui32Left == 0)
+		{
+			if(!flashLogIterLoad(psIter))
+			{
+				return(false);
+			}
+			continue;
+		}
+
+		bOk = flashLogGetVarint(psIter, &ui32Value);
+		if(psIter->bFirst)
+		{
+			psIter->sPrev.ui32Time = ui32Value;
+		}
+		else
+		{
+			psIter->sPrev.ui32Time += (uint32_t)flashLogUnzigzag(ui32Value);
+		}
+		for(ui32Ch = 0; ui32Ch < WS_FLASHLOG_CHANNELS; ui32Ch++)
+		{
+			bOk = bOk && flashLogGetVarint(psIter, &ui32Value);
+			psIter->sPrev.pi32Values[ui32Ch] = flashLogUnzigzag(ui32Value) +
+				(psIter->bFirst ? 0 : psIter->sPrev.pi32Values[ui32Ch]);
+		}
+
+		if(!bOk)
+		{
+			/* Short block, drop the rest of it */
+			psIter->ui32Left = 0;
+			continue;
+		}
+
+		psIter->bFirst = false;
+		psIter->ui32Left--;
+
+		if(psIter->sPrev.ui32Time >= psIter->ui32From)
+		{
+			*psSample = psIter->sPrev;
+			return(true);
+		}
+	}
+}
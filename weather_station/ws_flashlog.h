@@ -0,0 +1,145 @@
+#ifndef WEATHER_STATION_WS_FLASHLOG_H_
+#define WEATHER_STATION_WS_FLASHLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Append-only sample log in flash.
+ *
+ *  The log area is split into erase sectors used round robin, which levels
+ *  the wear: a sector is only erased when the log wraps onto it again. Every
+ *  sector starts with a header carrying a sequence number, the newest sector
+ *  is the one with the highest sequence.
+ *
+ *  Samples are collected in RAM and written as blocks. A block holds up to
+ *  WS_FLASHLOG_BLOCK_BYTES of delta coded samples: the first sample of the
+ *  block is stored whole, the following ones as differences to the previous
+ *  sample, each field as a zigzag varint. Slowly changing 1 s means take 6
+ *  to 10 bytes per sample instead of 20.
+ *
+ *  A block is programmed header first, then the payload, then the CRC word of
+ *  the header. A reset during the write leaves a block whose length is known
+ *  but whose CRC does not match, readers skip it.
+ *
+ *  Mounting reads the sector headers and walks the block headers of the
+ *  newest sector, then decodes the newest block for the time of the newest
+ *  sample.
+ *
+ *  Sample times have to grow, readers skip to a time and page by it.
+ *  flashLogTime gives them: the wall clock in seconds since 1970 once it is
+ *  set, else seconds of uptime counted on from the newest sample the mount
+ *  found, so the log's time goes on across resets instead of restarting at
+ *  0 under older, larger stamps.
+ *
+ *  The flash itself is reached through WS_FlashBackend_t, the internal flash
+ *  backend is in ws_flashlog_flash.c, a RAM simulation in ws_flashlog_ram.c.
+ *  Backend functions return 0 on success and -1 on failure like the
+ *  driverlib flash functions. */
+//*****************************************************************************
+
+#define WS_FLASHLOG_CHANNELS		4		/* Temperature, humidity, pressure, light */
+#define WS_FLASHLOG_MAX_SECTORS		32
+#define WS_FLASHLOG_BLOCK_BYTES		512		/* Payload of one block */
+
+/* Storage the log runs on */
+typedef struct {
+	void *pvContext;
+	uint32_t ui32SectorSize;		/* Erase unit, bytes */
+	uint32_t ui32SectorCount;
+	int32_t (*pfnRead)(void *pvContext, uint32_t ui32Offset, void *pvData, uint32_t ui32Count);
+	/* Offset and count are multiples of 4, bits can only be cleared */
+	int32_t (*pfnProgram)(void *pvContext, uint32_t ui32Offset, const void *pvData, uint32_t ui32Count);
+	int32_t (*pfnErase)(void *pvContext, uint32_t ui32Sector);
+}WS_FlashBackend_t;
+
+/* One logged sample, values in thousandths of the sensor unit */
+typedef struct {
+	uint32_t ui32Time;				/* s, see flashLogTime */
+	int32_t pi32Values[WS_FLASHLOG_CHANNELS];
+}WS_LogSample_t;
+
+typedef struct {
+	uint32_t ui32Samples;			/* Samples appended */
+	uint32_t ui32Blocks;			/* Blocks written */
+	uint32_t ui32FlashBytes;		/* Bytes programmed, headers and padding included */
+	uint32_t ui32Erases;			/* Sectors erased */
+	uint32_t ui32MountReads;		/* Header reads of the last mount */
+}WS_FlashLogStats_t;
+
+typedef struct {
+	const WS_FlashBackend_t *psBackend;
+	bool bMounted;
+
+	/* Sector state, a sequence of 0 marks an unused sector */
+	uint32_t pui32Seq[WS_FLASHLOG_MAX_SECTORS];
+	uint32_t ui32Active;			/* Sector being written */
+	uint32_t ui32Offset;			/* Write position in the active sector */
+
+	/* Block being collected */
+	uint32_t pui32Block[(12 + WS_FLASHLOG_BLOCK_BYTES + 3) / 4];
+	uint32_t ui32BlockLen;			/* Payload bytes */
+	uint32_t ui32BlockCount;		/* Samples */
+	WS_LogSample_t sLast;			/* Reference of the delta coding */
+
+	uint32_t ui32NextTime;			/* Earliest time of the next sample */
+	uint32_t ui32BootTime;			/* Log time of uptime 0 */
+
+	WS_FlashLogStats_t sStats;
+}WS_FlashLog_t;
+
+/* Reader state, walks the log from the oldest sample */
+typedef struct {
+	const WS_FlashLog_t *psLog;
+	uint32_t ui32From;				/* Skip samples older than this */
+	uint32_t ui32Step;				/* Sectors visited */
+	uint32_t ui32Sector;
+	uint32_t ui32Offset;
+	uint8_t pui8Payload[WS_FLASHLOG_BLOCK_BYTES];
+	uint32_t ui32PayloadLen;
+	uint32_t ui32Pos;
+	uint32_t ui32Left;				/* Samples left in the block */
+	bool bFirst;
+	bool bRam;						/* Reading the block still in RAM */
+	WS_LogSample_t sPrev;
+}WS_FlashLogIter_t;
+
+/* The station's log */
+extern WS_FlashLog_t FlashLog;
+
+/* Find the end of the log, formats the area if it holds no log. */
+int32_t flashLogMount(WS_FlashLog_t *psLog, const WS_FlashBackend_t *psBackend);
+
+/* Time of a sample to append, taken ui32UptimeS after the reset or, if not
+ * 0, at the wall clock ui32UnixS. Never before the newest sample logged. */
+uint32_t flashLogTime(const WS_FlashLog_t *psLog, uint32_t ui32UptimeS, uint32_t ui32UnixS);
+
+/* Append a sample, blocks are written as they fill up. */
+int32_t flashLogAppend(WS_FlashLog_t *psLog, const WS_LogSample_t *psSample);
+
+/* Write the collected samples as a block now. */
+int32_t flashLogFlush(WS_FlashLog_t *psLog);
+
+/* History reader, samples come oldest first, the ones not yet flushed
+ * included. */
+void flashLogIterInit(const WS_FlashLog_t *psLog, WS_FlashLogIter_t *psIter, uint32_t ui32From);
+bool flashLogIterNext(WS_FlashLogIter_t *psIter, WS_LogSample_t *psSample);
+
+/* Backends */
+extern const WS_FlashBackend_t FlashLogInternal;
+
+typedef struct {
+	uint8_t *pui8Mem;
+	uint32_t ui32SectorSize;
+	uint32_t ui32Programs;			/* Program calls */
+	uint32_t ui32ProgramBytes;
+	uint32_t ui32Erases;
+	uint32_t ui32Reads;
+}WS_FlashRam_t;
+
+/* Set up a RAM simulated flash of ui32SectorCount sectors in pui8Mem. The
+ * memory starts out erased. */
+void flashLogRamInit(WS_FlashBackend_t *psBackend, WS_FlashRam_t *psRam, uint8_t *pui8Mem,
+					 uint32_t ui32SectorSize, uint32_t ui32SectorCount);
+
+#endif /* WEATHER_STATION_WS_FLASHLOG_H_ */
@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "driverlib/flash.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "ws_flashlog.h"
+
+//*****************************************************************************
+/*  Internal flash backend of the log. The top 256 KB of the 1 MB flash are
+ *  kept out of the FLASH region in enet_io_ccs.cmd for it, the TM4C1294
+ *  erases in 16 KB sectors. The flash is memory mapped, reads are copies. */
+//*****************************************************************************
+#define FLASHLOG_BASE			0x000C0000
+#define FLASHLOG_SECTOR_SIZE	0x4000
+#define FLASHLOG_SECTORS		16
+
+static int32_t flashInternalRead(void *pvContext, uint32_t ui32Offset, void *pvData, uint32_t ui32Count)
+{
+	memcpy(pvData, (const void *)(FLASHLOG_BASE + ui32Offset), ui32Count);
+	return(0);
+}
+
+static int32_t flashInternalProgram(void *pvContext, uint32_t ui32Offset, const void *pvData, uint32_t ui32Count)
+{
+	return(MAP_FlashProgram((uint32_t *)pvData, FLASHLOG_BASE + ui32Offset, ui32Count));
+}
+
+static int32_t flashInternalErase(void *pvContext, uint32_t ui32Sector)
+{
+	return(MAP_FlashErase(FLASHLOG_BASE + ui32Sector * FLASHLOG_SECTOR_SIZE));
+}
+
+const WS_FlashBackend_t FlashLogInternal =
+{
+	NULL,
+	FLASHLOG_SECTOR_SIZE,
+	FLASHLOG_SECTORS,
+	flashInternalRead,
+	flashInternalProgram,
+	flashInternalErase
+};
@@ -0,0 +1,68 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ws_flashlog.h"
+
+//*****************************************************************************
+/*  RAM simulation of NOR flash for the log. Programming can only clear bits
+ *  and erasing sets a whole sector to 0xff, like the real part. The counters
+ *  give the write amplification and the mount cost. */
+//*****************************************************************************
+
+static int32_t flashRamRead(void *pvContext, uint32_t ui32Offset, void *pvData, uint32_t ui32Count)
+{
+	WS_FlashRam_t *psRam = (WS_FlashRam_t *)pvContext;
+
+	memcpy(pvData, psRam->pui8Mem + ui32Offset, ui32Count);
+	psRam->ui32Reads++;
+
+	return(0);
+}
+
+static int32_t flashRamProgram(void *pvContext, uint32_t ui32Offset, const void *pvData, uint32_t ui32Count)
+{
+	WS_FlashRam_t *psRam = (WS_FlashRam_t *)pvContext;
+	const uint8_t *pui8Data = (const uint8_t *)pvData;
+	uint32_t ui32Idx;
+
+	if((ui32Offset & 3) || (ui32Count & 3))
+	{
+		return(-1);
+	}
+
+	for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+	{
+		psRam->pui8Mem[ui32Offset + ui32Idx] &= pui8Data[ui32Idx];
+	}
+	psRam->ui32Programs++;
+	psRam->ui32ProgramBytes += ui32Count;
+
+	return(0);
+}
+
+static int32_t flashRamErase(void *pvContext, uint32_t ui32Sector)
+{
+	WS_FlashRam_t *psRam = (WS_FlashRam_t *)pvContext;
+
+	memset(psRam->pui8Mem + ui32Sector * psRam->ui32SectorSize, 0xff, psRam->ui32SectorSize);
+	psRam->ui32Erases++;
+
+	return(0);
+}
+
+void flashLogRamInit(WS_FlashBackend_t *psBackend, WS_FlashRam_t *psRam, uint8_t *pui8Mem,
+					 uint32_t ui32SectorSize, uint32_t ui32SectorCount)
+{
+	memset(psRam, 0, sizeof(WS_FlashRam_t));
+	psRam->pui8Mem = pui8Mem;
+	psRam->ui32SectorSize = ui32SectorSize;
+	memset(pui8Mem, 0xff, ui32SectorSize * ui32SectorCount);
+
+	psBackend->pvContext = psRam;
+	psBackend->ui32SectorSize = ui32SectorSize;
+	psBackend->ui32SectorCount = ui32SectorCount;
+	psBackend->pfnRead = flashRamRead;
+	psBackend->pfnProgram = flashRamProgram;
+	psBackend->pfnErase = flashRamErase;
+}
@@ -0,0 +1,939 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils/lwiplib.h"
+#include "utils/ustdlib.h"
+#include "lwip/tcp.h"
+#include "httpserver_raw/fs.h"
+
+#include "ws_route.h"
+#include "ws_http.h"
+
+typedef enum {
+	HttpRequestLine			= 0x00u,	/* Waiting for a request */
+	HttpHeaders				= 0x01u,
+	HttpPending				= 0x02u,	/* Parsed, it may wait for a dynamic file */
+	HttpResponding			= 0x03u		/* The next requests wait in their pbufs */
+}HttpState_t;
+
+typedef struct {
+	struct tcp_pcb *psPCB;				/* NULL if the slot is free */
+	HttpState_t eState;
+	struct pbuf *psRecv;				/* Received, not parsed yet */
+	uint16_t ui16RecvOffset;			/* Parsed bytes of its first pbuf */
+
+	/* Request being parsed. The lengths count past what is kept. */
+	char pcLine[WS_HTTP_LINE_LEN];
+	uint16_t ui16LineLen;
+	char pcField[WS_HTTP_FIELD_LEN];
+	uint16_t ui16FieldLen;
+	bool bKeepAliveAsked;
+	bool bCloseAsked;
+	char *pcURI;						/* In pcLine, NULL for another method */
+	bool bHead;
+
+	/* Response being queued: pcOut first, then the body */
+	char pcOut[WS_HTTP_OUT_LEN];
+	uint16_t ui16OutLen;
+	uint16_t ui16OutSent;
+	struct fs_file *psFile;
+	const char *pcData;
+	uint32_t ui32Left;
+	uint8_t ui8WriteFlags;				/* TCP_WRITE_FLAG_COPY for a dynamic file */
+	bool bSSI;
+	bool bClose;						/* Close once the response is queued */
+
+	uint16_t ui16Requests;
+	uint8_t ui8Polls;					/* Poll periods without progress */
+}HttpConn_t;
+
+typedef struct {
+	const char *pcExt;
+	const char *pcType;
+	bool bSSI;
+}HttpType_t;
+
+/* Content types by extension, text/plain for the others and for paths
+ * without one, as the dynamic files are */
+static const HttpType_t HttpTypes[] =
+{
+	{ "html", "text/html", false },
+	{ "htm", "text/html", false },
+	{ "shtml", "text/html", true },
+	{ "shtm", "text/html", true },
+	{ "ssi", "text/html", true },
+	{ "css", "text/css", false },
+	{ "js", "application/javascript", false },
+	{ "json", "application/json", false },
+	{ "ico", "image/x-icon", false },
+	{ "png", "image/png", false },
+	{ "jpg", "image/jpeg", false },
+	{ "gif", "image/gif", false },
+	{ "zip", "application/zip", false }
+};
+
+#define HTTP_NUM_TYPES			(sizeof(HttpTypes) / sizeof(HttpTypes[0]))
+
+/* SSI tags are "<!--#name-->", names longer than this are no tags */
+#define HTTP_SSI_NAME_LEN		32
+
+static const char HttpNotFound[] =
+	"<html><body><h2>404: The requested file cannot be found.</h2></body></html>\r\n";
+static const char HttpTooLong[] =
+	"<html><body><h2>414: Request-URI Too Long</h2></body></html>\r\n";
+static const char HttpNotImplemented[] =
+	"<html><body><h2>501: Not Implemented</h2></body></html>\r\n";
+static const char HttpNotAllowed[] =
+	"<html><body><h2>405: Method Not Allowed</h2></body></html>\r\n";
+
+/* Default documents of a path ending in '/', in httpd's order */
+static const char * const HttpIndexes[] =
+{
+	"index.shtml", "index.ssi", "index.shtm", "index.html", "index.htm"
+};
+
+#define HTTP_NUM_INDEXES		(sizeof(HttpIndexes) / sizeof(HttpIndexes[0]))
+#define HTTP_INDEX_LEN			12		/* Longest of them, with the terminator */
+
+WS_HttpStats_t HttpStats;
+
+static HttpConn_t HttpConns[WS_HTTP_MAX_CONNS];
+
+/* The connection whose dynamic file is not all queued yet, NULL if none.
+ * The dynamic files are built in one static buffer that the next fs_open of
+ * any of them builds again, so only one connection at a time has one left
+ * to queue: the dynamic requests of the others wait for it. */
+static HttpConn_t *HttpBodyOwner;
+
+//*****************************************************************************
+//
+// Requests.
+//
+//*****************************************************************************
+static char httpLower(char c)
+{
+	return(((c >= 'A') && (c <= 'Z')) ? (c + ('a' - 'A')) : c);
+}
+
+/* Case-insensitive search of a lower case word */
+static bool httpHas(const char *pcText, const char *pcWord)
+{
+	uint32_t ui32Idx;
+
+	for(; *pcText; pcText++)
+	{
+		for(ui32Idx = 0; pcWord[ui32Idx] && (httpLower(pcText[ui32Idx]) == pcWord[ui32Idx]);
+			ui32Idx++)
+		{
+		}
+		if(!pcWord[ui32Idx])
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/* A header line, only Connection matters */
+static void httpField(HttpConn_t *psConn)
+{
+	static const char pcConnection[] = "connection:";
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; pcConnection[ui32Idx]; ui32Idx++)
+	{
+		if(httpLower(psConn->pcField[ui32Idx]) != pcConnection[ui32Idx])
+		{
+			return;
+		}
+	}
+
+	psConn->bCloseAsked |= httpHas(psConn->pcField + ui32Idx, "close");
+	psConn->bKeepAliveAsked |= httpHas(psConn->pcField + ui32Idx, "keep-alive");
+}
+
+/* Feed a received byte, true when it ends a request */
+static bool httpParseByte(HttpConn_t *psConn, char c)
+{
+	if(c == '\r')
+	{
+		return(false);
+	}
+
+	if(psConn->eState == HttpRequestLine)
+	{
+		if(c != '\n')
+		{
+			if(psConn->ui16LineLen < WS_HTTP_LINE_LEN)
+			{
+				psConn->pcLine[psConn->ui16LineLen] = c;
+				psConn->ui16LineLen++;
+			}
+			return(false);
+		}
+
+		/* Empty lines before a request are allowed */
+		if(psConn->ui16LineLen)
+		{
+			psConn->pcLine[(psConn->ui16LineLen < WS_HTTP_LINE_LEN) ?
+						   psConn->ui16LineLen : (WS_HTTP_LINE_LEN - 1)] = 0;
+			psConn->eState = HttpHeaders;
+			psConn->ui16FieldLen = 0;
+			psConn->bKeepAliveAsked = false;
+			psConn->bCloseAsked = false;
+		}
+		return(false);
+	}
+
+	if(c != '\n')
+	{
+		if(psConn->ui16FieldLen < (WS_HTTP_FIELD_LEN - 1))
+		{
+			psConn->pcField[psConn->ui16FieldLen] = c;
+			psConn->ui16FieldLen++;
+		}
+		return(false);
+	}
+
+	/* The empty line ends the request */
+	if(!psConn->ui16FieldLen)
+	{
+		return(true);
+	}
+
+	psConn->pcField[psConn->ui16FieldLen] = 0;
+	httpField(psConn);
+	psConn->ui16FieldLen = 0;
+
+	return(false);
+}
+
+/* Parse the received bytes up to the end of a request, true if one ended.
+ * The window opens for the bytes parsed. */
+static bool httpParse(HttpConn_t *psConn)
+{
+	struct pbuf *psNext;
+	const char *pcPayload;
+	uint32_t ui32Parsed = 0;
+	bool bDone = false;
+
+	while(psConn->psRecv && !bDone)
+	{
+		pcPayload = psConn->psRecv->payload;
+		while(!bDone && (psConn->ui16RecvOffset < psConn->psRecv->len))
+		{
+			bDone = httpParseByte(psConn, pcPayload[psConn->ui16RecvOffset++]);
+			ui32Parsed++;
+		}
+
+		/* Done with the first pbuf, keep the rest of the chain */
+		if(psConn->ui16RecvOffset == psConn->psRecv->len)
+		{
+			psNext = psConn->psRecv->next;
+			if(psNext)
+			{
+				pbuf_ref(psNext);
+			}
+			pbuf_free(psConn->psRecv);
+			psConn->psRecv = psNext;
+			psConn->ui16RecvOffset = 0;
+		}
+	}
+
+	if(ui32Parsed)
+	{
+		tcp_recved(psConn->psPCB, (u16_t)ui32Parsed);
+	}
+
+	return(bDone);
+}
+
+//*****************************************************************************
+//
+// Responses.
+//
+//*****************************************************************************
+/* Content type of the path, up to any '?' */
+static const HttpType_t *httpType(const char *pcPath)
+{
+	static const HttpType_t sDefault = { "", "text/plain", false };
+	const char *pcExt = NULL;
+	uint32_t ui32Idx;
+
+	for(; *pcPath && (*pcPath != '?'); pcPath++)
+	{
+		if(*pcPath == '.')
+		{
+			pcExt = pcPath + 1;
+		}
+		else if(*pcPath == '/')
+		{
+			pcExt = NULL;
+		}
+	}
+
+	for(ui32Idx = 0; pcExt && (ui32Idx < HTTP_NUM_TYPES); ui32Idx++)
+	{
+		if((strlen(HttpTypes[ui32Idx].pcExt) == (uint32_t)(pcPath - pcExt)) &&
+		   !memcmp(HttpTypes[ui32Idx].pcExt, pcExt, pcPath - pcExt))
+		{
+			return(&HttpTypes[ui32Idx]);
+		}
+	}
+
+	return(&sDefault);
+}
+
+/* The default document of a path ending in '/', built in pcIndex, or the
+ * path itself */
+static const char *httpIndex(const char *pcPath, char *pcIndex)
+{
+	uint32_t ui32Len, ui32Idx;
+
+	ui32Len = strcspn(pcPath, "?");
+	if(!ui32Len || (pcPath[ui32Len - 1] != '/') || (ui32Len >= WS_HTTP_LINE_LEN))
+	{
+		return(pcPath);
+	}
+
+	memcpy(pcIndex, pcPath, ui32Len);
+	for(ui32Idx = 0; ui32Idx < HTTP_NUM_INDEXES; ui32Idx++)
+	{
+		strcpy(pcIndex + ui32Len, HttpIndexes[ui32Idx]);
+		if(routeFind(pcIndex, NULL))
+		{
+			return(pcIndex);
+		}
+	}
+
+	return(pcPath);
+}
+
+/* Open a file of the router as the body, false if there is none */
+static bool httpOpen(HttpConn_t *psConn, const char *pcPath)
+{
+	const WS_Route_t *psRoute;
+
+	psRoute = routeFind(pcPath, NULL);
+	if(!psRoute)
+	{
+		return(false);
+	}
+
+	psConn->psFile = fs_open(pcPath);
+	if(!psConn->psFile)
+	{
+		return(false);
+	}
+
+	/* Copied as queued, the buffer is the connection's until all of it is */
+	psConn->pcData = psConn->psFile->data;
+	psConn->ui32Left = psConn->psFile->len;
+	psConn->ui8WriteFlags = 0;
+	if(psRoute->pfnOpen)
+	{
+		psConn->ui8WriteFlags = TCP_WRITE_FLAG_COPY;
+		HttpBodyOwner = psConn;
+	}
+
+	return(true);
+}
+
+/* Take the request in pcLine apart, it is answered by httpRespond */
+static void httpRequest(HttpConn_t *psConn)
+{
+	char *pcVersion;
+	bool bKeep;
+
+	HttpStats.ui32Requests++;
+	if(psConn->ui16Requests)
+	{
+		HttpStats.ui32Reused++;
+	}
+	psConn->ui16Requests++;
+	psConn->eState = HttpPending;
+
+	/* "GET /path?query HTTP/1.1" */
+	psConn->bHead = !strncmp(psConn->pcLine, "HEAD ", 5);
+	psConn->pcURI = psConn->bHead ? (psConn->pcLine + 5) :
+					(strncmp(psConn->pcLine, "GET ", 4) ? NULL : (psConn->pcLine + 4));
+	pcVersion = psConn->pcURI ? strchr(psConn->pcURI, ' ') : NULL;
+	if(pcVersion)
+	{
+		*pcVersion++ = 0;
+	}
+
+	/* HTTP/1.1 keeps the connection unless told not to, 1.0 only if asked */
+	if(pcVersion && !strcmp(pcVersion, "HTTP/1.1"))
+	{
+		bKeep = !psConn->bCloseAsked;
+	}
+	else
+	{
+		bKeep = psConn->bKeepAliveAsked && !psConn->bCloseAsked;
+	}
+	psConn->bClose = !bKeep || (psConn->ui16Requests >= WS_HTTP_MAX_REQUESTS);
+}
+
+/* Answer the request httpRequest took apart, the response is queued by
+ * httpSend. False if it has to wait for another connection's dynamic file. */
+static bool httpRespond(HttpConn_t *psConn)
+{
+	char pcIndex[WS_HTTP_LINE_LEN + HTTP_INDEX_LEN];
+	char *pcQuery;
+	const char *pcPath, *pcStatus, *pcAllow = NULL;
+	const HttpType_t *psType;
+	const WS_Route_t *psRoute = NULL;
+	bool bKeep = !psConn->bClose;
+	tCGIQuery sQuery;
+	int iLen;
+
+	if(psConn->pcURI && (psConn->ui16LineLen < WS_HTTP_LINE_LEN))
+	{
+		psRoute = routeFind(psConn->pcURI, NULL);
+		if(psRoute && (psRoute->pfnOpen || psRoute->pfnCGI) && HttpBodyOwner &&
+		   (HttpBodyOwner != psConn))
+		{
+			return(false);
+		}
+	}
+
+	/* The polls spent waiting are no stalled response */
+	psConn->eState = HttpResponding;
+	psConn->ui8Polls = 0;
+	psConn->psFile = NULL;
+	psConn->ui8WriteFlags = 0;
+	psConn->ui16OutSent = 0;
+
+	psType = httpType("");
+	if(psConn->ui16LineLen >= WS_HTTP_LINE_LEN)
+	{
+		pcStatus = "414 Request-URI Too Long";
+		psConn->pcData = HttpTooLong;
+		psConn->ui32Left = sizeof(HttpTooLong) - 1;
+		psType = httpType(".html");
+		bKeep = false;
+	}
+	else if(!psConn->pcURI)
+	{
+		pcStatus = "501 Not Implemented";
+		psConn->pcData = HttpNotImplemented;
+		psConn->ui32Left = sizeof(HttpNotImplemented) - 1;
+		psType = httpType(".html");
+		bKeep = false;
+	}
+	else if(psRoute && !routeAllows(psRoute, psConn->bHead ? WS_ROUTE_HEAD : WS_ROUTE_GET))
+	{
+		pcStatus = "405 Method Not Allowed";
+		pcAllow = routeAllows(psRoute, WS_ROUTE_GET) ? "GET" : "HEAD";
+		psConn->pcData = HttpNotAllowed;
+		psConn->ui32Left = sizeof(HttpNotAllowed) - 1;
+		psType = httpType(".html");
+	}
+	else
+	{
+		/* A CGI gets the query split and decoded in one pass and names the
+		 * file to answer with */
+		pcPath = psConn->pcURI;
+		if(psRoute && psRoute->pfnCGI)
+		{
+			pcQuery = strchr(psConn->pcURI, '?');
+			if(pcQuery)
+			{
+				*pcQuery++ = 0;
+			}
+			else
+			{
+				pcQuery = psConn->pcURI + strlen(psConn->pcURI);
+			}
+			ParseCGIQuery(pcQuery, &sQuery);
+			pcPath = psRoute->pfnCGI(&sQuery);
+		}
+		else if(!psRoute)
+		{
+			pcPath = httpIndex(pcPath, pcIndex);
+		}
+
+		if(pcPath && httpOpen(psConn, pcPath))
+		{
+			pcStatus = "200 OK";
+			psType = httpType(pcPath);
+		}
+		else if(httpOpen(psConn, "/404.html"))
+		{
+			pcStatus = "404 Not Found";
+			psType = httpType(".html");
+		}
+		else
+		{
+			pcStatus = "404 Not Found";
+			psConn->pcData = HttpNotFound;
+			psConn->ui32Left = sizeof(HttpNotFound) - 1;
+			psType = httpType(".html");
+		}
+	}
+
+	/* The length of a page with SSI tags is only known once it is sent */
+	psConn->bSSI = psType->bSSI;
+	bKeep = bKeep && !psConn->bSSI;
+	psConn->bClose = !bKeep;
+
+	iLen = usnprintf(psConn->pcOut, WS_HTTP_OUT_LEN,
+					 "HTTP/1.1 %s\r\nServer: weather_station\r\nContent-Type: %s\r\n",
+					 pcStatus, psType->pcType);
+	if(pcAllow)
+	{
+		iLen += usnprintf(psConn->pcOut + iLen, WS_HTTP_OUT_LEN - iLen, "Allow: %s\r\n", pcAllow);
+	}
+	if(!psConn->bSSI)
+	{
+		iLen += usnprintf(psConn->pcOut + iLen, WS_HTTP_OUT_LEN - iLen, "Content-Length: %u\r\n",
+						  psConn->ui32Left);
+	}
+	iLen += usnprintf(psConn->pcOut + iLen, WS_HTTP_OUT_LEN - iLen, "Connection: %s\r\n\r\n",
+					  bKeep ? "keep-alive" : "close");
+	psConn->ui16OutLen = (uint16_t)iLen;
+
+	if(psConn->bHead)
+	{
+		psConn->ui32Left = 0;
+	}
+
+	return(true);
+}
+
+/* Queue what fits of the data, returns the bytes queued */
+static uint32_t httpWrite(HttpConn_t *psConn, const void *pvData, uint32_t ui32Len,
+						  uint8_t ui8Flags)
+{
+	uint16_t ui16Len;
+	err_t eErr;
+
+	if(tcp_sndqueuelen(psConn->psPCB) >= TCP_SND_QUEUELEN)
+	{
+		return(0);
+	}
+
+	ui16Len = tcp_sndbuf(psConn->psPCB);
+	if(ui32Len < ui16Len)
+	{
+		ui16Len = (uint16_t)ui32Len;
+	}
+
+	/* Short of segments, try less, as httpd does */
+	while(ui16Len)
+	{
+		eErr = tcp_write(psConn->psPCB, pvData, ui16Len, ui8Flags);
+		if(eErr == ERR_OK)
+		{
+			return(ui16Len);
+		}
+		if(eErr != ERR_MEM)
+		{
+			break;
+		}
+		ui16Len /= 2;
+	}
+
+	return(0);
+}
+
+/* Length of the SSI tag at pcData, 0 if there is none there */
+static uint32_t httpSSITag(const char *pcData, uint32_t ui32Left, uint32_t *pui32Name)
+{
+	uint32_t ui32Len;
+
+	if((ui32Left < 8) || memcmp(pcData, "<!--#", 5))
+	{
+		return(0);
+	}
+
+	for(ui32Len = 5; ((ui32Len + 3) <= ui32Left) && (ui32Len <= (5 + HTTP_SSI_NAME_LEN)); ui32Len++)
+	{
+		if(!memcmp(pcData + ui32Len, "-->", 3))
+		{
+			for(*pui32Name = ui32Len - 5; *pui32Name && (pcData[4 + *pui32Name] == ' ');
+				(*pui32Name)--)
+			{
+			}
+			return(ui32Len + 3);
+		}
+	}
+
+	return(0);
+}
+
+/* Bytes of a page up to its next SSI tag */
+static uint32_t httpSSIRun(const char *pcData, uint32_t ui32Left)
+{
+	const char *pcTag;
+	uint32_t ui32Name;
+
+	for(pcTag = memchr(pcData, '<', ui32Left); pcTag;
+		pcTag = memchr(pcTag + 1, '<', ui32Left - (pcTag + 1 - pcData)))
+	{
+		if(httpSSITag(pcTag, ui32Left - (pcTag - pcData), &ui32Name))
+		{
+			return(pcTag - pcData);
+		}
+	}
+
+	return(ui32Left);
+}
+
+/* Queue the response, true once all of it is queued */
+static bool httpSend(HttpConn_t *psConn)
+{
+	uint32_t ui32Len, ui32Tag, ui32Name;
+	int32_t i32Insert;
+
+	for(;;)
+	{
+		/* Headers or an SSI insert, copied */
+		if(psConn->ui16OutSent < psConn->ui16OutLen)
+		{
+			ui32Len = httpWrite(psConn, psConn->pcOut + psConn->ui16OutSent,
+								psConn->ui16OutLen - psConn->ui16OutSent, TCP_WRITE_FLAG_COPY);
+			if(!ui32Len)
+			{
+				return(false);
+			}
+			psConn->ui16OutSent += ui32Len;
+			continue;
+		}
+
+		if(!psConn->ui32Left)
+		{
+			break;
+		}
+
+		ui32Len = psConn->bSSI ? httpSSIRun(psConn->pcData, psConn->ui32Left) : psConn->ui32Left;
+		if(!ui32Len)
+		{
+			/* A tag: its insert goes out next */
+			ui32Tag = httpSSITag(psConn->pcData, psConn->ui32Left, &ui32Name);
+			i32Insert = routeSSI(psConn->pcData + 5, ui32Name, psConn->pcOut, WS_HTTP_OUT_LEN);
+			psConn->ui16OutLen = (i32Insert < 0) ? 0 :
+								 (i32Insert >= WS_HTTP_OUT_LEN) ? (WS_HTTP_OUT_LEN - 1) : i32Insert;
+			psConn->ui16OutSent = 0;
+			psConn->pcData += ui32Tag;
+			psConn->ui32Left -= ui32Tag;
+			continue;
+		}
+
+		ui32Len = httpWrite(psConn, psConn->pcData, ui32Len, psConn->ui8WriteFlags);
+		if(!ui32Len)
+		{
+			return(false);
+		}
+		psConn->pcData += ui32Len;
+		psConn->ui32Left -= ui32Len;
+	}
+
+	if(psConn->psFile)
+	{
+		fs_close(psConn->psFile);
+		psConn->psFile = NULL;
+	}
+	if(HttpBodyOwner == psConn)
+	{
+		HttpBodyOwner = NULL;
+	}
+
+	return(true);
+}
+
+//*****************************************************************************
+//
+// Connections.
+//
+//*****************************************************************************
+static void httpFree(HttpConn_t *psConn)
+{
+	if(psConn->psRecv)
+	{
+		pbuf_free(psConn->psRecv);
+		psConn->psRecv = NULL;
+	}
+	if(psConn->psFile)
+	{
+		fs_close(psConn->psFile);
+		psConn->psFile = NULL;
+	}
+	if(HttpBodyOwner == psConn)
+	{
+		HttpBodyOwner = NULL;
+	}
+
+	psConn->psPCB = NULL;
+	HttpStats.ui32Open--;
+}
+
+/* Close the connection, what is queued is still sent. ERR_ABRT if the PCB
+ * had to be aborted. */
+static err_t httpClose(HttpConn_t *psConn)
+{
+	struct tcp_pcb *psPCB = psConn->psPCB;
+
+	tcp_arg(psPCB, NULL);
+	tcp_recv(psPCB, NULL);
+	tcp_sent(psPCB, NULL);
+	tcp_poll(psPCB, NULL, 0);
+	tcp_err(psPCB, NULL);
+
+	/* lwIP resets a connection closed with bytes not taken, and drops the
+	 * response queued before */
+	if(psConn->psRecv)
+	{
+		tcp_recved(psPCB, psConn->psRecv->tot_len - psConn->ui16RecvOffset);
+	}
+	httpFree(psConn);
+
+	if(tcp_close(psPCB) != ERR_OK)
+	{
+		tcp_abort(psPCB);
+		return(ERR_ABRT);
+	}
+
+	return(ERR_OK);
+}
+
+/* Answer the requests received, in order, as far as the send buffer goes */
+static err_t httpProcess(HttpConn_t *psConn)
+{
+	struct tcp_pcb *psPCB = psConn->psPCB;
+	bool bWaiting = false;
+
+	for(;;)
+	{
+		if((psConn->eState == HttpPending) && !httpRespond(psConn))
+		{
+			break;
+		}
+
+		if(psConn->eState == HttpResponding)
+		{
+			if(!httpSend(psConn))
+			{
+				break;
+			}
+			if(psConn->bClose)
+			{
+				return(httpClose(psConn));
+			}
+
+			/* Requests already received were pipelined behind this one */
+			psConn->eState = HttpRequestLine;
+			psConn->ui16LineLen = 0;
+			bWaiting = (psConn->psRecv != NULL);
+		}
+
+		if(!httpParse(psConn))
+		{
+			break;
+		}
+		if(bWaiting)
+		{
+			HttpStats.ui32Pipelined++;
+		}
+		httpRequest(psConn);
+	}
+
+	tcp_output(psPCB);
+
+	return(ERR_OK);
+}
+
+/* Answer the requests that wait for a dynamic file, if none is left to
+ * queue. Those behind a connection that was dropped are retried from their
+ * poll. */
+static void httpResume(HttpConn_t *psFrom)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; (ui32Idx < WS_HTTP_MAX_CONNS) && !HttpBodyOwner; ui32Idx++)
+	{
+		if(HttpConns[ui32Idx].psPCB && (HttpConns[ui32Idx].eState == HttpPending) &&
+		   (&HttpConns[ui32Idx] != psFrom))
+		{
+			httpProcess(&HttpConns[ui32Idx]);
+		}
+	}
+}
+
+static err_t httpRecv(void *pvArg, struct tcp_pcb *psPCB, struct pbuf *p, err_t eErr)
+{
+	HttpConn_t *psConn = pvArg;
+	err_t eResult;
+
+	/* The client closed its side, as httpd does the rest is not sent */
+	if(!p)
+	{
+		return(httpClose(psConn));
+	}
+
+	psConn->ui8Polls = 0;
+	if(psConn->psRecv)
+	{
+		pbuf_cat(psConn->psRecv, p);
+	}
+	else
+	{
+		psConn->psRecv = p;
+		psConn->ui16RecvOffset = 0;
+	}
+
+	eResult = httpProcess(psConn);
+	httpResume(psConn);
+
+	return(eResult);
+}
+
+static err_t httpSent(void *pvArg, struct tcp_pcb *psPCB, u16_t ui16Len)
+{
+	HttpConn_t *psConn = pvArg;
+	err_t eResult;
+
+	psConn->ui8Polls = 0;
+	eResult = httpProcess(psConn);
+	httpResume(psConn);
+
+	return(eResult);
+}
+
+static err_t httpPoll(void *pvArg, struct tcp_pcb *psPCB)
+{
+	HttpConn_t *psConn = pvArg;
+
+	psConn->ui8Polls++;
+
+	/* Not timed out, the connection it waits for is if it stalls */
+	if(psConn->eState == HttpPending)
+	{
+		return(httpProcess(psConn));
+	}
+
+	if(psConn->eState == HttpResponding)
+	{
+		if(psConn->ui8Polls < WS_HTTP_SEND_POLLS)
+		{
+			return(httpProcess(psConn));
+		}
+
+		tcp_arg(psPCB, NULL);
+		tcp_err(psPCB, NULL);
+		httpFree(psConn);
+		tcp_abort(psPCB);
+		return(ERR_ABRT);
+	}
+
+	if(psConn->ui8Polls >= WS_HTTP_IDLE_POLLS)
+	{
+		HttpStats.ui32IdleClosed++;
+		return(httpClose(psConn));
+	}
+
+	return(ERR_OK);
+}
+
+/* The PCB is already freed */
+static void httpError(void *pvArg, err_t eErr)
+{
+	HttpConn_t *psConn = pvArg;
+
+	if(psConn)
+	{
+		httpFree(psConn);
+	}
+}
+
+static err_t httpAccept(void *pvArg, struct tcp_pcb *psPCB, err_t eErr)
+{
+	struct tcp_pcb *psListen = pvArg;
+	HttpConn_t *psConn = NULL, *psIdle = NULL;
+	uint32_t ui32Idx;
+
+	tcp_accepted(psListen);
+
+	/* A free slot, or the one idle for the longest time */
+	for(ui32Idx = 0; (ui32Idx < WS_HTTP_MAX_CONNS) && !psConn; ui32Idx++)
+	{
+		if(!HttpConns[ui32Idx].psPCB)
+		{
+			psConn = &HttpConns[ui32Idx];
+		}
+		else if((HttpConns[ui32Idx].eState == HttpRequestLine) &&
+				!HttpConns[ui32Idx].ui16LineLen && !HttpConns[ui32Idx].psRecv &&
+				(!psIdle || (HttpConns[ui32Idx].ui8Polls > psIdle->ui8Polls)))
+		{
+			psIdle = &HttpConns[ui32Idx];
+		}
+	}
+
+	if(!psConn && psIdle)
+	{
+		HttpStats.ui32Evicted++;
+		httpClose(psIdle);
+		psConn = psIdle;
+	}
+	if(!psConn)
+	{
+		HttpStats.ui32Refused++;
+		return(ERR_MEM);
+	}
+
+	psConn->psPCB = psPCB;
+	psConn->eState = HttpRequestLine;
+	psConn->psRecv = NULL;
+	psConn->ui16RecvOffset = 0;
+	psConn->ui16LineLen = 0;
+	psConn->psFile = NULL;
+	psConn->ui16Requests = 0;
+	psConn->ui8Polls = 0;
+
+	HttpStats.ui32Accepted++;
+	HttpStats.ui32Open++;
+	if(HttpStats.ui32Open > HttpStats.ui32MaxOpen)
+	{
+		HttpStats.ui32MaxOpen = HttpStats.ui32Open;
+	}
+
+	/* Responses go out as soon as they are queued, a pipelined one must not
+	 * wait for the delayed ACK of the one before */
+	tcp_setprio(psPCB, TCP_PRIO_MIN);
+	tcp_nagle_disable(psPCB);
+	tcp_arg(psPCB, psConn);
+	tcp_recv(psPCB, httpRecv);
+	tcp_sent(psPCB, httpSent);
+	tcp_err(psPCB, httpError);
+	tcp_poll(psPCB, httpPoll, WS_HTTP_POLL_INTERVAL);
+
+	return(ERR_OK);
+}
+
+void httpInit(void)
+{
+	struct tcp_pcb *psPCB;
+
+	psPCB = tcp_new();
+	if(!psPCB)
+	{
+		return;
+	}
+
+	tcp_setprio(psPCB, TCP_PRIO_MIN);
+	if(tcp_bind(psPCB, IP_ADDR_ANY, WS_HTTP_PORT) != ERR_OK)
+	{
+		tcp_close(psPCB);
+		return;
+	}
+
+	psPCB = tcp_listen(psPCB);
+	if(psPCB)
+	{
+		tcp_arg(psPCB, psPCB);
+		tcp_accept(psPCB, httpAccept);
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef WEATHER_STATION_WS_HTTP_H_
+#define WEATHER_STATION_WS_HTTP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  HTTP/1.1 server of the station, on lwIP's raw TCP API.
+ *
+ *  lwIP 1.4.1's httpd answers one request per connection and closes it, so
+ *  every dashboard poll costs a handshake and leaves a PCB in TIME_WAIT. This
+ *  server keeps the connection open: every response carries a Content-Length
+ *  and a Connection header, HTTP/1.1 requests keep the connection unless they
+ *  ask for "Connection: close", HTTP/1.0 ones only with "Connection:
+ *  keep-alive".
+ *
+ *  Requests are pipelined: the ones that arrive while a response is being
+ *  sent stay in their pbufs, and are parsed and answered in order once the
+ *  response is queued. The receive window only opens for the bytes parsed,
+ *  so a client cannot queue more than TCP_WND ahead.
+ *
+ *  The files, CGIs and SSI tags are the router's, the files are opened with
+ *  fs_open. A path ending in '/' gets its index file, as with httpd, and a
+ *  HEAD for a route that answers GET only gets 405. Pages with SSI tags
+ *  (.shtml, .shtm, .ssi) have no length known beforehand: they are sent as
+ *  by httpd, with the connection closed after them.
+ *
+ *  A dynamic file is built in a static buffer and copied as it is queued.
+ *  While one connection still has one to queue, the requests of the others
+ *  for a dynamic file or a CGI wait, so no fs_open builds the buffer again
+ *  under it.
+ *
+ *  A keep-alive connection idle for WS_HTTP_IDLE_POLLS poll periods is
+ *  closed. When all WS_HTTP_MAX_CONNS are taken, a new connection replaces
+ *  the one idle for the longest time, or is refused if none is idle. */
+//*****************************************************************************
+
+#define WS_HTTP_PORT			80
+#define WS_HTTP_MAX_CONNS		12		/* Of MEMP_NUM_TCP_PCB, the rest for clients */
+#define WS_HTTP_LINE_LEN		192		/* Longest request line, longer ones get 414 */
+#define WS_HTTP_FIELD_LEN		32		/* Start of a header line kept to be matched */
+#define WS_HTTP_OUT_LEN			192		/* Headers, then SSI inserts */
+#define WS_HTTP_MAX_REQUESTS	1000	/* Per connection, then it is closed */
+
+/* tcp_poll period, in TCP coarse timer ticks of 500 ms */
+#define WS_HTTP_POLL_INTERVAL	2
+#define WS_HTTP_IDLE_POLLS		10		/* Idle keep-alive connection closed after */
+#define WS_HTTP_SEND_POLLS		8		/* Response without progress aborted after */
+
+typedef struct {
+	uint32_t ui32Accepted;		/* Connections */
+	uint32_t ui32Requests;
+	uint32_t ui32Reused;		/* Requests on a connection that had answered one */
+	uint32_t ui32Pipelined;		/* Requests waiting when the previous response was queued */
+	uint32_t ui32IdleClosed;	/* Keep-alive connections closed for being idle */
+	uint32_t ui32Evicted;		/* Idle ones closed to take a new connection */
+	uint32_t ui32Refused;		/* New connections without a free slot */
+	uint32_t ui32Open;
+	uint32_t ui32MaxOpen;
+}WS_HttpStats_t;
+
+extern WS_HttpStats_t HttpStats;
+
+/* Listen on WS_HTTP_PORT, after lwIPInit and the routes */
+void httpInit(void);
+
+#endif /* WEATHER_STATION_WS_HTTP_H_ */
@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils/lwiplib.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "ws_packet.h"
+#include "ws_time.h"
+#include "ws_mcast.h"
+
+WS_McastStats_t McastStats;
+
+#if WS_MCAST_PORT
+static struct udp_pcb *McastPcb;
+
+/* Samples waiting for mcastTick, written by main, read by lwIP */
+static WS_Packet_t McastQueue[WS_MCAST_QUEUE];
+static uint32_t McastHead;
+static uint32_t McastCount;
+static uint32_t McastSequence;
+
+/* Take the oldest queued sample, false if there is none */
+static bool mcastTake(WS_Packet_t *psPacket)
+{
+	bool bMasked, bTaken = false;
+
+	bMasked = MAP_IntMasterDisable();
+	if(McastCount)
+	{
+		*psPacket = McastQueue[McastHead];
+		McastHead = (McastHead + 1) & (WS_MCAST_QUEUE - 1);
+		McastCount--;
+		bTaken = true;
+	}
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+
+	return(bTaken);
+}
+#endif
+
+void mcastPublish(uint64_t ui64TimeUs, const int32_t *pi32Values, uint32_t ui32Channels)
+{
+#if WS_MCAST_PORT
+	WS_Packet_t *psPacket;
+	bool bMasked;
+
+	if(ui32Channels > WS_PACKET_CHANNELS)
+	{
+		ui32Channels = WS_PACKET_CHANNELS;
+	}
+
+	bMasked = MAP_IntMasterDisable();
+	if(McastCount == WS_MCAST_QUEUE)
+	{
+		McastHead = (McastHead + 1) & (WS_MCAST_QUEUE - 1);
+		McastCount--;
+		McastStats.ui32Overrun++;
+	}
+	psPacket = &McastQueue[(McastHead + McastCount) & (WS_MCAST_QUEUE - 1)];
+	McastCount++;
+
+	/* The wall clock time is looked up when the sample is sent */
+	psPacket->ui32Sequence = McastSequence++;
+	psPacket->ui64TimeUs = ui64TimeUs;
+	psPacket->ui64UnixMs = 0;
+	psPacket->ui32Channels = ui32Channels;
+	memcpy(psPacket->pi32Values, pi32Values, ui32Channels * sizeof(int32_t));
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+#endif
+}
+
+void mcastTick(void)
+{
+#if WS_MCAST_PORT
+	uint8_t pui8Data[WS_PACKET_MAX_LEN];
+	WS_Packet_t sPacket;
+	ip_addr_t sGroup;
+	uint64_t ui64UnixUs;
+	uint32_t ui32Len;
+	struct pbuf *p;
+
+	/* No address before DHCP finished, the samples of that time are dropped */
+	if(!netif_default || ip_addr_isany(&netif_default->ip_addr))
+	{
+		while(mcastTake(&sPacket))
+		{
+		}
+		return;
+	}
+
+	if(!McastPcb)
+	{
+		McastPcb = udp_new();
+		if(!McastPcb)
+		{
+			return;
+		}
+		McastPcb->ttl = WS_MCAST_TTL;
+	}
+
+	WS_MCAST_GROUP(&sGroup);
+	while(mcastTake(&sPacket))
+	{
+		if(timeUnixUs(sPacket.ui64TimeUs, &ui64UnixUs))
+		{
+			sPacket.ui64UnixMs = ui64UnixUs / 1000u;
+		}
+		ui32Len = packetEncode(pui8Data, sizeof(pui8Data), &sPacket);
+
+		p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)ui32Len, PBUF_RAM);
+		if(!p)
+		{
+			McastStats.ui32Errors++;
+			continue;
+		}
+		pbuf_take(p, pui8Data, (u16_t)ui32Len);
+
+		if(udp_sendto(McastPcb, p, &sGroup, WS_MCAST_PORT) == ERR_OK)
+		{
+			McastStats.ui32Sent++;
+		}
+		else
+		{
+			McastStats.ui32Errors++;
+		}
+		pbuf_free(p);
+	}
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef WEATHER_STATION_WS_MCAST_H_
+#define WEATHER_STATION_WS_MCAST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Multicast publisher of the samples.
+ *
+ *  Every sample set that passes StreamDeadband (ws_deadband.h) is sent as
+ *  one datagram (ws_packet.h) to a UDP multicast group, so any number of
+ *  hosts on the LAN can follow the station for the price of one packet per
+ *  sample, instead of one HTTP session each. The sequence number of the
+ *  datagrams lets a receiver count what it lost; a set within the deadband
+ *  is not sent and takes no sequence number.
+ *
+ *  The samples are taken in main and queued; lwIP runs in the Ethernet
+ *  interrupt, so the queue is sent from lwIPHostTimerHandler. A sample that
+ *  finds the queue full pushes out the oldest one, which the receivers see
+ *  as a gap. Nothing is sent before the interface has an address.
+ *
+ *  The group defaults to an organization-local address, build with
+ *
+ *      WS_MCAST_GROUP(a)=IP4_ADDR((a),239,1,2,3)
+ *
+ *  to choose another, WS_MCAST_PORT=<port> for the port, or with
+ *  WS_MCAST_PORT=0 to publish nothing. Sending to a group needs no IGMP,
+ *  LWIP_IGMP stays off. */
+//*****************************************************************************
+
+#ifndef WS_MCAST_GROUP
+#define WS_MCAST_GROUP(a)		IP4_ADDR((a), 239, 255, 87, 83)
+#endif
+
+#ifndef WS_MCAST_PORT
+#define WS_MCAST_PORT			47883
+#endif
+
+#define WS_MCAST_TTL			1		/* Routers do not pass it on */
+#define WS_MCAST_QUEUE			4		/* Samples between two sends, power of two */
+
+typedef struct {
+	uint32_t ui32Sent;
+	uint32_t ui32Overrun;		/* Pushed out of a full queue */
+	uint32_t ui32Errors;		/* pbuf or send failures */
+}WS_McastStats_t;
+
+extern WS_McastStats_t McastStats;
+
+/* Queue a sample set, values in thousandths (see ws_packet.h), taken at the
+ * tickNowUs time ui64TimeUs. Called from main. */
+void mcastPublish(uint64_t ui64TimeUs, const int32_t *pi32Values, uint32_t ui32Channels);
+
+/* Send the queued samples, called from lwIPHostTimerHandler */
+void mcastTick(void);
+
+#endif /* WEATHER_STATION_WS_MCAST_H_ */
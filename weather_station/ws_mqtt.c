@@ -0,0 +1,689 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils/lwiplib.h"
+#include "utils/ustdlib.h"
+#include "lwip/tcp.h"
+#include "lwip/netif.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "ws_probe.h"
+#include "ws_tick.h"
+#include "ws_time.h"
+#include "ws_mqtt.h"
+
+WS_MqttStats_t MqttStats;
+
+#if WS_MQTT_PORT
+
+/* Control packet types, the high nibble of the first byte */
+#define MQTT_CONNECT			0x10
+#define MQTT_CONNACK			0x20
+#define MQTT_PUBLISH			0x30
+#define MQTT_PUBACK				0x40
+#define MQTT_PINGREQ			0xC0
+#define MQTT_PINGRESP			0xD0
+#define MQTT_TYPE_M				0xF0
+
+#define MQTT_PUBLISH_DUP		0x08
+#define MQTT_PUBLISH_QOS_S		1
+#define MQTT_CONNECT_CLEAN		0x02
+#define MQTT_LEVEL_311			4
+
+#define MQTT_TOPICS				4
+#define MQTT_TOPIC_MAX			48		/* WS_MQTT_TOPIC_PREFIX up to 36 characters */
+#define MQTT_LINE_LEN			28		/* "<time> <value>\n", the longest */
+
+/* Room for the fixed header ahead of a PUBLISH: the type and a remaining
+ * length of up to two bytes */
+#define MQTT_HEADER_MAX			3
+
+#if (MQTT_HEADER_MAX + 2 + MQTT_TOPIC_MAX + 2 + WS_MQTT_BATCH_MAX * MQTT_LINE_LEN) > WS_MQTT_MSG_LEN
+#error "WS_MQTT_MSG_LEN does not hold a PUBLISH of WS_MQTT_BATCH_MAX samples"
+#endif
+
+typedef enum {
+	MqttIdle				= 0x00u,	/* Waiting for the next attempt */
+	MqttConnecting			= 0x01u,
+	MqttWaitConnack			= 0x02u,
+	MqttConnected			= 0x03u
+}MqttState_t;
+
+typedef enum {
+	MqttRxHeader			= 0x00u,
+	MqttRxLength			= 0x01u,
+	MqttRxBody				= 0x02u
+}MqttRxState_t;
+
+typedef struct {
+	uint64_t ui64TimeUs;
+	int32_t pi32Values[MQTT_TOPICS];
+}MqttSample_t;
+
+/* A QoS 1 PUBLISH waiting for its PUBACK */
+typedef struct {
+	uint16_t ui16Id;
+	uint16_t ui16Start;					/* Of the message in pui8Msg */
+	uint16_t ui16Len;
+	bool bAcked;
+	uint8_t pui8Msg[WS_MQTT_MSG_LEN];
+}MqttInflight_t;
+
+static const char * const MqttTopics[MQTT_TOPICS] =
+{
+	WS_MQTT_TOPIC_PREFIX "temperature",
+	WS_MQTT_TOPIC_PREFIX "humidity",
+	WS_MQTT_TOPIC_PREFIX "pressure",
+	WS_MQTT_TOPIC_PREFIX "light"
+};
+
+/* Configuration, taken over by the next connection */
+static uint32_t MqttBrokerAddr;			/* 0 for the built-in broker */
+static uint16_t MqttPortNext = WS_MQTT_PORT;
+static uint8_t MqttQoSNext = WS_MQTT_QOS;
+static uint8_t MqttQoS;
+
+static struct tcp_pcb *MqttPCB;
+static MqttState_t MqttState;
+static uint32_t MqttStateMs;			/* When the state was entered */
+static uint32_t MqttRetryMs;			/* Next attempt, in MqttIdle */
+static uint32_t MqttBackoffMs;
+static uint32_t MqttLastTxMs;
+static uint32_t MqttPingMs;				/* PINGREQ without PINGRESP, 0 if none */
+
+/* Sample sets waiting, written by main. The head MqttBatchLen sets are the
+ * batch being published, topics below MqttBatchTopic are sent. */
+static MqttSample_t MqttQueue[WS_MQTT_QUEUE];
+static uint32_t MqttHead;
+static uint32_t MqttCount;
+static uint32_t MqttBatchLen;
+static uint32_t MqttBatchTopic;
+
+/* QoS 1 PUBLISHes in the order they were sent. The first MqttResendPos of
+ * them went out again on this connection. */
+static MqttInflight_t MqttInflight[WS_MQTT_INFLIGHT];
+static uint32_t MqttInflightHead;
+static uint32_t MqttInflightCount;
+static uint32_t MqttResendPos;
+static uint16_t MqttPacketId;
+
+/* QoS 0 PUBLISH being written, tcp_write copies it */
+static uint8_t MqttOut[WS_MQTT_MSG_LEN];
+
+/* Packet being received. Only the first bytes of the body are kept, no
+ * packet the broker sends a publisher has more. */
+static MqttRxState_t MqttRxState;
+static uint8_t MqttRxType;
+static uint32_t MqttRxLen;
+static uint32_t MqttRxShift;
+static uint32_t MqttRxGot;
+static uint8_t MqttRxData[4];
+
+static void mqttFlush(void);
+
+/* Schedule the next attempt after the backoff */
+static void mqttRetry(void)
+{
+	uint32_t ui32WaitMs;
+
+	MqttState = MqttIdle;
+	MqttStats.bConnected = false;
+	MqttStats.ui32Failures++;
+
+	MqttBackoffMs = MqttBackoffMs ? (MqttBackoffMs * 2) : WS_MQTT_BACKOFF_MIN_MS;
+	if(MqttBackoffMs > WS_MQTT_BACKOFF_MAX_MS)
+	{
+		MqttBackoffMs = WS_MQTT_BACKOFF_MAX_MS;
+	}
+	MqttStats.ui32BackoffMs = MqttBackoffMs;
+
+	/* Up to a quarter less, so stations restarted together spread out */
+	ui32WaitMs = MqttBackoffMs - (MqttBackoffMs / 4) * ((uint32_t)tickNowUs() & 0xFF) / 256;
+	MqttRetryMs = tickNowMs() + ui32WaitMs;
+}
+
+/* Give up the connection and retry later. Returns ERR_ABRT if the PCB was
+ * aborted, for the callbacks to pass on. */
+static err_t mqttDrop(bool bAbort)
+{
+	struct tcp_pcb *psPCB = MqttPCB;
+	err_t eErr = ERR_OK;
+
+	MqttPCB = NULL;
+	if(psPCB)
+	{
+		tcp_arg(psPCB, NULL);
+		tcp_recv(psPCB, NULL);
+		tcp_sent(psPCB, NULL);
+		tcp_err(psPCB, NULL);
+		if(bAbort || (tcp_close(psPCB) != ERR_OK))
+		{
+			tcp_abort(psPCB);
+			eErr = ERR_ABRT;
+		}
+	}
+
+	mqttRetry();
+
+	return(eErr);
+}
+
+/* Queue a message, false if the send buffer has no room for it */
+static bool mqttWrite(const uint8_t *pui8Msg, uint32_t ui32Len)
+{
+	if((tcp_sndbuf(MqttPCB) < ui32Len) || (tcp_sndqueuelen(MqttPCB) >= TCP_SND_QUEUELEN) ||
+	   (tcp_write(MqttPCB, pui8Msg, (u16_t)ui32Len, TCP_WRITE_FLAG_COPY) != ERR_OK))
+	{
+		return(false);
+	}
+
+	MqttLastTxMs = tickNowMs();
+	return(true);
+}
+
+/* One payload line, returns its length */
+static int mqttLine(char *pcBuf, int iBufLen, uint64_t ui64TimeUs, int32_t i32Value)
+{
+	uint32_t ui32Abs = (i32Value < 0) ? (uint32_t)-i32Value : (uint32_t)i32Value;
+	uint64_t ui64UnixUs;
+	int iLen = 0;
+
+	if(timeUnixUs(ui64TimeUs, &ui64UnixUs))
+	{
+		iLen = timeFormatU64(pcBuf, iBufLen, ui64UnixUs / 1000u);
+	}
+	else
+	{
+		pcBuf[iLen++] = '+';
+		iLen += timeFormatU64(pcBuf + iLen, iBufLen - iLen, ui64TimeUs / 1000u);
+	}
+
+	return(iLen + usnprintf(pcBuf + iLen, iBufLen - iLen, " %s%u.%03u\n",
+							(i32Value < 0) ? "-" : "", ui32Abs / 1000, ui32Abs % 1000));
+}
+
+/* PUBLISH of the batch to one topic. The message starts at *pui16Start of
+ * the buffer, its length is returned. */
+static uint32_t mqttEncode(uint8_t *pui8Buf, uint32_t ui32Topic, uint16_t ui16Id,
+						   uint16_t *pui16Start)
+{
+	uint8_t *pui8Var = pui8Buf + MQTT_HEADER_MAX;
+	uint32_t ui32TopicLen = strlen(MqttTopics[ui32Topic]);
+	const MqttSample_t *psSample;
+	uint32_t ui32Len, ui32Idx;
+
+	pui8Var[0] = (uint8_t)(ui32TopicLen >> 8);
+	pui8Var[1] = (uint8_t)ui32TopicLen;
+	memcpy(pui8Var + 2, MqttTopics[ui32Topic], ui32TopicLen);
+	ui32Len = 2 + ui32TopicLen;
+	if(MqttQoS)
+	{
+		pui8Var[ui32Len++] = (uint8_t)(ui16Id >> 8);
+		pui8Var[ui32Len++] = (uint8_t)ui16Id;
+	}
+
+	for(ui32Idx = 0; ui32Idx < MqttBatchLen; ui32Idx++)
+	{
+		psSample = &MqttQueue[(MqttHead + ui32Idx) & (WS_MQTT_QUEUE - 1)];
+		ui32Len += mqttLine((char *)pui8Var + ui32Len, WS_MQTT_MSG_LEN - MQTT_HEADER_MAX - ui32Len,
+							psSample->ui64TimeUs, psSample->pi32Values[ui32Topic]);
+	}
+
+	/* The fixed header right ahead of the rest */
+	if(ui32Len < 128)
+	{
+		*pui16Start = 1;
+		pui8Buf[2] = (uint8_t)ui32Len;
+	}
+	else
+	{
+		*pui16Start = 0;
+		pui8Buf[1] = (uint8_t)(ui32Len | 0x80);
+		pui8Buf[2] = (uint8_t)(ui32Len >> 7);
+	}
+	pui8Buf[*pui16Start] = MQTT_PUBLISH | (MqttQoS << MQTT_PUBLISH_QOS_S);
+
+	return(ui32Len + MQTT_HEADER_MAX - *pui16Start);
+}
+
+/* The batch went out to every topic. main only adds to the queue, and
+ * cannot interrupt lwIP. */
+static void mqttRelease(void)
+{
+	MqttHead = (MqttHead + MqttBatchLen) & (WS_MQTT_QUEUE - 1);
+	MqttCount -= MqttBatchLen;
+	MqttBatchLen = 0;
+	MqttBatchTopic = 0;
+}
+
+static void mqttAcked(uint16_t ui16Id)
+{
+	MqttInflight_t *psSlot;
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < MqttInflightCount; ui32Idx++)
+	{
+		psSlot = &MqttInflight[(MqttInflightHead + ui32Idx) & (WS_MQTT_INFLIGHT - 1)];
+		if(!psSlot->bAcked && (psSlot->ui16Id == ui16Id))
+		{
+			psSlot->bAcked = true;
+			MqttStats.ui32Acked++;
+			break;
+		}
+	}
+
+	/* Free the slots from the oldest on */
+	while(MqttInflightCount && MqttInflight[MqttInflightHead].bAcked)
+	{
+		MqttInflightHead = (MqttInflightHead + 1) & (WS_MQTT_INFLIGHT - 1);
+		MqttInflightCount--;
+		if(MqttResendPos)
+		{
+			MqttResendPos--;
+		}
+	}
+}
+
+/* Handle a complete packet from the broker, false to drop the connection */
+static bool mqttHandle(void)
+{
+	switch(MqttRxType & MQTT_TYPE_M)
+	{
+		case MQTT_CONNACK:
+			/* Return code 0 is accepted */
+			if((MqttState != MqttWaitConnack) || (MqttRxGot < 2) || MqttRxData[1])
+			{
+				return(false);
+			}
+			MqttState = MqttConnected;
+			MqttStateMs = tickNowMs();
+			MqttBackoffMs = 0;
+			MqttPingMs = 0;
+			MqttResendPos = 0;
+			MqttStats.ui32BackoffMs = 0;
+			MqttStats.ui32Connects++;
+			MqttStats.bConnected = true;
+			break;
+		case MQTT_PUBACK:
+			if(MqttRxGot >= 2)
+			{
+				mqttAcked((uint16_t)((MqttRxData[0] << 8) | MqttRxData[1]));
+			}
+			break;
+		case MQTT_PINGRESP:
+			MqttPingMs = 0;
+			break;
+		default:
+			break;
+	}
+
+	return(true);
+}
+
+static bool mqttParseByte(uint8_t ui8Byte)
+{
+	switch(MqttRxState)
+	{
+		case MqttRxHeader:
+			MqttRxType = ui8Byte;
+			MqttRxLen = 0;
+			MqttRxShift = 0;
+			MqttRxGot = 0;
+			MqttRxState = MqttRxLength;
+			return(true);
+		case MqttRxLength:
+			MqttRxLen |= (uint32_t)(ui8Byte & 0x7F) << MqttRxShift;
+			MqttRxShift += 7;
+			if(ui8Byte & 0x80)
+			{
+				/* Four bytes at most */
+				return(MqttRxShift < 28);
+			}
+			if(MqttRxLen)
+			{
+				MqttRxState = MqttRxBody;
+				return(true);
+			}
+			break;
+		default:
+			if(MqttRxGot < sizeof(MqttRxData))
+			{
+				MqttRxData[MqttRxGot] = ui8Byte;
+			}
+			if(++MqttRxGot < MqttRxLen)
+			{
+				return(true);
+			}
+			break;
+	}
+
+	MqttRxState = MqttRxHeader;
+	return(mqttHandle());
+}
+
+/* Resend what the last connection left unacknowledged, then publish the
+ * queue, batched if the link is behind */
+static void mqttFlush(void)
+{
+	MqttInflight_t *psSlot = NULL;
+	uint8_t *pui8Msg;
+	uint32_t ui32Len;
+	uint16_t ui16Start, ui16Id = 0;
+	bool bBehind;
+
+	if(MqttState != MqttConnected)
+	{
+		return;
+	}
+
+	while(MqttResendPos < MqttInflightCount)
+	{
+		psSlot = &MqttInflight[(MqttInflightHead + MqttResendPos) & (WS_MQTT_INFLIGHT - 1)];
+		if(!psSlot->bAcked)
+		{
+			psSlot->pui8Msg[psSlot->ui16Start] |= MQTT_PUBLISH_DUP;
+			if(!mqttWrite(psSlot->pui8Msg + psSlot->ui16Start, psSlot->ui16Len))
+			{
+				tcp_output(MqttPCB);
+				return;
+			}
+			MqttStats.ui32Resent++;
+		}
+		MqttResendPos++;
+	}
+
+	/* The previous PUBLISHes are not through yet, what piled up meanwhile
+	 * goes out together */
+	bBehind = (tcp_sndqueuelen(MqttPCB) != 0) || (MqttInflightCount != 0);
+
+	for(;;)
+	{
+		if(!MqttBatchLen)
+		{
+			if(!MqttCount)
+			{
+				break;
+			}
+			MqttBatchLen = bBehind ? MqttCount : 1;
+			if(MqttBatchLen > WS_MQTT_BATCH_MAX)
+			{
+				MqttBatchLen = WS_MQTT_BATCH_MAX;
+			}
+		}
+
+		if(MqttQoS)
+		{
+			if(MqttInflightCount == WS_MQTT_INFLIGHT)
+			{
+				break;
+			}
+			psSlot = &MqttInflight[(MqttInflightHead + MqttInflightCount) & (WS_MQTT_INFLIGHT - 1)];
+			pui8Msg = psSlot->pui8Msg;
+			ui16Id = (MqttPacketId == 0xFFFF) ? 1 : (MqttPacketId + 1);
+		}
+		else
+		{
+			pui8Msg = MqttOut;
+		}
+
+		ui32Len = mqttEncode(pui8Msg, MqttBatchTopic, ui16Id, &ui16Start);
+		if(!mqttWrite(pui8Msg + ui16Start, ui32Len))
+		{
+			break;
+		}
+
+		if(MqttQoS)
+		{
+			psSlot->ui16Id = ui16Id;
+			psSlot->ui16Start = ui16Start;
+			psSlot->ui16Len = (uint16_t)ui32Len;
+			psSlot->bAcked = false;
+			MqttInflightCount++;
+			MqttResendPos = MqttInflightCount;
+			MqttPacketId = ui16Id;
+		}
+
+		MqttStats.ui32Publishes++;
+		MqttStats.ui32Samples += MqttBatchLen;
+		if(MqttBatchLen > MqttStats.ui32MaxBatch)
+		{
+			MqttStats.ui32MaxBatch = MqttBatchLen;
+		}
+
+		if(++MqttBatchTopic == MQTT_TOPICS)
+		{
+			mqttRelease();
+		}
+	}
+
+	tcp_output(MqttPCB);
+}
+
+static err_t mqttRecv(void *pvArg, struct tcp_pcb *psPCB, struct pbuf *p, err_t eErr)
+{
+	uint32_t ui32Probe = probeStart();
+	struct pbuf *q;
+	uint16_t ui16Idx;
+	bool bOk = true;
+
+	err_t eResult = ERR_OK;
+
+	/* The broker closed the connection */
+	if(!p)
+	{
+		eResult = mqttDrop(false);
+	}
+	else
+	{
+		tcp_recved(psPCB, p->tot_len);
+		for(q = p; q && bOk; q = q->next)
+		{
+			for(ui16Idx = 0; (ui16Idx < q->len) && bOk; ui16Idx++)
+			{
+				bOk = mqttParseByte(((const uint8_t *)q->payload)[ui16Idx]);
+			}
+		}
+		pbuf_free(p);
+
+		if(bOk)
+		{
+			/* A CONNACK or a PUBACK lets more out */
+			mqttFlush();
+		}
+		else
+		{
+			eResult = mqttDrop(true);
+		}
+	}
+
+	probeEnd(WS_ProbeMqtt, ui32Probe);
+	return(eResult);
+}
+
+static err_t mqttSent(void *pvArg, struct tcp_pcb *psPCB, u16_t ui16Len)
+{
+	uint32_t ui32Probe = probeStart();
+
+	mqttFlush();
+
+	probeEnd(WS_ProbeMqtt, ui32Probe);
+	return(ERR_OK);
+}
+
+/* The PCB is already freed */
+static void mqttError(void *pvArg, err_t eErr)
+{
+	MqttPCB = NULL;
+	mqttRetry();
+}
+
+static err_t mqttConnected(void *pvArg, struct tcp_pcb *psPCB, err_t eErr)
+{
+	uint8_t pui8Msg[14 + sizeof(WS_MQTT_CLIENT_ID) - 1];
+	uint32_t ui32IdLen = sizeof(WS_MQTT_CLIENT_ID) - 1;
+
+	pui8Msg[0] = MQTT_CONNECT;
+	pui8Msg[1] = (uint8_t)(sizeof(pui8Msg) - 2);
+	pui8Msg[2] = 0;
+	pui8Msg[3] = 4;
+	memcpy(pui8Msg + 4, "MQTT", 4);
+	pui8Msg[8] = MQTT_LEVEL_311;
+	pui8Msg[9] = MQTT_CONNECT_CLEAN;
+	pui8Msg[10] = (uint8_t)(WS_MQTT_KEEPALIVE_S >> 8);
+	pui8Msg[11] = (uint8_t)WS_MQTT_KEEPALIVE_S;
+	pui8Msg[12] = (uint8_t)(ui32IdLen >> 8);
+	pui8Msg[13] = (uint8_t)ui32IdLen;
+	memcpy(pui8Msg + 14, WS_MQTT_CLIENT_ID, ui32IdLen);
+
+	MqttRxState = MqttRxHeader;
+	if(!mqttWrite(pui8Msg, sizeof(pui8Msg)))
+	{
+		return(mqttDrop(true));
+	}
+	tcp_output(psPCB);
+
+	MqttState = MqttWaitConnack;
+	return(ERR_OK);
+}
+
+static void mqttConnect(void)
+{
+	ip_addr_t sBroker;
+
+	/* No address before DHCP finished */
+	if(!netif_default || ip_addr_isany(&netif_default->ip_addr))
+	{
+		return;
+	}
+
+	if(MqttBrokerAddr)
+	{
+		sBroker.addr = MqttBrokerAddr;
+	}
+	else
+	{
+#ifdef WS_MQTT_BROKER
+		WS_MQTT_BROKER(&sBroker);
+#else
+		if(ip_addr_isany(&netif_default->gw))
+		{
+			return;
+		}
+		ip_addr_copy(sBroker, netif_default->gw);
+#endif
+	}
+
+	MqttQoS = MqttQoSNext;
+	MqttState = MqttConnecting;
+	MqttStateMs = tickNowMs();
+
+	MqttPCB = tcp_new();
+	if(!MqttPCB)
+	{
+		mqttRetry();
+		return;
+	}
+
+	/* The batching is done here, what is written goes out right away */
+	tcp_nagle_disable(MqttPCB);
+	tcp_arg(MqttPCB, NULL);
+	tcp_recv(MqttPCB, mqttRecv);
+	tcp_sent(MqttPCB, mqttSent);
+	tcp_err(MqttPCB, mqttError);
+	if(tcp_connect(MqttPCB, &sBroker, MqttPortNext, mqttConnected) != ERR_OK)
+	{
+		mqttDrop(true);
+	}
+}
+#endif
+
+void mqttConfigure(uint32_t ui32Broker, uint16_t ui16Port, uint8_t ui8QoS)
+{
+#if WS_MQTT_PORT
+	MqttBrokerAddr = ui32Broker;
+	MqttPortNext = ui16Port;
+	MqttQoSNext = ui8QoS ? 1 : 0;
+#endif
+}
+
+void mqttPublish(uint64_t ui64TimeUs, const int32_t *pi32Values, uint32_t ui32Channels)
+{
+#if WS_MQTT_PORT
+	MqttSample_t *psSample;
+	bool bMasked;
+
+	if(ui32Channels > MQTT_TOPICS)
+	{
+		ui32Channels = MQTT_TOPICS;
+	}
+
+	bMasked = MAP_IntMasterDisable();
+	if(MqttCount == WS_MQTT_QUEUE)
+	{
+		/* The oldest goes, with what is left of it when it is being sent */
+		MqttHead = (MqttHead + 1) & (WS_MQTT_QUEUE - 1);
+		MqttCount--;
+		MqttStats.ui32Overrun++;
+		if(MqttBatchLen && !--MqttBatchLen)
+		{
+			MqttBatchTopic = 0;
+		}
+	}
+	psSample = &MqttQueue[(MqttHead + MqttCount) & (WS_MQTT_QUEUE - 1)];
+	MqttCount++;
+
+	psSample->ui64TimeUs = ui64TimeUs;
+	memset(psSample->pi32Values, 0, sizeof(psSample->pi32Values));
+	memcpy(psSample->pi32Values, pi32Values, ui32Channels * sizeof(int32_t));
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+#endif
+}
+
+void mqttTick(void)
+{
+#if WS_MQTT_PORT
+	uint32_t ui32Probe = probeStart();
+	uint32_t ui32NowMs = tickNowMs();
+	uint8_t pui8Ping[2] = { MQTT_PINGREQ, 0 };
+
+	switch(MqttState)
+	{
+		case MqttIdle:
+			if((int32_t)(ui32NowMs - MqttRetryMs) >= 0)
+			{
+				mqttConnect();
+			}
+			break;
+		case MqttConnecting:
+		case MqttWaitConnack:
+			if((ui32NowMs - MqttStateMs) >= WS_MQTT_CONNECT_MS)
+			{
+				mqttDrop(true);
+			}
+			break;
+		default:
+			/* A PINGREQ when nothing else went out for half the keep alive,
+			 * the broker has the other half to answer */
+			if(MqttPingMs && ((ui32NowMs - MqttPingMs) >= (WS_MQTT_KEEPALIVE_S * 500u)))
+			{
+				mqttDrop(true);
+				break;
+			}
+			if(!MqttPingMs && ((ui32NowMs - MqttLastTxMs) >= (WS_MQTT_KEEPALIVE_S * 500u)) &&
+			   mqttWrite(pui8Ping, sizeof(pui8Ping)))
+			{
+				MqttPingMs = ui32NowMs | 1;
+			}
+			mqttFlush();
+			break;
+	}
+
+	probeEnd(WS_ProbeMqtt, ui32Probe);
+#endif
+}
@@ -0,0 +1,94 @@
+#ifndef WEATHER_STATION_WS_MQTT_H_
+#define WEATHER_STATION_WS_MQTT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  MQTT 3.1.1 publisher on lwIP's raw TCP API.
+ *
+ *  Every sample set that passes StreamDeadband (ws_deadband.h) is published
+ *  to one topic per sensor, WS_MQTT_TOPIC_PREFIX followed by temperature,
+ *  humidity, pressure and light. The payload is one line per sample:
+ *
+ *      <time> <value>\n
+ *
+ *  the time in milliseconds since 1970, or "+" and the uptime in
+ *  milliseconds while the wall clock is not set, the value with three
+ *  decimals in the unit of the sensor.
+ *
+ *  The samples are taken in main and queued; lwIP runs in the Ethernet
+ *  interrupt, so the queue is sent from lwIPHostTimerHandler and from the
+ *  sent callback. While the link keeps up, each sample set goes out as its
+ *  own PUBLISHes. When the previous ones are still unacknowledged (TCP, or
+ *  PUBACK at QoS 1) the samples that piled up meanwhile are batched, up to
+ *  WS_MQTT_BATCH_MAX lines per PUBLISH, so a slow link gets fewer and larger
+ *  messages instead of a growing backlog. A full queue pushes out the oldest
+ *  sample set.
+ *
+ *  At QoS 1 up to WS_MQTT_INFLIGHT PUBLISHes wait for their PUBACK. They are
+ *  sent again, marked DUP, after a reconnect.
+ *
+ *  A lost connection, a refused CONNECT and a missing CONNACK or PINGRESP
+ *  are retried after a backoff that doubles from WS_MQTT_BACKOFF_MIN_MS to
+ *  WS_MQTT_BACKOFF_MAX_MS, with a quarter of jitter, and starts over with
+ *  the next CONNACK.
+ *
+ *  The broker defaults to the gateway DHCP handed out, build with
+ *
+ *      WS_MQTT_BROKER(a)=IP4_ADDR((a),192,168,1,10)
+ *
+ *  to name one, WS_MQTT_QOS=0 for QoS 0, or WS_MQTT_PORT=0 to publish
+ *  nothing. */
+//*****************************************************************************
+
+#ifndef WS_MQTT_PORT
+#define WS_MQTT_PORT			1883
+#endif
+
+#ifndef WS_MQTT_QOS
+#define WS_MQTT_QOS				1
+#endif
+
+#define WS_MQTT_CLIENT_ID		"weather_station"
+#define WS_MQTT_TOPIC_PREFIX	"weather_station/"
+#define WS_MQTT_KEEPALIVE_S		60
+
+#define WS_MQTT_QUEUE			32		/* Sample sets, power of two */
+#define WS_MQTT_BATCH_MAX		16		/* Samples per PUBLISH */
+#define WS_MQTT_INFLIGHT		8		/* QoS 1 PUBLISHes without PUBACK, power of two */
+#define WS_MQTT_MSG_LEN			512		/* Longest PUBLISH */
+
+#define WS_MQTT_CONNECT_MS		10000	/* Connect to CONNACK */
+#define WS_MQTT_BACKOFF_MIN_MS	1000
+#define WS_MQTT_BACKOFF_MAX_MS	60000
+
+typedef struct {
+	uint32_t ui32Connects;		/* CONNACKs accepted */
+	uint32_t ui32Failures;		/* Connections lost or not made */
+	uint32_t ui32Publishes;
+	uint32_t ui32Samples;		/* Lines in the PUBLISHes */
+	uint32_t ui32MaxBatch;		/* Most lines in one PUBLISH */
+	uint32_t ui32Acked;			/* PUBACKs */
+	uint32_t ui32Resent;		/* PUBLISHes sent again after a reconnect */
+	uint32_t ui32Overrun;		/* Sample sets pushed out of a full queue */
+	uint32_t ui32BackoffMs;		/* Wait before the next attempt, 0 if connected */
+	bool bConnected;
+}WS_MqttStats_t;
+
+extern WS_MqttStats_t MqttStats;
+
+/* Publish to another broker, or at another QoS, from the next connection
+ * on. ui32Broker is the address as lwIP keeps it, in network byte order, 0
+ * for the built-in one. Call before lwIPInit or from lwIP context. */
+void mqttConfigure(uint32_t ui32Broker, uint16_t ui16Port, uint8_t ui8QoS);
+
+/* Queue a sample set, values in thousandths of temperature, humidity,
+ * pressure and light, taken at the tickNowUs time ui64TimeUs. Called from
+ * main. */
+void mqttPublish(uint64_t ui64TimeUs, const int32_t *pi32Values, uint32_t ui32Channels);
+
+/* Connect, keep alive and send, called from lwIPHostTimerHandler */
+void mqttTick(void);
+
+#endif /* WEATHER_STATION_WS_MQTT_H_ */
@@ -0,0 +1,310 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#include "utils/lwiplib.h"
+#include "utils/uartstdio.h"
+#include "utils/ustdlib.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+#include "ws_http.h"
+#include "ws_mcast.h"
+#include "ws_mqtt.h"
+#include "ws_coap.h"
+#include "ws_deadband.h"
+#include "ws_netstats.h"
+
+#if !LWIP_STATS || !MEM_STATS || !MEMP_STATS
+#error "ws_netstats needs LWIP_STATS, MEM_STATS and MEMP_STATS in lwipopts.h"
+#endif
+
+volatile uint32_t FsOpenAllocFail;
+
+/* Pool names from the same list lwIP builds its pools from */
+static const char * const NetStatsPoolNames[MEMP_MAX] =
+{
+#define LWIP_MEMPOOL(name, num, size, desc)		#name,
+#include "lwip/memp_std.h"
+};
+
+/* Deadband channels */
+#define NETSTATS_SENSORS		NETSTATS_SENSOR("temperature")	\
+								NETSTATS_SENSOR("humidity")		\
+								NETSTATS_SENSOR("pressure")		\
+								NETSTATS_SENSOR("light")
+#define NETSTATS_SENSOR_LEN		11
+
+#define NETSTATS_SENSOR(s)		s,
+static const char * const NetStatsSensorNames[WS_DEADBAND_CHANNELS] =
+{
+	NETSTATS_SENSORS
+};
+#undef NETSTATS_SENSOR
+
+/* The counters after the pools */
+#define NETSTATS_FS				"# TYPE ws_fs_open_alloc_failures_total counter\n" \
+								"ws_fs_open_alloc_failures_total %u\n"
+#define NETSTATS_HTTP			"# TYPE ws_http_connections_total counter\n" \
+								"ws_http_connections_total %u\n" \
+								"# TYPE ws_http_requests_total counter\n" \
+								"ws_http_requests_total{connection=\"new\"} %u\n" \
+								"ws_http_requests_total{connection=\"reused\"} %u\n" \
+								"# TYPE ws_http_pipelined_requests_total counter\n" \
+								"ws_http_pipelined_requests_total %u\n"
+#define NETSTATS_HTTP_CLOSED	"# TYPE ws_http_closed_total counter\n" \
+								"ws_http_closed_total{reason=\"idle\"} %u\n" \
+								"ws_http_closed_total{reason=\"evicted\"} %u\n" \
+								"ws_http_closed_total{reason=\"refused\"} %u\n" \
+								"# TYPE ws_http_open_connections gauge\n" \
+								"ws_http_open_connections %u\n" \
+								"# TYPE ws_http_open_connections_max gauge\n" \
+								"ws_http_open_connections_max %u\n"
+#define NETSTATS_MCAST			"# TYPE ws_mcast_samples_total counter\n" \
+								"ws_mcast_samples_total{result=\"sent\"} %u\n" \
+								"ws_mcast_samples_total{result=\"overrun\"} %u\n" \
+								"ws_mcast_samples_total{result=\"error\"} %u\n"
+#define NETSTATS_MQTT			"# TYPE ws_mqtt_connected gauge\n" \
+								"ws_mqtt_connected %u\n" \
+								"# TYPE ws_mqtt_connects_total counter\n" \
+								"ws_mqtt_connects_total{result=\"ok\"} %u\n" \
+								"ws_mqtt_connects_total{result=\"failed\"} %u\n" \
+								"# TYPE ws_mqtt_backoff_ms gauge\n" \
+								"ws_mqtt_backoff_ms %u\n"
+#define NETSTATS_MQTT_PUBLISH	"# TYPE ws_mqtt_publishes_total counter\n" \
+								"ws_mqtt_publishes_total{kind=\"new\"} %u\n" \
+								"ws_mqtt_publishes_total{kind=\"resent\"} %u\n" \
+								"# TYPE ws_mqtt_puback_total counter\n" \
+								"ws_mqtt_puback_total %u\n" \
+								"# TYPE ws_mqtt_samples_total counter\n" \
+								"ws_mqtt_samples_total{result=\"sent\"} %u\n" \
+								"ws_mqtt_samples_total{result=\"overrun\"} %u\n" \
+								"# TYPE ws_mqtt_batch_max gauge\n" \
+								"ws_mqtt_batch_max %u\n"
+#define NETSTATS_COAP			"# TYPE ws_coap_requests_total counter\n" \
+								"ws_coap_requests_total %u\n" \
+								"# TYPE ws_coap_notifications_total counter\n" \
+								"ws_coap_notifications_total %u\n" \
+								"# TYPE ws_coap_sent_bytes_total counter\n" \
+								"ws_coap_sent_bytes_total %u\n" \
+								"# TYPE ws_coap_observers gauge\n" \
+								"ws_coap_observers %u\n"
+#define NETSTATS_COAP_DROPPED	"# TYPE ws_coap_observers_dropped_total counter\n" \
+								"ws_coap_observers_dropped_total{reason=\"refused\"} %u\n" \
+								"ws_coap_observers_dropped_total{reason=\"timeout\"} %u\n" \
+								"ws_coap_observers_dropped_total{reason=\"reset\"} %u\n" \
+								"# TYPE ws_coap_errors_total counter\n" \
+								"ws_coap_errors_total %u\n"
+#define NETSTATS_PUBLISH_TYPE	"# TYPE ws_publish_updates_total counter\n"
+#define NETSTATS_PUBLISH		"ws_publish_updates_total{sensor=\"%s\",result=\"published\"} %u\n" \
+								"ws_publish_updates_total{sensor=\"%s\",result=\"heartbeat\"} %u\n" \
+								"ws_publish_updates_total{sensor=\"%s\",result=\"suppressed\"} %u\n"
+
+/* Values they print, a %u becomes up to 10 digits */
+#define NETSTATS_FIXED_VALUES	31
+
+/* WS_NETSTATS_FORMAT_MAX has to cover the output, an array of negative size
+ * stops the build: no pool or sensor name longer than assumed, and the
+ * counters after the pools within WS_NETSTATS_FIXED_LEN. */
+#define LWIP_MEMPOOL(name, num, size, desc)		+ ((sizeof(#name) - 1) > WS_NETSTATS_POOL_NAME_LEN)
+typedef char NetStatsPoolCheck[(0
+#include "lwip/memp_std.h"
+							   ) ? -1 : 1];
+#define NETSTATS_SENSOR(s)		+ ((sizeof(s) - 1) > NETSTATS_SENSOR_LEN)
+typedef char NetStatsSensorCheck[(0 NETSTATS_SENSORS) ? -1 : 1];
+#undef NETSTATS_SENSOR
+typedef char NetStatsFixedCheck[((sizeof(NETSTATS_FS NETSTATS_HTTP NETSTATS_HTTP_CLOSED NETSTATS_MCAST NETSTATS_MQTT
+										 NETSTATS_MQTT_PUBLISH NETSTATS_COAP NETSTATS_COAP_DROPPED
+										 NETSTATS_PUBLISH_TYPE) - 1 + 8 * NETSTATS_FIXED_VALUES +
+								  WS_DEADBAND_CHANNELS * (sizeof(NETSTATS_PUBLISH) - 1 + 3 * 8 +
+														  3 * (NETSTATS_SENSOR_LEN - 2))) <=
+								 WS_NETSTATS_FIXED_LEN) ? 1 : -1];
+
+static uint32_t NetStatsElapsedMs;
+static uint32_t NetStatsLastErrors;
+
+/* Append to the buffer, a full buffer truncates instead of overrunning */
+static int netStatsAppend(char *pcBuf, int iBufLen, int iLen, const char *pcFormat, ...)
+{
+	va_list vaArgP;
+
+	if(iLen >= (iBufLen - 1))
+	{
+		return(iLen);
+	}
+
+	va_start(vaArgP, pcFormat);
+	iLen += uvsnprintf(pcBuf + iLen, iBufLen - iLen, pcFormat, vaArgP);
+	va_end(vaArgP);
+
+	return((iLen < iBufLen) ? iLen : (iBufLen - 1));
+}
+
+/* Statistics of the heap (index MEMP_MAX) or of a pool */
+static const struct stats_mem *netStatsGet(uint32_t ui32Index, const char **ppcName)
+{
+	if(ui32Index == MEMP_MAX)
+	{
+		*ppcName = "HEAP";
+		return(&lwip_stats.mem);
+	}
+
+	*ppcName = NetStatsPoolNames[ui32Index];
+	return(&lwip_stats.memp[ui32Index]);
+}
+
+static uint32_t netStatsErrors(void)
+{
+	uint32_t ui32Index, ui32Errors;
+
+	ui32Errors = lwip_stats.mem.err + FsOpenAllocFail;
+	for(ui32Index = 0; ui32Index < MEMP_MAX; ui32Index++)
+	{
+		ui32Errors += lwip_stats.memp[ui32Index].err;
+	}
+
+	return(ui32Errors);
+}
+
+int netStatsFormat(char *pcBuf, int iBufLen)
+{
+	static const struct {
+		const char *pcName;
+		const char *pcType;
+	}psFamilies[4] =
+	{
+		{ "ws_lwip_mem_avail", "gauge" },
+		{ "ws_lwip_mem_used", "gauge" },
+		{ "ws_lwip_mem_max", "gauge" },
+		{ "ws_lwip_mem_alloc_failures_total", "counter" }
+	};
+	const struct stats_mem *psStats;
+	const WS_DeadbandStats_t *psDeadband;
+	const char *pcName;
+	uint32_t ui32Family, ui32Index, ui32Value;
+	int iLen = 0;
+
+	/* Every family lists the heap and all pools, capacity in bytes for the
+	 * heap and in elements for the pools */
+	for(ui32Family = 0; ui32Family < 4; ui32Family++)
+	{
+		iLen = netStatsAppend(pcBuf, iBufLen, iLen, "# TYPE %s %s\n",
+							  psFamilies[ui32Family].pcName, psFamilies[ui32Family].pcType);
+		for(ui32Index = 0; ui32Index <= MEMP_MAX; ui32Index++)
+		{
+			psStats = netStatsGet(ui32Index, &pcName);
+			switch(ui32Family)
+			{
+				case 0:
+					ui32Value = psStats->avail;
+					break;
+				case 1:
+					ui32Value = psStats->used;
+					break;
+				case 2:
+					ui32Value = psStats->max;
+					break;
+				default:
+					ui32Value = psStats->err;
+					break;
+			};
+			iLen = netStatsAppend(pcBuf, iBufLen, iLen, "%s{pool=\"%s\"} %u\n",
+								  psFamilies[ui32Family].pcName, pcName, ui32Value);
+		}
+	}
+
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_FS, FsOpenAllocFail);
+
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_HTTP,
+						  HttpStats.ui32Accepted, HttpStats.ui32Requests - HttpStats.ui32Reused,
+						  HttpStats.ui32Reused, HttpStats.ui32Pipelined);
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_HTTP_CLOSED,
+						  HttpStats.ui32IdleClosed, HttpStats.ui32Evicted, HttpStats.ui32Refused,
+						  HttpStats.ui32Open, HttpStats.ui32MaxOpen);
+
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_MCAST,
+						  McastStats.ui32Sent, McastStats.ui32Overrun, McastStats.ui32Errors);
+
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_MQTT,
+						  MqttStats.bConnected, MqttStats.ui32Connects, MqttStats.ui32Failures,
+						  MqttStats.ui32BackoffMs);
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_MQTT_PUBLISH,
+						  MqttStats.ui32Publishes, MqttStats.ui32Resent, MqttStats.ui32Acked,
+						  MqttStats.ui32Samples, MqttStats.ui32Overrun, MqttStats.ui32MaxBatch);
+
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_COAP,
+						  CoapStats.ui32Requests, CoapStats.ui32Notifications, CoapStats.ui32TxBytes,
+						  CoapStats.ui32Observers);
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_COAP_DROPPED,
+						  CoapStats.ui32Refused, CoapStats.ui32Timeouts, CoapStats.ui32Resets,
+						  CoapStats.ui32Errors);
+
+	/* Refreshes of the published measurements, per sensor */
+	iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_PUBLISH_TYPE);
+	for(ui32Index = 0; ui32Index < WS_DEADBAND_CHANNELS; ui32Index++)
+	{
+		psDeadband = &PublishDeadband.psStats[ui32Index];
+		iLen = netStatsAppend(pcBuf, iBufLen, iLen, NETSTATS_PUBLISH,
+							  NetStatsSensorNames[ui32Index], psDeadband->ui32Published,
+							  NetStatsSensorNames[ui32Index], psDeadband->ui32Heartbeats,
+							  NetStatsSensorNames[ui32Index], psDeadband->ui32Suppressed);
+	}
+
+	return(iLen);
+}
+
+void netStatsPrint(void)
+{
+	const struct stats_mem *psStats;
+	const WS_DeadbandStats_t *psDeadband;
+	const char *pcName;
+	uint32_t ui32Index;
+
+	UARTprintf("lwIP memory (avail/used/max/fail):\n");
+	for(ui32Index = 0; ui32Index <= MEMP_MAX; ui32Index++)
+	{
+		psStats = netStatsGet(ui32Index, &pcName);
+		UARTprintf("  %s: %u/%u/%u/%u\n", pcName, psStats->avail, psStats->used,
+				   psStats->max, psStats->err);
+	}
+	UARTprintf("fs_open alloc failures: %u\n", FsOpenAllocFail);
+	UARTprintf("HTTP connections/requests/reused/pipelined: %u/%u/%u/%u, open %u (max %u)\n",
+			   HttpStats.ui32Accepted, HttpStats.ui32Requests, HttpStats.ui32Reused,
+			   HttpStats.ui32Pipelined, HttpStats.ui32Open, HttpStats.ui32MaxOpen);
+	UARTprintf("Multicast samples sent/overrun/errors: %u/%u/%u\n", McastStats.ui32Sent,
+			   McastStats.ui32Overrun, McastStats.ui32Errors);
+	UARTprintf("MQTT %s, connects/failures: %u/%u, publishes/resent/acked: %u/%u/%u, "
+			   "samples/overrun: %u/%u (batch max %u)\n",
+			   MqttStats.bConnected ? "connected" : "disconnected", MqttStats.ui32Connects,
+			   MqttStats.ui32Failures, MqttStats.ui32Publishes, MqttStats.ui32Resent,
+			   MqttStats.ui32Acked, MqttStats.ui32Samples, MqttStats.ui32Overrun,
+			   MqttStats.ui32MaxBatch);
+	UARTprintf("CoAP requests/notifications: %u/%u (%u bytes), observers %u, "
+			   "refused/timeouts/resets/errors: %u/%u/%u/%u\n", CoapStats.ui32Requests,
+			   CoapStats.ui32Notifications, CoapStats.ui32TxBytes, CoapStats.ui32Observers,
+			   CoapStats.ui32Refused, CoapStats.ui32Timeouts, CoapStats.ui32Resets,
+			   CoapStats.ui32Errors);
+	UARTprintf("Published/heartbeat/suppressed:");
+	for(ui32Index = 0; ui32Index < WS_DEADBAND_CHANNELS; ui32Index++)
+	{
+		psDeadband = &PublishDeadband.psStats[ui32Index];
+		UARTprintf(" %s %u/%u/%u", NetStatsSensorNames[ui32Index], psDeadband->ui32Published,
+				   psDeadband->ui32Heartbeats, psDeadband->ui32Suppressed);
+	}
+	UARTprintf("\n");
+}
+
+void netStatsTick(uint32_t ui32ElapsedMs)
+{
+	uint32_t ui32Errors;
+
+	NetStatsElapsedMs += ui32ElapsedMs;
+	ui32Errors = netStatsErrors();
+
+	if( (NetStatsElapsedMs >= WS_NETSTATS_UART_PERIOD_MS) || (ui32Errors != NetStatsLastErrors) )
+	{
+		NetStatsElapsedMs = 0;
+		NetStatsLastErrors = ui32Errors;
+		netStatsPrint();
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef WEATHER_STATION_WS_NETSTATS_H_
+#define WEATHER_STATION_WS_NETSTATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lwip/memp.h"
+
+//*****************************************************************************
+/*  lwIP memory statistics.
+ *
+ *  lwIP counts, with MEM_STATS and MEMP_STATS on, the current use, the high
+ *  water mark and the failed allocations of the mem heap and of every memp
+ *  pool. These functions report them, together with the connection counts
+ *  of the HTTP server, the samples of the multicast and MQTT publishers and
+ *  of the CoAP server, and the refreshes the deadband published or
+ *  suppressed.
+ *
+ *  They are meant for sizing MEM_SIZE and the MEMP_NUM_x values in
+ *  lwipopts.h from traffic: run the host build under load, for instance
+ *  ./build/loadgen -c 16 -d 30, and read the max and alloc failure
+ *  columns. The values in lwipopts.h have not been sized that way yet. */
+//*****************************************************************************
+
+/* Period of the statistics dump on the UART */
+#define WS_NETSTATS_UART_PERIOD_MS		60000
+
+/* Longest lwIP pool name, and the most the counters after the pools take,
+ * ws_netstats.c does not compile with longer ones */
+#define WS_NETSTATS_POOL_NAME_LEN		15
+#define WS_NETSTATS_FIXED_LEN			3200
+
+/* Longest output of netStatsFormat: four families of at most 32 characters
+ * over the heap and every pool, with 10 digit values, then the counters */
+#define WS_NETSTATS_FORMAT_MAX			(WS_NETSTATS_FIXED_LEN + \
+										 4 * (48 + (MEMP_MAX + 1) * (53 + WS_NETSTATS_POOL_NAME_LEN)))
+
+/* fs_open could not allocate its fs_file */
+extern volatile uint32_t FsOpenAllocFail;
+
+/* Write the statistics in Prometheus text format, returns the length.
+ * WS_NETSTATS_FORMAT_MAX bytes hold it all. */
+int netStatsFormat(char *pcBuf, int iBufLen);
+
+/* Print the statistics on the UART. */
+void netStatsPrint(void);
+
+/* Call every ui32ElapsedMs, prints every WS_NETSTATS_UART_PERIOD_MS and
+ * right away when an allocation failed since the last print. */
+void netStatsTick(uint32_t ui32ElapsedMs);
+
+#endif /* WEATHER_STATION_WS_NETSTATS_H_ */
@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_packet.h"
+
+static void packetPut32(uint8_t *pui8Data, uint32_t ui32Value)
+{
+	pui8Data[0] = (uint8_t)(ui32Value >> 24);
+	pui8Data[1] = (uint8_t)(ui32Value >> 16);
+	pui8Data[2] = (uint8_t)(ui32Value >> 8);
+	pui8Data[3] = (uint8_t)ui32Value;
+}
+
+static uint32_t packetGet32(const uint8_t *pui8Data)
+{
+	return(((uint32_t)pui8Data[0] << 24) | ((uint32_t)pui8Data[1] << 16) |
+		   ((uint32_t)pui8Data[2] << 8) | pui8Data[3]);
+}
+
+uint32_t packetEncode(uint8_t *pui8Buf, uint32_t ui32Size, const WS_Packet_t *psPacket)
+{
+	uint32_t ui32Ch, ui32Len;
+
+	ui32Len = WS_PACKET_HEADER_LEN + 4 * psPacket->ui32Channels;
+	if((psPacket->ui32Channels > WS_PACKET_CHANNELS) || (ui32Len > ui32Size))
+	{
+		return(0);
+	}
+
+	pui8Buf[0] = WS_PACKET_MAGIC0;
+	pui8Buf[1] = WS_PACKET_MAGIC1;
+	pui8Buf[2] = WS_PACKET_VERSION;
+	pui8Buf[3] = (uint8_t)psPacket->ui32Channels;
+	packetPut32(pui8Buf + 4, psPacket->ui32Sequence);
+	packetPut32(pui8Buf + 8, (uint32_t)(psPacket->ui64TimeUs >> 32));
+	packetPut32(pui8Buf + 12, (uint32_t)psPacket->ui64TimeUs);
+	packetPut32(pui8Buf + 16, (uint32_t)(psPacket->ui64UnixMs >> 32));
+	packetPut32(pui8Buf + 20, (uint32_t)psPacket->ui64UnixMs);
+	for(ui32Ch = 0; ui32Ch < psPacket->ui32Channels; ui32Ch++)
+	{
+		packetPut32(pui8Buf + WS_PACKET_HEADER_LEN + 4 * ui32Ch,
+					(uint32_t)psPacket->pi32Values[ui32Ch]);
+	}
+
+	return(ui32Len);
+}
+
+bool packetDecode(const uint8_t *pui8Buf, uint32_t ui32Len, WS_Packet_t *psPacket)
+{
+	uint32_t ui32Ch;
+
+	if((ui32Len < WS_PACKET_HEADER_LEN) || (pui8Buf[0] != WS_PACKET_MAGIC0) ||
+	   (pui8Buf[1] != WS_PACKET_MAGIC1) || (pui8Buf[2] != WS_PACKET_VERSION) ||
+	   (ui32Len < (WS_PACKET_HEADER_LEN + 4u * pui8Buf[3])))
+	{
+		return(false);
+	}
+
+	/* Channels this side does not know are skipped */
+	psPacket->ui32Channels = pui8Buf[3];
+	if(psPacket->ui32Channels > WS_PACKET_CHANNELS)
+	{
+		psPacket->ui32Channels = WS_PACKET_CHANNELS;
+	}
+
+	psPacket->ui32Sequence = packetGet32(pui8Buf + 4);
+	psPacket->ui64TimeUs = ((uint64_t)packetGet32(pui8Buf + 8) << 32) | packetGet32(pui8Buf + 12);
+	psPacket->ui64UnixMs = ((uint64_t)packetGet32(pui8Buf + 16) << 32) | packetGet32(pui8Buf + 20);
+	for(ui32Ch = 0; ui32Ch < psPacket->ui32Channels; ui32Ch++)
+	{
+		psPacket->pi32Values[ui32Ch] = (int32_t)packetGet32(pui8Buf + WS_PACKET_HEADER_LEN + 4 * ui32Ch);
+	}
+
+	return(true);
+}
@@ -0,0 +1,51 @@
+#ifndef WEATHER_STATION_WS_PACKET_H_
+#define WEATHER_STATION_WS_PACKET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Sample datagram of the multicast publisher (ws_mcast.h), shared with the
+ *  receivers on the hosts. It has no hardware or lwIP dependency.
+ *
+ *  All fields are big endian:
+ *
+ *       0  magic     "WS"
+ *       2  version   WS_PACKET_VERSION
+ *       3  channels  number of values that follow
+ *       4  sequence  32 bit, one more for each sample the station published
+ *       8  time      64 bit, acquisition time, microseconds of uptime
+ *      16  unix      64 bit, the same time in milliseconds since 1970, 0
+ *                    while the wall clock is not set
+ *      24  values    32 bit signed each, thousandths of the unit:
+ *                    temperature, humidity, pressure, light
+ *
+ *  A receiver takes the values it knows and ignores any further ones, so
+ *  channels can be added without a new version. The sequence starts over
+ *  when the station restarts; the uptime going back tells a restart from
+ *  datagrams that arrived out of order. */
+//*****************************************************************************
+
+#define WS_PACKET_MAGIC0		'W'
+#define WS_PACKET_MAGIC1		'S'
+#define WS_PACKET_VERSION		1
+#define WS_PACKET_HEADER_LEN	24
+#define WS_PACKET_CHANNELS		4		/* Temperature, humidity, pressure, light */
+#define WS_PACKET_MAX_LEN		(WS_PACKET_HEADER_LEN + 4 * WS_PACKET_CHANNELS)
+
+typedef struct {
+	uint32_t ui32Sequence;
+	uint64_t ui64TimeUs;			/* Uptime */
+	uint64_t ui64UnixMs;			/* 0 if unknown */
+	uint32_t ui32Channels;			/* Values filled in */
+	int32_t pi32Values[WS_PACKET_CHANNELS];
+}WS_Packet_t;
+
+/* Encode a sample, returns the length, 0 if it does not fit in ui32Size */
+uint32_t packetEncode(uint8_t *pui8Buf, uint32_t ui32Size, const WS_Packet_t *psPacket);
+
+/* Decode a datagram. False if it is not a sample datagram of this version
+ * or is cut short. */
+bool packetDecode(const uint8_t *pui8Buf, uint32_t ui32Len, WS_Packet_t *psPacket);
+
+#endif /* WEATHER_STATION_WS_PACKET_H_ */
@@ -0,0 +1,130 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#include "utils/ustdlib.h"
+
+#include "ws_probe.h"
+
+WS_ProbeStats_t ProbeStats[WS_NUM_PROBES];
+
+/* Headers and type lines of probeFormat, and its bucket line */
+#define PROBE_HEAD				"# HELP ws_probe_cycles Duration of instrumented code paths in CPU cycles.\n" \
+								"# TYPE ws_probe_cycles histogram\n"
+#define PROBE_MIN_HEAD			"# TYPE ws_probe_cycles_min gauge\n"
+#define PROBE_MAX_HEAD			"# TYPE ws_probe_cycles_max gauge\n"
+#define PROBE_BUCKET_LINE		"ws_probe_cycles_bucket{probe=\"%s\",le=\"%u\"} %u\n"
+
+/* Names in WS_Probe_t order */
+#define PROBE_NAMES				PROBE_NAME("systick")			\
+								PROBE_NAME("i2c_int")			\
+								PROBE_NAME("i2c_transaction")	\
+								PROBE_NAME("fs_open")			\
+								PROBE_NAME("send_data")			\
+								PROBE_NAME("process_sample")	\
+								PROBE_NAME("mqtt")
+
+/* WS_PROBE_FORMAT_MAX has to cover them: the type lines, no name longer than
+ * WS_PROBE_NAME_LEN and the bucket line, whose two %u become 10 digits each.
+ * An array of negative size stops the build. */
+#define PROBE_NAME(s)			+ ((sizeof(s) - 1) > WS_PROBE_NAME_LEN)
+typedef char ProbeTypesCheck[((sizeof(PROBE_HEAD PROBE_MIN_HEAD PROBE_MAX_HEAD) - 1) <=
+							  WS_PROBE_TYPES_LEN) ? 1 : -1];
+typedef char ProbeNameCheck[(0 PROBE_NAMES) ? -1 : 1];
+typedef char ProbeLineCheck[((sizeof(PROBE_BUCKET_LINE) - 1 - 6 + WS_PROBE_NAME_LEN + 20) <=
+							 WS_PROBE_LINE_MAX) ? 1 : -1];
+#undef PROBE_NAME
+
+#define PROBE_NAME(s)			s,
+static const char * const ProbeNames[WS_NUM_PROBES] =
+{
+	PROBE_NAMES
+};
+#undef PROBE_NAME
+
+const char *probeName(WS_Probe_t eProbe)
+{
+	return(ProbeNames[eProbe]);
+}
+
+/* Append to the buffer, a full buffer truncates instead of overrunning */
+static int probeAppend(char *pcBuf, int iBufLen, int iLen, const char *pcFormat, ...)
+{
+	va_list vaArgP;
+
+	if(iLen >= (iBufLen - 1))
+	{
+		return(iLen);
+	}
+
+	va_start(vaArgP, pcFormat);
+	iLen += uvsnprintf(pcBuf + iLen, iBufLen - iLen, pcFormat, vaArgP);
+	va_end(vaArgP);
+
+	return((iLen < iBufLen) ? iLen : (iBufLen - 1));
+}
+
+int probeFormat(char *pcBuf, int iBufLen)
+{
+	WS_ProbeStats_t sStats;
+	uint32_t ui32Probe, ui32Bucket, ui32Last, ui32Cumulative;
+	int iLen;
+
+	iLen = probeAppend(pcBuf, iBufLen, 0, PROBE_HEAD);
+
+	for(ui32Probe = 0; ui32Probe < WS_NUM_PROBES; ui32Probe++)
+	{
+		/* Work on a copy, the probe may be updated by an interrupt meanwhile */
+		sStats = ProbeStats[ui32Probe];
+
+		/* Buckets up to the highest one in use, the rest is covered by +Inf */
+		ui32Last = 0;
+		for(ui32Bucket = 0; ui32Bucket < (WS_PROBE_BUCKETS - 1); ui32Bucket++)
+		{
+			if(sStats.pui32Hist[ui32Bucket])
+			{
+				ui32Last = ui32Bucket;
+			}
+		}
+
+		ui32Cumulative = 0;
+		for(ui32Bucket = 0; ui32Bucket <= ui32Last; ui32Bucket++)
+		{
+			ui32Cumulative += sStats.pui32Hist[ui32Bucket];
+			iLen = probeAppend(pcBuf, iBufLen, iLen, PROBE_BUCKET_LINE, ProbeNames[ui32Probe],
+							   (1u << ui32Bucket) - 1, ui32Cumulative);
+		}
+		iLen = probeAppend(pcBuf, iBufLen, iLen, "ws_probe_cycles_bucket{probe=\"%s\",le=\"+Inf\"} %u\n",
+						   ProbeNames[ui32Probe], sStats.ui32Count);
+
+		/* usnprintf has no 64 bit conversion, print the sum in two halves */
+		if(sStats.ui64Sum >= 1000000000u)
+		{
+			iLen = probeAppend(pcBuf, iBufLen, iLen, "ws_probe_cycles_sum{probe=\"%s\"} %u%09u\n",
+							   ProbeNames[ui32Probe], (uint32_t)(sStats.ui64Sum / 1000000000u),
+							   (uint32_t)(sStats.ui64Sum % 1000000000u));
+		}
+		else
+		{
+			iLen = probeAppend(pcBuf, iBufLen, iLen, "ws_probe_cycles_sum{probe=\"%s\"} %u\n",
+							   ProbeNames[ui32Probe], (uint32_t)sStats.ui64Sum);
+		}
+		iLen = probeAppend(pcBuf, iBufLen, iLen, "ws_probe_cycles_count{probe=\"%s\"} %u\n",
+						   ProbeNames[ui32Probe], sStats.ui32Count);
+	}
+
+	iLen = probeAppend(pcBuf, iBufLen, iLen, PROBE_MIN_HEAD);
+	for(ui32Probe = 0; ui32Probe < WS_NUM_PROBES; ui32Probe++)
+	{
+		iLen = probeAppend(pcBuf, iBufLen, iLen, "ws_probe_cycles_min{probe=\"%s\"} %u\n",
+						   ProbeNames[ui32Probe], ProbeStats[ui32Probe].ui32Min);
+	}
+	iLen = probeAppend(pcBuf, iBufLen, iLen, PROBE_MAX_HEAD);
+	for(ui32Probe = 0; ui32Probe < WS_NUM_PROBES; ui32Probe++)
+	{
+		iLen = probeAppend(pcBuf, iBufLen, iLen, "ws_probe_cycles_max{probe=\"%s\"} %u\n",
+						   ProbeNames[ui32Probe], ProbeStats[ui32Probe].ui32Max);
+	}
+
+	return(iLen);
+}
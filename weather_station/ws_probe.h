@@ -0,0 +1,103 @@
+#ifndef WEATHER_STATION_WS_PROBE_H_
+#define WEATHER_STATION_WS_PROBE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_cycles.h"
+
+//*****************************************************************************
+/*  Timing probes on the hot paths.
+ *
+ *  A probe is a start stamp taken with probeStart() and handed back to
+ *  probeEnd() at the end of the measured section. probeEnd() keeps count,
+ *  sum, min, max and a power of two histogram of the durations, in cycles
+ *  (nanoseconds on the host). The start is one load of the DWT counter, the
+ *  end a handful of integer operations and one CLZ, no locks: every probe is
+ *  updated from one execution context only. */
+//*****************************************************************************
+
+typedef enum {
+	WS_ProbeSysTick,			/* SysTickIntHandler */
+	WS_ProbeI2CInt,				/* I2C interrupt handlers */
+	WS_ProbeI2CTransaction,		/* Sensor transaction, start to callback */
+	WS_ProbeFsOpen,				/* fs_open, every HTTP request */
+	WS_ProbeSendData,			/* io_send_data */
+	WS_ProbeProcessSample,		/* processSample */
+	WS_ProbeMqtt,				/* MQTT publisher, lwIP context */
+	WS_NUM_PROBES
+}WS_Probe_t;
+
+/* Histogram bucket k counts durations below 2^k, the last one the rest */
+#define WS_PROBE_BUCKETS		24
+
+/* Longest probe name and the type lines of probeFormat, ws_probe.c does
+ * not compile with longer ones */
+#define WS_PROBE_NAME_LEN		15
+#define WS_PROBE_TYPES_LEN		176
+
+/* Longest line of probeFormat: a bucket line with the longest name and two
+ * 10 digit values, the sum line with its 20 digits is shorter */
+#define WS_PROBE_LINE_MAX		(60 + WS_PROBE_NAME_LEN)
+
+/* Longest output of probeFormat: the type lines, and every probe with all
+ * its bucket lines, +Inf, sum, count, min and max */
+#define WS_PROBE_FORMAT_MAX		(WS_PROBE_TYPES_LEN + WS_NUM_PROBES * (WS_PROBE_BUCKETS + 4) * WS_PROBE_LINE_MAX)
+
+typedef struct {
+	uint32_t ui32Count;
+	uint32_t ui32Min;
+	uint32_t ui32Max;
+	uint64_t ui64Sum;
+	uint32_t pui32Hist[WS_PROBE_BUCKETS];
+}WS_ProbeStats_t;
+
+extern WS_ProbeStats_t ProbeStats[WS_NUM_PROBES];
+
+/* Count leading zeros, a single instruction on the Cortex-M4 */
+#if defined(__TI_COMPILER_VERSION__)
+#define WS_PROBE_CLZ(x)			_norm(x)
+#else
+#define WS_PROBE_CLZ(x)			__builtin_clz(x)
+#endif
+
+static inline uint32_t probeStart(void)
+{
+	return(cyclesGet());
+}
+
+static inline void probeEnd(WS_Probe_t eProbe, uint32_t ui32Start)
+{
+	WS_ProbeStats_t *psStats = &ProbeStats[eProbe];
+	uint32_t ui32Cycles = cyclesGet() - ui32Start;
+	uint32_t ui32Bucket;
+
+	/* First set bit gives the power of two, 0 lands in bucket 0 */
+	ui32Bucket = ui32Cycles ? (32 - WS_PROBE_CLZ(ui32Cycles)) : 0;
+	if(ui32Bucket >= WS_PROBE_BUCKETS)
+	{
+		ui32Bucket = WS_PROBE_BUCKETS - 1;
+	}
+	psStats->pui32Hist[ui32Bucket]++;
+
+	/* A zero count marks min as unset */
+	if((psStats->ui32Count == 0) || (ui32Cycles < psStats->ui32Min))
+	{
+		psStats->ui32Min = ui32Cycles;
+	}
+	if(ui32Cycles > psStats->ui32Max)
+	{
+		psStats->ui32Max = ui32Cycles;
+	}
+	psStats->ui32Count++;
+	psStats->ui64Sum += ui32Cycles;
+}
+
+/* Prometheus name label of a probe */
+const char *probeName(WS_Probe_t eProbe);
+
+/* Write every probe in Prometheus text format, returns the length.
+ * WS_PROBE_FORMAT_MAX bytes hold it all. */
+int probeFormat(char *pcBuf, int iBufLen);
+
+#endif /* WEATHER_STATION_WS_PROBE_H_ */
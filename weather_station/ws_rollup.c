@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ws_rollup.h"
+
+static WS_RollupBucket_t Rollup1s[WS_ROLLUP_1S_SIZE];
+static WS_RollupBucket_t Rollup1m[WS_ROLLUP_1M_SIZE];
+static WS_RollupBucket_t Rollup10m[WS_ROLLUP_10M_SIZE];
+static WS_RollupBucket_t Rollup1h[WS_ROLLUP_1H_SIZE];
+
+static WS_RollupLevel_t RollupLevels[WS_ROLLUP_LEVELS] =
+{
+	{ 1,	WS_ROLLUP_1S_SIZE,	Rollup1s },
+	{ 60,	WS_ROLLUP_1M_SIZE,	Rollup1m },
+	{ 600,	WS_ROLLUP_10M_SIZE,	Rollup10m },
+	{ 3600,	WS_ROLLUP_1H_SIZE,	Rollup1h }
+};
+
+/* Divide rounding to nearest, also for negative sums */
+static int32_t rollupMean(int64_t i64Sum, uint32_t ui32Count)
+{
+	if(i64Sum < 0)
+	{
+		return((int32_t)((i64Sum - (int64_t)(ui32Count / 2)) / (int64_t)ui32Count));
+	}
+	return((int32_t)((i64Sum + (int64_t)(ui32Count / 2)) / (int64_t)ui32Count));
+}
+
+static void rollupMerge(uint32_t ui32Level, const WS_RollupAccum_t *psAccum);
+
+/* Store the open bucket of a level and hand it up to the next one */
+static void rollupClose(uint32_t ui32Level)
+{
+	WS_RollupLevel_t *psLevel = &RollupLevels[ui32Level];
+	WS_RollupBucket_t *psBucket;
+	uint32_t ui32Ch;
+
+	if(psLevel->sOpen.ui32Count == 0)
+	{
+		return;
+	}
+
+	if(psLevel->ui32Count < psLevel->ui32Size)
+	{
+		psBucket = &psLevel->psBuckets[(psLevel->ui32Head + psLevel->ui32Count) % psLevel->ui32Size];
+		psLevel->ui32Count++;
+	}
+	else
+	{
+		/* Full, overwrite the oldest */
+		psBucket = &psLevel->psBuckets[psLevel->ui32Head];
+		psLevel->ui32Head = (psLevel->ui32Head + 1) % psLevel->ui32Size;
+	}
+
+	psBucket->ui32Start = psLevel->sOpen.ui32Start;
+	psBucket->ui32Count = psLevel->sOpen.ui32Count;
+	for(ui32Ch = 0; ui32Ch < WS_ROLLUP_CHANNELS; ui32Ch++)
+	{
+		psBucket->psStat[ui32Ch].i32Min = psLevel->sOpen.pi32Min[ui32Ch];
+		psBucket->psStat[ui32Ch].i32Max = psLevel->sOpen.pi32Max[ui32Ch];
+		psBucket->psStat[ui32Ch].i32Mean = rollupMean(psLevel->sOpen.pi64Sum[ui32Ch], psLevel->sOpen.ui32Count);
+	}
+
+	if((ui32Level + 1) < WS_ROLLUP_LEVELS)
+	{
+		rollupMerge(ui32Level + 1, &psLevel->sOpen);
+	}
+
+	psLevel->sOpen.ui32Count = 0;
+}
+
+/* Merge an accumulator (a closed finer bucket or a single sample) into the
+ * open bucket of a level, closing it first if the period moved on. */
+static void rollupMerge(uint32_t ui32Level, const WS_RollupAccum_t *psAccum)
+{
+	WS_RollupLevel_t *psLevel = &RollupLevels[ui32Level];
+	WS_RollupAccum_t *psOpen = &psLevel->sOpen;
+	uint32_t ui32Start, ui32Ch;
+
+	ui32Start = psAccum->ui32Start - (psAccum->ui32Start % psLevel->ui32Period);
+
+	if(psOpen->ui32Count && (psOpen->ui32Start != ui32Start))
+	{
+		rollupClose(ui32Level);
+	}
+
+	if(psOpen->ui32Count == 0)
+	{
+		*psOpen = *psAccum;
+		psOpen->ui32Start = ui32Start;
+		return;
+	}
+
+	psOpen->ui32Count += psAccum->ui32Count;
+	for(ui32Ch = 0; ui32Ch < WS_ROLLUP_CHANNELS; ui32Ch++)
+	{
+		if(psAccum->pi32Min[ui32Ch] < psOpen->pi32Min[ui32Ch])
+		{
+			psOpen->pi32Min[ui32Ch] = psAccum->pi32Min[ui32Ch];
+		}
+		if(psAccum->pi32Max[ui32Ch] > psOpen->pi32Max[ui32Ch])
+		{
+			psOpen->pi32Max[ui32Ch] = psAccum->pi32Max[ui32Ch];
+		}
+		psOpen->pi64Sum[ui32Ch] += psAccum->pi64Sum[ui32Ch];
+	}
+}
+
+void rollupAddSample(uint32_t ui32TimeS, const int32_t pi32Values[WS_ROLLUP_CHANNELS])
+{
+	WS_RollupAccum_t sSample;
+	uint32_t ui32Ch;
+
+	sSample.ui32Start = ui32TimeS;
+	sSample.ui32Count = 1;
+	for(ui32Ch = 0; ui32Ch < WS_ROLLUP_CHANNELS; ui32Ch++)
+	{
+		sSample.pi32Min[ui32Ch] = pi32Values[ui32Ch];
+		sSample.pi32Max[ui32Ch] = pi32Values[ui32Ch];
+		sSample.pi64Sum[ui32Ch] = pi32Values[ui32Ch];
+	}
+
+	rollupMerge(0, &sSample);
+}
+
+const WS_RollupLevel_t *rollupLevelGet(uint32_t ui32Period)
+{
+	uint32_t ui32Level;
+
+	for(ui32Level = 0; ui32Level < WS_ROLLUP_LEVELS; ui32Level++)
+	{
+		if(RollupLevels[ui32Level].ui32Period == ui32Period)
+		{
+			return(&RollupLevels[ui32Level]);
+		}
+	}
+
+	return(NULL);
+}
+
+const WS_RollupBucket_t *rollupBucketGet(const WS_RollupLevel_t *psLevel, uint32_t ui32Index)
+{
+	if(ui32Index >= psLevel->ui32Count)
+	{
+		return(NULL);
+	}
+
+	return(&psLevel->psBuckets[(psLevel->ui32Head + ui32Index) % psLevel->ui32Size]);
+}
@@ -0,0 +1,69 @@
+#ifndef WEATHER_STATION_WS_ROLLUP_H_
+#define WEATHER_STATION_WS_ROLLUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Cascading min/max/mean rollups.
+ *
+ *  Every sample set updates the open 1 s bucket. When a bucket's period ends
+ *  it is stored in its level's ring and its accumulator is merged into the
+ *  open bucket of the next level (1 s -> 1 min -> 10 min -> 1 h), so each
+ *  sample is touched once and the coarse levels never rescan the fine ones.
+ *  The sums travel up in 64 bit integers, the coarse means are exact.
+ *
+ *  Values are thousandths of the sensor unit, times are seconds. All storage
+ *  is static and sized by the defines below. */
+//*****************************************************************************
+
+#define WS_ROLLUP_CHANNELS		4		/* Temperature, humidity, pressure, light */
+#define WS_ROLLUP_LEVELS		4
+
+/* Buckets kept per level */
+#define WS_ROLLUP_1S_SIZE		60		/* 1 minute */
+#define WS_ROLLUP_1M_SIZE		120		/* 2 hours */
+#define WS_ROLLUP_10M_SIZE		144		/* 1 day */
+#define WS_ROLLUP_1H_SIZE		48		/* 2 days */
+
+typedef struct {
+	int32_t i32Min;
+	int32_t i32Max;
+	int32_t i32Mean;
+}WS_RollupStat_t;
+
+/* Closed bucket */
+typedef struct {
+	uint32_t ui32Start;				/* Start of the period, s */
+	uint32_t ui32Count;				/* Samples merged into the bucket */
+	WS_RollupStat_t psStat[WS_ROLLUP_CHANNELS];
+}WS_RollupBucket_t;
+
+/* Open bucket */
+typedef struct {
+	uint32_t ui32Start;
+	uint32_t ui32Count;
+	int32_t pi32Min[WS_ROLLUP_CHANNELS];
+	int32_t pi32Max[WS_ROLLUP_CHANNELS];
+	int64_t pi64Sum[WS_ROLLUP_CHANNELS];
+}WS_RollupAccum_t;
+
+typedef struct {
+	uint32_t ui32Period;			/* Bucket length, s */
+	uint32_t ui32Size;				/* Capacity of the ring */
+	WS_RollupBucket_t *psBuckets;
+	uint32_t ui32Head;				/* Oldest bucket once the ring is full */
+	uint32_t ui32Count;
+	WS_RollupAccum_t sOpen;
+}WS_RollupLevel_t;
+
+/* Add one sample set taken at ui32TimeS. */
+void rollupAddSample(uint32_t ui32TimeS, const int32_t pi32Values[WS_ROLLUP_CHANNELS]);
+
+/* Level with the given bucket length in seconds, NULL if there is none. */
+const WS_RollupLevel_t *rollupLevelGet(uint32_t ui32Period);
+
+/* Closed bucket of a level, index 0 is the oldest. */
+const WS_RollupBucket_t *rollupBucketGet(const WS_RollupLevel_t *psLevel, uint32_t ui32Index);
+
+#endif /* WEATHER_STATION_WS_ROLLUP_H_ */
@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils/ustdlib.h"
+
+#include "ws_route.h"
+
+/* Paths are hashed with 32 bit FNV-1a */
+#define ROUTE_HASH_BASIS		2166136261u
+#define ROUTE_HASH_STEP(h, c)	(((h) ^ (uint8_t)(c)) * 16777619u)
+
+static WS_Route_t Routes[WS_ROUTE_MAX];
+static uint32_t RouteHash[WS_ROUTE_MAX];
+static uint32_t RouteLen[WS_ROUTE_MAX];
+static uint32_t RouteCount;
+static uint32_t RoutePrefixes;		/* Routes with WS_ROUTE_PREFIX */
+
+/* Route index plus one, 0 if the slot is free */
+static uint8_t RouteSlot[WS_ROUTE_SLOTS];
+
+static const char *RouteSSITags[WS_ROUTE_MAX_SSI];
+static WS_RouteSSI_t RouteSSIInsert[WS_ROUTE_MAX_SSI];
+static uint8_t RouteSSICache[WS_ROUTE_MAX_SSI];	/* Cache index plus one, 0 if none */
+static uint32_t RouteSSICount;
+
+/* Rendered text of the cached tags, valid while the generation it was
+ * rendered at is the current one. 0 is no generation. */
+static char RouteSSIText[WS_ROUTE_SSI_CACHED][WS_ROUTE_SSI_CACHE_LEN];
+static int32_t RouteSSILen[WS_ROUTE_SSI_CACHED];
+static uint32_t RouteSSIGen[WS_ROUTE_SSI_CACHED];
+static uint32_t RouteSSICached;
+static uint32_t RouteSSIGeneration = 1;
+
+static int32_t routeLookup(uint32_t ui32Hash, const char *pcPath, uint32_t ui32Len)
+{
+	uint32_t ui32Slot, ui32Index;
+
+	for(ui32Slot = ui32Hash & (WS_ROUTE_SLOTS - 1); RouteSlot[ui32Slot] != 0;
+		ui32Slot = (ui32Slot + 1) & (WS_ROUTE_SLOTS - 1))
+	{
+		ui32Index = RouteSlot[ui32Slot] - 1;
+		if((RouteHash[ui32Index] == ui32Hash) && (RouteLen[ui32Index] == ui32Len) &&
+		   (memcmp(Routes[ui32Index].pcPath, pcPath, ui32Len) == 0))
+		{
+			return(ui32Index);
+		}
+	}
+
+	return(-1);
+}
+
+/* Enter a route in the table, its index or -1 */
+static int32_t routeInsert(const WS_Route_t *psRoute)
+{
+	uint32_t ui32Hash = ROUTE_HASH_BASIS;
+	uint32_t ui32Len, ui32Slot;
+
+	for(ui32Len = 0; psRoute->pcPath[ui32Len]; ui32Len++)
+	{
+		ui32Hash = ROUTE_HASH_STEP(ui32Hash, psRoute->pcPath[ui32Len]);
+	}
+
+	if((RouteCount == WS_ROUTE_MAX) || (routeLookup(ui32Hash, psRoute->pcPath, ui32Len) >= 0))
+	{
+		return(-1);
+	}
+
+	for(ui32Slot = ui32Hash & (WS_ROUTE_SLOTS - 1); RouteSlot[ui32Slot] != 0;
+		ui32Slot = (ui32Slot + 1) & (WS_ROUTE_SLOTS - 1))
+	{
+	}
+
+	Routes[RouteCount] = *psRoute;
+	RouteHash[RouteCount] = ui32Hash;
+	RouteLen[RouteCount] = ui32Len;
+	RouteSlot[ui32Slot] = (uint8_t)(RouteCount + 1);
+	if(psRoute->ui32Flags & WS_ROUTE_PREFIX)
+	{
+		RoutePrefixes++;
+	}
+
+	return(RouteCount++);
+}
+
+static int32_t routeSSIHandler(int32_t i32Index, char *pcInsert, int32_t i32InsertLen)
+{
+	uint32_t ui32Cache;
+	int32_t i32Len;
+
+	if((i32Index < 0) || ((uint32_t)i32Index >= RouteSSICount))
+	{
+		usnprintf(pcInsert, i32InsertLen, "??");
+		return(strlen(pcInsert));
+	}
+
+	if(!RouteSSICache[i32Index])
+	{
+		return(RouteSSIInsert[i32Index](pcInsert, i32InsertLen));
+	}
+
+	ui32Cache = RouteSSICache[i32Index] - 1;
+	if((RouteSSIGen[ui32Cache] == RouteSSIGeneration) && (RouteSSILen[ui32Cache] < i32InsertLen))
+	{
+		memcpy(pcInsert, RouteSSIText[ui32Cache], RouteSSILen[ui32Cache] + 1);
+		return(RouteSSILen[ui32Cache]);
+	}
+
+	/* Keep it if it fits, with its terminator, in the cache and the insert */
+	i32Len = RouteSSIInsert[i32Index](pcInsert, i32InsertLen);
+	if((i32Len >= 0) && (i32Len < WS_ROUTE_SSI_CACHE_LEN) && (i32Len < i32InsertLen))
+	{
+		memcpy(RouteSSIText[ui32Cache], pcInsert, i32Len);
+		RouteSSIText[ui32Cache][i32Len] = 0;
+		RouteSSILen[ui32Cache] = i32Len;
+		RouteSSIGen[ui32Cache] = RouteSSIGeneration;
+	}
+
+	return(i32Len);
+}
+
+bool routeAdd(const char *pcPath, uint32_t ui32Flags, WS_RouteOpen_t pfnOpen)
+{
+	WS_Route_t sRoute = { pcPath, ui32Flags, pfnOpen, NULL, NULL, 0 };
+
+	return(routeInsert(&sRoute) >= 0);
+}
+
+bool routeAddFile(const char *pcPath, const char *pcData, uint32_t ui32Len)
+{
+	WS_Route_t sRoute = { pcPath, 0, NULL, NULL, pcData, ui32Len };
+
+	return(routeInsert(&sRoute) >= 0);
+}
+
+bool routeAddCGI(const char *pcPath, WS_RouteCGI_t pfnCGI)
+{
+	WS_Route_t sRoute = { pcPath, WS_ROUTE_GET, NULL, pfnCGI, NULL, 0 };
+
+	return(routeInsert(&sRoute) >= 0);
+}
+
+bool routeAddSSI(const char *pcTag, uint32_t ui32Flags, WS_RouteSSI_t pfnInsert)
+{
+	if((RouteSSICount == WS_ROUTE_MAX_SSI) ||
+	   ((ui32Flags & WS_ROUTE_SSI_CACHE) && (RouteSSICached == WS_ROUTE_SSI_CACHED)))
+	{
+		return(false);
+	}
+
+	RouteSSITags[RouteSSICount] = pcTag;
+	RouteSSIInsert[RouteSSICount] = pfnInsert;
+	if(ui32Flags & WS_ROUTE_SSI_CACHE)
+	{
+		RouteSSICache[RouteSSICount] = (uint8_t)(++RouteSSICached);
+	}
+	RouteSSICount++;
+
+	return(true);
+}
+
+void routeSSIChanged(void)
+{
+	/* Skip 0, it marks an empty cache entry */
+	if(++RouteSSIGeneration == 0)
+	{
+		RouteSSIGeneration = 1;
+	}
+}
+
+int32_t routeSSI(const char *pcTag, uint32_t ui32TagLen, char *pcInsert, int32_t i32InsertLen)
+{
+	uint32_t ui32Index;
+
+	for(ui32Index = 0; ui32Index < RouteSSICount; ui32Index++)
+	{
+		if(!strncmp(RouteSSITags[ui32Index], pcTag, ui32TagLen) &&
+		   !RouteSSITags[ui32Index][ui32TagLen])
+		{
+			break;
+		}
+	}
+
+	return(routeSSIHandler((ui32Index < RouteSSICount) ? (int32_t)ui32Index : -1, pcInsert,
+						   i32InsertLen));
+}
+
+const WS_Route_t *routeFind(const char *pcName, const char **ppcQuery)
+{
+	uint32_t pui32CutHash[WS_ROUTE_MAX_DEPTH], pui32CutLen[WS_ROUTE_MAX_DEPTH];
+	uint32_t ui32Hash = ROUTE_HASH_BASIS;
+	uint32_t ui32Len, ui32Cuts = 0;
+	int32_t i32Index;
+
+	/* One pass hashes the path and each prefix ending before a '/' */
+	for(ui32Len = 0; pcName[ui32Len] && (pcName[ui32Len] != '?'); ui32Len++)
+	{
+		if((pcName[ui32Len] == '/') && ui32Len && (ui32Cuts < WS_ROUTE_MAX_DEPTH))
+		{
+			pui32CutHash[ui32Cuts] = ui32Hash;
+			pui32CutLen[ui32Cuts] = ui32Len;
+			ui32Cuts++;
+		}
+		ui32Hash = ROUTE_HASH_STEP(ui32Hash, pcName[ui32Len]);
+	}
+
+	/* The longest prefix route takes a path without a route of its own */
+	i32Index = routeLookup(ui32Hash, pcName, ui32Len);
+	while((i32Index < 0) && ui32Cuts && RoutePrefixes)
+	{
+		ui32Cuts--;
+		i32Index = routeLookup(pui32CutHash[ui32Cuts], pcName, pui32CutLen[ui32Cuts]);
+		if((i32Index >= 0) && !(Routes[i32Index].ui32Flags & WS_ROUTE_PREFIX))
+		{
+			i32Index = -1;
+		}
+	}
+
+	if(ppcQuery)
+	{
+		*ppcQuery = (pcName[ui32Len] == '?') ? (pcName + ui32Len + 1) : "";
+	}
+
+	return((i32Index < 0) ? NULL : &Routes[i32Index]);
+}
+
+bool routeAllows(const WS_Route_t *psRoute, uint32_t ui32Method)
+{
+	return(!(psRoute->ui32Flags & (WS_ROUTE_GET | WS_ROUTE_HEAD)) ||
+		   (psRoute->ui32Flags & ui32Method));
+}
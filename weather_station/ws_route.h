@@ -0,0 +1,95 @@
+#ifndef WEATHER_STATION_WS_ROUTE_H_
+#define WEATHER_STATION_WS_ROUTE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cgifuncs.h"
+
+//*****************************************************************************
+/*  Registry of everything the web server answers: the files of the file
+ *  system image, the dynamic files fs_open builds, the CGIs and the SSI tags.
+ *
+ *  Paths are kept in an open addressed hash table, so finding one costs a
+ *  hash of the path and, as a rule, one comparison, however many routes
+ *  there are. A path is the part of the URI before any '?'. A route added
+ *  with WS_ROUTE_PREFIX also answers the paths below it, "/a" takes "/a/b"
+ *  when there is no route of its own for it; the lookup hashes the path once
+ *  and tries the prefix ending at each '/'.
+ *
+ *  A route answers GET and HEAD, or only the methods its WS_ROUTE_GET and
+ *  WS_ROUTE_HEAD flags name. CGIs answer GET only: they change something,
+ *  and HEAD must not.
+ *
+ *  An SSI tag added with WS_ROUTE_SSI_CACHE is rendered once and copied from
+ *  then on, until routeSSIChanged is called: whatever changes what such a
+ *  tag shows has to call it. A tag longer than WS_ROUTE_SSI_CACHE_LEN - 1
+ *  is rendered every time.
+ *
+ *  The routes are added at start-up, ws_http serves them. */
+//*****************************************************************************
+
+#define WS_ROUTE_MAX			64
+#define WS_ROUTE_SLOTS			128		/* Power of two, at least twice WS_ROUTE_MAX */
+#define WS_ROUTE_MAX_SSI		12
+#define WS_ROUTE_MAX_DEPTH		8		/* '/' tried for prefix routes */
+#define WS_ROUTE_SSI_CACHED		4		/* Tags with WS_ROUTE_SSI_CACHE */
+#define WS_ROUTE_SSI_CACHE_LEN	192		/* httpd's LWIP_HTTPD_MAX_TAG_INSERT_LEN */
+
+/* Route flags */
+#define WS_ROUTE_PREFIX			0x01	/* Also answers the paths below */
+#define WS_ROUTE_SSI_CACHE		0x04	/* SSI tag, kept until routeSSIChanged */
+#define WS_ROUTE_GET			0x08	/* Answers GET, neither method flag is both */
+#define WS_ROUTE_HEAD			0x10	/* Answers HEAD */
+
+/* Builds a dynamic file. pcQuery is the query of the request without the
+ * '?', "" if there is none. Returns the content, which has to stay valid
+ * until the next call, and its length, or NULL if there is no such file. */
+typedef const char *(*WS_RouteOpen_t)(const char *pcQuery, uint32_t *pui32Len);
+
+/* Runs a CGI. psQuery is the query of the request parsed by ParseCGIQuery.
+ * Returns the path of the file to answer with, NULL for 404. */
+typedef const char *(*WS_RouteCGI_t)(const tCGIQuery *psQuery);
+
+/* Writes the replacement of an SSI tag, returns its length */
+typedef int32_t (*WS_RouteSSI_t)(char *pcInsert, int32_t i32InsertLen);
+
+typedef struct
+{
+	const char *pcPath;
+	uint32_t ui32Flags;
+	WS_RouteOpen_t pfnOpen;		/* Dynamic file, NULL for the others */
+	WS_RouteCGI_t pfnCGI;		/* CGI, NULL for the others */
+	const char *pcData;			/* File of the file system image */
+	uint32_t ui32Len;
+}WS_Route_t;
+
+/* Add a dynamic file. ui32Flags are WS_ROUTE_PREFIX and the method flags.
+ * False if the table is full or the path is taken. */
+bool routeAdd(const char *pcPath, uint32_t ui32Flags, WS_RouteOpen_t pfnOpen);
+
+/* Add a file of the file system image */
+bool routeAddFile(const char *pcPath, const char *pcData, uint32_t ui32Len);
+
+/* Add a CGI. It answers GET only. */
+bool routeAddCGI(const char *pcPath, WS_RouteCGI_t pfnCGI);
+
+/* Add an SSI tag, the name without the <!--# --> around it. ui32Flags is 0
+ * or WS_ROUTE_SSI_CACHE. */
+bool routeAddSSI(const char *pcTag, uint32_t ui32Flags, WS_RouteSSI_t pfnInsert);
+
+/* What a cached SSI tag shows changed, the next page renders it again */
+void routeSSIChanged(void);
+
+/* Render the SSI tag of that name, "??" for an unknown one. Returns the
+ * length. */
+int32_t routeSSI(const char *pcTag, uint32_t ui32TagLen, char *pcInsert, int32_t i32InsertLen);
+
+/* The route of a path, up to any '?'. *ppcQuery is set to the query the
+ * route gets (see WS_RouteOpen_t). NULL if there is no route. */
+const WS_Route_t *routeFind(const char *pcName, const char **ppcQuery);
+
+/* Whether the route answers a method, WS_ROUTE_GET or WS_ROUTE_HEAD */
+bool routeAllows(const WS_Route_t *psRoute, uint32_t ui32Method);
+
+#endif /* WEATHER_STATION_WS_ROUTE_H_ */
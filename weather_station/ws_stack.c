@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_stack.h"
+
+#ifndef WS_HOST_BUILD
+#include "inc/hw_nvic.h"
+#include "inc/hw_types.h"
+
+/* Stack limits from the linker, see enet_io_ccs.cmd */
+extern uint32_t __stack;
+extern uint32_t __STACK_TOP;
+
+/* Room left above the painted area for the frames of stackInit and
+ * stackPaint themselves */
+#define STACK_PAINT_MARGIN		64
+
+static volatile uint32_t StackMaxNesting;
+#endif
+
+void stackPaint(uint32_t *pui32Low, uint32_t *pui32High)
+{
+	while(pui32Low < pui32High)
+	{
+		*pui32Low++ = WS_STACK_PATTERN;
+	}
+}
+
+uint32_t stackScan(const uint32_t *pui32Low, const uint32_t *pui32High)
+{
+	const uint32_t *pui32Word = pui32Low;
+
+	while((pui32Word < pui32High) && (*pui32Word == WS_STACK_PATTERN))
+	{
+		pui32Word++;
+	}
+
+	return((uint32_t)(pui32Word - pui32Low) * 4);
+}
+
+#ifndef WS_HOST_BUILD
+/* Number of set bits */
+static uint32_t stackPopCount(uint32_t ui32Value)
+{
+	ui32Value = ui32Value - ((ui32Value >> 1) & 0x55555555u);
+	ui32Value = (ui32Value & 0x33333333u) + ((ui32Value >> 2) & 0x33333333u);
+	ui32Value = (ui32Value + (ui32Value >> 4)) & 0x0f0f0f0fu;
+	return((ui32Value * 0x01010101u) >> 24);
+}
+
+void stackInit(void)
+{
+	volatile uint32_t ui32Marker = 0;
+
+	/* Everything below the current frame is free */
+	stackPaint(&__stack, (uint32_t *)&ui32Marker - STACK_PAINT_MARGIN / 4);
+}
+
+void stackSampleNesting(void)
+{
+	uint32_t ui32Depth;
+
+	/* Active peripheral interrupts, plus SysTick and PendSV which live in
+	 * the system handler register */
+	ui32Depth = stackPopCount(HWREG(NVIC_ACTIVE0)) + stackPopCount(HWREG(NVIC_ACTIVE1)) +
+				stackPopCount(HWREG(NVIC_ACTIVE2)) + stackPopCount(HWREG(NVIC_ACTIVE3));
+	ui32Depth += stackPopCount(HWREG(NVIC_SYS_HND_CTRL) & (NVIC_SYS_HND_CTRL_TICK | NVIC_SYS_HND_CTRL_PNDSV));
+
+	if(ui32Depth > StackMaxNesting)
+	{
+		StackMaxNesting = ui32Depth;
+	}
+}
+
+void stackReport(WS_StackReport_t *psReport)
+{
+	uint32_t ui32Free;
+
+	psReport->ui32Size = (uint32_t)((uint8_t *)&__STACK_TOP - (uint8_t *)&__stack);
+	ui32Free = stackScan(&__stack, &__STACK_TOP);
+	psReport->ui32Used = psReport->ui32Size - ui32Free;
+	psReport->ui32MaxNesting = StackMaxNesting;
+}
+#endif /* WS_HOST_BUILD */
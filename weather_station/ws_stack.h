@@ -0,0 +1,43 @@
+#ifndef WEATHER_STATION_WS_STACK_H_
+#define WEATHER_STATION_WS_STACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Stack usage monitor.
+ *
+ *  The free part of the stack is filled with a pattern at boot. The stack
+ *  grows down, so the words from the bottom up that still hold the pattern
+ *  have never been used, the rest is the high-water mark. Interrupt handlers
+ *  sample how many exceptions are active at once, which is the nesting depth
+ *  the stack has to carry.
+ *
+ *  stackPaint and stackScan have no hardware dependency. */
+//*****************************************************************************
+
+#define WS_STACK_PATTERN		0xA5A5A5A5u
+
+typedef struct {
+	uint32_t ui32Size;			/* Stack size, bytes */
+	uint32_t ui32Used;			/* High-water mark, bytes */
+	uint32_t ui32MaxNesting;	/* Most exceptions seen active at once */
+}WS_StackReport_t;
+
+/* Fill [pui32Low, pui32High) with the pattern. */
+void stackPaint(uint32_t *pui32Low, uint32_t *pui32High);
+
+/* Bytes from pui32Low up that still hold the pattern. */
+uint32_t stackScan(const uint32_t *pui32Low, const uint32_t *pui32High);
+
+/* Paint the unused part of the system stack. Call first thing in main. */
+void stackInit(void);
+
+/* Record the exception nesting depth, call at the start of interrupt
+ * handlers. */
+void stackSampleNesting(void);
+
+/* Measure the high-water mark now and fill in the report. */
+void stackReport(WS_StackReport_t *psReport);
+
+#endif /* WEATHER_STATION_WS_STACK_H_ */
@@ -0,0 +1,208 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_tick.h"
+
+#ifndef WS_HOST_BUILD
+#include "inc/hw_memmap.h"
+#include "inc/hw_nvic.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#else
+#include "driverlib/interrupt.h"
+#endif
+
+WS_TickStats_t TickStats;
+
+static uint64_t TickDeadline[WS_NUM_TICK_CLIENTS];
+
+/* Deadline SysTick is programmed for, 0 while the handler runs */
+static uint64_t TickArmed = WS_TICK_NONE;
+
+/* 64 bit extension of the free running count, from TickBase on */
+static uint32_t TickLastCount;
+static uint64_t TickHigh;
+static uint32_t TickBase;
+
+#ifndef WS_HOST_BUILD
+void tickHwInit(void)
+{
+	/* Free running, it also has to count while the core sleeps */
+	MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER3);
+	MAP_SysCtlPeripheralSleepEnable(SYSCTL_PERIPH_TIMER3);
+	MAP_TimerConfigure(TIMER3_BASE, TIMER_CFG_PERIODIC_UP);
+	MAP_TimerLoadSet(TIMER3_BASE, TIMER_A, 0xFFFFFFFF);
+	MAP_TimerEnable(TIMER3_BASE, TIMER_A);
+
+	MAP_SysTickPeriodSet(WS_TICK_MAX_US * WS_TICK_CLOCKS_PER_US);
+	MAP_SysTickEnable();
+	MAP_SysTickIntEnable();
+}
+
+uint32_t tickHwCount(void)
+{
+	return(MAP_TimerValueGet(TIMER3_BASE, TIMER_A));
+}
+
+void tickHwArm(uint32_t ui32Clocks)
+{
+	/* A write to the current value register reloads the new period */
+	MAP_SysTickPeriodSet(ui32Clocks);
+	HWREG(NVIC_ST_CURRENT) = 0;
+}
+#endif
+
+void tickInit(void)
+{
+	uint32_t ui32Idx;
+
+	for(ui32Idx = 0; ui32Idx < WS_NUM_TICK_CLIENTS; ui32Idx++)
+	{
+		TickDeadline[ui32Idx] = WS_TICK_NONE;
+	}
+
+	tickHwInit();
+	TickBase = tickHwCount();
+	TickLastCount = TickBase;
+	TickHigh = 0;
+}
+
+uint64_t tickNowUs(void)
+{
+	uint32_t ui32Count;
+	uint64_t ui64Clocks;
+	bool bMasked;
+
+	/* The extension is shared with the interrupt handlers */
+	bMasked = MAP_IntMasterDisable();
+	ui32Count = tickHwCount();
+	if(ui32Count < TickLastCount)
+	{
+		TickHigh += (uint64_t)1 << 32;
+	}
+	TickLastCount = ui32Count;
+	ui64Clocks = (TickHigh | ui32Count) - TickBase;
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+
+	return(ui64Clocks / WS_TICK_CLOCKS_PER_US);
+}
+
+uint32_t tickNowMs(void)
+{
+	return((uint32_t)(tickNowUs() / 1000u));
+}
+
+uint64_t tickNextPeriod(uint64_t ui64LastUs, uint64_t ui64PeriodUs)
+{
+	uint64_t ui64NowUs = tickNowUs();
+
+	/* Keep the phase, but do not catch up on missed periods */
+	if((ui64LastUs + ui64PeriodUs) <= ui64NowUs)
+	{
+		return(ui64NowUs + ui64PeriodUs);
+	}
+
+	return(ui64LastUs + ui64PeriodUs);
+}
+
+/* Program SysTick for ui64DeadlineUs. Interrupts masked. */
+static void tickProgram(uint64_t ui64DeadlineUs)
+{
+	uint64_t ui64NowUs = tickNowUs();
+	uint64_t ui64DelayUs;
+
+	TickArmed = ui64DeadlineUs;
+
+	if(ui64DeadlineUs <= (ui64NowUs + WS_TICK_MIN_US))
+	{
+		ui64DelayUs = WS_TICK_MIN_US;
+	}
+	else if((ui64DeadlineUs - ui64NowUs) > WS_TICK_MAX_US)
+	{
+		ui64DelayUs = WS_TICK_MAX_US;
+	}
+	else
+	{
+		ui64DelayUs = ui64DeadlineUs - ui64NowUs;
+	}
+
+	tickHwArm((uint32_t)ui64DelayUs * WS_TICK_CLOCKS_PER_US);
+}
+
+void tickDeadlineSet(WS_TickClient_t eClient, uint64_t ui64DeadlineUs)
+{
+	bool bMasked;
+
+	bMasked = MAP_IntMasterDisable();
+	TickDeadline[eClient] = ui64DeadlineUs;
+
+	/* From the handler tickArm programs the earliest one anyway */
+	if((TickArmed != 0) && (ui64DeadlineUs < TickArmed))
+	{
+		tickProgram(ui64DeadlineUs);
+	}
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+}
+
+uint32_t tickExpired(void)
+{
+	uint64_t ui64NowUs = tickNowUs();
+	uint32_t ui32Due = 0;
+	uint32_t ui32Idx;
+	bool bMasked;
+
+	bMasked = MAP_IntMasterDisable();
+	for(ui32Idx = 0; ui32Idx < WS_NUM_TICK_CLIENTS; ui32Idx++)
+	{
+		if(TickDeadline[ui32Idx] <= ui64NowUs)
+		{
+			TickDeadline[ui32Idx] = WS_TICK_NONE;
+			ui32Due |= 1u << ui32Idx;
+		}
+	}
+	TickArmed = 0;
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+
+	TickStats.ui32Wakeups++;
+	if(!ui32Due)
+	{
+		TickStats.ui32Empty++;
+	}
+
+	return(ui32Due);
+}
+
+void tickArm(void)
+{
+	uint64_t ui64Earliest = WS_TICK_NONE;
+	uint32_t ui32Idx;
+	bool bMasked;
+
+	bMasked = MAP_IntMasterDisable();
+	for(ui32Idx = 0; ui32Idx < WS_NUM_TICK_CLIENTS; ui32Idx++)
+	{
+		if(TickDeadline[ui32Idx] < ui64Earliest)
+		{
+			ui64Earliest = TickDeadline[ui32Idx];
+		}
+	}
+	tickProgram(ui64Earliest);
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef WEATHER_STATION_WS_TICK_H_
+#define WEATHER_STATION_WS_TICK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Tickless timekeeping.
+ *
+ *  A free running 32 bit timer (Timer 3, system clock) is extended to a 64
+ *  bit monotonic clock. SysTick no longer runs at a fixed rate: it is
+ *  programmed as a one-shot for the earliest deadline of its clients, so the
+ *  core only wakes up when something is due. Each client owns one deadline,
+ *  periodic clients set the next one from the interrupt handler.
+ *
+ *  SysTick is 24 bits wide, a deadline further away than WS_TICK_MAX_US
+ *  takes more than one interrupt. The clock has to be read at least once per
+ *  timer period (~35 s), the lwIP deadline sees to that. */
+//*****************************************************************************
+
+/* Clock of the free running timer and of SysTick, the system clock */
+#define WS_TICK_CLOCKS_PER_US	120u
+
+/* Longest SysTick period */
+#define WS_TICK_MAX_US			(0x00FFFFFFu / WS_TICK_CLOCKS_PER_US)
+
+/* Shortest programmed delay, a deadline already due fires this soon */
+#define WS_TICK_MIN_US			2u
+
+#define WS_TICK_NONE			UINT64_MAX
+
+/* Owners of a deadline */
+typedef enum {
+	WS_TickLwIP				= 0x00u,	/* lwIP timers */
+	WS_TickRefresh			= 0x01u,	/* Sample cycle and UART report */
+	WS_TickSensorBus0		= 0x02u,	/* Sensor delays, one per I2C bus */
+	WS_TickSensorBus1		= 0x03u,
+	WS_NUM_TICK_CLIENTS
+}WS_TickClient_t;
+
+typedef struct {
+	uint32_t ui32Wakeups;		/* SysTick interrupts */
+	uint32_t ui32Empty;			/* Of those, with nothing due */
+}WS_TickStats_t;
+
+extern WS_TickStats_t TickStats;
+
+/* Start the clock and SysTick, no deadline set. */
+void tickInit(void);
+
+/* Time since tickInit */
+uint64_t tickNowUs(void);
+uint32_t tickNowMs(void);
+
+/* Wake up at ui64DeadlineUs (tickNowUs time), WS_TICK_NONE clears. */
+void tickDeadlineSet(WS_TickClient_t eClient, uint64_t ui64DeadlineUs);
+
+/* Next period of a periodic deadline: ui64PeriodUs after the last one, or
+ * after now if that is already past. */
+uint64_t tickNextPeriod(uint64_t ui64LastUs, uint64_t ui64PeriodUs);
+
+/* For SysTickIntHandler: the clients whose deadline passed, as a bit mask
+ * (1 << client). Their deadlines are cleared. Call tickArm once the
+ * handler has set the new deadlines. */
+uint32_t tickExpired(void);
+void tickArm(void);
+
+/* Hardware layer, ws_tick.c on the target, host/sim_tick.c on the host */
+void tickHwInit(void);
+uint32_t tickHwCount(void);
+void tickHwArm(uint32_t ui32Clocks);
+
+#endif /* WEATHER_STATION_WS_TICK_H_ */
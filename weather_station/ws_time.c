@@ -0,0 +1,219 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils/lwiplib.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "ws_tick.h"
+#include "ws_time.h"
+
+/* SNTP message, RFC 4330 */
+#define SNTP_MSG_LEN			48
+#define SNTP_MODE_CLIENT		0x23		/* Version 4, client */
+#define SNTP_MODE_SERVER		4
+#define SNTP_MODE_M				0x07
+#define SNTP_ORIGINATE			24
+#define SNTP_RECEIVE			32
+#define SNTP_TRANSMIT			40
+
+/* Wall clock minus monotonic clock, written by timeSet only */
+static uint64_t TimeOffsetUs;
+static volatile bool TimeValid;
+
+#if WS_SNTP_POLL_S
+static struct udp_pcb *TimePcb;
+static uint32_t TimeWaitMs;			/* Until the next request */
+static uint64_t TimeRequestUs;		/* Send time of the open request, 0 if none */
+#endif
+
+bool timeSynced(void)
+{
+	return(TimeValid);
+}
+
+void timeSet(uint64_t ui64UnixUs, uint64_t ui64MonoUs)
+{
+	bool bMasked;
+
+	/* SysTick reads the offset for the UART report */
+	bMasked = MAP_IntMasterDisable();
+	TimeOffsetUs = ui64UnixUs - ui64MonoUs;
+	TimeValid = true;
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+}
+
+bool timeUnixUs(uint64_t ui64MonoUs, uint64_t *pui64UnixUs)
+{
+	bool bMasked;
+
+	if(!TimeValid)
+	{
+		return(false);
+	}
+
+	bMasked = MAP_IntMasterDisable();
+	*pui64UnixUs = ui64MonoUs + TimeOffsetUs;
+	if(!bMasked)
+	{
+		MAP_IntMasterEnable();
+	}
+
+	return(true);
+}
+
+int timeFormatU64(char *pcBuf, int iBufLen, uint64_t ui64Value)
+{
+	char pcDigits[20];
+	int iCount = 0, iLen;
+
+	do
+	{
+		pcDigits[iCount++] = '0' + (char)(ui64Value % 10);
+		ui64Value /= 10;
+	}
+	while(ui64Value);
+
+	for(iLen = 0; (iCount > 0) && (iLen < (iBufLen - 1)); iLen++)
+	{
+		pcBuf[iLen] = pcDigits[--iCount];
+	}
+	if(iBufLen > 0)
+	{
+		pcBuf[iLen] = 0;
+	}
+
+	return(iLen);
+}
+
+#if WS_SNTP_POLL_S
+static uint32_t timeGet32(const uint8_t *pui8Data)
+{
+	return(((uint32_t)pui8Data[0] << 24) | ((uint32_t)pui8Data[1] << 16) |
+		   ((uint32_t)pui8Data[2] << 8) | pui8Data[3]);
+}
+
+static void timePut32(uint8_t *pui8Data, uint32_t ui32Value)
+{
+	pui8Data[0] = (uint8_t)(ui32Value >> 24);
+	pui8Data[1] = (uint8_t)(ui32Value >> 16);
+	pui8Data[2] = (uint8_t)(ui32Value >> 8);
+	pui8Data[3] = (uint8_t)ui32Value;
+}
+
+/* NTP timestamp to Unix microseconds */
+static uint64_t timeNtpToUnixUs(const uint8_t *pui8Stamp)
+{
+	uint32_t ui32Seconds = timeGet32(pui8Stamp);
+	uint32_t ui32Fraction = timeGet32(pui8Stamp + 4);
+
+	return((uint64_t)(ui32Seconds - WS_NTP_UNIX_OFFSET) * 1000000u +
+		   (((uint64_t)ui32Fraction * 1000000u) >> 32));
+}
+
+static void timeReceive(void *pvArg, struct udp_pcb *psPcb, struct pbuf *p, ip_addr_t *psAddr,
+						u16_t ui16Port)
+{
+	uint8_t pui8Msg[SNTP_MSG_LEN];
+	uint64_t ui64NowUs = tickNowUs();
+	uint64_t ui64ReceiveUs, ui64TransmitUs, ui64ServerUs;
+
+	if((pbuf_copy_partial(p, pui8Msg, SNTP_MSG_LEN, 0) != SNTP_MSG_LEN) || !TimeRequestUs)
+	{
+		pbuf_free(p);
+		return;
+	}
+	pbuf_free(p);
+
+	/* A server answer, synchronized (stratum set), to the open request:
+	 * the originate field echoes the transmit field that was sent */
+	if(((pui8Msg[0] & SNTP_MODE_M) != SNTP_MODE_SERVER) || (pui8Msg[1] == 0) ||
+	   (timeGet32(pui8Msg + SNTP_ORIGINATE) != (uint32_t)(TimeRequestUs >> 32)) ||
+	   (timeGet32(pui8Msg + SNTP_ORIGINATE + 4) != (uint32_t)TimeRequestUs))
+	{
+		return;
+	}
+
+	/* Half of the round trip, less the time the server held the request,
+	 * passed since the server sent its answer */
+	ui64ReceiveUs = timeNtpToUnixUs(pui8Msg + SNTP_RECEIVE);
+	ui64TransmitUs = timeNtpToUnixUs(pui8Msg + SNTP_TRANSMIT);
+	ui64ServerUs = ui64TransmitUs - ui64ReceiveUs;
+	if(ui64ServerUs > (ui64NowUs - TimeRequestUs))
+	{
+		ui64ServerUs = ui64NowUs - TimeRequestUs;
+	}
+	timeSet(ui64TransmitUs + (ui64NowUs - TimeRequestUs - ui64ServerUs) / 2, ui64NowUs);
+
+	TimeRequestUs = 0;
+	TimeWaitMs = WS_SNTP_POLL_S * 1000u;
+}
+
+static void timeRequest(void)
+{
+	ip_addr_t sServer;
+	struct pbuf *p;
+	uint8_t *pui8Msg;
+
+#ifdef WS_SNTP_SERVER
+	WS_SNTP_SERVER(&sServer);
+#else
+	/* No address before DHCP finished */
+	if(!netif_default || ip_addr_isany(&netif_default->gw))
+	{
+		return;
+	}
+	ip_addr_copy(sServer, netif_default->gw);
+#endif
+
+	if(!TimePcb)
+	{
+		TimePcb = udp_new();
+		if(!TimePcb)
+		{
+			return;
+		}
+		udp_recv(TimePcb, timeReceive, NULL);
+	}
+
+	p = pbuf_alloc(PBUF_TRANSPORT, SNTP_MSG_LEN, PBUF_RAM);
+	if(!p)
+	{
+		return;
+	}
+
+	/* The transmit field carries the send time, the answer echoes it */
+	TimeRequestUs = tickNowUs();
+	pui8Msg = p->payload;
+	memset(pui8Msg, 0, SNTP_MSG_LEN);
+	pui8Msg[0] = SNTP_MODE_CLIENT;
+	timePut32(pui8Msg + SNTP_TRANSMIT, (uint32_t)(TimeRequestUs >> 32));
+	timePut32(pui8Msg + SNTP_TRANSMIT + 4, (uint32_t)TimeRequestUs);
+
+	udp_sendto(TimePcb, p, &sServer, WS_SNTP_PORT);
+	pbuf_free(p);
+}
+#endif
+
+void timeTick(uint32_t ui32ElapsedMs)
+{
+#if WS_SNTP_POLL_S
+	if(TimeWaitMs > ui32ElapsedMs)
+	{
+		TimeWaitMs -= ui32ElapsedMs;
+		return;
+	}
+
+	/* An unanswered request is dropped by the next one */
+	TimeWaitMs = (TimeValid ? WS_SNTP_POLL_S : WS_SNTP_RETRY_S) * 1000u;
+	timeRequest();
+#endif
+}
@@ -0,0 +1,47 @@
+#ifndef WEATHER_STATION_WS_TIME_H_
+#define WEATHER_STATION_WS_TIME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Wall clock on top of the monotonic clock of ws_tick.h.
+ *
+ *  The wall clock is the monotonic time plus an offset. SNTP sets the
+ *  offset: a request goes to the server every WS_SNTP_POLL_S seconds, or
+ *  every WS_SNTP_RETRY_S seconds until the first answer. The server defaults
+ *  to the gateway DHCP handed out, build with
+ *
+ *      WS_SNTP_SERVER(a)=IP4_ADDR((a),192,168,1,1)
+ *
+ *  to name one, or with WS_SNTP_POLL_S=0 to leave the wall clock unset. */
+//*****************************************************************************
+
+#ifndef WS_SNTP_POLL_S
+#define WS_SNTP_POLL_S			3600
+#endif
+
+#define WS_SNTP_RETRY_S			16
+#define WS_SNTP_PORT			123
+
+/* Seconds from 1900 (NTP era 0) to 1970 (Unix epoch) */
+#define WS_NTP_UNIX_OFFSET		2208988800u
+
+/* Drive SNTP, called from lwIPHostTimerHandler */
+void timeTick(uint32_t ui32ElapsedMs);
+
+/* True once the wall clock was set */
+bool timeSynced(void);
+
+/* Wall clock time of a tickNowUs time, microseconds since 1970. False while
+ * the wall clock is not set. */
+bool timeUnixUs(uint64_t ui64MonoUs, uint64_t *pui64UnixUs);
+
+/* Set the wall clock: ui64UnixUs was the time at ui64MonoUs */
+void timeSet(uint64_t ui64UnixUs, uint64_t ui64MonoUs);
+
+/* Prints a 64 bit unsigned value in decimal, ustdlib has no long long
+ * conversions. Returns the length. */
+int timeFormatU64(char *pcBuf, int iBufLen, uint64_t ui64Value);
+
+#endif /* WEATHER_STATION_WS_TIME_H_ */
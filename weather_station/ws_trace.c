@@ -0,0 +1,213 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/i2c.h"
+#include "utils/ustdlib.h"
+
+#include "ws_cycles.h"
+#include "ws_trace.h"
+
+/* Worst case size of an encoded record */
+#define TRACE_MAX_RECORD		(1 + 5 + 1 + 2 * (1 + WS_TRACE_MAX_DATA))
+
+static uint8_t TraceBuf[WS_TRACE_BUF_SIZE];
+static uint32_t TraceLen;
+static uint32_t TraceRecords;
+static volatile bool TraceCapturing;
+static bool TraceFull;
+
+/* Time base: cycles not yet counted as a whole microsecond carry over */
+static uint32_t TraceLastCycles;
+static uint32_t TraceCycleRest;
+static uint32_t TraceTimeUs;
+static int32_t TraceLastDelta;
+
+static uint32_t traceVarint(uint8_t *pui8Out, uint32_t ui32Value)
+{
+	uint32_t ui32Len = 0;
+
+	while(ui32Value >= 0x80)
+	{
+		pui8Out[ui32Len++] = (uint8_t)(ui32Value | 0x80);
+		ui32Value >>= 7;
+	}
+	pui8Out[ui32Len++] = (uint8_t)ui32Value;
+
+	return(ui32Len);
+}
+
+/* Small magnitudes of either sign to small unsigned values */
+static uint32_t traceZigzag(int32_t i32Value)
+{
+	return(((uint32_t)i32Value << 1) ^ (uint32_t)(i32Value >> 31));
+}
+
+static uint32_t traceBytes(uint8_t *pui8Out, const uint8_t *pui8Data, uint32_t ui32Count)
+{
+	uint32_t ui32Len = traceVarint(pui8Out, ui32Count);
+
+	memcpy(pui8Out + ui32Len, pui8Data, ui32Count);
+	return(ui32Len + ui32Count);
+}
+
+void traceStart(void)
+{
+	TraceCapturing = false;
+
+	memcpy(TraceBuf, WS_TRACE_MAGIC, 4);
+	TraceBuf[4] = WS_TRACE_VERSION;
+	TraceBuf[5] = 0;
+	TraceBuf[6] = 0;
+	TraceBuf[7] = 0;
+	TraceLen = WS_TRACE_HEADER_SIZE;
+	TraceRecords = 0;
+	TraceFull = false;
+
+	TraceLastCycles = cyclesGet();
+	TraceCycleRest = 0;
+	TraceTimeUs = 0;
+	TraceLastDelta = 0;
+
+	TraceCapturing = true;
+}
+
+void traceStop(void)
+{
+	TraceCapturing = false;
+}
+
+bool traceCapturing(void)
+{
+	return(TraceCapturing);
+}
+
+const uint8_t *traceData(uint32_t *pui32Len)
+{
+	*pui32Len = TraceLen;
+	return(TraceBuf);
+}
+
+int traceFormatStatus(char *pcBuf, int iBufLen)
+{
+	return(usnprintf(pcBuf, iBufLen,
+					 "{\"capturing\":%s,\"full\":%s,\"records\":%u,\"bytes\":%u,\"timeUs\":%u}",
+					 TraceCapturing ? "true" : "false", TraceFull ? "true" : "false",
+					 TraceRecords, TraceLen, TraceTimeUs));
+}
+
+void traceRecord(uint32_t ui32Bus, uint8_t ui8Addr, const uint8_t *pui8Write,
+				 uint32_t ui32WriteCount, const uint8_t *pui8Read, uint32_t ui32ReadCount,
+				 uint8_t ui8Status)
+{
+	uint8_t *pui8Out;
+	uint32_t ui32Cycles, ui32Delta;
+	int32_t i32Delta;
+
+	if(!TraceCapturing)
+	{
+		return;
+	}
+	if((WS_TRACE_BUF_SIZE - TraceLen) < TRACE_MAX_RECORD)
+	{
+		TraceFull = true;
+		TraceCapturing = false;
+		return;
+	}
+
+	ui32Cycles = cyclesGet();
+	TraceCycleRest += ui32Cycles - TraceLastCycles;
+	TraceLastCycles = ui32Cycles;
+	ui32Delta = TraceCycleRest / WS_CYCLES_PER_US;
+	TraceCycleRest -= ui32Delta * WS_CYCLES_PER_US;
+	TraceTimeUs += ui32Delta;
+
+	if(ui32WriteCount > WS_TRACE_MAX_DATA)
+	{
+		ui32WriteCount = WS_TRACE_MAX_DATA;
+	}
+	if(ui32ReadCount > WS_TRACE_MAX_DATA)
+	{
+		ui32ReadCount = WS_TRACE_MAX_DATA;
+	}
+
+	pui8Out = TraceBuf + TraceLen;
+	*pui8Out = (ui32Bus & WS_TRACE_TAG_BUS_M) |
+			   ((ui8Status << WS_TRACE_TAG_STATUS_S) & WS_TRACE_TAG_STATUS_M) |
+			   (ui32WriteCount ? WS_TRACE_TAG_WRITE : 0) | (ui32ReadCount ? WS_TRACE_TAG_READ : 0);
+	pui8Out++;
+
+	i32Delta = (int32_t)ui32Delta;
+	pui8Out += traceVarint(pui8Out, traceZigzag(i32Delta - TraceLastDelta));
+	TraceLastDelta = i32Delta;
+
+	*pui8Out++ = ui8Addr;
+	if(ui32WriteCount)
+	{
+		pui8Out += traceBytes(pui8Out, pui8Write, ui32WriteCount);
+	}
+	if(ui32ReadCount)
+	{
+		pui8Out += traceBytes(pui8Out, pui8Read, ui32ReadCount);
+	}
+
+	TraceLen = pui8Out - TraceBuf;
+	TraceRecords++;
+}
+
+void traceI2CBefore(WS_TraceI2C_t *psTrace, const tI2CMInstance *psInst)
+{
+	const tI2CMCommand *psCommand;
+	uint32_t ui32Err;
+
+	psTrace->bActive = TraceCapturing && (psInst->ui8ReadPtr != psInst->ui8WritePtr);
+	if(!psTrace->bActive)
+	{
+		return;
+	}
+
+	/* The callback may reuse the write buffer for its next command, copy
+	 * it while it still holds what was sent */
+	psCommand = &psInst->pCommands[psInst->ui8ReadPtr];
+	psTrace->ui8ReadPtr = psInst->ui8ReadPtr;
+	psTrace->ui8Addr = psCommand->ui8Addr;
+	psTrace->ui8WriteCount = (psCommand->ui16WriteCount < WS_TRACE_MAX_SNAP) ?
+							 psCommand->ui16WriteCount : WS_TRACE_MAX_SNAP;
+	memcpy(psTrace->pui8Write, psCommand->pui8WriteData, psTrace->ui8WriteCount);
+	psTrace->pui8Read = psCommand->pui8ReadData;
+	psTrace->ui8ReadCount = (psCommand->ui16ReadCount < WS_TRACE_MAX_DATA) ?
+							psCommand->ui16ReadCount : WS_TRACE_MAX_DATA;
+
+	/* The handler clears the error, the status the callback gets follows it */
+	ui32Err = I2CMasterErr(psInst->ui32Base);
+	if(ui32Err & I2C_MASTER_ERR_ADDR_ACK)
+	{
+		psTrace->ui8Status = I2CM_STATUS_ADDR_NACK;
+	}
+	else if(ui32Err & I2C_MASTER_ERR_DATA_ACK)
+	{
+		psTrace->ui8Status = I2CM_STATUS_DATA_NACK;
+	}
+	else if(ui32Err & I2C_MASTER_ERR_ARB_LOST)
+	{
+		psTrace->ui8Status = I2CM_STATUS_ARB_LOST;
+	}
+	else
+	{
+		psTrace->ui8Status = I2CM_STATUS_SUCCESS;
+	}
+}
+
+void traceI2CAfter(const WS_TraceI2C_t *psTrace, const tI2CMInstance *psInst, uint32_t ui32Bus)
+{
+	/* The driver moves on to the next command once one completed */
+	if(!psTrace->bActive || (psInst->ui8ReadPtr == psTrace->ui8ReadPtr))
+	{
+		return;
+	}
+
+	traceRecord(ui32Bus, psTrace->ui8Addr, psTrace->pui8Write, psTrace->ui8WriteCount,
+				psTrace->pui8Read, (psTrace->ui8Status == I2CM_STATUS_SUCCESS) ?
+				psTrace->ui8ReadCount : 0, psTrace->ui8Status);
+}
@@ -0,0 +1,118 @@
+#ifndef WEATHER_STATION_WS_TRACE_H_
+#define WEATHER_STATION_WS_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sensorlib/i2cm_drv.h"
+
+//*****************************************************************************
+/*  Sensor I2C trace capture.
+ *
+ *  While a capture runs every completed sensor transaction is appended to a
+ *  RAM buffer: bus, address, status, the bytes written, the bytes read back
+ *  and when it completed. The host build replays such a trace in place of
+ *  the sensors (host/sim_trace.c), so the acquisition path can be measured
+ *  and compared on identical input.
+ *
+ *  The trace is an 8 byte header ("WSTR", version, 3 reserved bytes)
+ *  followed by the records:
+ *
+ *      tag      bits 0-1 bus, bits 2-4 I2CM status, bit 5 write data
+ *               follows, bit 6 read data follows
+ *      time     zigzag varint, change of the time since the previous record
+ *               against the one before, in us. Periodic sampling encodes in
+ *               one byte.
+ *      address  7 bit I2C address
+ *      write    varint count, bytes (if bit 5)
+ *      read     varint count, bytes (if bit 6)
+ *
+ *  The capture stops by itself when the buffer is full. Transactions are
+ *  recorded from the I2C interrupts, which run at one priority and so never
+ *  preempt each other; the time base is the DWT counter, records have to be
+ *  less than 2^32 cycles (~35 s) apart. */
+//*****************************************************************************
+
+#ifndef WS_TRACE_BUF_SIZE
+#define WS_TRACE_BUF_SIZE		32768
+#endif
+
+#define WS_TRACE_MAGIC			"WSTR"
+#define WS_TRACE_VERSION		1
+#define WS_TRACE_HEADER_SIZE	8
+
+/* Data bytes kept per direction, longer transfers are cut */
+#define WS_TRACE_MAX_DATA		32
+
+/* Write bytes copied by traceI2CBefore, sensor commands are a register
+ * address and a few bytes at most */
+#define WS_TRACE_MAX_SNAP		8
+
+#define WS_TRACE_TAG_BUS_M		0x03
+#define WS_TRACE_TAG_STATUS_S	2
+#define WS_TRACE_TAG_STATUS_M	0x1C
+#define WS_TRACE_TAG_WRITE		0x20
+#define WS_TRACE_TAG_READ		0x40
+
+/* A decoded record */
+typedef struct {
+	uint32_t ui32TimeUs;		/* Since the start of the capture */
+	uint8_t ui8Bus;
+	uint8_t ui8Addr;
+	uint8_t ui8Status;
+	uint8_t ui8WriteCount;
+	uint8_t ui8ReadCount;
+	uint8_t pui8Write[WS_TRACE_MAX_DATA];
+	uint8_t pui8Read[WS_TRACE_MAX_DATA];
+}WS_TraceRecord_t;
+
+typedef struct {
+	const uint8_t *pui8Data;
+	uint32_t ui32Len;
+	uint32_t ui32Pos;
+	uint32_t ui32TimeUs;
+	int32_t i32LastDelta;
+}WS_TraceReader_t;
+
+/* Command in progress on a bus, taken before the I2CM interrupt handler */
+typedef struct {
+	bool bActive;
+	uint8_t ui8ReadPtr;
+	uint8_t ui8Addr;
+	uint8_t ui8Status;
+	uint8_t ui8WriteCount;
+	uint8_t ui8ReadCount;
+	uint8_t *pui8Read;
+	uint8_t pui8Write[WS_TRACE_MAX_SNAP];
+}WS_TraceI2C_t;
+
+/* Start a new capture, the previous trace is dropped */
+void traceStart(void);
+
+/* Stop the capture, the trace stays readable */
+void traceStop(void);
+
+bool traceCapturing(void);
+
+/* The trace captured so far */
+const uint8_t *traceData(uint32_t *pui32Len);
+
+/* Capture state as JSON, returns the length */
+int traceFormatStatus(char *pcBuf, int iBufLen);
+
+/* Append a transaction, ignored unless a capture runs */
+void traceRecord(uint32_t ui32Bus, uint8_t ui8Addr, const uint8_t *pui8Write,
+				 uint32_t ui32WriteCount, const uint8_t *pui8Read, uint32_t ui32ReadCount,
+				 uint8_t ui8Status);
+
+/* Call around I2CMIntHandler: a command that completed in the handler is
+ * recorded. Cheap when no capture runs. */
+void traceI2CBefore(WS_TraceI2C_t *psTrace, const tI2CMInstance *psInst);
+void traceI2CAfter(const WS_TraceI2C_t *psTrace, const tI2CMInstance *psInst, uint32_t ui32Bus);
+
+/* Decoding, see ws_trace_decode.c. Init fails on a bad header, Next at the
+ * end of the trace or on a truncated record. */
+bool traceReaderInit(WS_TraceReader_t *psReader, const uint8_t *pui8Data, uint32_t ui32Len);
+bool traceReaderNext(WS_TraceReader_t *psReader, WS_TraceRecord_t *psRecord);
+
+#endif /* WEATHER_STATION_WS_TRACE_H_ */
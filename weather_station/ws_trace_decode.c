@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ws_trace.h"
+
+//*****************************************************************************
+/*  Decoder of the sensor I2C trace, used by the host replay and tools. It has
+ *  no hardware dependency. */
+//*****************************************************************************
+
+static bool traceReadVarint(WS_TraceReader_t *psReader, uint32_t *pui32Value)
+{
+	uint32_t ui32Shift = 0;
+	uint8_t ui8Byte;
+
+	*pui32Value = 0;
+	do
+	{
+		if((psReader->ui32Pos >= psReader->ui32Len) || (ui32Shift > 28))
+		{
+			return(false);
+		}
+		ui8Byte = psReader->pui8Data[psReader->ui32Pos++];
+		*pui32Value |= (uint32_t)(ui8Byte & 0x7F) << ui32Shift;
+		ui32Shift += 7;
+	}
+	while(ui8Byte & 0x80);
+
+	return(true);
+}
+
+static bool traceReadBytes(WS_TraceReader_t *psReader, uint8_t *pui8Out, uint8_t *pui8Count)
+{
+	uint32_t ui32Count;
+
+	if(!traceReadVarint(psReader, &ui32Count) || (ui32Count > WS_TRACE_MAX_DATA) ||
+	   (ui32Count > (psReader->ui32Len - psReader->ui32Pos)))
+	{
+		return(false);
+	}
+
+	memcpy(pui8Out, psReader->pui8Data + psReader->ui32Pos, ui32Count);
+	psReader->ui32Pos += ui32Count;
+	*pui8Count = (uint8_t)ui32Count;
+
+	return(true);
+}
+
+bool traceReaderInit(WS_TraceReader_t *psReader, const uint8_t *pui8Data, uint32_t ui32Len)
+{
+	if((ui32Len < WS_TRACE_HEADER_SIZE) || memcmp(pui8Data, WS_TRACE_MAGIC, 4) ||
+	   (pui8Data[4] != WS_TRACE_VERSION))
+	{
+		return(false);
+	}
+
+	psReader->pui8Data = pui8Data;
+	psReader->ui32Len = ui32Len;
+	psReader->ui32Pos = WS_TRACE_HEADER_SIZE;
+	psReader->ui32TimeUs = 0;
+	psReader->i32LastDelta = 0;
+
+	return(true);
+}
+
+bool traceReaderNext(WS_TraceReader_t *psReader, WS_TraceRecord_t *psRecord)
+{
+	uint32_t ui32Zigzag;
+	uint8_t ui8Tag;
+
+	if((psReader->ui32Len - psReader->ui32Pos) < 3)
+	{
+		return(false);
+	}
+
+	ui8Tag = psReader->pui8Data[psReader->ui32Pos++];
+	if(!traceReadVarint(psReader, &ui32Zigzag) || (psReader->ui32Pos >= psReader->ui32Len))
+	{
+		return(false);
+	}
+
+	/* Undo the zigzag, then the delta of deltas */
+	psReader->i32LastDelta += (int32_t)(ui32Zigzag >> 1) ^ -(int32_t)(ui32Zigzag & 1);
+	psReader->ui32TimeUs += (uint32_t)psReader->i32LastDelta;
+
+	psRecord->ui32TimeUs = psReader->ui32TimeUs;
+	psRecord->ui8Bus = ui8Tag & WS_TRACE_TAG_BUS_M;
+	psRecord->ui8Status = (ui8Tag & WS_TRACE_TAG_STATUS_M) >> WS_TRACE_TAG_STATUS_S;
+	psRecord->ui8Addr = psReader->pui8Data[psReader->ui32Pos++];
+	psRecord->ui8WriteCount = 0;
+	psRecord->ui8ReadCount = 0;
+
+	if((ui8Tag & WS_TRACE_TAG_WRITE) &&
+	   !traceReadBytes(psReader, psRecord->pui8Write, &psRecord->ui8WriteCount))
+	{
+		return(false);
+	}
+	if((ui8Tag & WS_TRACE_TAG_READ) &&
+	   !traceReadBytes(psReader, psRecord->pui8Read, &psRecord->ui8ReadCount))
+	{
+		return(false);
+	}
+
+	return(true);
+}
@@ -0,0 +1,178 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ws_trend.h"
+
+WS_Trend_t PressureTrend;
+
+/* Zambretti forecasts indexed by Z - 1. Z 1..9 belong to falling pressure,
+ * 10..19 to steady and 20..32 to rising pressure. */
+static const struct {
+	char cLetter;
+	const char *pcText;
+}ZambrettiTable[32] =
+{
+	{ 'A', "Settled fine" },
+	{ 'B', "Fine weather" },
+	{ 'D', "Fine, becoming less settled" },
+	{ 'H', "Fairly fine, showery later" },
+	{ 'O', "Showery, becoming more unsettled" },
+	{ 'R', "Unsettled, rain later" },
+	{ 'U', "Rain at times, worse later" },
+	{ 'X', "Rain at times, becoming very unsettled" },
+	{ 'Z', "Very unsettled, rain" },
+	{ 'A', "Settled fine" },
+	{ 'B', "Fine weather" },
+	{ 'E', "Fine, possibly showers" },
+	{ 'K', "Fairly fine, showers likely" },
+	{ 'N', "Showery, bright intervals" },
+	{ 'P', "Changeable, some rain" },
+	{ 'S', "Unsettled, rain at times" },
+	{ 'W', "Rain at frequent intervals" },
+	{ 'X', "Very unsettled, rain" },
+	{ 'Z', "Stormy, much rain" },
+	{ 'A', "Settled fine" },
+	{ 'B', "Fine weather" },
+	{ 'C', "Becoming fine" },
+	{ 'F', "Fairly fine, improving" },
+	{ 'G', "Fairly fine, possibly showers early" },
+	{ 'I', "Showery early, improving" },
+	{ 'J', "Changeable, mending" },
+	{ 'L', "Rather unsettled, clearing later" },
+	{ 'M', "Unsettled, probably improving" },
+	{ 'Q', "Unsettled, short fine intervals" },
+	{ 'T', "Very unsettled, finer at times" },
+	{ 'Y', "Stormy, possibly improving" },
+	{ 'Z', "Stormy, much rain" }
+};
+
+/* Push one minute mean into the ring and update the regression sums */
+static void trendPushMinute(WS_Trend_t *psTrend, int32_t i32Value)
+{
+	int32_t i32Oldest;
+
+	if(psTrend->ui32Count < WS_TREND_WINDOW_MIN)
+	{
+		/* The new value lands at x = n */
+		psTrend->i64SumXY += (int64_t)psTrend->ui32Count * i32Value;
+		psTrend->i64SumY += i32Value;
+		psTrend->pi32Minutes[(psTrend->ui32Head + psTrend->ui32Count) % WS_TREND_WINDOW_MIN] = i32Value;
+		psTrend->ui32Count++;
+		return;
+	}
+
+	/* Every remaining value moves one position towards x = 0, the oldest
+	 * leaves and the new one lands at x = n - 1:
+	 * Sxy' = Sxy - (Sy - y0) + (n - 1) * ynew */
+	i32Oldest = psTrend->pi32Minutes[psTrend->ui32Head];
+	psTrend->i64SumXY -= psTrend->i64SumY - i32Oldest;
+	psTrend->i64SumXY += (int64_t)(WS_TREND_WINDOW_MIN - 1) * i32Value;
+	psTrend->i64SumY += (int64_t)i32Value - i32Oldest;
+
+	psTrend->pi32Minutes[psTrend->ui32Head] = i32Value;
+	psTrend->ui32Head = (psTrend->ui32Head + 1) % WS_TREND_WINDOW_MIN;
+}
+
+void trendAddSample(WS_Trend_t *psTrend, uint32_t ui32TimeMs, float fPressure)
+{
+	if(!psTrend->bStarted)
+	{
+		psTrend->bStarted = true;
+		psTrend->ui32PeriodStartMs = ui32TimeMs;
+	}
+
+	/* Close the finished minute, a gap without samples does not create
+	 * minutes, the fit stays over the minutes that were measured. */
+	if((ui32TimeMs - psTrend->ui32PeriodStartMs) >= WS_TREND_PERIOD_MS)
+	{
+		if(psTrend->ui32PeriodCount)
+		{
+			trendPushMinute(psTrend, (int32_t)(psTrend->i64PeriodSum / psTrend->ui32PeriodCount));
+		}
+		psTrend->i64PeriodSum = 0;
+		psTrend->ui32PeriodCount = 0;
+		psTrend->ui32PeriodStartMs += ((ui32TimeMs - psTrend->ui32PeriodStartMs) / WS_TREND_PERIOD_MS) * WS_TREND_PERIOD_MS;
+	}
+
+	psTrend->i64PeriodSum += (int32_t)(fPressure + 0.5f);
+	psTrend->ui32PeriodCount++;
+}
+
+void trendGet(const WS_Trend_t *psTrend, float fSeaLevelPressure, WS_TrendResult_t *psResult)
+{
+	int64_t i64N, i64SumX, i64SumXX, i64Den;
+	float fSlope;
+	int32_t i32Z;
+	int32_t i32HPa;
+
+	psResult->ui32Minutes = psTrend->ui32Count;
+	psResult->eTendency = WS_TrendUnknown;
+	psResult->fChange3h = 0.0f;
+	psResult->cZambretti = 0;
+	psResult->pcForecast = "Unknown";
+
+	if(psTrend->ui32Count < WS_TREND_MIN_SAMPLES)
+	{
+		return;
+	}
+
+	/* Closed forms of the x sums over 0..n-1 */
+	i64N = psTrend->ui32Count;
+	i64SumX = i64N * (i64N - 1) / 2;
+	i64SumXX = (i64N - 1) * i64N * (2 * i64N - 1) / 6;
+	i64Den = i64N * i64SumXX - i64SumX * i64SumX;
+
+	/* Slope in Pa per minute */
+	fSlope = (float)(i64N * psTrend->i64SumXY - i64SumX * psTrend->i64SumY) / (float)i64Den;
+	psResult->fChange3h = fSlope * (float)WS_TREND_WINDOW_MIN;
+
+	if(psResult->fChange3h <= -(float)WS_TREND_THRESHOLD_PA)
+	{
+		psResult->eTendency = WS_TrendFalling;
+	}
+	else if(psResult->fChange3h >= (float)WS_TREND_THRESHOLD_PA)
+	{
+		psResult->eTendency = WS_TrendRising;
+	}
+	else
+	{
+		psResult->eTendency = WS_TrendSteady;
+	}
+
+	/* Zambretti number from the sea-level pressure in hPa, the ranges of
+	 * the three formulas are clamped to their part of the table. */
+	i32HPa = (int32_t)(fSeaLevelPressure * 0.01f + 0.5f);
+	switch(psResult->eTendency)
+	{
+		case WS_TrendFalling:
+			i32Z = 127 - (i32HPa * 12) / 100;
+			i32Z = (i32Z < 1) ? 1 : ((i32Z > 9) ? 9 : i32Z);
+			break;
+		case WS_TrendRising:
+			i32Z = 185 - (i32HPa * 16) / 100;
+			i32Z = (i32Z < 20) ? 20 : ((i32Z > 32) ? 32 : i32Z);
+			break;
+		default:
+			i32Z = 144 - (i32HPa * 13) / 100;
+			i32Z = (i32Z < 10) ? 10 : ((i32Z > 19) ? 19 : i32Z);
+			break;
+	};
+
+	psResult->cZambretti = ZambrettiTable[i32Z - 1].cLetter;
+	psResult->pcForecast = ZambrettiTable[i32Z - 1].pcText;
+}
+
+const char *trendTendencyName(WS_Tendency_t eTendency)
+{
+	switch(eTendency)
+	{
+		case WS_TrendFalling:
+			return("falling");
+		case WS_TrendSteady:
+			return("steady");
+		case WS_TrendRising:
+			return("rising");
+		default:
+			return("unknown");
+	};
+}
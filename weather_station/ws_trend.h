@@ -0,0 +1,68 @@
+#ifndef WEATHER_STATION_WS_TREND_H_
+#define WEATHER_STATION_WS_TREND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+/*  Barometric tendency and Zambretti forecast.
+ *
+ *  Pressure samples are averaged into one value per minute, the last three
+ *  hours of minute values are kept in a ring. A least squares line is fitted
+ *  over the ring, its sums are updated in O(1) whenever a minute enters and
+ *  an old one leaves, so the history is never rescanned. The sums are kept in
+ *  integers, adding and removing the same values leaves no rounding drift. */
+//*****************************************************************************
+
+#define WS_TREND_WINDOW_MIN		180		/* Regression window, minutes */
+#define WS_TREND_MIN_SAMPLES	30		/* Minutes needed for a tendency */
+#define WS_TREND_PERIOD_MS		60000u	/* Decimation period */
+
+/* Change over three hours that counts as rising or falling, Pa */
+#define WS_TREND_THRESHOLD_PA	160
+
+typedef enum {
+	WS_TrendUnknown		= 0x00u,	/* Not enough history yet */
+	WS_TrendFalling		= 0x01u,
+	WS_TrendSteady		= 0x02u,
+	WS_TrendRising		= 0x03u
+}WS_Tendency_t;
+
+typedef struct {
+	/* Per minute decimation */
+	uint32_t ui32PeriodStartMs;
+	int64_t i64PeriodSum;			/* Sum of the samples in the current minute, Pa */
+	uint32_t ui32PeriodCount;
+	bool bStarted;
+
+	/* Ring of minute means, oldest at ui32Head once full */
+	int32_t pi32Minutes[WS_TREND_WINDOW_MIN];
+	uint32_t ui32Head;
+	uint32_t ui32Count;
+
+	/* Regression sums over the ring, x is the position from the oldest */
+	int64_t i64SumY;
+	int64_t i64SumXY;
+}WS_Trend_t;
+
+typedef struct {
+	WS_Tendency_t eTendency;
+	float fChange3h;				/* Fitted change over three hours, Pa */
+	uint32_t ui32Minutes;			/* History behind the fit */
+	char cZambretti;				/* Forecast letter 'A'..'Z', 0 if unknown */
+	const char *pcForecast;			/* Forecast text */
+}WS_TrendResult_t;
+
+/* Trend of the station's sea-level pressure */
+extern WS_Trend_t PressureTrend;
+
+/* Add a pressure sample (Pa) taken at ui32TimeMs. */
+void trendAddSample(WS_Trend_t *psTrend, uint32_t ui32TimeMs, float fPressure);
+
+/* Evaluate the tendency and the forecast for the given sea-level pressure. */
+void trendGet(const WS_Trend_t *psTrend, float fSeaLevelPressure, WS_TrendResult_t *psResult);
+
+/* Name of a tendency */
+const char *trendTendencyName(WS_Tendency_t eTendency);
+
+#endif /* WEATHER_STATION_WS_TREND_H_ */